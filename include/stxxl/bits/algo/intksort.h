@@ -15,7 +15,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <vector>
 #include <stxxl/bits/common/types.h>
+#include <stxxl/bits/common/utils.h>
 #include <stxxl/bits/unused.h>
 #include <stxxl/bits/parallel.h>
 
@@ -362,6 +364,208 @@ void classify_block(Type* begin, Type* end, TypeKey*& out, int_type* bucket, typ
     STXXL_UNUSED(K);
 }
 
+//! Extracts the key of a (key, pointer) pair as used by the integer sorters.
+template <typename TypeKey>
+struct type_key_extractor
+{
+    typedef typename TypeKey::key_type key_type;
+
+    key_type operator () (const TypeKey& a) const
+    {
+        return a.key;
+    }
+};
+
+//! Minimum number of elements per thread in radix_sort_lsd().
+static const int_type radix_sort_min_per_thread = 1 << 16;
+
+//! Returns the bits in which the unsigned integer keys returned by keyobj
+//! for [begin, end) differ.
+template <typename Type, typename KeyExtractor>
+typename KeyExtractor::key_type
+differing_key_bits(const Type* begin, const Type* end, KeyExtractor keyobj)
+{
+    typedef typename KeyExtractor::key_type key_type;
+
+    const int_type n = end - begin;
+    key_type all_or = key_type(0), all_and = key_type(~key_type(0));
+#if STXXL_PARALLEL
+    const int num_threads = (int)STXXL_MAX(int_type(1), STXXL_MIN(int_type(omp_get_max_threads()), n / radix_sort_min_per_thread));
+#pragma omp parallel for num_threads(num_threads) reduction(| : all_or) reduction(& : all_and)
+#endif
+    for (int_type i = 0; i < n; ++i)
+    {
+        key_type key = keyobj(begin[i]);
+        all_or |= key;
+        all_and &= key;
+    }
+    return key_type(all_or ^ all_and);
+}
+
+//! Returns true if radix_sort_lsd() is expected to be faster than the two
+//! level most significant digit classification of ksort for keys which
+//! differ in the given bits. The former needs one pass per byte in which the
+//! keys differ and hence only pays off if at most half of the bytes differ.
+template <typename KeyType>
+bool prefer_radix_sort_lsd(KeyType differ)
+{
+    unsigned passes = 0;
+    for (unsigned shift = 0; shift < sizeof(KeyType) * 8; shift += 8)
+        if ((differ >> shift) & KeyType(0xff))
+            ++passes;
+
+    return passes <= 4;
+}
+
+//! Least significant digit radix sort of [begin, end) by the unsigned
+//! integer keys returned by keyobj, using [tmp, tmp + (end - begin)) as
+//! scratch space. The sort is stable. Only the bytes which differ between
+//! the keys (see differing_key_bits()) are sorted by, e.g. the upper bytes of
+//! small keys are skipped. Large inputs are split among all threads, which
+//! count their part of the input and then scatter it through small buffers
+//! per bucket, such that a thread writes whole cache lines instead of single
+//! elements to the up to 256 output positions.
+//! \return pointer to the sorted sequence, which is either begin or tmp
+template <typename Type, typename KeyExtractor>
+Type* radix_sort_lsd(Type* begin, Type* end, Type* tmp, KeyExtractor keyobj,
+                     typename KeyExtractor::key_type differ)
+{
+    typedef typename KeyExtractor::key_type key_type;
+
+    static const unsigned radix_bits = 8;
+    static const int_type K = int_type(1) << radix_bits;
+    // elements in a write combining buffer, about one cache line
+    static const int_type wc_size = (sizeof(Type) < 64) ? (64 / sizeof(Type)) : 1;
+
+    const int_type n = end - begin;
+    if (n < 2)
+        return begin;
+
+#if STXXL_PARALLEL
+    const int num_threads = (int)STXXL_MAX(int_type(1), STXXL_MIN(int_type(omp_get_max_threads()), n / radix_sort_min_per_thread));
+#else
+    const int num_threads = 1;
+#endif
+
+    std::vector<int_type> bucket(num_threads * K);
+    Type* src = begin;
+    Type* dst = tmp;
+
+    for (unsigned shift = 0; shift < sizeof(key_type) * 8; shift += radix_bits)
+    {
+        if (((differ >> shift) & key_type(K - 1)) == 0)
+            continue;
+
+#if STXXL_PARALLEL
+#pragma omp parallel num_threads(num_threads)
+#endif
+        {
+#if STXXL_PARALLEL
+            const int t = omp_get_thread_num();
+#else
+            const int t = 0;
+#endif
+            Type* chunk_begin = src + n * t / num_threads;
+            Type* chunk_end = src + n * (t + 1) / num_threads;
+            int_type* my_bucket = &bucket[t * K];
+
+            std::fill(my_bucket, my_bucket + K, 0);
+            for (Type* p = chunk_begin; p < chunk_end; ++p)
+                ++my_bucket[(keyobj(*p) >> shift) & key_type(K - 1)];
+
+#if STXXL_PARALLEL
+#pragma omp barrier
+#pragma omp single
+#endif
+            {
+                // the output of thread t follows that of threads < t in each bucket
+                int_type sum = 0;
+                for (int_type b = 0; b < K; ++b)
+                {
+                    for (int u = 0; u < num_threads; ++u)
+                    {
+                        int_type current = bucket[u * K + b];
+                        bucket[u * K + b] = sum;
+                        sum += current;
+                    }
+                }
+            }
+
+            std::vector<Type> wc(K * wc_size);
+            std::vector<int_type> wc_fill(K, 0);
+            for (Type* p = chunk_begin; p < chunk_end; ++p)
+            {
+                int_type b = (keyobj(*p) >> shift) & key_type(K - 1);
+                wc[b * wc_size + wc_fill[b]] = *p;
+                if (++wc_fill[b] == wc_size)
+                {
+                    std::copy(wc.begin() + b * wc_size, wc.begin() + (b + 1) * wc_size,
+                              dst + my_bucket[b]);
+                    my_bucket[b] += wc_size;
+                    wc_fill[b] = 0;
+                }
+            }
+            for (int_type b = 0; b < K; ++b)
+            {
+                std::copy(wc.begin() + b * wc_size, wc.begin() + b * wc_size + wc_fill[b],
+                          dst + my_bucket[b]);
+            }
+        }
+
+        std::swap(src, dst);
+    }
+
+    return src;
+}
+
+//! Least significant digit radix sort of [begin, end), see above.
+template <typename Type, typename KeyExtractor>
+Type* radix_sort_lsd(Type* begin, Type* end, Type* tmp, KeyExtractor keyobj)
+{
+    return radix_sort_lsd(begin, end, tmp, keyobj,
+                          differing_key_bits(begin, end, keyobj));
+}
+
+//! Comparison functor ordering records by the unsigned integer keys given by
+//! a key extractor as used by ksort(). Runs of stream::sort and sorter with
+//! this comparator are formed by radix_sort_lsd() instead of comparison based
+//! sorting.
+template <typename RecordType, typename KeyExtractor>
+class radix_key_cmp
+{
+public:
+    typedef RecordType value_type;
+    typedef KeyExtractor key_extractor_type;
+    typedef typename KeyExtractor::key_type key_type;
+
+protected:
+    KeyExtractor m_keyobj;
+
+public:
+    radix_key_cmp(KeyExtractor keyobj = KeyExtractor()) : m_keyobj(keyobj)
+    { }
+
+    bool operator () (const RecordType& a, const RecordType& b) const
+    {
+        return m_keyobj(a) < m_keyobj(b);
+    }
+
+    RecordType min_value() const
+    {
+        return m_keyobj.min_value();
+    }
+
+    RecordType max_value() const
+    {
+        return m_keyobj.max_value();
+    }
+
+    const KeyExtractor& key_extractor() const
+    {
+        return m_keyobj;
+    }
+};
+
 STXXL_END_NAMESPACE
 
 #endif // !STXXL_ALGO_INTKSORT_HEADER
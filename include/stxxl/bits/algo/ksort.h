@@ -247,36 +247,53 @@ create_runs(
             classify_block(Blocks1[i].begin(), Blocks1[i].end(), ref_ptr, bucket1, offset, shift1, keyobj);
         }
 
-        exclusive_prefix_sum(bucket1, k1);
-        classify(refs1, refs1 + run_size * Blocks1->size, refs2, bucket1,
-                 offset, shift1);
-
         int_type out_block = 0;
         int_type out_pos = 0;
         unsigned_type next_run_size = (k < nruns - 1) ? (runs[k + 1]->size()) : 0;
 
-        // recurse on each bucket
-        type_key_* c = refs2;
-        type_key_* d = refs1;
         BlockType* cur_blk = Blocks2;
         BlockType* end_blk = Blocks2 + next_run_size;
         write_completion_handler<BlockType, bid_type>* next_read = next_run_reads;
 
-        for (i = 0; i < k1; i++)
-        {
-            type_key_* cEnd = refs2 + bucket1[i];
-            type_key_* dEnd = refs1 + bucket1[i];
+        type_key_* refs_end = refs1 + run_size * Blocks1->size;
+        const key_type differ = differing_key_bits(refs1, refs_end, type_key_extractor<type_key_>());
 
-            l1sort(c, cEnd, d, bucket2, k2,
-                   offset + (key_type(1) << key_type(shift1)) * key_type(i), shift2);             // key_type,key_type,... paranoia
+        if (prefer_radix_sort_lsd(differ))
+        {
+            // keys do not span the whole key range or are short
+            type_key_* sorted = radix_sort_lsd(refs1, refs_end, refs2,
+                                               type_key_extractor<type_key_>(), differ);
 
             write_out(
-                d, dEnd, cur_blk, end_blk,
+                sorted, sorted + (refs_end - refs1), cur_blk, end_blk,
                 out_block, out_pos, *run, next_read, bids,
                 write_reqs, read_reqs, it, keyobj);
+        }
+        else
+        {
+            exclusive_prefix_sum(bucket1, k1);
+            classify(refs1, refs_end, refs2, bucket1, offset, shift1);
 
-            c = cEnd;
-            d = dEnd;
+            // recurse on each bucket
+            type_key_* c = refs2;
+            type_key_* d = refs1;
+
+            for (i = 0; i < k1; i++)
+            {
+                type_key_* cEnd = refs2 + bucket1[i];
+                type_key_* dEnd = refs1 + bucket1[i];
+
+                l1sort(c, cEnd, d, bucket2, k2,
+                       offset + (key_type(1) << key_type(shift1)) * key_type(i), shift2);         // key_type,key_type,... paranoia
+
+                write_out(
+                    d, dEnd, cur_blk, end_blk,
+                    out_block, out_pos, *run, next_read, bids,
+                    write_reqs, read_reqs, it, keyobj);
+
+                c = cEnd;
+                d = dEnd;
+            }
         }
 
         std::swap(Blocks1, Blocks2);
@@ -16,7 +16,12 @@
 #ifndef STXXL_ALGO_SORT_HEADER
 #define STXXL_ALGO_SORT_HEADER
 
+#include <exception>
 #include <functional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <stxxl/bits/mng/block_manager.h>
 #include <stxxl/bits/common/rand.h>
@@ -24,6 +29,7 @@
 #include <stxxl/bits/common/simple_vector.h>
 #include <stxxl/bits/common/settings.h>
 #include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/mutex.h>
 #include <stxxl/bits/mng/block_alloc_interleaved.h>
 #include <stxxl/bits/io/request_operations.h>
 #include <stxxl/bits/algo/sort_base.h>
@@ -38,6 +44,7 @@
 #include <stxxl/bits/algo/inmemsort.h>
 #include <stxxl/bits/parallel.h>
 #include <stxxl/bits/common/is_sorted.h>
+#include <stxxl/bits/stream/sort_stream.h>
 
 STXXL_BEGIN_NAMESPACE
 
@@ -48,6 +55,56 @@ STXXL_BEGIN_NAMESPACE
  */
 namespace sort_local {
 
+//! Keeps the first exception thrown in the iterations of an OpenMP loop,
+//! which must not leave the parallel region, to rethrow it after the loop.
+class parallel_exception
+{
+    mutex m_mutex;
+    bool m_caught;
+#if __cplusplus >= 201103L || (STXXL_MSVC && _MSC_VER >= 1900)
+    std::exception_ptr m_error;
+#else
+    std::string m_error;
+#endif
+
+public:
+    parallel_exception() : m_caught(false) { }
+
+    //! Stores the exception currently handled, call only in a catch block.
+    void capture()
+    {
+        scoped_mutex_lock lock(m_mutex);
+        if (m_caught)
+            return;
+        m_caught = true;
+#if __cplusplus >= 201103L || (STXXL_MSVC && _MSC_VER >= 1900)
+        m_error = std::current_exception();
+#else
+        try {
+            throw;
+        }
+        catch (std::exception& e) {
+            m_error = e.what();
+        }
+        catch (...) {
+            m_error = "unknown exception in parallel loop";
+        }
+#endif
+    }
+
+    //! Rethrows the stored exception, if any.
+    void rethrow()
+    {
+        if (!m_caught)
+            return;
+#if __cplusplus >= 201103L || (STXXL_MSVC && _MSC_VER >= 1900)
+        std::rethrow_exception(m_error);
+#else
+        throw std::runtime_error(m_error);
+#endif
+    }
+};
+
 template <typename BlockType, typename BidType>
 struct read_next_after_write_completed
 {
@@ -78,6 +135,7 @@ create_runs(
     typedef RunType run_type;
 
     typedef typename block_type::bid_type bid_type;
+    typedef typename sort_helper::run_codec_of<ValueCmp>::type codec_type;
     STXXL_VERBOSE1("stxxl::create_runs nruns=" << nruns << " m=" << _m);
 
     int_type m2 = _m / 2;
@@ -91,6 +149,9 @@ create_runs(
     request_ptr* write_reqs = new request_ptr[m2];
     read_next_after_write_completed<block_type, bid_type>* next_run_reads =
         new read_next_after_write_completed<block_type, bid_type>[m2];
+    // the runs are encoded with the codec of the comparator, if any
+    simple_vector<unsigned char> scratch(
+        codec_type::enabled ? block_codec_scratch_size<codec_type, block_type>() : 0);
 
     disk_queues::get_instance()->set_priority_op(request_queue::WRITE);
 
@@ -149,14 +210,16 @@ create_runs(
             STXXL_VERBOSE1("stxxl::create_runs posting write " << Blocks1[i].elem);
             (*run)[i].value = Blocks1[i][0];
             if (i >= runplus2size) {
-                write_reqs[i] = Blocks1[i].write((*run)[i].bid);
+                write_reqs[i] = sort_helper::write_run_block<codec_type>(
+                    Blocks1[i], (*run)[i], scratch.begin());
             }
             else
             {
                 next_run_reads[i].block = Blocks1 + i;
                 next_run_reads[i].req = read_reqs1 + i;
                 bids1[i] = next_run_reads[i].bid = *(it++);
-                write_reqs[i] = Blocks1[i].write((*run)[i].bid, next_run_reads[i]);
+                write_reqs[i] = sort_helper::write_run_block<codec_type>(
+                    Blocks1[i], (*run)[i], scratch.begin(), next_run_reads[i]);
             }
         }
         std::swap(Blocks1, Blocks2);
@@ -186,8 +249,8 @@ create_runs(
     {
         STXXL_VERBOSE1("stxxl::create_runs posting write " << Blocks1[i].elem);
         (*run)[i].value = Blocks1[i][0];
-        write_reqs[i] = Blocks1[i].write((*run)[i].bid);
     }
+    sort_helper::write_run_blocks<codec_type>(Blocks1, *run, run_size, write_reqs);
 
     STXXL_VERBOSE1("stxxl::create_runs start waiting write_reqs");
     wait_all(write_reqs, run_size);
@@ -203,6 +266,156 @@ create_runs(
     delete[] next_run_reads;
 }
 
+//! Pipelined variant of create_runs(), which is used if the memory overhead
+//! of a parallel sort is accounted for (sort_memory_usage_factor() > 1).
+//!
+//! Three buffers of _m/2 blocks are used instead of sorting in place: while
+//! run k is sorted, run k+1 is read into the second input buffer and run k-1
+//! is written from the output buffer. Run k is split into chunks which are
+//! sorted by all threads as soon as their blocks have arrived, the sorted
+//! chunks are then merged in parallel into the output buffer, and the input
+//! buffer immediately receives the reads of run k+2.
+template <
+    typename BlockType,
+    typename RunType,
+    typename InputBidIterator,
+    typename ValueCmp>
+void
+create_runs_pipelined(
+    InputBidIterator it,
+    RunType** runs,
+    int_type nruns,
+    int_type _m,
+    ValueCmp cmp)
+{
+    typedef BlockType block_type;
+    typedef RunType run_type;
+
+    typedef typename block_type::bid_type bid_type;
+    typedef typename element_iterator_traits<block_type, int_type>::element_iterator element_iterator;
+    typedef std::pair<element_iterator, element_iterator> sequence;
+    typedef typename sort_helper::run_codec_of<ValueCmp>::type codec_type;
+    STXXL_VERBOSE1("stxxl::create_runs_pipelined nruns=" << nruns << " m=" << _m);
+
+    int_type m2 = _m / 2;
+    block_manager* bm = block_manager::get_instance();
+    block_type* in_blocks[2] = { new block_type[m2], new block_type[m2] };
+    bid_type* bids[2] = { new bid_type[m2], new bid_type[m2] };
+    request_ptr* read_reqs[2] = { new request_ptr[m2], new request_ptr[m2] };
+    block_type* out_blocks = new block_type[m2];
+    request_ptr* write_reqs = new request_ptr[m2];
+
+#if STXXL_PARALLEL
+    const int_type num_threads = omp_get_max_threads();
+#else
+    const int_type num_threads = 1;
+#endif
+    // more chunks than threads, such that the sorting of the first chunks
+    // overlaps with reading the last ones
+    const int_type max_chunks = STXXL_MAX(int_type(1), 4 * num_threads);
+    std::vector<int_type> bounds(max_chunks + 1);
+    std::vector<sequence> seqs(max_chunks);
+
+    disk_queues::get_instance()->set_priority_op(request_queue::WRITE);
+
+    int_type i;
+    int_type last_write_size = 0;
+
+    for (int_type k = 0; k < STXXL_MIN(nruns, int_type(2)); ++k)
+    {
+        for (i = 0; i < int_type(runs[k]->size()); ++i)
+        {
+            bids[k][i] = *(it++);
+            read_reqs[k][i] = in_blocks[k][i].read(bids[k][i]);
+        }
+    }
+
+    for (int_type k = 0; k < nruns; ++k)
+    {
+        block_type* blocks = in_blocks[k % 2];
+        run_type* run = runs[k];
+        int_type run_size = run->size();
+        assert(run_size <= m2);
+
+        int_type num_chunks = STXXL_MIN(run_size, max_chunks);
+        for (int_type c = 0; c <= num_chunks; ++c)
+            bounds[c] = c * run_size / num_chunks;
+
+        check_sort_settings();
+
+        STXXL_VERBOSE1("stxxl::create_runs_pipelined sorting chunks of run " << k);
+        parallel_exception error;
+#if STXXL_PARALLEL
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+        for (int_type c = 0; c < num_chunks; ++c)
+        {
+            try
+            {
+                wait_all(read_reqs[k % 2] + bounds[c], bounds[c + 1] - bounds[c]);
+                std::sort(make_element_iterator(blocks, bounds[c] * block_type::size),
+                          make_element_iterator(blocks, bounds[c + 1] * block_type::size),
+                          cmp);
+            }
+            catch (...)
+            {
+                error.capture();
+            }
+        }
+        error.rethrow();
+
+        for (i = 0; i < run_size; ++i)
+            bm->delete_block(bids[k % 2][i]);
+
+        STXXL_VERBOSE1("stxxl::create_runs_pipelined start waiting write_reqs");
+        wait_all(write_reqs, last_write_size);
+        STXXL_VERBOSE1("stxxl::create_runs_pipelined finish waiting write_reqs");
+
+        for (int_type c = 0; c < num_chunks; ++c)
+        {
+            seqs[c] = std::make_pair(
+                make_element_iterator(blocks, bounds[c] * block_type::size),
+                make_element_iterator(blocks, bounds[c + 1] * block_type::size));
+        }
+        potentially_parallel::multiway_merge(
+            seqs.begin(), seqs.begin() + num_chunks,
+            make_element_iterator(out_blocks, 0),
+            run_size * block_type::size, cmp);
+
+        // the input buffer is free again
+        if (k + 2 < nruns)
+        {
+            for (i = 0; i < int_type(runs[k + 2]->size()); ++i)
+            {
+                bids[k % 2][i] = *(it++);
+                read_reqs[k % 2][i] = blocks[i].read(bids[k % 2][i]);
+            }
+        }
+
+        for (i = 0; i < run_size; ++i)
+            (*run)[i].value = out_blocks[i][0];
+        // a single run is the result, which is stored unchanged
+        if (nruns > 1)
+            sort_helper::write_run_blocks<codec_type>(out_blocks, *run, run_size, write_reqs);
+        else
+            sort_helper::write_run_blocks(out_blocks, *run, run_size, write_reqs);
+        last_write_size = run_size;
+    }
+
+    STXXL_VERBOSE1("stxxl::create_runs_pipelined start waiting write_reqs");
+    wait_all(write_reqs, last_write_size);
+    STXXL_VERBOSE1("stxxl::create_runs_pipelined finish waiting write_reqs");
+
+    for (int_type k = 0; k < 2; ++k)
+    {
+        delete[] in_blocks[k];
+        delete[] bids[k];
+        delete[] read_reqs[k];
+    }
+    delete[] out_blocks;
+    delete[] write_reqs;
+}
+
 template <typename BlockType, typename RunType, typename ValueCmp>
 bool check_sorted_runs(RunType** runs,
                        unsigned_type nruns,
@@ -211,6 +424,11 @@ bool check_sorted_runs(RunType** runs,
 {
     typedef BlockType block_type;
     typedef typename block_type::value_type value_type;
+    typedef typename RunType::value_type trigger_entry_type;
+    typedef typename sort_helper::run_codec_of<ValueCmp>::type codec_type;
+
+    simple_vector<unsigned char> scratch(
+        codec_type::enabled ? block_codec_scratch_size<codec_type, block_type>() : 0);
 
     STXXL_MSG("check_sorted_runs  Runs: " << nruns);
     unsigned_type irun = 0;
@@ -230,9 +448,13 @@ bool check_sorted_runs(RunType** runs,
 
             for (unsigned_type j = 0; j < nblocks; ++j)
             {
-                reqs[j] = blocks[j].read((*runs[irun])[j + off].bid);
+                const trigger_entry_type& entry = (*runs[irun])[j + off];
+                reqs[j] = entry.bid.storage->aread(
+                    blocks + j, entry.bid.offset, entry.stored_size);
             }
             wait_all(reqs, reqs + nblocks);
+            for (unsigned_type j = 0; j < nblocks; ++j)
+                decode_block<codec_type>(blocks[j], (*runs[irun])[j + off].stored_size, scratch.begin());
 
             if (off && cmp(blocks[0][0], last))
             {
@@ -311,7 +533,8 @@ void merge_runs(RunType** in_runs, int_type nruns,
     typedef RunType run_type;
     typedef ValueCmp value_cmp;
     typedef typename run_type::value_type trigger_entry_type;
-    typedef block_prefetcher<block_type, typename run_type::iterator> prefetcher_type;
+    typedef typename sort_helper::run_codec_of<value_cmp>::type codec_type;
+    typedef block_prefetcher<block_type, typename run_type::iterator, codec_type> prefetcher_type;
     typedef run_cursor2<block_type, prefetcher_type> run_cursor_type;
     typedef sort_helper::run_cursor2_cmp<block_type, prefetcher_type, value_cmp> run_cursor2_cmp_type;
 
@@ -357,10 +580,17 @@ void merge_runs(RunType** in_runs, int_type nruns,
 
 #endif
 
+    // the input runs may be encoded, the output run is stored unchanged
+    std::vector<unsigned_type> stored_sizes(consume_seq.size());
+    for (unsigned_type i = 0; i < consume_seq.size(); ++i)
+        stored_sizes[i] = consume_seq[i].stored_size;
+
     prefetcher_type prefetcher(consume_seq.begin(),
                                consume_seq.end(),
                                prefetch_seq,
-                               nruns + n_prefetch_buffers);
+                               nruns + n_prefetch_buffers,
+                               completion_handler(),
+                               codec_type::enabled ? &stored_sizes[0] : NULL);
 
     buffered_writer<block_type> writer(n_write_buffers, n_write_buffers / 2);
 
@@ -537,6 +767,8 @@ sort_blocks(InputBidIterator input_bids,
     //STXXL_VERBOSE ("n=" << _n << " nruns=" << nruns << "=" << full_runs << "+" << partial_runs);
 
     double begin = timestamp(), after_runs_creation, end;
+    const double pio_before_rf = stats::get_instance()->get_pio_time();
+    const double io_wait_before_rf = stats::get_instance()->get_io_wait_time();
 
     run_type** runs = new run_type*[nruns];
 
@@ -549,10 +781,16 @@ sort_blocks(InputBidIterator input_bids,
     for (i = 0; i < nruns; ++i)
         mng->new_blocks(alloc_strategy(), make_bid_iterator(runs[i]->begin()), make_bid_iterator(runs[i]->end()));
 
-    sort_local::create_runs<block_type,
-                            run_type,
-                            input_bid_iterator,
-                            value_cmp>(input_bids, runs, nruns, _m, cmp);
+    if (sort_memory_usage_factor() > 1)
+        sort_local::create_runs_pipelined<block_type,
+                                          run_type,
+                                          input_bid_iterator,
+                                          value_cmp>(input_bids, runs, nruns, _m, cmp);
+    else
+        sort_local::create_runs<block_type,
+                                run_type,
+                                input_bid_iterator,
+                                value_cmp>(input_bids, runs, nruns, _m, cmp);
 
     after_runs_creation = timestamp();
 
@@ -560,7 +798,26 @@ sort_blocks(InputBidIterator input_bids,
 
     disk_queues::get_instance()->set_priority_op(request_queue::WRITE);
 
-    const int_type merge_factor = optimal_merge_factor(nruns, _m);
+    // estimate the I/O and merging times of a merge pass from run formation,
+    // which also reads and writes all data once, and sorts with all threads.
+#if STXXL_PARALLEL
+    const int_type num_threads = omp_get_max_threads();
+#else
+    const int_type num_threads = 1;
+#endif
+    const double rf_io_time = stats::get_instance()->get_pio_time() - pio_before_rf;
+    const double rf_cpu_time = STXXL_MAX(0.0, (after_runs_creation - begin) - (io_wait_after_rf - io_wait_before_rf));
+    const double cpu_time = rf_cpu_time * double(num_threads) /
+                            STXXL_MAX(1.0, log(double(m2 * block_type::size)) / log(2.0));
+
+    // merge_runs() needs at least 2 * D prefetch and 2 * D write buffers
+    // besides the k current blocks, and with its 3:1 split of the remaining
+    // blocks these fit only from 8 * D blocks on
+    const merge_plan plan = plan_merge(nruns, _m, 8 * config::get_instance()->disks_number(),
+                                       num_threads, rf_io_time, cpu_time);
+    const int_type merge_factor = plan.merge_factor;
+    STXXL_VERBOSE("Merge plan: " << plan.num_passes << " passes, merge factor " << merge_factor <<
+                  ", up to " << plan.num_parallel << " concurrent merges");
     run_type** new_runs;
 
     while (nruns > 1)
@@ -617,21 +874,32 @@ sort_blocks(InputBidIterator input_bids,
                             runs2bid_array_adaptor2<block_type::raw_size, run_type>(new_runs, 0, new_nruns, blocks_in_new_run),
                             runs2bid_array_adaptor2<block_type::raw_size, run_type>(new_runs, _n, new_nruns, blocks_in_new_run));
         }
-        // merge all
-        runs_left = nruns;
-        cur_out_run = 0;
-        while (runs_left > 0)
+        // merge all, independent merges share the memory
+        const int_type num_parallel = STXXL_MIN(int_type(plan.num_parallel), new_nruns);
+        sort_local::parallel_exception error;
+#if STXXL_PARALLEL
+#pragma omp parallel for num_threads(num_parallel) schedule(dynamic, 1) if (num_parallel > 1)
+#endif
+        for (int_type g = 0; g < new_nruns; ++g)
         {
-            int_type runs2merge = STXXL_MIN(runs_left, merge_factor);
+            int_type first_run = g * merge_factor;
+            int_type runs2merge = STXXL_MIN(int_type(nruns) - first_run, merge_factor);
 #if STXXL_CHECK_ORDER_IN_SORTS
-            assert((check_sorted_runs<block_type, run_type, value_cmp>(runs + nruns - runs_left, runs2merge, m2, cmp)));
+            assert((check_sorted_runs<block_type, run_type, value_cmp>(runs + first_run, runs2merge, m2, cmp)));
 #endif
             STXXL_VERBOSE("Merging " << runs2merge << " runs");
-            merge_runs<block_type, run_type>(runs + nruns - runs_left,
-                                             runs2merge, *(new_runs + (cur_out_run++)), _m, cmp
-                                             );
-            runs_left -= runs2merge;
+            try
+            {
+                merge_runs<block_type, run_type>(runs + first_run,
+                                                 runs2merge, new_runs[g], _m / num_parallel, cmp
+                                                 );
+            }
+            catch (...)
+            {
+                error.capture();
+            }
         }
+        error.rethrow();
 
         nruns = new_nruns;
         delete[] runs;
@@ -651,29 +919,11 @@ sort_blocks(InputBidIterator input_bids,
     return result;
 }
 
-} // namespace sort_local
-
-/*!
- * Sort records comparison-based, see \ref design_algo_sort.
- *
- * stxxl::sort sorts the elements in [first, last) into ascending order,
- * meaning that if \c i and \c j are any two valid iterators in [first, last)
- * such that \c i precedes \c j, then \c *j is not less than \c *i. Note: as
- * std::sort, stxxl::sort is not guaranteed to be stable. That is, suppose that
- * \c *i and \c *j are equivalent: neither one is less than the other. It is
- * not guaranteed that the relative order of these two elements will be
- * preserved by stxxl::sort.
- *
- * The order is defined by the \c cmp parameter. The sorter's internal memory
- * consumption is bounded by \a M bytes.
- *
- * \param first object of model of \c ext_random_access_iterator concept
- * \param last object of model of \c ext_random_access_iterator concept
- * \param cmp comparison object of \ref StrictWeakOrdering
- * \param M amount of memory for internal use (in bytes)
- */
+//! Sorts [first, last), the incomplete first and last blocks are padded with
+//! the sentinels of cmp.
 template <typename ExtIterator, typename StrictWeakOrdering>
-void sort(ExtIterator first, ExtIterator last, StrictWeakOrdering cmp, unsigned_type M)
+void sort_range(ExtIterator first, ExtIterator last, StrictWeakOrdering cmp, unsigned_type M,
+                sort_helper::sentinels_tag<true>)
 {
     sort_helper::verify_sentinel_strict_weak_ordering(cmp);
 
@@ -992,6 +1242,72 @@ void sort(ExtIterator first, ExtIterator last, StrictWeakOrdering cmp, unsigned_
 #endif
 }
 
+//! Sorts [first, last) for a comparator without sentinels. The runs are
+//! formed and merged by the stream sorter, which keeps track of incomplete
+//! blocks instead of padding them.
+template <typename ExtIterator, typename StrictWeakOrdering>
+void sort_range(ExtIterator first, ExtIterator last, StrictWeakOrdering cmp, unsigned_type M,
+                sort_helper::sentinels_tag<false>)
+{
+    typedef typename ExtIterator::vector_type::value_type value_type;
+    typedef typename ExtIterator::block_type block_type;
+    typedef typename ExtIterator::vector_type::alloc_strategy_type alloc_strategy_type;
+    typedef typename stream::streamify_traits<ExtIterator>::stream_type input_type;
+    typedef stream::runs_creator<input_type, StrictWeakOrdering,
+                                 block_type::raw_size, alloc_strategy_type> runs_creator_type;
+    typedef typename runs_creator_type::sorted_runs_type sorted_runs_type;
+    typedef stream::runs_merger<sorted_runs_type, StrictWeakOrdering, alloc_strategy_type> runs_merger_type;
+
+    first.flush();
+
+    if ((last - first) * sizeof(value_type) * sort_memory_usage_factor() < M)
+    {
+        stl_in_memory_sort(first, last, cmp);
+        return;
+    }
+
+    sorted_runs_type runs;
+    {
+        input_type input = stream::streamify(first, last);
+        runs_creator_type creator(input, cmp, M);
+        runs = creator.result();
+    }
+
+    runs_merger_type merger(runs, cmp, M);
+    stream::materialize(merger, first, last);
+}
+
+} // namespace sort_local
+
+/*!
+ * Sort records comparison-based, see \ref design_algo_sort.
+ *
+ * stxxl::sort sorts the elements in [first, last) into ascending order,
+ * meaning that if \c i and \c j are any two valid iterators in [first, last)
+ * such that \c i precedes \c j, then \c *j is not less than \c *i. Note: as
+ * std::sort, stxxl::sort is not guaranteed to be stable. That is, suppose that
+ * \c *i and \c *j are equivalent: neither one is less than the other. It is
+ * not guaranteed that the relative order of these two elements will be
+ * preserved by stxxl::sort.
+ *
+ * The order is defined by the \c cmp parameter. The sorter's internal memory
+ * consumption is bounded by \a M bytes. If \c cmp provides no sentinels
+ * min_value() and max_value(), the records are sorted by the stream sorter,
+ * see stream::runs_creator and stream::runs_merger.
+ *
+ * \param first object of model of \c ext_random_access_iterator concept
+ * \param last object of model of \c ext_random_access_iterator concept
+ * \param cmp comparison object of \ref StrictWeakOrdering
+ * \param M amount of memory for internal use (in bytes)
+ */
+template <typename ExtIterator, typename StrictWeakOrdering>
+void sort(ExtIterator first, ExtIterator last, StrictWeakOrdering cmp, unsigned_type M)
+{
+    sort_local::sort_range(
+        first, last, cmp, M,
+        sort_helper::sentinels_tag<sort_helper::has_sentinels<StrictWeakOrdering>::value>());
+}
+
 //! \}
 
 STXXL_END_NAMESPACE
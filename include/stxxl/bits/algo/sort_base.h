@@ -13,6 +13,7 @@
 #ifndef STXXL_ALGO_SORT_BASE_HEADER
 #define STXXL_ALGO_SORT_BASE_HEADER
 
+#include <algorithm>
 #include <cmath>
 #include <stxxl/bits/common/types.h>
 
@@ -42,6 +43,72 @@ inline unsigned_type optimal_merge_factor(unsigned_type num_runs, unsigned_type
     return unsigned_type(ceil(pow(double(num_runs), 1. / ceil(log(double(num_runs)) / log(double(max_concurrent_runs))))));
 }
 
+//! Schedule of the merge phase of a sort, see plan_merge().
+struct merge_plan
+{
+    //! number of runs merged at once
+    unsigned_type merge_factor;
+    //! number of merge passes
+    unsigned_type num_passes;
+    //! maximum number of independent merges running concurrently in a pass
+    unsigned_type num_parallel;
+};
+
+//! Chooses the merge factor and the number of concurrent merges per pass.
+//!
+//! Every pass reads and writes all data once, which takes \c io_time. A
+//! merge of k runs needs k + min_buffers of the m blocks, so merges run
+//! concurrently only if each of them gets that many blocks. A single thread
+//! merges all data with merge factor k in cpu_time * log2(k). Independent
+//! merges of a pass run concurrently as far as threads and memory allow, and
+//! overlap with their I/O, so a pass takes max(io_time, cpu_time * log2(k) /
+//! concurrent merges). Up to two passes more than the minimum are
+//! considered, since smaller merge factors leave memory for more concurrent
+//! merges. Without measurements (zero times) the fewest passes are chosen.
+inline merge_plan plan_merge(unsigned_type num_runs, unsigned_type m,
+                             unsigned_type min_buffers, unsigned_type num_threads,
+                             double io_time, double cpu_time)
+{
+    merge_plan best;
+    best.merge_factor = optimal_merge_factor(num_runs, m);
+    best.num_passes = 0;
+    best.num_parallel = 1;
+    double best_cost = 0.0;
+
+    const unsigned_type min_passes = unsigned_type(
+        ceil(log(double(num_runs)) / log(double(m))));
+
+    for (unsigned_type passes = min_passes; passes <= min_passes + 2; ++passes)
+    {
+        unsigned_type k = unsigned_type(ceil(pow(double(num_runs), 1. / double(passes))));
+        if (k < 2)
+            break;
+
+        unsigned_type parallel = (k + min_buffers <= m) ? m / (k + min_buffers) : 1;
+        parallel = std::max<unsigned_type>(1, std::min(parallel, num_threads));
+
+        double cost = 0.0;
+        unsigned_type actual_passes = 0;
+        for (unsigned_type runs = num_runs; runs > 1; ++actual_passes)
+        {
+            unsigned_type groups = (runs + k - 1) / k;
+            unsigned_type concurrent = std::min(parallel, groups);
+            cost += std::max(io_time, cpu_time * log(double(k)) / log(2.0) / double(concurrent));
+            runs = groups;
+        }
+
+        if (best.num_passes == 0 || cost < best_cost)
+        {
+            best.merge_factor = k;
+            best.num_passes = actual_passes;
+            best.num_parallel = parallel;
+            best_cost = cost;
+        }
+    }
+
+    return best;
+}
+
 STXXL_END_NAMESPACE
 
 #endif // !STXXL_ALGO_SORT_BASE_HEADER
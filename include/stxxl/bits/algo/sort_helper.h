@@ -16,7 +16,11 @@
 
 #include <algorithm>
 #include <functional>
+#include <stxxl/bits/algo/intksort.h>
 #include <stxxl/bits/algo/run_cursor.h>
+#include <stxxl/bits/common/simple_vector.h>
+#include <stxxl/bits/io/request.h>
+#include <stxxl/bits/mng/block_codec.h>
 #include <stxxl/bits/verbose.h>
 
 STXXL_BEGIN_NAMESPACE
@@ -24,8 +28,60 @@ STXXL_BEGIN_NAMESPACE
 //! \internal
 namespace sort_helper {
 
+//! Detects whether the comparator class provides the sentinels min_value()
+//! and max_value(), by checking that calls of them are well-formed.
 template <typename StrictWeakOrdering>
-inline void verify_sentinel_strict_weak_ordering(StrictWeakOrdering cmp)
+class has_sentinels
+{
+    typedef char yes[1];
+    typedef char no[2];
+
+    template <typename Type>
+    static yes & test_min(char (*)[sizeof(static_cast<Type*>(NULL)->min_value())]);
+    template <typename Type>
+    static no & test_min(...);
+
+    template <typename Type>
+    static yes & test_max(char (*)[sizeof(static_cast<Type*>(NULL)->max_value())]);
+    template <typename Type>
+    static no & test_max(...);
+
+public:
+    enum {
+        value = sizeof(test_min<StrictWeakOrdering>(NULL)) == sizeof(yes) &&
+                sizeof(test_max<StrictWeakOrdering>(NULL)) == sizeof(yes)
+    };
+};
+
+//! \internal helper of run_codec_of
+template <typename Type>
+struct run_codec_void
+{
+    typedef void type;
+};
+
+//! Codec of the blocks of sort runs: the comparator's nested type run_codec,
+//! e.g. delta_varint_codec, or no_block_codec if there is none.
+template <typename StrictWeakOrdering, typename Enable = void>
+struct run_codec_of
+{
+    typedef no_block_codec type;
+};
+
+template <typename StrictWeakOrdering>
+struct run_codec_of<StrictWeakOrdering,
+                    typename run_codec_void<typename StrictWeakOrdering::run_codec>::type>
+{
+    typedef typename StrictWeakOrdering::run_codec type;
+};
+
+//! Tag type for dispatching on has_sentinels.
+template <bool HasSentinels>
+struct sentinels_tag
+{ };
+
+template <typename StrictWeakOrdering>
+inline void verify_sentinel_strict_weak_ordering(StrictWeakOrdering cmp, sentinels_tag<true>)
 {
     STXXL_ASSERT(!cmp(cmp.min_value(), cmp.min_value()));
     STXXL_ASSERT(cmp(cmp.min_value(), cmp.max_value()));
@@ -33,6 +89,40 @@ inline void verify_sentinel_strict_weak_ordering(StrictWeakOrdering cmp)
     STXXL_ASSERT(!cmp(cmp.max_value(), cmp.max_value()));
 }
 
+template <typename StrictWeakOrdering>
+inline void verify_sentinel_strict_weak_ordering(StrictWeakOrdering, sentinels_tag<false>)
+{ }
+
+//! Checks the sentinels of the comparator, if it has any.
+template <typename StrictWeakOrdering>
+inline void verify_sentinel_strict_weak_ordering(StrictWeakOrdering cmp)
+{
+    verify_sentinel_strict_weak_ordering(
+        cmp, sentinels_tag<has_sentinels<StrictWeakOrdering>::value>());
+}
+
+template <typename StrictWeakOrdering, typename ValueType>
+inline ValueType padding_value(StrictWeakOrdering cmp, const ValueType&, sentinels_tag<true>)
+{
+    return cmp.max_value();
+}
+
+template <typename StrictWeakOrdering, typename ValueType>
+inline ValueType padding_value(StrictWeakOrdering, const ValueType& element, sentinels_tag<false>)
+{
+    return element;
+}
+
+//! Returns the value to fill up the last block of a run with: max_value() if
+//! the comparator has sentinels, otherwise the given element of the run, as
+//! the padding is then never read by the merger.
+template <typename StrictWeakOrdering, typename ValueType>
+inline ValueType padding_value(StrictWeakOrdering cmp, const ValueType& element)
+{
+    return padding_value(cmp, element,
+                         sentinels_tag<has_sentinels<StrictWeakOrdering>::value>());
+}
+
 template <typename BlockType, typename ValueType = typename BlockType::value_type>
 struct trigger_entry
 {
@@ -43,12 +133,133 @@ struct trigger_entry
     bid_type bid;
     value_type value;
 
+    //! number of bytes of the block stored on disk, less than
+    //! block_type::raw_size if the block is encoded, see encode_block()
+    unsigned_type stored_size;
+
+    trigger_entry()
+        : stored_size(block_type::raw_size)
+    { }
+
     operator bid_type ()
     {
         return bid;
     }
 };
 
+//! Sorts the elements [begin, end) of a run with cmp.
+template <typename Iterator, typename CompareType>
+inline void sort_run_elements(Iterator begin, Iterator end, CompareType cmp)
+{
+    check_sort_settings();
+    potentially_parallel::sort(begin, end, cmp);
+}
+
+//! Sorts the elements [begin, end) of a run by the integer keys of cmp with
+//! radix_sort_lsd(), which needs a temporary copy of the run.
+template <typename ValueType, typename KeyExtractor>
+inline void sort_run_elements(ValueType* begin, ValueType* end,
+                              radix_key_cmp<ValueType, KeyExtractor> cmp)
+{
+    simple_vector<ValueType> tmp(end - begin);
+    ValueType* sorted = radix_sort_lsd(begin, end, tmp.begin(), cmp.key_extractor());
+    if (sorted != begin)
+        std::copy(sorted, sorted + (end - begin), begin);
+}
+
+//! Factor by which sort_run_elements() on Iterator ranges with CompareType
+//! increases the memory usage, see sort_memory_usage_factor().
+template <typename Iterator, typename CompareType>
+struct run_memory_usage_factor
+{
+    static unsigned value()
+    {
+        return sort_memory_usage_factor();
+    }
+};
+
+//! radix_sort_lsd() needs a temporary copy of the run, it is taken only for
+//! plain pointer ranges.
+template <typename ValueType, typename KeyExtractor>
+struct run_memory_usage_factor<ValueType*, radix_key_cmp<ValueType, KeyExtractor> >
+{
+    static unsigned value()
+    {
+        return 2;
+    }
+};
+
+//! Factor by which sorting runs of Iterator ranges with cmp in
+//! sort_run_elements() increases the memory usage.
+template <typename Iterator, typename CompareType>
+inline unsigned memory_usage_factor(const CompareType&)
+{
+    return run_memory_usage_factor<Iterator, CompareType>::value();
+}
+
+//! Writes blocks[0,n) to the bids of the first n entries of run, submitting
+//! all requests as one batch, see typed_block::write_batch().
+template <typename BlockType, typename RunType>
+inline void write_run_blocks(BlockType* blocks, const RunType& run,
+                             unsigned_type n, request_ptr* reqs)
+{
+    simple_vector<BlockType*> block_ptrs(n);
+    simple_vector<typename BlockType::bid_type> bids(n);
+    for (unsigned_type i = 0; i < n; ++i)
+    {
+        block_ptrs[i] = blocks + i;
+        bids[i] = run[i].bid;
+    }
+    BlockType::write_batch(block_ptrs.begin(), bids.begin(), n, reqs);
+}
+
+//! Writes blocks[0,n) to the bids of the first n entries of run like
+//! write_run_blocks(), but encodes them with Codec first, see
+//! encode_block(), and records their stored sizes in the entries. The
+//! contents of the blocks are lost unless restored by restore_run_blocks().
+template <typename Codec, typename BlockType, typename RunType>
+inline void write_run_blocks(BlockType* blocks, RunType& run,
+                             unsigned_type n, request_ptr* reqs)
+{
+    if (!Codec::enabled)
+        return write_run_blocks(blocks, run, n, reqs);
+
+    simple_vector<unsigned char> scratch(block_codec_scratch_size<Codec, BlockType>());
+    for (unsigned_type i = 0; i < n; ++i)
+    {
+        run[i].stored_size = encode_block<Codec>(blocks[i], scratch.begin());
+        reqs[i] = run[i].bid.storage->awrite(
+            blocks + i, run[i].bid.offset, run[i].stored_size);
+    }
+}
+
+//! Writes block to the bid of entry like typed_block::write(), but encodes it
+//! with Codec first and records its stored size in entry, see
+//! write_run_blocks(). scratch must hold block_codec_scratch_size() bytes.
+template <typename Codec, typename BlockType, typename EntryType>
+inline request_ptr write_run_block(BlockType& block, EntryType& entry,
+                                   unsigned char* scratch,
+                                   completion_handler on_cmpl = completion_handler())
+{
+    if (!Codec::enabled)
+        return block.write(entry.bid, on_cmpl);
+
+    entry.stored_size = encode_block<Codec>(block, scratch);
+    return entry.bid.storage->awrite(&block, entry.bid.offset, entry.stored_size, on_cmpl);
+}
+
+//! Decodes blocks[0,n) after write_run_blocks() with Codec has completed.
+template <typename Codec, typename BlockType, typename RunType>
+inline void restore_run_blocks(BlockType* blocks, const RunType& run, unsigned_type n)
+{
+    if (!Codec::enabled)
+        return;
+
+    simple_vector<unsigned char> scratch(block_codec_scratch_size<Codec, BlockType>());
+    for (unsigned_type i = 0; i < n; ++i)
+        decode_block<Codec>(blocks[i], run[i].stored_size, scratch.begin());
+}
+
 template <typename TriggerEntryType, typename ValueCmp>
 struct trigger_entry_cmp
     : public std::binary_function<TriggerEntryType, TriggerEntryType, bool>
@@ -145,6 +356,53 @@ refill_or_remove_empty_sequences(SequenceVector& seqs,
     }
 }
 
+// this function is used by mergers of runs with incomplete blocks:
+// block_sizes holds the number of elements of each block in the consume
+// sequence of the prefetcher
+template <typename SequenceVector, typename BufferPtrVector, typename Prefetcher,
+          typename SizeVector>
+inline void
+refill_or_remove_empty_sequences(SequenceVector& seqs,
+                                 BufferPtrVector& buffers,
+                                 Prefetcher& prefetcher,
+                                 const SizeVector& block_sizes)
+{
+    typedef typename SequenceVector::size_type seqs_size_type;
+
+    for (seqs_size_type i = 0; i < seqs.size(); ++i)
+    {
+        if (seqs[i].first == seqs[i].second)                    // run empty
+        {
+            if (prefetcher.block_consumed(buffers[i]))
+            {
+                seqs[i].first = buffers[i]->begin();            // reset iterator
+                seqs[i].second = buffers[i]->begin() + block_sizes[prefetcher.pos() - 1];
+                STXXL_VERBOSE1("block ran empty " << i);
+            }
+            else
+            {
+                seqs.erase(seqs.begin() + i);                   // remove this sequence
+                buffers.erase(buffers.begin() + i);
+                STXXL_VERBOSE1("seq removed " << i);
+                --i;                                            // don't skip the next sequence
+            }
+        }
+    }
+}
+
+//! Compares indexes into an array of trigger entries by their values.
+template <typename TriggerEntryType, typename ValueCmp>
+struct trigger_entry_index_cmp
+{
+    const TriggerEntryType* entries;
+    ValueCmp cmp;
+    trigger_entry_index_cmp(const TriggerEntryType* e, ValueCmp c) : entries(e), cmp(c) { }
+    bool operator () (unsigned_type a, unsigned_type b) const
+    {
+        return cmp(entries[a].value, entries[b].value);
+    }
+};
+
 } // namespace sort_helper
 
 STXXL_END_NAMESPACE
@@ -14,9 +14,10 @@
 #ifndef STXXL_ALGO_STABLE_KSORT_HEADER
 #define STXXL_ALGO_STABLE_KSORT_HEADER
 
-// it is a first try: distribution sort without sampling
-// I rework the stable_ksort when I would have a time
-
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
 #include <stxxl/bits/mng/block_manager.h>
 #include <stxxl/bits/mng/buf_istream.h>
 #include <stxxl/bits/mng/buf_ostream.h>
@@ -24,6 +25,8 @@
 #include <stxxl/bits/algo/intksort.h>
 #include <stxxl/bits/algo/sort_base.h>
 #include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/common/rand.h>
+#include <stxxl/bits/parallel.h>
 
 #ifndef STXXL_VERBOSE_STABLE_KSORT
 #define STXXL_VERBOSE_STABLE_KSORT STXXL_VERBOSE1
@@ -38,21 +41,6 @@ STXXL_BEGIN_NAMESPACE
  */
 namespace stable_ksort_local {
 
-template <class Type, class TypeKey>
-void classify_block(Type* begin, Type* end, TypeKey*& out,
-                    int_type* bucket, typename Type::key_type offset,
-                    unsigned shift)
-{
-    for (Type* p = begin; p < end; p++, out++)      // count & create references
-    {
-        out->ptr = p;
-        typename Type::key_type key = p->key();
-        int_type ibucket = (int_type)((key - offset) >> shift);
-        out->key = key;
-        bucket[ibucket]++;
-    }
-}
-
 template <typename Type>
 struct type_key
 {
@@ -121,36 +109,144 @@ public:
     }
     size_type size() { return bids->size(); }
     iterator begin() { return bids->begin(); }
-    ~bid_sequence()
+    //! Frees the blocks of the sequence.
+    void release()
     {
+        if (!bids) return;
         block_manager::get_instance()->delete_blocks(bids->begin(), bids->end());
         delete bids;
+        bids = NULL;
+    }
+    ~bid_sequence()
+    {
+        release();
     }
 };
 
-template <typename ExtIterator>
+//! A bucket of the distribution, its records are stored in the blocks of
+//! bids. All keys lie in [min_key, max_key].
+template <typename BidSequence, typename KeyType>
+struct bucket
+{
+    typedef BidSequence bid_sequence_type;
+
+    BidSequence* bids;
+    int64 size;
+    KeyType min_key, max_key;
+};
+
+//! Draws a random sample of keys from the records [skip, skip + nelements)
+//! stored in the blocks starting at bids. The records are taken from
+//! nsample_blocks blocks chosen by stratified sampling, so that a pre-sorted
+//! input does not bias the sample, and keys_per_block random records are
+//! taken from each of them.
+template <typename BlockType, typename BidIterator, typename KeyType>
+void sample_keys(BidIterator bids, unsigned_type skip, int64 nelements,
+                 unsigned_type nsample_blocks, unsigned_type keys_per_block,
+                 std::vector<KeyType>& sample)
+{
+    typedef BlockType block_type;
+
+    const unsigned_type nblocks = (unsigned_type)div_ceil(skip + nelements, block_type::size);
+    nsample_blocks = STXXL_MIN(nsample_blocks, nblocks);
+
+    block_type* blocks = new block_type[nsample_blocks];
+    request_ptr* reqs = new request_ptr[nsample_blocks];
+    unsigned_type* sampled = new unsigned_type[nsample_blocks];
+
+    random_number64 rnd;
+    for (unsigned_type i = 0; i < nsample_blocks; ++i)
+    {
+        // one block out of each of nsample_blocks equal parts of the input
+        sampled[i] = (unsigned_type)((uint64(i) * nblocks + rnd(nblocks)) / nsample_blocks);
+        reqs[i] = blocks[i].read(*(bids + sampled[i]));
+    }
+
+    sample.clear();
+    sample.reserve(nsample_blocks * keys_per_block);
+    for (unsigned_type i = 0; i < nsample_blocks; ++i)
+    {
+        reqs[i]->wait();
+        // the records of the block which belong to the range
+        const int64 block_begin = int64(sampled[i]) * block_type::size;
+        const unsigned_type lo = (unsigned_type)(STXXL_MAX<int64>(skip, block_begin) - block_begin);
+        const unsigned_type hi = (unsigned_type)(STXXL_MIN<int64>(skip + nelements, block_begin + block_type::size) - block_begin);
+        for (unsigned_type j = 0; j < keys_per_block; ++j)
+            sample.push_back(blocks[i].elem[lo + (unsigned_type)rnd(hi - lo)].key());
+    }
+
+    delete[] sampled;
+    delete[] reqs;
+    delete[] blocks;
+}
+
+//! Chooses distinct splitters which divide the sample into nbuckets parts of
+//! equal size. A key which spans several parts is frequent, it gets a bucket
+//! of its own by also splitting at its predecessor. If a key range [min_key,
+//! max_key] is given, only splitters inside the range are kept, and at least
+//! one which separates min_key from max_key, so that each distribution makes
+//! progress.
+template <typename KeyType>
+void choose_splitters(std::vector<KeyType>& sample, unsigned_type nbuckets,
+                      std::vector<KeyType>& splitters,
+                      bool restrict_range, KeyType min_key, KeyType max_key)
+{
+    std::sort(sample.begin(), sample.end());
+
+    std::vector<KeyType> quantiles(nbuckets - 1);
+    for (unsigned_type i = 1; i < nbuckets; ++i)
+        quantiles[i - 1] = sample[(size_t)(uint64(i) * sample.size() / nbuckets)];
+
+    splitters.clear();
+    for (unsigned_type i = 0; i < quantiles.size(); ++i)
+    {
+        const KeyType& s = quantiles[i];
+        if (i > 0 && quantiles[i - 1] == s)
+            continue;
+
+        const bool frequent = (i + 1 < quantiles.size() && quantiles[i + 1] == s);
+        if (frequent && std::numeric_limits<KeyType>::min() < s &&
+            (!restrict_range || (min_key < s && !(max_key < s))) &&
+            (splitters.empty() || splitters.back() < s - 1))
+            splitters.push_back(s - 1);
+
+        if (restrict_range && (s < min_key || !(s < max_key)))
+            continue;
+        if (splitters.empty() || splitters.back() < s)
+            splitters.push_back(s);
+    }
+
+    if (splitters.empty())
+        splitters.push_back(restrict_range ? min_key : sample[sample.size() / 2]);
+}
+
+//! Distributes the records [skip, skip + nelements) stored in the blocks
+//! [bids_begin, bids_end) into splitters.size() + 1 buckets. Bucket i receives
+//! the keys in (splitters[i - 1], splitters[i]], the input order of records
+//! with equal keys is kept. The buckets are classified in parallel.
+template <typename BlockType, typename BidIterator, typename BucketType>
 void distribute(
-    bid_sequence<typename ExtIterator::vector_type::block_type::bid_type,
-                 typename ExtIterator::vector_type::alloc_strategy_type>* bucket_bids,
-    int64* bucket_sizes,
-    const int_type nbuckets,
-    const int_type lognbuckets,
-    ExtIterator first,
-    ExtIterator last,
+    BidIterator bids_begin,
+    BidIterator bids_end,
+    unsigned_type skip,
+    int64 nelements,
+    const std::vector<typename BlockType::value_type::key_type>& splitters,
+    std::vector<BucketType>& buckets,
+    const unsigned_type est_bucket_size,
     const int_type nread_buffers,
     const int_type nwrite_buffers)
 {
-    typedef typename ExtIterator::vector_type::value_type value_type;
+    typedef BlockType block_type;
+    typedef typename block_type::value_type value_type;
     typedef typename value_type::key_type key_type;
-    typedef typename ExtIterator::block_type block_type;
-    typedef typename ExtIterator::bids_container_iterator bids_container_iterator;
-
-    typedef buf_istream<block_type, bids_container_iterator> buf_istream_type;
+    typedef buf_istream<block_type, BidIterator> buf_istream_type;
 
+    const int_type nbuckets = splitters.size() + 1;
+    const key_type* splitters_begin = &splitters[0];
+    const key_type* splitters_end = splitters_begin + splitters.size();
     int_type i = 0;
 
-    buf_istream_type in(first.bid(), last.bid() + ((first.block_offset()) ? 1 : 0),
-                        nread_buffers);
+    buf_istream_type in(bids_begin, bids_end, nread_buffers);
 
     buffered_writer<block_type> out(
         nbuckets + nwrite_buffers,
@@ -160,47 +256,70 @@ void distribute(
     unsigned_type* bucket_iblock = new unsigned_type[nbuckets];
     block_type** bucket_blocks = new block_type*[nbuckets];
 
-    std::fill(bucket_sizes, bucket_sizes + nbuckets, 0);
-    std::fill(bucket_iblock, bucket_iblock + nbuckets, 0);
-    std::fill(bucket_block_offsets, bucket_block_offsets + nbuckets, 0);
-
+    buckets.resize(nbuckets);
     for (i = 0; i < nbuckets; i++)
+    {
+        buckets[i].bids = new typename BucketType::bid_sequence_type(est_bucket_size);
+        buckets[i].size = 0;
+        buckets[i].min_key = std::numeric_limits<key_type>::max();
+        buckets[i].max_key = std::numeric_limits<key_type>::min();
+        bucket_iblock[i] = 0;
+        bucket_block_offsets[i] = 0;
         bucket_blocks[i] = out.get_free_block();
-
-    ExtIterator cur = first - first.block_offset();
+    }
 
     // skip part of the block before first untouched
-    for ( ; cur != first; cur++)
+    for (unsigned_type j = 0; j < skip; j++)
         ++in;
 
-    const int_type shift = sizeof(key_type) * 8 - lognbuckets;
-    // search in the the range [_begin,_end)
-    STXXL_VERBOSE_STABLE_KSORT("Shift by: " << shift << " bits, lognbuckets: " << lognbuckets);
-    for ( ; cur != last; cur++)
+    // records are classified in batches of one block
+    simple_vector<value_type> batch(block_type::size);
+    simple_vector<int_type> batch_bucket(block_type::size);
+
+    STXXL_VERBOSE_STABLE_KSORT("Distributing " << nelements << " records into " << nbuckets << " buckets");
+    for (int64 done = 0; done < nelements; )
     {
-        key_type cur_key = in.current().key();
-        int_type ibucket = (int_type)(cur_key >> shift);
+        const int_type nbatch = (int_type)STXXL_MIN<int64>(block_type::size, nelements - done);
+        for (int_type j = 0; j < nbatch; j++)
+            in >> batch[j];
+
+#if STXXL_PARALLEL
+#pragma omp parallel for if (nbatch >= 16 * 1024)
+#endif
+        for (int_type j = 0; j < nbatch; j++)
+            batch_bucket[j] = std::lower_bound(splitters_begin, splitters_end,
+                                               batch[j].key()) - splitters_begin;
 
-        int_type block_offset = bucket_block_offsets[ibucket];
-        in >> (bucket_blocks[ibucket]->elem[block_offset++]);
-        if (block_offset == block_type::size)
+        for (int_type j = 0; j < nbatch; j++)
         {
-            block_offset = 0;
-            int_type iblock = bucket_iblock[ibucket]++;
-            bucket_blocks[ibucket] = out.write(bucket_blocks[ibucket], bucket_bids[ibucket][iblock]);
+            const int_type ibucket = batch_bucket[j];
+            const key_type cur_key = batch[j].key();
+            BucketType& b = buckets[ibucket];
+            if (cur_key < b.min_key) b.min_key = cur_key;
+            if (b.max_key < cur_key) b.max_key = cur_key;
+
+            unsigned_type block_offset = bucket_block_offsets[ibucket];
+            bucket_blocks[ibucket]->elem[block_offset++] = batch[j];
+            if (block_offset == block_type::size)
+            {
+                block_offset = 0;
+                unsigned_type iblock = bucket_iblock[ibucket]++;
+                bucket_blocks[ibucket] = out.write(bucket_blocks[ibucket], (*b.bids)[iblock]);
+            }
+            bucket_block_offsets[ibucket] = block_offset;
         }
-        bucket_block_offsets[ibucket] = block_offset;
+        done += nbatch;
     }
     for (i = 0; i < nbuckets; i++)
     {
         if (bucket_block_offsets[i])
         {
-            out.write(bucket_blocks[i], bucket_bids[i][bucket_iblock[i]]);
+            out.write(bucket_blocks[i], (*buckets[i].bids)[bucket_iblock[i]]);
         }
-        bucket_sizes[i] = int64(block_type::size) * bucket_iblock[i] +
+        buckets[i].size = int64(block_type::size) * bucket_iblock[i] +
                           bucket_block_offsets[i];
-        STXXL_VERBOSE_STABLE_KSORT("Bucket " << i << " has size " << bucket_sizes[i] <<
-                                   ", estimated size: " << ((last - first) / int64(nbuckets)));
+        STXXL_VERBOSE_STABLE_KSORT("Bucket " << i << " has size " << buckets[i].size <<
+                                   ", estimated size: " << (nelements / int64(nbuckets)));
     }
 
     delete[] bucket_blocks;
@@ -208,19 +327,70 @@ void distribute(
     delete[] bucket_iblock;
 }
 
+//! Splits the records [skip, skip + nelements) stored in the blocks starting
+//! at bids_begin into at most max_buckets buckets, using splitters chosen
+//! from a random sample of the keys. The number of buckets aims at half of
+//! max_bucket_size records per bucket, mem_blocks blocks of memory are
+//! available. If restrict_range is set, all keys lie in [min_key, max_key].
+template <typename BlockType, typename BidIterator, typename BucketType>
+void partition(
+    BidIterator bids_begin,
+    unsigned_type skip,
+    int64 nelements,
+    int64 max_bucket_size,
+    unsigned_type max_buckets,
+    unsigned_type mem_blocks,
+    bool restrict_range,
+    typename BlockType::value_type::key_type min_key,
+    typename BlockType::value_type::key_type max_key,
+    std::vector<BucketType>& buckets)
+{
+    typedef BlockType block_type;
+    typedef typename block_type::value_type::key_type key_type;
+
+    // number of sampled keys per bucket
+    static const unsigned_type oversampling = 32;
+
+    const unsigned_type nbuckets = (unsigned_type)
+                                   STXXL_MAX<int64>(2, STXXL_MIN<int64>(max_buckets, 2 * div_ceil(nelements, max_bucket_size)));
+    const unsigned_type nblocks = (unsigned_type)div_ceil(skip + nelements, block_type::size);
+
+    // the sample is read from at most an eighth of the input and half of
+    // the memory
+    const unsigned_type nsample_blocks = STXXL_MAX<unsigned_type>(
+        1, STXXL_MIN<unsigned_type>(mem_blocks / 2, div_ceil(nblocks, 8)));
+    const unsigned_type keys_per_block = (unsigned_type)div_ceil(oversampling * nbuckets, nsample_blocks);
+
+    std::vector<key_type> sample, splitters;
+    sample_keys<block_type>(bids_begin, skip, nelements, nsample_blocks, keys_per_block, sample);
+    choose_splitters(sample, nbuckets, splitters, restrict_range, min_key, max_key);
+
+    const unsigned_type nbuffers = mem_blocks - (splitters.size() + 1);
+    const unsigned_type est_bucket_size = (unsigned_type)
+                                          div_ceil(nelements / int64(splitters.size() + 1), block_type::size);
+
+    distribute<block_type>(bids_begin, bids_begin + nblocks, skip, nelements,
+                           splitters, buckets, est_bucket_size,
+                           nbuffers / 2, nbuffers / 2);
+}
+
 } // namespace stable_ksort_local
 
-//! Sort records with integer keys
+//! Sort records with integer keys, the order of records with equal keys is
+//! preserved.
+//!
+//! The records are distributed into buckets by splitters chosen from a
+//! random sample of the keys, which are then sorted in internal memory. Hence
+//! two passes over the data suffice for arbitrary key distributions. Buckets
+//! which turn out too large are distributed again, large buckets of a single
+//! key need no sorting.
 //! \param first object of model of \c ext_random_access_iterator concept
 //! \param last object of model of \c ext_random_access_iterator concept
 //! \param M amount of memory for internal use (in bytes)
 //! \remark Elements must provide a method key() which returns the integer key.
-//! \remark Not yet fully implemented, it assumes that the keys are uniformly
-//! distributed between [0,std::numeric_limits<key_type>::max().
 template <typename ExtIterator>
 void stable_ksort(ExtIterator first, ExtIterator last, unsigned_type M)
 {
-    STXXL_MSG("Warning: stable_ksort is not yet fully implemented, it assumes that the keys are uniformly distributed between [0,std::numeric_limits<key_type>::max()]");
     typedef typename ExtIterator::vector_type::value_type value_type;
     typedef typename value_type::key_type key_type;
     typedef typename ExtIterator::block_type block_type;
@@ -228,10 +398,17 @@ void stable_ksort(ExtIterator first, ExtIterator last, unsigned_type M)
     typedef typename block_type::bid_type bid_type;
     typedef typename ExtIterator::vector_type::alloc_strategy_type alloc_strategy;
     typedef stable_ksort_local::bid_sequence<bid_type, alloc_strategy> bucket_bids_type;
+    typedef stable_ksort_local::bucket<bucket_bids_type, key_type> bucket_type;
     typedef stable_ksort_local::type_key<value_type> type_key_;
+    // a piece of a bucket which is sorted in internal memory
+    typedef std::pair<typename bucket_bids_type::iterator, int64> piece_type;
 
     first.flush();     // flush container
 
+    const int64 n = last - first;
+    if (n == 0)
+        return;
+
     double begin = timestamp();
 
     unsigned_type i = 0;
@@ -242,73 +419,94 @@ void stable_ksort(ExtIterator first, ExtIterator last, unsigned_type M)
     const unsigned_type read_buffers_multiple = 2;
     const unsigned_type ndisks = cfg->disks_number();
     const unsigned_type min_num_read_write_buffers = (write_buffers_multiple + read_buffers_multiple) * ndisks;
-    const unsigned_type nmaxbuckets = m - min_num_read_write_buffers;
-    const unsigned int lognbuckets = ilog2_floor(nmaxbuckets);
-    const unsigned_type nbuckets = unsigned_type(1) << lognbuckets;
-    const unsigned_type est_bucket_size = (unsigned_type)div_ceil((last - first) / nbuckets, block_type::size);      //in blocks
+    // the batch of records classified in parallel during the distribution
+    const unsigned_type nbatch_blocks = 2;
 
-    if (m < min_num_read_write_buffers + 2 || nbuckets < 2) {
+    if (m < min_num_read_write_buffers + nbatch_blocks + 2) {
         STXXL_ERRMSG("stxxl::stable_ksort: Not enough memory. Blocks available: " << m <<
                      ", required for r/w buffers: " << min_num_read_write_buffers <<
-                     ", required for buckets: 2, nbuckets: " << nbuckets);
+                     ", required for classification: " << nbatch_blocks <<
+                     ", required for buckets: 2");
         throw bad_parameter("stxxl::stable_ksort(): INSUFFICIENT MEMORY provided, please increase parameter 'M'");
     }
-    STXXL_VERBOSE_STABLE_KSORT("Elements to sort: " << (last - first));
-    STXXL_VERBOSE_STABLE_KSORT("Number of buckets has to be reduced from " << nmaxbuckets << " to " << nbuckets);
-    const unsigned_type nread_buffers = (m - nbuckets) * read_buffers_multiple / (read_buffers_multiple + write_buffers_multiple);
-    const unsigned_type nwrite_buffers = (m - nbuckets) * write_buffers_multiple / (read_buffers_multiple + write_buffers_multiple);
+    const unsigned_type nmaxbuckets = m - min_num_read_write_buffers - nbatch_blocks;
 
-    STXXL_VERBOSE_STABLE_KSORT("Read buffers in distribution phase: " << nread_buffers);
-    STXXL_VERBOSE_STABLE_KSORT("Write buffers in distribution phase: " << nwrite_buffers);
+    // two buckets are held in memory while sorting them
+    const unsigned_type write_buffers_multiple_bs = 2;
+    const unsigned_type max_bucket_size_bl = (m - write_buffers_multiple_bs * ndisks) / 2; // in number of blocks
+    const int64 max_bucket_size_rec = int64(max_bucket_size_bl) * block_type::size;        // in number of records
 
-    bucket_bids_type* bucket_bids = new bucket_bids_type[nbuckets];
-    for (i = 0; i < nbuckets; ++i)
-        bucket_bids[i].init(est_bucket_size);
-
-    int64* bucket_sizes = new int64[nbuckets];
+    STXXL_VERBOSE_STABLE_KSORT("Elements to sort: " << n);
+    STXXL_VERBOSE_STABLE_KSORT("Maximum number of buckets: " << nmaxbuckets <<
+                               ", maximum bucket size: " << max_bucket_size_rec);
 
     disk_queues::get_instance()->set_priority_op(request_queue::WRITE);
 
-    stable_ksort_local::distribute(
-        bucket_bids,
-        bucket_sizes,
-        nbuckets,
-        lognbuckets,
-        first,
-        last,
-        nread_buffers,
-        nwrite_buffers);
+    // the buckets still to process, in reverse order
+    std::vector<bucket_type> buckets;
+    stable_ksort_local::partition<block_type>(
+        first.bid(), first.block_offset(), n,
+        max_bucket_size_rec, nmaxbuckets, m - nbatch_blocks,
+        false, key_type(), key_type(), buckets);
+    std::reverse(buckets.begin(), buckets.end());
+
+    std::vector<bucket_bids_type*> sorted_bids;
+    std::vector<piece_type> pieces;
+    unsigned_type nrefined = 0;
+
+    while (!buckets.empty())
+    {
+        bucket_type b = buckets.back();
+        buckets.pop_back();
+
+        if (b.size == 0) {
+            delete b.bids;
+            continue;
+        }
+        if (b.size > max_bucket_size_rec && b.min_key < b.max_key)
+        {
+            // distribute the bucket again, its keys are sampled anew
+            STXXL_VERBOSE_STABLE_KSORT("Refining bucket of size " << b.size <<
+                                       ", keys [" << b.min_key << "," << b.max_key << "]");
+            std::vector<bucket_type> sub_buckets;
+            stable_ksort_local::partition<block_type>(
+                b.bids->begin(), 0, b.size,
+                max_bucket_size_rec, nmaxbuckets, m - nbatch_blocks,
+                true, b.min_key, b.max_key, sub_buckets);
+            delete b.bids;
+            buckets.insert(buckets.end(), sub_buckets.rbegin(), sub_buckets.rend());
+            ++nrefined;
+            continue;
+        }
+
+        // records with equal keys are in input order, hence a large bucket
+        // of a single key is sorted in pieces
+        sorted_bids.push_back(b.bids);
+        for (int64 offset = 0; offset < b.size; offset += max_bucket_size_rec)
+            pieces.push_back(piece_type(b.bids->begin() + offset / block_type::size,
+                                        STXXL_MIN(max_bucket_size_rec, b.size - offset)));
+    }
+
+    if (nrefined)
+        STXXL_VERBOSE_STABLE_KSORT("Refined " << nrefined << " buckets, sorting " << pieces.size() << " pieces");
 
     double dist_end = timestamp(), end;
     double io_wait_after_d = stats::get_instance()->get_io_wait_time();
 
     {
         // sort buckets
-        unsigned_type write_buffers_multiple_bs = 2;
-        unsigned_type max_bucket_size_bl = (m - write_buffers_multiple_bs * ndisks) / 2; // in number of blocks
-        int64 max_bucket_size_rec = int64(max_bucket_size_bl) * block_type::size;        // in number of records
+        const unsigned_type npieces = pieces.size();
         int64 max_bucket_size_act = 0;                                                   // actual max bucket size
-        // establish output stream
 
-        for (i = 0; i < nbuckets; i++)
-        {
-            max_bucket_size_act = STXXL_MAX(bucket_sizes[i], max_bucket_size_act);
-            if (bucket_sizes[i] > max_bucket_size_rec)
-            {
-                STXXL_ERRMSG("Bucket " << i << " is too large: " << bucket_sizes[i] <<
-                             " records, maximum: " << max_bucket_size_rec);
-                STXXL_ERRMSG("Recursion on buckets is not yet implemented, aborting.");
-                abort();
-            }
-        }
+        for (i = 0; i < npieces; i++)
+            max_bucket_size_act = STXXL_MAX(pieces[i].second, max_bucket_size_act);
+
         // here we can increase write_buffers_multiple_b knowing max(bucket_sizes[i])
         // ... and decrease max_bucket_size_bl
-        const int_type max_bucket_size_act_bl = (int_type)div_ceil(max_bucket_size_act, block_type::size);
+        const unsigned_type max_bucket_size_act_bl = (unsigned_type)div_ceil(max_bucket_size_act, block_type::size);
         STXXL_VERBOSE_STABLE_KSORT("Reducing required number of required blocks per bucket from " <<
                                    max_bucket_size_bl << " to " << max_bucket_size_act_bl);
-        max_bucket_size_rec = max_bucket_size_act;
-        max_bucket_size_bl = max_bucket_size_act_bl;
-        const unsigned_type nwrite_buffers_bs = m - 2 * max_bucket_size_bl;
+        const unsigned_type nwrite_buffers_bs = m - 2 * max_bucket_size_act_bl;
         STXXL_VERBOSE_STABLE_KSORT("Write buffers in bucket sorting phase: " << nwrite_buffers_bs);
 
         typedef buf_ostream<block_type, bids_container_iterator> buf_ostream_type;
@@ -330,112 +528,75 @@ void stable_ksort(ExtIterator first, ExtIterator last, unsigned_type M)
             }
             delete block;
         }
-        block_type* blocks1 = new block_type[max_bucket_size_bl];
-        block_type* blocks2 = new block_type[max_bucket_size_bl];
-        request_ptr* reqs1 = new request_ptr[max_bucket_size_bl];
-        request_ptr* reqs2 = new request_ptr[max_bucket_size_bl];
-        type_key_* refs1 = new type_key_[(size_t)max_bucket_size_rec];
-        type_key_* refs2 = new type_key_[(size_t)max_bucket_size_rec];
-
-        // submit reading first 2 buckets (Peter's scheme)
-        unsigned_type nbucket_blocks = (unsigned_type)div_ceil(bucket_sizes[0], block_type::size);
-        for (i = 0; i < nbucket_blocks; i++)
-            reqs1[i] = blocks1[i].read(bucket_bids[0][i]);
-
-        nbucket_blocks = (unsigned_type)div_ceil(bucket_sizes[1], block_type::size);
+        block_type* blocks1 = new block_type[max_bucket_size_act_bl];
+        block_type* blocks2 = new block_type[max_bucket_size_act_bl];
+        request_ptr* reqs1 = new request_ptr[max_bucket_size_act_bl];
+        request_ptr* reqs2 = new request_ptr[max_bucket_size_act_bl];
+        type_key_* refs1 = new type_key_[(size_t)max_bucket_size_act];
+        type_key_* refs2 = new type_key_[(size_t)max_bucket_size_act];
+
+        // submit reading first 2 pieces (Peter's scheme)
+        unsigned_type nbucket_blocks = (unsigned_type)div_ceil(pieces[0].second, block_type::size);
         for (i = 0; i < nbucket_blocks; i++)
-            reqs2[i] = blocks2[i].read(bucket_bids[1][i]);
+            reqs1[i] = blocks1[i].read(pieces[0].first[i]);
 
-        key_type offset = 0;
-        const unsigned log_k1 = STXXL_MAX<unsigned>(ilog2_ceil(max_bucket_size_rec * sizeof(type_key_) / STXXL_L2_SIZE), 1);
-        unsigned_type k1 = unsigned_type(1) << log_k1;
-        int_type* bucket1 = new int_type[k1];
-
-        const unsigned int shift = (unsigned int)(sizeof(key_type) * 8 - lognbuckets);
-        const unsigned int shift1 = shift - log_k1;
+        if (npieces > 1)
+        {
+            nbucket_blocks = (unsigned_type)div_ceil(pieces[1].second, block_type::size);
+            for (i = 0; i < nbucket_blocks; i++)
+                reqs2[i] = blocks2[i].read(pieces[1].first[i]);
+        }
 
-        STXXL_VERBOSE_STABLE_KSORT("Classifying " << nbuckets << " buckets, max size:" << max_bucket_size_rec <<
-                                   " block size:" << block_type::size << " log_k1:" << log_k1);
+        STXXL_VERBOSE_STABLE_KSORT("Sorting " << npieces << " pieces, max size:" << max_bucket_size_act <<
+                                   " block size:" << block_type::size);
 
-        for (unsigned_type k = 0; k < nbuckets; k++)
+        for (unsigned_type k = 0; k < npieces; k++)
         {
-            nbucket_blocks = (unsigned_type)div_ceil(bucket_sizes[k], block_type::size);
-            const unsigned log_k1_k = STXXL_MAX<unsigned>(ilog2_ceil(bucket_sizes[k] * sizeof(type_key_) / STXXL_L2_SIZE), 1);
-            assert(log_k1_k <= log_k1);
-            k1 = (unsigned_type)(1) << log_k1_k;
-            std::fill(bucket1, bucket1 + k1, 0);
-
-            STXXL_VERBOSE_STABLE_KSORT("Classifying bucket " << k << " size:" << bucket_sizes[k] <<
-                                       " blocks:" << nbucket_blocks << " log_k1:" << log_k1_k);
-            // classify first nbucket_blocks-1 blocks, they are full
+            nbucket_blocks = (unsigned_type)div_ceil(pieces[k].second, block_type::size);
+
+            STXXL_VERBOSE_STABLE_KSORT("Sorting piece " << k << " size:" << pieces[k].second <<
+                                       " blocks:" << nbucket_blocks);
+            // create references, the last block might be non-full
             type_key_* ref_ptr = refs1;
-            key_type offset1 = offset + (key_type(1) << key_type(shift)) * key_type(k);
-            for (i = 0; i < nbucket_blocks - 1; i++)
+            for (i = 0; i < nbucket_blocks; i++)
             {
                 reqs1[i]->wait();
-                stable_ksort_local::classify_block(blocks1[i].begin(), blocks1[i].end(),
-                                                   ref_ptr, bucket1, offset1, shift1 /*,k1*/);
+                const unsigned_type block_size = (i + 1 < nbucket_blocks) ? (unsigned_type)block_type::size :
+                                                 (unsigned_type)(pieces[k].second - i * block_type::size);
+                for (value_type* p = blocks1[i].begin(); p < blocks1[i].begin() + block_size; ++p)
+                    *ref_ptr++ = type_key_(p->key(), p);
             }
-            // last block might be non-full
-            const unsigned_type last_block_size =
-                (unsigned_type)(bucket_sizes[k] - (nbucket_blocks - 1) * block_type::size);
-            reqs1[i]->wait();
-
-            //STXXL_MSG("block_type::size: "<<block_type::size<<" last_block_size:"<<last_block_size);
 
-            classify_block(blocks1[i].begin(), blocks1[i].begin() + last_block_size,
-                           ref_ptr, bucket1, offset1, shift1);
+            // the radix sort is stable, key bits which are equal in the
+            // whole bucket are skipped.
+            type_key_* sorted = radix_sort_lsd(refs1, ref_ptr, refs2,
+                                               type_key_extractor<type_key_>());
 
-            exclusive_prefix_sum(bucket1, k1);
-            classify(refs1, refs1 + bucket_sizes[k], refs2, bucket1, offset1, shift1);
+            // write out all
+            for (type_key_* p = sorted; p < sorted + (ref_ptr - refs1); p++)
+                out << (*(p->ptr));
 
-            type_key_* c = refs2;
-            type_key_* d = refs1;
-            for (i = 0; i < k1; i++)
-            {
-                type_key_* cEnd = refs2 + bucket1[i];
-                type_key_* dEnd = refs1 + bucket1[i];
-
-                const unsigned log_k2 = ilog2_floor(bucket1[i]) - 1;        // adaptive bucket size
-                const unsigned_type k2 = unsigned_type(1) << log_k2;
-                int_type* bucket2 = new int_type[k2];
-                const unsigned shift2 = shift1 - log_k2;
-
-                // STXXL_MSG("Sorting bucket "<<k<<":"<<i);
-                l1sort(c, cEnd, d, bucket2, k2,
-                       offset1 + (key_type(1) << key_type(shift1)) * key_type(i),
-                       shift2);
-
-                // write out all
-                for (type_key_* p = d; p < dEnd; p++)
-                    out << (*(p->ptr));
-
-                delete[] bucket2;
-                c = cEnd;
-                d = dEnd;
-            }
             // submit next read
-            const unsigned_type bucket2submit = k + 2;
-            if (bucket2submit < nbuckets)
+            const unsigned_type piece2submit = k + 2;
+            if (piece2submit < npieces)
             {
-                nbucket_blocks = (unsigned_type)div_ceil(bucket_sizes[bucket2submit], block_type::size);
+                nbucket_blocks = (unsigned_type)div_ceil(pieces[piece2submit].second, block_type::size);
                 for (i = 0; i < nbucket_blocks; i++)
-                    reqs1[i] = blocks1[i].read(bucket_bids[bucket2submit][i]);
+                    reqs1[i] = blocks1[i].read(pieces[piece2submit].first[i]);
             }
 
             std::swap(blocks1, blocks2);
             std::swap(reqs1, reqs2);
         }
 
-        delete[] bucket1;
         delete[] refs1;
         delete[] refs2;
         delete[] blocks1;
         delete[] blocks2;
         delete[] reqs1;
         delete[] reqs2;
-        delete[] bucket_bids;
-        delete[] bucket_sizes;
+        for (i = 0; i < sorted_bids.size(); i++)
+            delete sorted_bids[i];
 
         if (last.block_offset())
         {
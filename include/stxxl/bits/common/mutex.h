@@ -148,6 +148,12 @@ public:
             m_mutex.unlock();
         }
     }
+    //! lock mutex again after unlock()
+    void lock()
+    {
+        m_mutex.lock();
+        is_locked = true;
+    }
     //! return platform specific handle
     pthread_mutex_t & native_handle()
     {
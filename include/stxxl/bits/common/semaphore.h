@@ -46,6 +46,19 @@ public:
         m_cond.notify_one();
         return res;
     }
+    //! function increments the semaphore by n and wakes up waiting threads,
+    //! equivalent to n calls of operator ++ but locking only once.
+    int signal(int n)
+    {
+        scoped_mutex_lock lock(m_mutex);
+        int res = (v += n);
+        lock.unlock();
+        if (n == 1)
+            m_cond.notify_one();
+        else if (n > 1)
+            m_cond.notify_all();
+        return res;
+    }
     //! function decrements the semaphore and blocks if the semaphore is <= 0
     //! until another thread signals a change
     int operator -- (int)
@@ -20,6 +20,7 @@
 #include <stxxl/bits/noncopyable.h>
 #include <stxxl/bits/common/rand.h>
 #include <stxxl/bits/common/simple_vector.h>
+#include <stxxl/bits/common/utils.h>
 
 STXXL_BEGIN_NAMESPACE
 
@@ -29,7 +30,9 @@ STXXL_BEGIN_NAMESPACE
 enum pager_type
 {
     random,
-    lru
+    lru,
+    second_chance,
+    two_queue
 };
 
 //! Pager with \b random replacement strategy
@@ -42,12 +45,32 @@ class random_pager
 
     size_type num_pages;
     random_number<random_uniform_fast> rnd;
+    //! page returned by the next kick()
+    size_type victim;
 
 public:
-    random_pager(size_type num_pages = n_pages) : num_pages(num_pages) { }
+    random_pager(size_type num_pages = n_pages)
+        : num_pages(num_pages), victim(num_pages ? rnd(num_pages) : 0)
+    { }
     size_type kick()
     {
-        return rnd(size());
+        size_type kicked = victim;
+        evict(kicked);
+        return kicked;
+    }
+
+    //! Returns the page the next kick() returns, without evicting it.
+    size_type peek() const
+    {
+        return victim;
+    }
+
+    //! Replaces the page in ipage, which the caller chose instead of kick(),
+    //! by a new one, see two_queue_pager::evict().
+    void evict(size_type ipage)
+    {
+        if (ipage == victim)
+            victim = rnd(size());
     }
 
     void hit(size_type ipage)
@@ -85,6 +108,19 @@ public:
         return history.back();
     }
 
+    //! Returns the page the next kick() returns, without evicting it.
+    size_type peek() const
+    {
+        return history.back();
+    }
+
+    //! Replaces the page in ipage, which the caller chose instead of kick(),
+    //! by a new one, the most recently used.
+    void evict(size_type ipage)
+    {
+        hit(ipage);
+    }
+
     void hit(size_type ipage)
     {
         assert(ipage < size());
@@ -103,6 +139,274 @@ public:
     }
 };
 
+//! Pager with \b CLOCK (second chance) replacement strategy, an
+//! approximation of LRU: hit() only sets a reference bit, which makes it
+//! cheaper than lru_pager for accesses to cached pages.
+template <unsigned npages_ = 0>
+class clock_pager : private noncopyable
+{
+    enum { n_pages = npages_ };
+
+    typedef unsigned_type size_type;
+
+    simple_vector<bool> referenced;
+    size_type hand;
+
+public:
+    clock_pager(size_type num_pages = n_pages)
+        : referenced(num_pages), hand(0)
+    {
+        for (size_type i = 0; i < size(); ++i)
+            referenced[i] = false;
+    }
+
+    //! Advances the hand to the next page not referenced since it passed
+    //! last, clearing the reference bits of the pages on its way.
+    size_type kick()
+    {
+        while (referenced[hand])
+        {
+            referenced[hand] = false;
+            hand = (hand + 1) % size();
+        }
+        size_type victim = hand;
+        hand = (hand + 1) % size();
+        return victim;
+    }
+
+    //! Returns the page the next kick() returns, without evicting it or
+    //! clearing reference bits.
+    size_type peek() const
+    {
+        for (size_type i = 0; i < size(); ++i)
+        {
+            size_type ipage = (hand + i) % size();
+            if (!referenced[ipage])
+                return ipage;
+        }
+        return hand;
+    }
+
+    //! Replaces the page in ipage, which the caller chose instead of kick(),
+    //! by a new one. The hand only moves on if it would have chosen ipage.
+    void evict(size_type ipage)
+    {
+        if (ipage == peek())
+            kick();
+    }
+
+    void hit(size_type ipage)
+    {
+        assert(ipage < size());
+        referenced[ipage] = true;
+    }
+
+    void swap(clock_pager& obj)
+    {
+        referenced.swap(obj.referenced);
+        std::swap(hand, obj.hand);
+    }
+
+    size_type size() const
+    {
+        return referenced.size();
+    }
+};
+
+//! Pager with scan resistant \b 2Q replacement strategy.
+//!
+//! Pages enter a probationary LRU queue and are promoted to a protected LRU
+//! queue when they are referenced again later. Pages are evicted from the
+//! probationary queue, which holds at least a quarter of the pages, so a scan
+//! over many pages, each referenced once, replaces only probationary pages
+//! and keeps the working set in the protected queue. As in the 2Q algorithm,
+//! correlated references are not counted: repeated hits of the same page,
+//! e.g. accessing its elements one after another, are one reference. Unlike
+//! 2Q, evicted pages are not remembered, since a pager only knows slots.
+//!
+//! All operations take constant time.
+template <unsigned npages_ = 0>
+class two_queue_pager : private noncopyable
+{
+    enum { n_pages = npages_ };
+
+    typedef unsigned_type size_type;
+    typedef std::list<size_type> list_type;
+
+    //! state of a slot: inserted after kick(), referenced once more, or in
+    //! the protected queue
+    enum { inserted, referenced, protect };
+
+    //! probationary and protected LRU queues
+    list_type probation, protection;
+    //! number of pages in the protected queue
+    size_type num_protected;
+    simple_vector<list_type::iterator> history_entry;
+    simple_vector<unsigned char> state;
+    //! maximum size of the protected queue
+    size_type max_protected;
+    //! slot of the last hit, to skip correlated references
+    size_type last_hit;
+    //! slot of the last kick() or evict(), whose next hit loaded its page
+    size_type kicked;
+
+public:
+    two_queue_pager(size_type num_pages = n_pages)
+        : num_protected(0), history_entry(num_pages), state(num_pages),
+          max_protected(num_pages > 1 ? num_pages - STXXL_MAX<size_type>(num_pages / 4, 1) : 0),
+          last_hit(num_pages), kicked(num_pages)
+    {
+        for (size_type i = 0; i < size(); ++i)
+        {
+            history_entry[i] = probation.insert(probation.end(), i);
+            state[i] = inserted;
+        }
+    }
+
+    size_type kick()
+    {
+        size_type victim = peek();
+        evict(victim);
+        return victim;
+    }
+
+    //! Returns the page the next kick() returns, without evicting it.
+    size_type peek() const
+    {
+        return probation.empty() ? protection.back() : probation.back();
+    }
+
+    //! Replaces the page in ipage, which the caller chose instead of kick(),
+    //! by a new one, which enters the probationary queue without being
+    //! referenced. The next hit of ipage, if it immediately follows, is the
+    //! access which loaded the page and not counted either. Hence pages read
+    //! ahead are inserted by evict() alone and count their first access.
+    void evict(size_type ipage)
+    {
+        assert(ipage < size());
+        if (state[ipage] == protect) {
+            probation.splice(probation.begin(), protection, history_entry[ipage]);
+            --num_protected;
+        }
+        else
+            probation.splice(probation.begin(), probation, history_entry[ipage]);
+        state[ipage] = inserted;
+        kicked = ipage;
+    }
+
+    void hit(size_type ipage)
+    {
+        assert(ipage < size());
+
+        if (ipage == kicked)
+        {
+            // the access which loaded the new page of the kicked slot
+            kicked = size();
+        }
+        else if (ipage == last_hit)
+        {
+            return;
+        }
+        else if (state[ipage] == inserted)
+        {
+            state[ipage] = referenced;
+            probation.splice(probation.begin(), probation, history_entry[ipage]);
+        }
+        else if (state[ipage] == referenced)
+        {
+            state[ipage] = protect;
+            protection.splice(protection.begin(), probation, history_entry[ipage]);
+            if (++num_protected > max_protected)
+            {
+                // demote the least recently used protected page
+                size_type demoted = protection.back();
+                state[demoted] = referenced;
+                probation.splice(probation.begin(), protection, history_entry[demoted]);
+                --num_protected;
+            }
+        }
+        else
+        {
+            protection.splice(protection.begin(), protection, history_entry[ipage]);
+        }
+        last_hit = ipage;
+    }
+
+    void swap(two_queue_pager& obj)
+    {
+        probation.swap(obj.probation);
+        protection.swap(obj.protection);
+        std::swap(num_protected, obj.num_protected);
+        history_entry.swap(obj.history_entry);
+        state.swap(obj.state);
+        std::swap(max_protected, obj.max_protected);
+        std::swap(last_hit, obj.last_hit);
+        std::swap(kicked, obj.kicked);
+    }
+
+    size_type size() const
+    {
+        return history_entry.size();
+    }
+};
+
+//! Detects sequential, backward and strided accesses to the pages of a
+//! vector and computes how many pages to read ahead.
+//!
+//! The vector reports each page fault and each first access to a page read
+//! ahead. Once two consecutive reports advanced by the same stride, the next
+//! page in stride direction is to be read ahead, and each further report with
+//! this stride doubles the read-ahead window up to max_window pages. Any other
+//! report ends read-ahead until a stride is confirmed again.
+class read_ahead_detector
+{
+    typedef unsigned_type size_type;
+
+    //! last page reported and its distance to the one before
+    int_type m_last_page, m_stride;
+    //! current and maximum number of pages to read ahead
+    size_type m_window, m_max_window;
+
+public:
+    read_ahead_detector(size_type max_window = 0)
+        : m_last_page(0), m_stride(0), m_window(0), m_max_window(max_window)
+    { }
+
+    //! Reports an access to page_no and returns the number of pages following
+    //! page_no in distance get_stride() to read ahead.
+    size_type access(int_type page_no)
+    {
+        int_type stride = page_no - m_last_page;
+        m_last_page = page_no;
+
+        if (stride != 0 && stride == m_stride)
+            m_window = STXXL_MIN(m_window ? 2 * m_window : 1, m_max_window);
+        else
+            m_stride = stride, m_window = 0;
+
+        return m_window;
+    }
+
+    //! Returns the distance of the pages to read ahead.
+    int_type get_stride() const
+    {
+        return m_stride;
+    }
+
+    //! Returns the maximum number of pages read ahead, 0 if disabled.
+    size_type get_max_window() const
+    {
+        return m_max_window;
+    }
+
+    //! Sets the maximum number of pages read ahead, 0 disables read-ahead.
+    void set_max_window(size_type max_window)
+    {
+        m_max_window = max_window;
+        m_window = STXXL_MIN(m_window, max_window);
+    }
+};
+
 //! \}
 
 STXXL_END_NAMESPACE
@@ -116,6 +420,20 @@ void swap(stxxl::lru_pager<npages_>& a,
     a.swap(b);
 }
 
+template <unsigned npages_>
+void swap(stxxl::clock_pager<npages_>& a,
+          stxxl::clock_pager<npages_>& b)
+{
+    a.swap(b);
+}
+
+template <unsigned npages_>
+void swap(stxxl::two_queue_pager<npages_>& a,
+          stxxl::two_queue_pager<npages_>& b)
+{
+    a.swap(b);
+}
+
 } // namespace std
 
 #endif // !STXXL_CONTAINERS_PAGER_HEADER
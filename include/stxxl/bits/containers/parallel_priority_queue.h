@@ -915,7 +915,10 @@ protected:
 
         m_minima[block_index] = this_block[0];
 
-        // write out block (in background)
+        // write out block (in background). The blocks are stored unchanged,
+        // the comparator's run_codec is not applied as for sort runs: the
+        // read_write_pool hands blocks still being written back to readers
+        // from memory, which needs them unencoded.
         m_pool->write(m_blocks[block_index], m_bids[block_index]);
 
         m_blocks[block_index] = NULL;
@@ -31,6 +31,10 @@ namespace priority_queue_local {
 
 /*!
  * External merger, based on the loser tree data structure.
+ *
+ * The sequences are ended by the sentinel CompareType::min_value(), and empty
+ * slots read from a block filled with it, so the comparator must provide it.
+ *
  * \param Arity  maximum arity of merger, does not need to be a power of 2
  */
 template <class BlockType, class CompareType, unsigned Arity,
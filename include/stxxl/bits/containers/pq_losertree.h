@@ -32,6 +32,11 @@ namespace priority_queue_local {
 // The data structure from Knuth, "Sorting and Searching", Section 5.4.1
 /*!
  * Loser tree from Knuth, "Sorting and Searching", Section 5.4.1
+ *
+ * The segments are ended by the sentinel CompareType::min_value(), which the
+ * comparator must provide. The sentinel-free merging of the sorters, see
+ * sort_helper::has_sentinels, is not available here.
+ *
  * \param  MaxArity  maximum arity of loser tree, has to be a power of two
  */
 template <class ValueType, class CompareType, unsigned MaxArity>
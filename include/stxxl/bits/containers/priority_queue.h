@@ -94,6 +94,11 @@ STXXL_BEGIN_NAMESPACE
 //! External priority queue data structure \n
 //! <b> Introduction </b> to priority queue container: see \ref tutorial_pqueue tutorial. \n
 //! <b> Design and Internals </b> of priority queue container: see \ref design_pqueue.
+//!
+//! Unlike the sorters, the priority queue has no sentinel-free variant: the
+//! comparator must provide min_value(), which ends the segments of the
+//! internal and external mergers and the buffers, and marks the empty slots
+//! of the loser trees.
 template <class ConfigType>
 class priority_queue : private noncopyable
 {
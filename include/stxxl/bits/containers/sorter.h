@@ -38,6 +38,11 @@ STXXL_BEGIN_NAMESPACE
  * In the first phase the container is filled with unordered items via push(),
  * which are presorted internally into runs of size M. When the internal memory
  * overflows a runs is written to external memory in blocks of block_size.
+ * If all items fit into half of the memory of the runs creator, no run is
+ * written: sort() sorts them internally (in parallel, if enabled) and copies
+ * them into a small run after releasing the other, unused half, so they are
+ * read back from main memory without any disk I/O and within the memory of the
+ * runs creator.
  *
  * When sort() is called the container enters the output phase and push() is
  * disallowed. After calling sort() the items can be read in sorted order using
@@ -27,6 +27,8 @@
 #include <stxxl/bits/common/tmeta.h>
 #include <stxxl/bits/containers/pager.h>
 #include <stxxl/bits/common/is_sorted.h>
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/common/condition_variable.h>
 #include <stxxl/bits/mng/buf_istream.h>
 #include <stxxl/bits/mng/buf_istream_reverse.h>
 #include <stxxl/bits/mng/buf_ostream.h>
@@ -267,6 +269,12 @@ class vector_bufreader_reverse;
 template <typename VectorIteratorType>
 class vector_bufwriter;
 
+template <typename VectorIteratorType>
+class vector_partitioned_bufreader;
+
+template <typename VectorIteratorType>
+class vector_partitioned_bufwriter;
+
 ////////////////////////////////////////////////////////////////////////////
 
 //! External vector iterator, model of \c ext_random_access_iterator concept.
@@ -808,8 +816,8 @@ public:
 //! For semantics of the methods see documentation of the STL std::vector
 //! \tparam ValueType type of contained objects (POD with no references to internal memory)
 //! \tparam PageSize number of blocks in a page
-//! \tparam PagerType pager type, \c random_pager<x> or \c lru_pager<x>, where x is the default number of pages,
-//!  default is \c lru_pager<8>
+//! \tparam PagerType pager type, \c random_pager<x>, \c lru_pager<x>, \c clock_pager<x> or the scan
+//!  resistant \c two_queue_pager<x>, where x is the default number of pages, default is \c lru_pager<8>
 //! \tparam BlockSize external block size in bytes, default is 2 MiB
 //! \tparam AllocStr one of allocation strategies: \c striping , \c RC , \c SR , or \c FR
 //!  default is RC
@@ -880,6 +888,12 @@ public:
     //! vector_bufreader compatible with this vector
     typedef vector_bufreader_reverse<const_iterator> bufreader_reverse_type;
 
+    //! vector_partitioned_bufwriter compatible with this vector
+    typedef vector_partitioned_bufwriter<iterator> partitioned_bufwriter_type;
+
+    //! vector_partitioned_bufreader compatible with this vector
+    typedef vector_partitioned_bufreader<const_iterator> partitioned_bufreader_type;
+
     //! \internal
     class bid_vector : public std::vector<BID<block_size> >
     {
@@ -910,13 +924,35 @@ private:
     mutable pager_type m_pager;
 
     // enum specifying status of a page of the vector
-    enum { valid_on_disk = 0, uninitialized = 1, dirty = 2 };
-    //! status of each page (valid_on_disk, uninitialized or dirty)
+    enum { valid_on_disk = 0, uninitialized = 1, dirty = 2, loading = 4, reading_ahead = 8, writing_back = 16 };
+    //! status of each page (valid_on_disk, uninitialized or dirty), or'ed
+    //! with loading while get_concurrent() reads the page, reading_ahead
+    //! while the page is read ahead, or writing_back while a dirty page is
+    //! written back
     mutable std::vector<unsigned char> m_page_status;
     mutable std::vector<int_type> m_page_to_slot;
     mutable simple_vector<int_type> m_slot_to_page;
     mutable std::queue<int_type> m_free_slots;
     mutable simple_vector<block_type>* m_cache;
+    //! detects strided page accesses to read ahead
+    mutable read_ahead_detector m_read_ahead;
+    //! requests reading ahead or writing back the pages of the cache slots,
+    //! page_size per slot
+    mutable simple_vector<request_ptr> m_async_reqs;
+    //! number of pages being read ahead or written back
+    mutable unsigned_type m_async_pages;
+    //! number of dirty pages in the cache not being written back
+    mutable unsigned_type m_dirty_pages;
+    //! number of dirty pages above which the pager's next victim is written back
+    unsigned_type m_dirty_budget;
+    //! number of most recently accessed slots never evicted or written back
+    enum { num_recent_slots = 2 };
+    //! most recently accessed slots, whose elements may still be referenced
+    mutable int_type m_recent_slots[num_recent_slots];
+    //! protects pager and page tables in get_concurrent()
+    mutable mutex m_mutex;
+    //! signaled when get_concurrent() finished loading a page
+    mutable condition_variable m_page_loaded;
     file* m_from;
     block_manager* m_bm;
     bool m_exported;
@@ -929,6 +965,25 @@ private:
         return (cur_size + rest / stxxl::uint64(sizeof(value_type)));
     }
 
+    //! Sets up page tables and allocates the blocks of a new vector.
+    void init_new()
+    {
+        m_bm = block_manager::get_instance();
+
+        allocate_page_cache();
+
+        for (size_t i = 0; i < m_page_status.size(); ++i)
+        {
+            m_page_status[i] = uninitialized;
+            m_page_to_slot[i] = on_disk;
+        }
+
+        for (unsigned_type i = 0; i < numpages(); ++i)
+            m_free_slots.push(i);
+
+        m_bm->new_blocks(m_alloc_strategy, m_bids.begin(), m_bids.end(), 0);
+    }
+
     stxxl::uint64 file_length() const
     {
         typedef stxxl::uint64 file_size_type;
@@ -958,23 +1013,43 @@ public:
           m_page_to_slot(div_ceil(m_bids.size(), page_size)),
           m_slot_to_page(npages),
           m_cache(NULL),
+          m_read_ahead(npages / 2),
+          m_async_reqs(npages * page_size),
+          m_async_pages(0),
+          m_dirty_pages(0),
+          m_dirty_budget(default_dirty_budget(npages)),
           m_from(NULL),
           m_exported(false)
     {
-        m_bm = block_manager::get_instance();
-
-        allocate_page_cache();
-
-        for (size_t i = 0; i < m_page_status.size(); ++i)
-        {
-            m_page_status[i] = uninitialized;
-            m_page_to_slot[i] = on_disk;
-        }
-
-        for (unsigned_type i = 0; i < numpages(); ++i)
-            m_free_slots.push(i);
+        init_new();
+    }
 
-        m_bm->new_blocks(m_alloc_strategy, m_bids.begin(), m_bids.end(), 0);
+    //! Constructs external vector with n elements, whose blocks are
+    //! allocated with the given allocation strategy object.
+    //!
+    //! \param n Number of elements.
+    //! \param alloc_strategy Allocation strategy, e.g. a
+    //! dynamic_alloc_strategy selected at run time.
+    //! \param npages Number of cached pages.
+    vector(size_type n, const alloc_strategy_type& alloc_strategy,
+           unsigned_type npages = pager_type().size())
+        : m_alloc_strategy(alloc_strategy),
+          m_size(n),
+          m_bids((size_t)div_ceil(n, block_type::size)),
+          m_pager(npages),
+          m_page_status(div_ceil(m_bids.size(), page_size)),
+          m_page_to_slot(div_ceil(m_bids.size(), page_size)),
+          m_slot_to_page(npages),
+          m_cache(NULL),
+          m_read_ahead(npages / 2),
+          m_async_reqs(npages * page_size),
+          m_async_pages(0),
+          m_dirty_pages(0),
+          m_dirty_budget(default_dirty_budget(npages)),
+          m_from(NULL),
+          m_exported(false)
+    {
+        init_new();
     }
 
     //! \}
@@ -994,6 +1069,13 @@ public:
         std::swap(m_slot_to_page, obj.m_slot_to_page);
         std::swap(m_free_slots, obj.m_free_slots);
         std::swap(m_cache, obj.m_cache);
+        std::swap(m_read_ahead, obj.m_read_ahead);
+        std::swap(m_async_reqs, obj.m_async_reqs);
+        std::swap(m_async_pages, obj.m_async_pages);
+        std::swap(m_dirty_pages, obj.m_dirty_pages);
+        std::swap(m_dirty_budget, obj.m_dirty_budget);
+        std::swap_ranges(m_recent_slots, m_recent_slots + num_recent_slots,
+                         obj.m_recent_slots);
         std::swap(m_from, obj.m_from);
         std::swap(m_exported, obj.m_exported);
     }
@@ -1009,6 +1091,7 @@ public:
         //  numpages() might be zero
         if (!m_cache && numpages() > 0)
             m_cache = new simple_vector<block_type>(numpages() * page_size);
+        std::fill(m_recent_slots, m_recent_slots + num_recent_slots, int_type(-1));
     }
 
     //! allows to free the cache, but you may not access any element until call
@@ -1113,6 +1196,7 @@ private:
     {
         reserve(n);
         if (n < m_size) {
+            finish_async_all();
             // mark excess pages as uninitialized and evict them from cache
             unsigned_type first_page_to_evict = (unsigned_type)div_ceil(n, block_type::size * page_size);
             for (size_t i = first_page_to_evict; i < m_page_status.size(); ++i) {
@@ -1122,6 +1206,7 @@ private:
                 }
                 m_page_status[i] = uninitialized;
             }
+            count_dirty_pages();
         }
         m_size = n;
     }
@@ -1138,6 +1223,8 @@ private:
         }
         else if (new_bids_size < old_bids_size)
         {
+            finish_async_all();
+
             unsigned_type new_pages_size = div_ceil(new_bids_size, page_size);
 
             STXXL_VERBOSE_VECTOR("shrinking from " << old_bids_size << " to " <<
@@ -1160,6 +1247,7 @@ private:
             // clear dirty flag, so these pages will be never written
             std::fill(m_page_status.begin() + new_pages_size,
                       m_page_status.end(), (unsigned char)valid_on_disk);
+            count_dirty_pages();
         }
 
         m_size = n;
@@ -1173,6 +1261,8 @@ public:
     //! occupied.
     void clear()
     {
+        finish_async_all();
+
         m_size = 0;
         if (m_from == NULL)
             m_bm->delete_blocks(m_bids.begin(), m_bids.end());
@@ -1180,6 +1270,7 @@ public:
         m_bids.clear();
         m_page_status.clear();
         m_page_to_slot.clear();
+        m_dirty_pages = 0;
         while (!m_free_slots.empty())
             m_free_slots.pop();
 
@@ -1249,6 +1340,11 @@ public:
           m_page_to_slot(div_ceil(m_bids.size(), page_size)),
           m_slot_to_page(npages),
           m_cache(NULL),
+          m_read_ahead(npages / 2),
+          m_async_reqs(npages * page_size),
+          m_async_pages(0),
+          m_dirty_pages(0),
+          m_dirty_budget(default_dirty_budget(npages)),
           m_from(from),
           m_exported(false)
     {
@@ -1294,6 +1390,11 @@ public:
           m_page_to_slot(div_ceil(m_bids.size(), page_size)),
           m_slot_to_page(obj.numpages()),
           m_cache(NULL),
+          m_read_ahead(obj.numpages() / 2),
+          m_async_reqs(obj.numpages() * page_size),
+          m_async_pages(0),
+          m_dirty_pages(0),
+          m_dirty_budget(default_dirty_budget(obj.numpages())),
           m_from(NULL),
           m_exported(false)
     {
@@ -1436,15 +1537,35 @@ public:
         return is_page_cached(blocked_index_type(offset));
     }
 
+    //! Returns a copy of the element at the given vector's offset. Unlike
+    //! operator[], this method may be called by many threads concurrently,
+    //! e.g. for lookups from an OpenMP parallel loop, as long as the vector is
+    //! neither accessed otherwise nor modified meanwhile.
+    //!
+    //! Page table and pager are locked only while looking up and replacing
+    //! pages; the pages are read, and dirty evicted pages written, outside of
+    //! the lock, so threads missing different pages wait for their I/Os in
+    //! parallel. Threads missing a page which is being read or written wait
+    //! for it.
+    value_type get_concurrent(size_type offset) const
+    {
+        assert(offset < (size_type)size());
+        return get_concurrent(blocked_index_type(offset));
+    }
+
     //! \}
 
     //! \name Modifiers
     //! \{
 
-    //! Flushes the cache pages to the external memory.
+    //! Flushes the cache pages to the external memory. The writes of all dirty
+    //! pages are posted at once, sorted by their offsets on the disks.
     void flush() const
     {
+        finish_async_all();
+
         simple_vector<bool> non_free_slots(numpages());
+        std::vector<block_write_type> writes;
 
         for (unsigned_type i = 0; i < numpages(); i++)
             non_free_slots[i] = true;
@@ -1461,13 +1582,32 @@ public:
             int_type page_no = m_slot_to_page[i];
             if (non_free_slots[i])
             {
-                STXXL_VERBOSE_VECTOR("flush(): flushing page " << i << " at address " <<
-                                     (int64(page_no) * int64(block_type::size) * int64(page_size)));
-                write_page(page_no, i);
+                if (m_page_status[page_no] & dirty)
+                {
+                    STXXL_VERBOSE_VECTOR("flush(): flushing page " << i << " at address " <<
+                                         (int64(page_no) * int64(block_type::size) * int64(page_size)));
+                    int_type block_no = page_no * page_size;
+                    int_type last_block = STXXL_MIN(block_no + page_size, int_type(m_bids.size()));
+                    for (int_type j = i * page_size; block_no < last_block; ++block_no, ++j)
+                        writes.push_back(std::make_pair(m_bids[block_no], j));
+                    m_page_status[page_no] = valid_on_disk;
+                }
 
                 m_page_to_slot[page_no] = on_disk;
             }
         }
+        m_dirty_pages = 0;
+
+        if (writes.empty())
+            return;
+
+        std::sort(writes.begin(), writes.end(), write_offset_less());
+        request_ptr* reqs = new request_ptr[writes.size()];
+        for (size_t k = 0; k < writes.size(); ++k)
+            reqs[k] = (*m_cache)[writes[k].second].write(writes[k].first);
+        stats::scoped_wait_site wait_site("vector::flush");
+        wait_all(reqs, writes.size());
+        delete[] reqs;
     }
 
     //! \}
@@ -1568,9 +1708,48 @@ public:
         return m_pager.size();
     }
 
+    //! Sets the maximum number of pages read ahead asynchronously when the
+    //! vector detects sequential, backward or strided accesses to its pages,
+    //! at most half of the cached pages. 0 disables read-ahead, which is
+    //! enabled with the maximum by default.
+    void set_read_ahead(unsigned_type max_pages)
+    {
+        m_read_ahead.set_max_window(STXXL_MIN(max_pages, numpages() / 2));
+    }
+
+    //! Returns the maximum number of pages read ahead, 0 if disabled.
+    unsigned_type get_read_ahead() const
+    {
+        return m_read_ahead.get_max_window();
+    }
+
+    //! Sets the number of dirty pages the cache may hold, at least one. When
+    //! a page becomes dirty beyond it, the page the pager evicts next is
+    //! written back asynchronously if it is dirty, so evicting it later needs
+    //! no write. The most recently modified pages are never written back. The
+    //! default budget is all pages but these. With numpages() or more, dirty
+    //! pages are written only when evicted or flushed.
+    void set_dirty_budget(unsigned_type max_pages)
+    {
+        m_dirty_budget = STXXL_MAX<unsigned_type>(max_pages, 1);
+    }
+
+    //! Returns the number of dirty pages the cache may hold.
+    unsigned_type get_dirty_budget() const
+    {
+        return m_dirty_budget;
+    }
+
     //! \}
 
 private:
+    //! Returns the default dirty budget: all pages but the most recently
+    //! accessed ones, which are never written back, and at least one.
+    static unsigned_type default_dirty_budget(unsigned_type npages)
+    {
+        return STXXL_MAX<unsigned_type>(npages, num_recent_slots + 1) - num_recent_slots;
+    }
+
     bids_container_iterator bid(const size_type& offset)
     {
         return (m_bids.begin() +
@@ -1611,6 +1790,7 @@ private:
             reqs[j] = (*m_cache)[i].read(m_bids[block_no]);
         }
         assert(last_block - page_no * page_size > 0);
+        stats::scoped_wait_site wait_site("vector::read_page");
         wait_all(reqs, last_block - page_no * page_size);
         delete[] reqs;
     }
@@ -1619,6 +1799,14 @@ private:
         assert(page_no < (int_type)m_page_status.size());
         if (!(m_page_status[page_no] & dirty))
             return;
+        write_page_blocks(page_no, cache_slot);
+        m_page_status[page_no] = valid_on_disk;
+        --m_dirty_pages;
+    }
+    //! Writes the blocks of page_no from cache_slot and waits for them,
+    //! without changing the status of the page.
+    void write_page_blocks(int_type page_no, int_type cache_slot) const
+    {
         STXXL_VERBOSE_VECTOR("write_page(): page_no=" << page_no << " cache_slot=" << cache_slot);
         request_ptr* reqs = new request_ptr[page_size];
         int_type block_no = page_no * page_size;
@@ -1629,12 +1817,228 @@ private:
         {
             reqs[j] = (*m_cache)[i].write(m_bids[block_no]);
         }
-        m_page_status[page_no] = valid_on_disk;
         assert(last_block - page_no * page_size > 0);
+        stats::scoped_wait_site wait_site("vector::write_page");
         wait_all(reqs, last_block - page_no * page_size);
         delete[] reqs;
     }
 
+    //! Reports an access to page_no, which is cached in cache_slot, to the
+    //! read-ahead detector, and posts reads of the pages it asks for into free
+    //! slots or slots evicted by the pager.
+    void read_ahead(int_type page_no, int_type cache_slot) const
+    {
+        unsigned_type window = m_read_ahead.access(page_no);
+        int_type stride = m_read_ahead.get_stride();
+        int_type ahead_page_no = page_no;
+
+        for (unsigned_type k = 0; k < window; ++k)
+        {
+            ahead_page_no += stride;
+            if (ahead_page_no < 0 || ahead_page_no * page_size >= int_type(m_bids.size()))
+                break;
+            // skip cached pages and pages never written
+            if (m_page_to_slot[ahead_page_no] != on_disk ||
+                m_page_status[ahead_page_no] != valid_on_disk)
+                continue;
+
+            int_type ahead_slot = read_ahead_slot(cache_slot);
+            if (ahead_slot < 0)
+                break;
+
+            STXXL_VERBOSE_VECTOR("read_ahead(): page_no=" << ahead_page_no << " cache_slot=" << ahead_slot);
+            m_page_to_slot[ahead_page_no] = ahead_slot;
+            m_slot_to_page[ahead_slot] = ahead_page_no;
+            m_page_status[ahead_page_no] = reading_ahead;
+            ++m_async_pages;
+
+            int_type block_no = ahead_page_no * page_size;
+            int_type last_block = STXXL_MIN(block_no + page_size, int_type(m_bids.size()));
+            int_type i = ahead_slot * page_size;
+            for ( ; block_no < last_block; ++block_no, ++i)
+            {
+                m_async_reqs[i] = (*m_cache)[i].read(m_bids[block_no]);
+            }
+        }
+    }
+
+    //! Returns a free slot to read a page ahead into, or evicts the pager's
+    //! choice, unless that is cache_slot or a page being read ahead or written
+    //! back. A dirty choice is not waited for but written back
+    //! asynchronously, such that a later read-ahead may take its slot.
+    //! \return the slot, or -1 if none was evicted
+    int_type read_ahead_slot(int_type cache_slot) const
+    {
+        if (!m_free_slots.empty())
+        {
+            int_type free_slot = m_free_slots.front();
+            m_free_slots.pop();
+            m_pager.evict(free_slot);
+            return free_slot;
+        }
+
+        int_type kicked_slot = m_pager.peek();
+        int_type old_page_no = m_slot_to_page[kicked_slot];
+        if (kicked_slot == cache_slot || is_recent_slot(kicked_slot) ||
+            (m_page_status[old_page_no] & (reading_ahead | writing_back)))
+            return -1;
+
+        if (m_page_status[old_page_no] & dirty)
+        {
+            write_back(old_page_no, kicked_slot);
+            return -1;
+        }
+
+        m_pager.evict(kicked_slot);
+        m_page_to_slot[old_page_no] = on_disk;
+        return kicked_slot;
+    }
+
+    //! block to write in flush() and its index in the cache
+    typedef std::pair<typename bids_container_type::bid_type, int_type> block_write_type;
+
+    //! orders the writes of flush() by disk and offset
+    struct write_offset_less
+    {
+        bool operator () (const block_write_type& a, const block_write_type& b) const
+        {
+            return (a.first.storage < b.first.storage) ||
+                   (a.first.storage == b.first.storage && a.first.offset < b.first.offset);
+        }
+    };
+
+    //! Waits for the reads or writes of page_no, which is read ahead into or
+    //! written back from cache_slot. A page written back is clean afterwards,
+    //! unless it is touched again, i.e. about to be modified.
+    void finish_async(int_type page_no, int_type cache_slot, bool touched = false) const
+    {
+        assert(m_page_status[page_no] & (reading_ahead | writing_back));
+        const char* site = "vector::read_ahead";
+        if (m_page_status[page_no] & writing_back)
+        {
+            site = "vector::write_back";
+            if (touched)
+                ++m_dirty_pages;
+            else
+                m_page_status[page_no] &= (unsigned char)~dirty;
+        }
+        m_page_status[page_no] &= (unsigned char)~(reading_ahead | writing_back);
+        --m_async_pages;
+
+        int_type num_blocks = STXXL_MIN(int_type(page_size),
+                                        int_type(m_bids.size()) - page_no * page_size);
+        request_ptr* reqs = &m_async_reqs[cache_slot * page_size];
+        stats::scoped_wait_site wait_site(site);
+        wait_all(reqs, num_blocks);
+        for (int_type j = 0; j < num_blocks; ++j)
+            reqs[j] = request_ptr();
+    }
+
+    //! Waits for all pages being read ahead or written back.
+    void finish_async_all() const
+    {
+        for (unsigned_type i = 0; m_async_pages > 0 && i < numpages(); ++i)
+        {
+            int_type page_no = m_slot_to_page[i];
+            if (page_no >= 0 && page_no < int_type(m_page_status.size()) &&
+                m_page_to_slot[page_no] == int_type(i) &&
+                (m_page_status[page_no] & (reading_ahead | writing_back)))
+                finish_async(page_no, i);
+        }
+    }
+
+    //! Recounts the dirty pages in the cache after pages were discarded.
+    void count_dirty_pages() const
+    {
+        m_dirty_pages = 0;
+        for (unsigned_type i = 0; i < numpages(); ++i)
+        {
+            int_type page_no = m_slot_to_page[i];
+            if (page_no >= 0 && page_no < int_type(m_page_status.size()) &&
+                m_page_to_slot[page_no] == int_type(i) &&
+                (m_page_status[page_no] & (dirty | writing_back)) == dirty)
+                ++m_dirty_pages;
+        }
+    }
+
+    //! Remembers cache_slot as the most recently accessed slot.
+    void touch_slot(int_type cache_slot) const
+    {
+        if (m_recent_slots[0] != cache_slot)
+        {
+            std::copy_backward(m_recent_slots, m_recent_slots + num_recent_slots - 1,
+                               m_recent_slots + num_recent_slots);
+            m_recent_slots[0] = cache_slot;
+        }
+    }
+
+    //! Returns whether cache_slot was among the most recently accessed slots,
+    //! whose elements the caller may still hold references to.
+    bool is_recent_slot(int_type cache_slot) const
+    {
+        for (int_type i = 0; i < num_recent_slots; ++i)
+            if (m_recent_slots[i] == cache_slot)
+                return true;
+        return false;
+    }
+
+    //! Evicts the pager's choice of a slot, or the next slot which was not
+    //! accessed recently, as pagers other than LRU may choose slots whose
+    //! elements are still referenced, e.g. in v[i] = v[j].
+    int_type kick_slot() const
+    {
+        int_type kicked_slot = m_pager.peek();
+        if (numpages() > num_recent_slots)
+        {
+            while (is_recent_slot(kicked_slot))
+                kicked_slot = (kicked_slot + 1) % int_type(numpages());
+        }
+        m_pager.evict(kicked_slot);
+        return kicked_slot;
+    }
+
+    //! Marks page_no, which is cached, dirty. While more pages than the dirty
+    //! budget are dirty, the pager's next victim is written back
+    //! asynchronously, unless it is clean, busy or recently accessed.
+    void set_dirty(int_type page_no) const
+    {
+        assert(!(m_page_status[page_no] & (reading_ahead | writing_back)));
+        if (m_page_status[page_no] & dirty)
+            return;
+        m_page_status[page_no] = dirty;
+        ++m_dirty_pages;
+
+        if (m_dirty_pages <= m_dirty_budget || !m_free_slots.empty())
+            return;
+
+        int_type victim_slot = m_pager.peek();
+        int_type victim_page_no = m_slot_to_page[victim_slot];
+        if (victim_page_no < 0 || victim_page_no >= int_type(m_page_status.size()) ||
+            m_page_to_slot[victim_page_no] != victim_slot ||
+            m_page_status[victim_page_no] != dirty ||
+            is_recent_slot(victim_slot))
+            return;
+
+        write_back(victim_page_no, victim_slot);
+    }
+
+    //! Posts the writes of page_no, which is dirty in cache_slot. The page
+    //! stays dirty until finish_async() waited for the writes.
+    void write_back(int_type page_no, int_type cache_slot) const
+    {
+        STXXL_VERBOSE_VECTOR("write_back(): page_no=" << page_no << " cache_slot=" << cache_slot);
+        int_type block_no = page_no * page_size;
+        int_type last_block = STXXL_MIN(block_no + page_size, int_type(m_bids.size()));
+        int_type i = cache_slot * page_size;
+        for ( ; block_no < last_block; ++block_no, ++i)
+        {
+            m_async_reqs[i] = (*m_cache)[i].write(m_bids[block_no]);
+        }
+        m_page_status[page_no] = dirty | writing_back;
+        --m_dirty_pages;
+        ++m_async_pages;
+    }
+
     reference element(size_type offset)
     {
 #ifdef STXXL_RANGE_CHECK
@@ -1655,9 +2059,11 @@ private:
         {
             if (m_free_slots.empty())              // has to kick
             {
-                int_type kicked_slot = m_pager.kick();
+                int_type kicked_slot = kick_slot();
                 m_pager.hit(kicked_slot);
                 int_type old_page_no = m_slot_to_page[kicked_slot];
+                if (m_page_status[old_page_no] & (reading_ahead | writing_back))
+                    finish_async(old_page_no, kicked_slot);
                 m_page_to_slot[page_no] = kicked_slot;
                 m_page_to_slot[old_page_no] = on_disk;
                 m_slot_to_page[kicked_slot] = page_no;
@@ -1665,7 +2071,10 @@ private:
                 write_page(old_page_no, kicked_slot);
                 read_page(page_no, kicked_slot);
 
-                m_page_status[page_no] = dirty;
+                m_page_status[page_no] = valid_on_disk;
+                touch_slot(kicked_slot);
+                set_dirty(page_no);
+                read_ahead(page_no, kicked_slot);
 
                 return (*m_cache)[kicked_slot * page_size + offset.get_block1()][offset.get_offset()];
             }
@@ -1673,30 +2082,155 @@ private:
             {
                 int_type free_slot = m_free_slots.front();
                 m_free_slots.pop();
+                m_pager.evict(free_slot);
                 m_pager.hit(free_slot);
                 m_page_to_slot[page_no] = free_slot;
                 m_slot_to_page[free_slot] = page_no;
 
                 read_page(page_no, free_slot);
 
-                m_page_status[page_no] = dirty;
+                m_page_status[page_no] = valid_on_disk;
+                touch_slot(free_slot);
+                set_dirty(page_no);
+                read_ahead(page_no, free_slot);
 
                 return (*m_cache)[free_slot * page_size + offset.get_block1()][offset.get_offset()];
             }
         }
         else
         {
-            m_page_status[page_no] = dirty;
+            if (m_page_status[page_no] & reading_ahead)
+            {
+                finish_async(page_no, cache_slot);
+                read_ahead(page_no, cache_slot);
+            }
+            else if (m_page_status[page_no] & writing_back)
+            {
+                finish_async(page_no, cache_slot, true);
+            }
+            touch_slot(cache_slot);
+            set_dirty(page_no);
             m_pager.hit(cache_slot);
             return (*m_cache)[cache_slot * page_size + offset.get_block1()][offset.get_offset()];
         }
     }
 
+    value_type get_concurrent(const blocked_index_type& offset) const
+    {
+        unsigned_type page_no = offset.get_block2();
+        assert(page_no < m_page_to_slot.size());   // fails if offset is too large, out of bound access
+
+        scoped_mutex_lock lock(m_mutex);
+        if (m_async_pages > 0)
+            finish_async_all();
+        int_type cache_slot;
+        for ( ; ; )
+        {
+            cache_slot = m_page_to_slot[page_no];
+            if (cache_slot >= 0 && !(m_page_status[page_no] & loading))
+            {
+                m_pager.hit(cache_slot);
+                return (*m_cache)[cache_slot * page_size + offset.get_block1()][offset.get_offset()];
+            }
+            if (cache_slot < 0 && (cache_slot = concurrent_slot(lock)) >= 0)
+            {
+                // another thread may have loaded the page while the lock was
+                // dropped to write back the evicted one
+                if (m_page_to_slot[page_no] < 0)
+                    break;
+                m_free_slots.push(cache_slot);
+                continue;
+            }
+            // wait for the page, or for any page if all slots are being read
+            m_page_loaded.wait(lock);
+        }
+
+        m_page_to_slot[page_no] = cache_slot;
+        m_slot_to_page[cache_slot] = page_no;
+        const unsigned char status = m_page_status[page_no];
+        m_page_status[page_no] = (unsigned char)(status | loading);
+        lock.unlock();
+
+        try
+        {
+            if (status != uninitialized)
+                read_page(page_no, cache_slot);
+        }
+        catch (...)
+        {
+            scoped_mutex_lock relock(m_mutex);
+            m_page_to_slot[page_no] = on_disk;
+            m_free_slots.push(cache_slot);
+            m_page_status[page_no] = status;
+            m_page_loaded.notify_all();
+            throw;
+        }
+
+        scoped_mutex_lock relock(m_mutex);
+        m_page_status[page_no] = status;
+        m_page_loaded.notify_all();
+        return (*m_cache)[cache_slot * page_size + offset.get_block1()][offset.get_offset()];
+    }
+
+    //! Returns a free cache slot for get_concurrent(), evicting a page which
+    //! is not being read, or -1 if all slots are being read. m_mutex must be
+    //! held by lock, which is dropped while a dirty evicted page is written;
+    //! the page is marked loading meanwhile, so it is neither evicted again
+    //! nor accessed by other threads.
+    int_type concurrent_slot(scoped_mutex_lock& lock) const
+    {
+        if (!m_free_slots.empty())
+        {
+            int_type free_slot = m_free_slots.front();
+            m_free_slots.pop();
+            m_pager.evict(free_slot);
+            m_pager.hit(free_slot);
+            return free_slot;
+        }
+
+        int_type kicked_slot = m_pager.peek();
+        for (unsigned_type i = 0; i < numpages(); ++i)
+        {
+            int_type old_page_no = m_slot_to_page[kicked_slot];
+            if (!(m_page_status[old_page_no] & loading))
+            {
+                m_pager.evict(kicked_slot);
+                m_pager.hit(kicked_slot);
+                if (m_page_status[old_page_no] & dirty)
+                {
+                    m_page_status[old_page_no] |= loading;
+                    lock.unlock();
+                    try
+                    {
+                        write_page_blocks(old_page_no, kicked_slot);
+                    }
+                    catch (...)
+                    {
+                        lock.lock();
+                        m_page_status[old_page_no] = dirty;
+                        m_page_loaded.notify_all();
+                        throw;
+                    }
+                    lock.lock();
+                    m_page_status[old_page_no] = valid_on_disk;
+                    --m_dirty_pages;
+                    m_page_loaded.notify_all();
+                }
+                m_page_to_slot[old_page_no] = on_disk;
+                return kicked_slot;
+            }
+            kicked_slot = (kicked_slot + 1) % (int_type)numpages();
+        }
+        return -1;
+    }
+
     // don't forget to first flush() the vector's cache before updating pages externally
     void page_externally_updated(unsigned_type page_no) const
     {
         // fails if offset is too large, out of bound access
         assert(page_no < m_page_status.size());
+        if (m_page_status[page_no] & (reading_ahead | writing_back))
+            finish_async(page_no, m_page_to_slot[page_no]);
         // "A dirty page has been marked as newly initialized. The page content will be lost."
         assert(!(m_page_status[page_no] & dirty));
         if (m_page_to_slot[page_no] != on_disk) {
@@ -1737,15 +2271,19 @@ private:
         {
             if (m_free_slots.empty())              // has to kick
             {
-                int_type kicked_slot = m_pager.kick();
+                int_type kicked_slot = kick_slot();
                 m_pager.hit(kicked_slot);
                 int_type old_page_no = m_slot_to_page[kicked_slot];
+                if (m_page_status[old_page_no] & (reading_ahead | writing_back))
+                    finish_async(old_page_no, kicked_slot);
                 m_page_to_slot[page_no] = kicked_slot;
                 m_page_to_slot[old_page_no] = on_disk;
                 m_slot_to_page[kicked_slot] = page_no;
 
                 write_page(old_page_no, kicked_slot);
                 read_page(page_no, kicked_slot);
+                touch_slot(kicked_slot);
+                read_ahead(page_no, kicked_slot);
 
                 return (*m_cache)[kicked_slot * page_size + offset.get_block1()][offset.get_offset()];
             }
@@ -1753,17 +2291,26 @@ private:
             {
                 int_type free_slot = m_free_slots.front();
                 m_free_slots.pop();
+                m_pager.evict(free_slot);
                 m_pager.hit(free_slot);
                 m_page_to_slot[page_no] = free_slot;
                 m_slot_to_page[free_slot] = page_no;
 
                 read_page(page_no, free_slot);
+                touch_slot(free_slot);
+                read_ahead(page_no, free_slot);
 
                 return (*m_cache)[free_slot * page_size + offset.get_block1()][offset.get_offset()];
             }
         }
         else
         {
+            if (m_page_status[page_no] & reading_ahead)
+            {
+                finish_async(page_no, cache_slot);
+                read_ahead(page_no, cache_slot);
+            }
+            touch_slot(cache_slot);
             m_pager.hit(cache_slot);
             return (*m_cache)[cache_slot * page_size + offset.get_block1()][offset.get_offset()];
         }
@@ -2592,6 +3139,417 @@ public:
 
 ////////////////////////////////////////////////////////////////////////////
 
+//! \internal
+//! Splits the range [begin,end) of a vector into num_partitions consecutive
+//! ranges of about equal size. All boundaries except begin and end are aligned
+//! to blocks, such that no two partitions share a block. Stores the
+//! num_partitions + 1 boundaries in bounds.
+template <typename VectorIterator>
+void vector_partition_range(VectorIterator begin, VectorIterator end,
+                            unsigned_type num_partitions,
+                            std::vector<VectorIterator>& bounds)
+{
+    typedef typename VectorIterator::block_type block_type;
+    typedef typename VectorIterator::size_type size_type;
+
+    assert(begin <= end && num_partitions > 0);
+    const size_type size = (size_type)(end - begin);
+
+    bounds.clear();
+    bounds.push_back(begin);
+    for (unsigned_type i = 1; i < num_partitions; ++i)
+    {
+        VectorIterator it = begin + (size_type)(size * i / num_partitions);
+        if (it.block_offset() != 0)
+            it += block_type::size - it.block_offset();
+        if (it < bounds.back()) it = bounds.back();
+        if (end < it) it = end;
+        bounds.push_back(it);
+    }
+    bounds.push_back(end);
+}
+
+/*!
+ * Partitioned buffered reader of a vector range for several threads.
+ *
+ * The range is split into num_partitions consecutive partitions of about equal
+ * size, whose boundaries are aligned to blocks. Each partition is read by a
+ * vector_bufreader of its own, i.e. with its own prefetching pipeline, such
+ * that different threads can scan the partitions concurrently. All readers
+ * are created in the constructor; afterwards each partition() may be read by
+ * one thread, while the vector itself must not be modified.
+ *
+ * The partitions share an I/O budget of nbuffers blocks: each prefetches
+ * nbuffers / num_partitions blocks, but at least two.
+ *
+ * See \ref tutorial_vector_buf
+ */
+template <typename VectorIterator>
+class vector_partitioned_bufreader : public noncopyable
+{
+public:
+    //! template parameter: the vector iterator type
+    typedef VectorIterator vector_iterator;
+
+    //! type of the input vector
+    typedef typename vector_iterator::vector_type vector_type;
+
+    //! buffered reader of one partition
+    typedef vector_bufreader<vector_iterator> bufreader_type;
+
+protected:
+    //! boundaries of the partitions
+    std::vector<vector_iterator> m_bounds;
+
+    //! buffered reader of each partition
+    std::vector<bufreader_type*> m_readers;
+
+    void create(unsigned_type num_partitions, unsigned_type nbuffers)
+    {
+        if (num_partitions == 0)
+            num_partitions = 1;
+        if (nbuffers == 0)
+            nbuffers = 2 * config::get_instance()->disks_number();
+
+        const unsigned_type partition_nbuffers =
+            std::max<unsigned_type>(2, nbuffers / num_partitions);
+
+        vector_partition_range(m_bounds.front(), m_bounds.back(),
+                               num_partitions, m_bounds);
+
+        m_readers.reserve(num_partitions);
+        for (unsigned_type i = 0; i < num_partitions; ++i)
+        {
+            m_readers.push_back(
+                new bufreader_type(m_bounds[i], m_bounds[i + 1],
+                                   partition_nbuffers));
+        }
+    }
+
+public:
+    //! Create partitioned reader for the given iterator range.
+    //! \param begin iterator to position were to start reading in vector
+    //! \param end iterator to position were to end reading in vector
+    //! \param num_partitions number of partitions, e.g. the number of threads
+    //! \param nbuffers number of buffers shared by all partitions (>= 2*D recommended)
+    vector_partitioned_bufreader(vector_iterator begin, vector_iterator end,
+                                 unsigned_type num_partitions,
+                                 unsigned_type nbuffers = 0)
+    {
+        m_bounds.push_back(begin);
+        m_bounds.push_back(end);
+        create(num_partitions, nbuffers);
+    }
+
+    //! Create partitioned reader for the whole vector's content.
+    //! \param vec vector to read
+    //! \param num_partitions number of partitions, e.g. the number of threads
+    //! \param nbuffers number of buffers shared by all partitions (>= 2*D recommended)
+    vector_partitioned_bufreader(const vector_type& vec,
+                                 unsigned_type num_partitions,
+                                 unsigned_type nbuffers = 0)
+    {
+        m_bounds.push_back(vec.begin());
+        m_bounds.push_back(vec.end());
+        create(num_partitions, nbuffers);
+    }
+
+    //! Finish reading and free all buffered readers.
+    ~vector_partitioned_bufreader()
+    {
+        for (unsigned_type i = 0; i < m_readers.size(); ++i)
+            delete m_readers[i];
+    }
+
+    //! Return the number of partitions.
+    unsigned_type num_partitions() const
+    {
+        return m_readers.size();
+    }
+
+    //! Return the buffered reader of partition i.
+    bufreader_type& partition(unsigned_type i)
+    {
+        assert(i < m_readers.size());
+        return *m_readers[i];
+    }
+
+    //! Return iterator to the first element of partition i.
+    vector_iterator partition_begin(unsigned_type i) const
+    {
+        assert(i < m_readers.size());
+        return m_bounds[i];
+    }
+
+    //! Return iterator behind the last element of partition i.
+    vector_iterator partition_end(unsigned_type i) const
+    {
+        assert(i < m_readers.size());
+        return m_bounds[i + 1];
+    }
+};
+
+/*!
+ * Partitioned buffered writer to a vector range for several threads.
+ *
+ * The range is split into num_partitions consecutive partitions of about equal
+ * size, whose boundaries are aligned to blocks. Each partition is written by a
+ * partition_writer with its own write-behind pipeline, which writes whole
+ * blocks directly to the vector's blocks on disk. Hence, different threads can
+ * fill the partitions concurrently. In contrast to vector_bufwriter, the
+ * vector is not enlarged: it must be resized to hold the range beforehand.
+ *
+ * The vector is flushed in the constructor. Until finish() is called, the
+ * vector itself must not be accessed, and each partition() may be written by
+ * one thread only. Elements of a partition which are not written keep their
+ * previous value. finish() must be called after all threads are done; it
+ * waits for the outstanding writes and invalidates the vector's cached pages
+ * of the range.
+ *
+ * The partitions share an I/O budget of nbuffers blocks: each writes behind
+ * nbuffers / num_partitions blocks, but at least two.
+ *
+ * See \ref tutorial_vector_buf
+ */
+template <typename VectorIterator>
+class vector_partitioned_bufwriter : public noncopyable
+{
+public:
+    //! template parameter: the vector iterator type
+    typedef VectorIterator iterator;
+
+    //! type of the output vector
+    typedef typename iterator::vector_type vector_type;
+
+    //! value type of the output vector
+    typedef typename iterator::value_type value_type;
+
+    //! block type used in the vector
+    typedef typename iterator::block_type block_type;
+
+    //! block identifier iterator of the vector
+    typedef typename iterator::bids_container_iterator bids_container_iterator;
+
+    //! iterator type of vector
+    typedef typename iterator::iterator vector_iterator;
+
+    //! construct output buffered stream used for overlapped writing
+    typedef buf_ostream<block_type, bids_container_iterator> buf_ostream_type;
+
+    //! size of remaining data
+    typedef typename vector_type::size_type size_type;
+
+    //! Buffered writer of one partition.
+    class partition_writer : public noncopyable
+    {
+    protected:
+        //! internal iterator into the vector.
+        vector_iterator m_iter;
+
+        //! iterator to the end of the partition.
+        vector_iterator m_end;
+
+        //! buffered output stream used to overlapped I/O.
+        buf_ostream_type* m_bufout;
+
+        //! Copy the elements [from,to) of the block at the internal iterator
+        //! from disk into the buffered stream.
+        void copy_from_disk(unsigned_type from, unsigned_type to)
+        {
+            block_type* blk = new block_type;
+            blk->read(*m_iter.bid())->wait();
+            for (unsigned_type i = from; i < to; ++i)
+                *m_bufout << blk->elem[i];
+            delete blk;
+        }
+
+    public:
+        //! Create writer for the partition [begin,end).
+        partition_writer(vector_iterator begin, vector_iterator end,
+                         unsigned_type nbuffers)
+            : m_iter(begin), m_end(end), m_bufout(NULL)
+        {
+            if (m_iter == m_end) return;
+
+            m_bufout = new buf_ostream_type(m_iter.bid(), nbuffers);
+
+            // keep the elements preceding the partition in its first block
+            if (m_iter.block_offset() != 0)
+                copy_from_disk(0, m_iter.block_offset());
+        }
+
+        //! Finish writing.
+        ~partition_writer()
+        {
+            finish();
+        }
+
+        //! Return mutable reference to item at the position of the internal
+        //! iterator.
+        value_type& operator * ()
+        {
+            assert(m_iter < m_end);
+            return m_bufout->operator * ();
+        }
+
+        //! Advance internal iterator.
+        partition_writer& operator ++ ()
+        {
+            assert(m_iter < m_end);
+            ++m_iter;
+            m_bufout->operator ++ ();
+            return *this;
+        }
+
+        //! Write value to the current position and advance the internal
+        //! iterator.
+        partition_writer& operator << (const value_type& v)
+        {
+            operator * () = v;
+            operator ++ ();
+            return *this;
+        }
+
+        //! Return number of elements remaining in the partition.
+        size_type size() const
+        {
+            return (size_type)(m_end - m_iter);
+        }
+
+        //! Returns true once the whole partition has been written.
+        bool empty() const
+        {
+            return (m_iter == m_end);
+        }
+
+        //! Finish writing: complete the current block with the data on disk
+        //! and wait for all writes.
+        void finish()
+        {
+            if (!m_bufout) return;
+
+            if (m_iter.block_offset() != 0)
+                copy_from_disk(m_iter.block_offset(), block_type::size);
+
+            delete m_bufout;
+            m_bufout = NULL;
+        }
+    };
+
+protected:
+    //! boundaries of the partitions
+    std::vector<vector_iterator> m_bounds;
+
+    //! buffered writer of each partition
+    std::vector<partition_writer*> m_writers;
+
+    void create(unsigned_type num_partitions, unsigned_type nbuffers)
+    {
+        if (num_partitions == 0)
+            num_partitions = 1;
+        if (nbuffers == 0)
+            nbuffers = 2 * config::get_instance()->disks_number();
+
+        const unsigned_type partition_nbuffers =
+            std::max<unsigned_type>(2, nbuffers / num_partitions);
+
+        assert(m_bounds.back() <= m_bounds.back().parent_vector()->end());
+        m_bounds.front().flush(); // flush container
+
+        vector_partition_range(m_bounds.front(), m_bounds.back(),
+                               num_partitions, m_bounds);
+
+        m_writers.reserve(num_partitions);
+        for (unsigned_type i = 0; i < num_partitions; ++i)
+        {
+            m_writers.push_back(
+                new partition_writer(m_bounds[i], m_bounds[i + 1],
+                                     partition_nbuffers));
+        }
+    }
+
+public:
+    //! Create partitioned writer for the given iterator range.
+    //! \param begin iterator to position were to start writing in vector
+    //! \param end iterator to position were to end writing in vector
+    //! \param num_partitions number of partitions, e.g. the number of threads
+    //! \param nbuffers number of buffers shared by all partitions (>= 2*D recommended)
+    vector_partitioned_bufwriter(vector_iterator begin, vector_iterator end,
+                                 unsigned_type num_partitions,
+                                 unsigned_type nbuffers = 0)
+    {
+        m_bounds.push_back(begin);
+        m_bounds.push_back(end);
+        create(num_partitions, nbuffers);
+    }
+
+    //! Create partitioned writer for the whole vector.
+    //! \param vec vector to write
+    //! \param num_partitions number of partitions, e.g. the number of threads
+    //! \param nbuffers number of buffers shared by all partitions (>= 2*D recommended)
+    vector_partitioned_bufwriter(vector_type& vec,
+                                 unsigned_type num_partitions,
+                                 unsigned_type nbuffers = 0)
+    {
+        m_bounds.push_back(vec.begin());
+        m_bounds.push_back(vec.end());
+        create(num_partitions, nbuffers);
+    }
+
+    //! Finish writing and flush output back to vector.
+    ~vector_partitioned_bufwriter()
+    {
+        finish();
+    }
+
+    //! Return the number of partitions.
+    unsigned_type num_partitions() const
+    {
+        return m_bounds.size() - 1;
+    }
+
+    //! Return the buffered writer of partition i.
+    partition_writer& partition(unsigned_type i)
+    {
+        assert(i < m_writers.size());
+        return *m_writers[i];
+    }
+
+    //! Return iterator to the first element of partition i.
+    vector_iterator partition_begin(unsigned_type i) const
+    {
+        assert(i + 1 < m_bounds.size());
+        return m_bounds[i];
+    }
+
+    //! Return iterator behind the last element of partition i.
+    vector_iterator partition_end(unsigned_type i) const
+    {
+        assert(i + 1 < m_bounds.size());
+        return m_bounds[i + 1];
+    }
+
+    //! Finish writing of all partitions, once all threads are done, and
+    //! inform the vector that the blocks of the range have been updated.
+    void finish()
+    {
+        if (m_writers.empty()) return;
+
+        for (unsigned_type i = 0; i < m_writers.size(); ++i)
+            delete m_writers[i];
+        m_writers.clear();
+
+        vector_iterator begin = m_bounds.front(), end = m_bounds.back();
+        for (vector_iterator it = begin - begin.block_offset(); it < end;
+             it += block_type::size)
+        {
+            it.block_externally_updated();
+        }
+    }
+};
+
+////////////////////////////////////////////////////////////////////////////
+
 //! External vector type generator.
 //!
 //! \tparam ValueType element type of contained objects (POD with no references to internal memory)
@@ -2599,7 +3557,7 @@ public:
 //! \tparam CachePages number of pages in cache, default: \b 8 (recommended >= 2)
 //! \tparam BlockSize external block size \a B in bytes, default: <b>2 MiB</b>
 //! \tparam AllocStr parallel disk allocation strategies: \c striping, RC, SR, or FR. default: \b RC.
-//! \tparam Pager pager type: \c random or \c lru, default: \b lru.
+//! \tparam Pager pager type: \c random, \c lru, \c second_chance (CLOCK) or \c two_queue (2Q), default: \b lru.
 //!
 //! \warning Do not store references to the elements of an external vector. Such references
 //! might be invalidated during any following access to elements of the vector
@@ -2613,8 +3571,12 @@ template <
     >
 struct VECTOR_GENERATOR
 {
-    typedef typename IF<Pager == lru,
-                        lru_pager<CachePages>, random_pager<CachePages> >::result PagerType;
+    typedef typename IF<Pager == lru, lru_pager<CachePages>,
+                        typename IF<Pager == second_chance, clock_pager<CachePages>,
+                                    typename IF<Pager == two_queue, two_queue_pager<CachePages>,
+                                                random_pager<CachePages> >::result
+                                    >::result
+                        >::result PagerType;
 
     typedef vector<ValueType, PageSize, PagerType, BlockSize, AllocStr> result;
 };
@@ -0,0 +1,125 @@
+/***************************************************************************
+ *  include/stxxl/bits/io/compressed_file.h
+ *
+ *  a pseudo file storing blocks compressed in a backend file
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_IO_COMPRESSED_FILE_HEADER
+#define STXXL_IO_COMPRESSED_FILE_HEADER
+
+#include <map>
+#include <set>
+#include <utility>
+
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/io/disk_queued_file.h>
+
+STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup fileimpl
+//! \{
+
+//! Implementation of file which compresses the written blocks and stores them
+//! with variable length in a backend file.
+//!
+//! Each write is compressed by a run-length encoding of repeated bytes, which
+//! suits sparse records and zero padding, and stored at a free place of the
+//! backend, rounded up to STXXL_BLOCK_ALIGN, choosing the smallest free
+//! region which fits. Blocks which do not shrink are stored unchanged. An index maps the logical offset of each written block to
+//! its place in the backend. Ranges never written read as zeros, shrinking
+//! the file releases the blocks behind its new end.
+//!
+//! The backend is accessed synchronously from the request queue of this file,
+//! logical and stored bytes are counted in stats.
+class compressed_file : public disk_queued_file
+{
+    //! place of a written block in the backend file
+    struct extent
+    {
+        //! offset in the backend file
+        offset_type physical;
+        //! number of logical bytes of the block
+        size_type bytes;
+        //! number of bytes stored in the backend file
+        size_type stored;
+        //! whether the stored bytes are compressed
+        bool compressed;
+    };
+
+    typedef std::map<offset_type, extent> extent_map;
+    typedef std::map<offset_type, offset_type> free_map;
+    typedef std::set<std::pair<offset_type, offset_type> > free_size_set;
+
+    //! the file used as backend
+    file* storage;
+    //! logical size of the file
+    offset_type sz;
+
+    //! sequentializes serve() and discard()
+    mutex m_mutex;
+    //! logical offset to stored block translation
+    extent_map m_extents;
+    //! list of free (physical) regions, offset to size
+    free_map m_free_space;
+    //! the same regions as (size, offset) pairs, for best fit allocation
+    free_size_set m_free_sizes;
+    //! end of the used part of the backend file
+    offset_type m_physical_end;
+    //! number of bytes occupied by stored blocks
+    offset_type m_stored_bytes;
+
+public:
+    //! Constructs file object.
+    //! \param backend_file file object used as storage backend, will be
+    //! deleted in ~compressed_file()
+    //! \param queue_id disk queue identifier
+    //! \param allocator_id linked disk_allocator
+    //! \param device_id physical device identifier
+    compressed_file(
+        file* backend_file,
+        int queue_id = DEFAULT_QUEUE,
+        int allocator_id = NO_ALLOCATOR,
+        unsigned int device_id = DEFAULT_DEVICE_ID);
+    ~compressed_file();
+    offset_type size();
+    void set_size(offset_type newsize);
+    void lock();
+    void serve(void* buffer, offset_type offset, size_type bytes,
+               request::request_type type);
+    void discard(offset_type offset, offset_type size);
+    void close_remove();
+    const char * io_type() const;
+
+    //! Returns the number of bytes the stored blocks occupy in the backend.
+    offset_type physical_size();
+
+    //! Encodes bytes of in into out, which has room for limit bytes.
+    //! \return the number of bytes written, or 0 if limit is exceeded
+    static size_type encode(const char* in, size_type bytes,
+                            char* out, size_type limit);
+
+    //! Decodes the data encode() stored in in into bytes of out.
+    static void decode(const char* in, char* out, size_type bytes);
+
+private:
+    void sread(char* buffer, offset_type offset, size_type bytes);
+    void swrite(const char* buffer, offset_type offset, size_type bytes);
+    void read_extent(const extent& e, char* buffer);
+    void free_extent(extent_map::iterator it);
+    offset_type allocate(size_type bytes);
+    void add_free_region(offset_type offset, offset_type size);
+    void erase_free_region(free_map::iterator it);
+};
+
+//! \}
+
+STXXL_END_NAMESPACE
+
+#endif // !STXXL_IO_COMPRESSED_FILE_HEADER
+// vim: et:ts=4:sw=4
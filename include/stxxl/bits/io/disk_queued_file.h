@@ -48,6 +48,22 @@ public:
         size_type bytes,
         const completion_handler& on_cmpl = completion_handler());
 
+    void aread_batch(
+        void* const* buffers,
+        const offset_type* offsets,
+        size_type bytes,
+        size_t n,
+        request_ptr* reqs,
+        const completion_handler& on_cmpl = completion_handler());
+
+    void awrite_batch(
+        void* const* buffers,
+        const offset_type* offsets,
+        size_type bytes,
+        size_t n,
+        request_ptr* reqs,
+        const completion_handler& on_cmpl = completion_handler());
+
     virtual int get_queue_id() const
     {
         return m_queue_id;
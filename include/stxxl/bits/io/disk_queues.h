@@ -16,15 +16,21 @@
 #ifndef STXXL_IO_DISK_QUEUES_HEADER
 #define STXXL_IO_DISK_QUEUES_HEADER
 
+#include <algorithm>
 #include <map>
+#include <vector>
 
 #include <stxxl/bits/namespace.h>
 #include <stxxl/bits/singleton.h>
+#include <stxxl/bits/verbose.h>
 #include <stxxl/bits/io/iostats.h>
 #include <stxxl/bits/io/request.h>
 #include <stxxl/bits/io/request_queue_impl_qwqr.h>
+#include <stxxl/bits/io/request_queue_impl_prio.h>
 #include <stxxl/bits/io/linuxaio_queue.h>
 #include <stxxl/bits/io/linuxaio_request.h>
+#include <stxxl/bits/io/iouring_queue.h>
+#include <stxxl/bits/io/iouring_request.h>
 #include <stxxl/bits/io/serving_request.h>
 
 STXXL_BEGIN_NAMESPACE
@@ -40,38 +46,76 @@ class disk_queues : public singleton<disk_queues>
 
     typedef stxxl::int64 DISKID;
     typedef std::map<DISKID, request_queue*> request_queue_map;
+    typedef std::map<DISKID, int> queue_threads_map;
 
 protected:
     request_queue_map queues;
+    //! number of worker threads of the queues, if not one
+    queue_threads_map queue_threads;
     disk_queues()
     {
         stxxl::stats::get_instance(); // initialize stats before ourselves
     }
 
+    //! Returns the queue of disk, creating one suitable for req if necessary.
+    request_queue * get_or_create_queue(request_ptr& req, DISKID disk)
+    {
+        request_queue_map::iterator qi = queues.find(disk);
+        if (qi != queues.end())
+            return qi->second;
+
+        // create new request queue
+#if STXXL_HAVE_LINUXAIO_FILE
+        if (dynamic_cast<linuxaio_request*>(req.get()))
+            return queues[disk] = new linuxaio_queue(
+                       dynamic_cast<linuxaio_file*>(req->get_file())->get_desired_queue_length()
+                       );
+#endif
+#if STXXL_HAVE_IOURING_FILE
+        if (dynamic_cast<iouring_request*>(req.get()))
+            return queues[disk] = new iouring_queue(
+                       dynamic_cast<iouring_file*>(req->get_file())->get_desired_queue_length()
+                       );
+#endif
+        queue_threads_map::const_iterator ti = queue_threads.find(disk);
+        const int threads = (ti != queue_threads.end()) ? ti->second : 1;
+#if STXXL_PRIORITY_REQUEST_QUEUE
+        return queues[disk] = new request_queue_impl_prio(threads);
+#else
+        STXXL_UNUSED(threads);
+        return queues[disk] = new request_queue_impl_qwqr();
+#endif
+    }
+
 public:
     void add_request(request_ptr& req, DISKID disk)
     {
 #ifdef STXXL_HACK_SINGLE_IO_THREAD
         disk = 42;
 #endif
-        request_queue_map::iterator qi = queues.find(disk);
-        request_queue* q;
-        if (qi == queues.end())
-        {
-            // create new request queue
-#if STXXL_HAVE_LINUXAIO_FILE
-            if (dynamic_cast<linuxaio_request*>(req.get()))
-                q = queues[disk] = new linuxaio_queue(
-                        dynamic_cast<linuxaio_file*>(req->get_file())->get_desired_queue_length()
-                        );
-            else
+        request* r = req.get();
+        stats::get_instance()->requests_queued(&r, 1);
+        get_or_create_queue(req, disk)->add_request(req);
+    }
+
+    //! Add n requests to the same disk queue at once, see
+    //! request_queue::add_requests.
+    //! \param reqs array of n requests of the same kind
+    //! \param n number of requests
+    //! \param disk disk number of the queue
+    void add_requests(request_ptr* reqs, size_t n, DISKID disk)
+    {
+        if (n == 0) return;
+#ifdef STXXL_HACK_SINGLE_IO_THREAD
+        disk = 42;
 #endif
-            q = queues[disk] = new request_queue_impl_qwqr();
+        if (stats::get_instance()->is_detailed()) {
+            std::vector<request*> r(n);
+            for (size_t i = 0; i < n; ++i)
+                r[i] = reqs[i].get();
+            stats::get_instance()->requests_queued(&r[0], n);
         }
-        else
-            q = qi->second;
-
-        q->add_request(req);
+        get_or_create_queue(reqs[0], disk)->add_requests(reqs, n);
     }
 
     //! Cancel a request.
@@ -93,6 +137,51 @@ public:
             return false;
     }
 
+    //! Raise the scheduling class of a queued request.
+    //! \param req request to promote
+    //! \param prio new priority
+    //! \param disk disk number for disk that \c req was scheduled on
+    //! \return \c true iff the queue took the new priority into account
+    bool raise_priority(request_ptr& req, request::priority_type prio, DISKID disk)
+    {
+#ifdef STXXL_HACK_SINGLE_IO_THREAD
+        disk = 42;
+#endif
+        request_queue_map::iterator qi = queues.find(disk);
+        if (qi != queues.end())
+            return qi->second->raise_priority(req, prio);
+        else
+            return false;
+    }
+
+    //! Set the number of worker threads which serve the requests of a disk
+    //! concurrently, for files which serve requests synchronously. Takes
+    //! effect if the queue of the disk is created afterwards, i.e. on the
+    //! first request. Disks sharing a queue get the maximum of their numbers.
+    //! request_queue_impl_qwqr is always served by one thread.
+    //! \param disk disk number of the queue
+    //! \param threads number of worker threads
+    void set_queue_threads(DISKID disk, int threads)
+    {
+#ifdef STXXL_HACK_SINGLE_IO_THREAD
+        disk = 42;
+#endif
+#if !STXXL_PRIORITY_REQUEST_QUEUE
+        if (threads > 1) {
+            STXXL_ERRMSG("disk_queues: request_queue_impl_qwqr is served by "
+                         "one thread, ignoring " << threads << " threads for queue " << disk);
+            return;
+        }
+#endif
+        if (queues.find(disk) != queues.end()) {
+            STXXL_ERRMSG("disk_queues: queue " << disk << " is running already, "
+                         "cannot set its number of threads to " << threads);
+            return;
+        }
+        int& t = queue_threads[disk];
+        t = std::max(t, threads);
+    }
+
     request_queue * get_queue(DISKID disk)
     {
         if (queues.find(disk) != queues.end())
@@ -29,6 +29,7 @@
 #include <stxxl/bits/common/exceptions.h>
 #include <stxxl/bits/common/counting_ptr.h>
 #include <stxxl/bits/common/types.h>
+#include <stxxl/bits/io/iostats.h>
 #include <stxxl/bits/io/request.h>
 #include <stxxl/bits/io/request_interface.h>
 #include <stxxl/bits/libstxxl.h>
@@ -81,6 +82,7 @@ public:
 
     static const int DEFAULT_QUEUE = -1;
     static const int DEFAULT_LINUXAIO_QUEUE = -2;
+    static const int DEFAULT_IOURING_QUEUE = -3;
     static const int NO_ALLOCATOR = -1;
     static const unsigned int DEFAULT_DEVICE_ID = (unsigned int)(-1);
 
@@ -110,9 +112,45 @@ public:
     virtual request_ptr awrite(void* buffer, offset_type pos, size_type bytes,
                                const completion_handler& on_cmpl = completion_handler()) = 0;
 
+    //! Schedules n asynchronous read requests of equal size to the file.
+    //! Queued implementations hand all requests to the disk queue at once,
+    //! which is cheaper than n separate calls to aread().
+    //! \param buffers array of n memory buffers to read into
+    //! \param offsets array of n file positions to read from
+    //! \param bytes number of bytes to transfer per request
+    //! \param n number of requests
+    //! \param reqs array receiving the n request objects
+    //! \param on_cmpl I/O completion handler, called for each request
+    virtual void aread_batch(void* const* buffers, const offset_type* offsets,
+                             size_type bytes, size_t n, request_ptr* reqs,
+                             const completion_handler& on_cmpl = completion_handler());
+
+    //! Schedules n asynchronous write requests of equal size to the file.
+    //! \param buffers array of n memory buffers to write from
+    //! \param offsets array of n file positions to write to
+    //! \param bytes number of bytes to transfer per request
+    //! \param n number of requests
+    //! \param reqs array receiving the n request objects
+    //! \param on_cmpl I/O completion handler, called for each request
+    virtual void awrite_batch(void* const* buffers, const offset_type* offsets,
+                              size_type bytes, size_t n, request_ptr* reqs,
+                              const completion_handler& on_cmpl = completion_handler());
+
     virtual void serve(void* buffer, offset_type offset, size_type bytes,
                        request::request_type type) = 0;
 
+    //! Serves n requests of one type for adjacent regions of the file at
+    //! once. Region i has sizes[i] bytes, is transferred from/to buffers[i]
+    //! and starts where region i-1 ends, region 0 starts at offset. The
+    //! default implementation serves the regions one by one.
+    virtual void serve_vectored(void* const* buffers, const size_type* sizes,
+                                size_t n, offset_type offset,
+                                request::request_type type);
+
+    //! Returns true if serve_vectored() transfers all regions with a single
+    //! system call, i.e. if disk queues should coalesce adjacent requests.
+    virtual bool has_vectored_io() const { return false; }
+
     //! Changes the size of the file.
     //! \param newsize new file size
     virtual void set_size(offset_type newsize) = 0;
@@ -200,6 +238,23 @@ public:
         return m_request_ref.get_reference_count();
     }
 
+protected:
+    //! I/O statistics of this file
+    file_stats m_file_stats;
+
+public:
+    //! Returns the I/O statistics of this file.
+    file_stats & get_file_stats()
+    {
+        return m_file_stats;
+    }
+
+    //! Returns the I/O statistics of this file.
+    const file_stats & get_file_stats() const
+    {
+        return m_file_stats;
+    }
+
 public:
     //! \name Static Functions for Platform Abstraction
     //! \{
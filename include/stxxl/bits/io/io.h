@@ -24,7 +24,9 @@
 #include <stxxl/bits/io/mem_file.h>
 #include <stxxl/bits/io/fileperblock_file.h>
 #include <stxxl/bits/io/wbtl_file.h>
+#include <stxxl/bits/io/compressed_file.h>
 #include <stxxl/bits/io/linuxaio_file.h>
+#include <stxxl/bits/io/iouring_file.h>
 #include <stxxl/bits/io/create_file.h>
 #include <stxxl/bits/io/disk_queues.h>
 #include <stxxl/bits/io/iostats.h>
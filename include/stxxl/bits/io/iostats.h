@@ -25,7 +25,9 @@
 #include <stxxl/bits/common/timer.h>
 #include <stxxl/bits/common/types.h>
 #include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/io/iostats_detail.h>
 #include <stxxl/bits/unused.h>
+#include <stxxl/bits/noncopyable.h>
 #include <stxxl/bits/singleton.h>
 
 #include <iostream>
@@ -33,11 +35,18 @@
 
 STXXL_BEGIN_NAMESPACE
 
+class request;
+
 //! \addtogroup iolayer
 //!
 //! \{
 
 //! Collects various I/O statistics.
+//!
+//! Detailed statistics, i.e. latency histograms and queue depth traces per
+//! disk and wait times per call site (see stats_detail), are collected after
+//! set_detailed(true) or if the environment variable STXXL_IOSTATS_DETAIL is
+//! set to a value other than 0. Otherwise they cost a test per request.
 //! \remarks is a singleton
 class stats : public singleton<stats>
 {
@@ -47,6 +56,8 @@ class stats : public singleton<stats>
     int64 volume_read, volume_written;          // number of bytes read/written
     unsigned c_reads, c_writes;                 // number of cached operations
     int64 c_volume_read, c_volume_written;      // number of bytes read/written from/to cache
+    int64 z_volume_read, z_volume_written;      // number of bytes read/written through compressed files
+    int64 z_stored_read, z_stored_written;      // number of bytes these occupied in the backend files
     double t_reads, t_writes;                   // seconds spent in operations
     double p_reads, p_writes;                   // seconds spent in parallel operations
     double p_begin_read, p_begin_write;         // start time of parallel operation
@@ -65,8 +76,15 @@ class stats : public singleton<stats>
     double last_reset;
     mutex read_mutex, write_mutex, io_mutex, wait_mutex;
 
+    bool detailed;                              // whether detailed statistics are collected
+    stats_detail detail;
+    mutable mutex detail_mutex;
+
     stats();
 
+    void detail_queued(request* const* reqs, size_t n);
+    void detail_served(const request& req, double service_time);
+
 public:
     enum wait_op_type {
         WAIT_OP_ANY,
@@ -222,12 +240,14 @@ public:
 #ifndef STXXL_DO_NOT_COUNT_WAIT_TIME
         bool running;
         wait_op_type wait_op;
+        //! start of the wait if it is attributed to a call site
+        double begin;
 #endif
 
     public:
         scoped_wait_timer(wait_op_type wait_op, bool measure_time = true)
 #ifndef STXXL_DO_NOT_COUNT_WAIT_TIME
-            : running(false), wait_op(wait_op)
+            : running(false), wait_op(wait_op), begin(0.0)
 #endif
         {
             if (measure_time)
@@ -244,7 +264,10 @@ public:
 #ifndef STXXL_DO_NOT_COUNT_WAIT_TIME
             if (!running) {
                 running = true;
-                stats::get_instance()->wait_started(wait_op);
+                stats* s = stats::get_instance();
+                s->wait_started(wait_op);
+                if (s->is_detailed())
+                    begin = timestamp();
             }
 #endif
         }
@@ -253,13 +276,44 @@ public:
         {
 #ifndef STXXL_DO_NOT_COUNT_WAIT_TIME
             if (running) {
-                stats::get_instance()->wait_finished(wait_op);
+                stats* s = stats::get_instance();
+                s->wait_finished(wait_op);
+                if (begin != 0.0) {
+                    s->wait_attributed(wait_op, timestamp() - begin);
+                    begin = 0.0;
+                }
                 running = false;
             }
 #endif
         }
     };
 
+    //! Attributes the time the current thread waits for requests during the
+    //! lifetime of this object to a call site, in the detailed statistics.
+    //! Nested sites take precedence, waits outside of any site are attributed
+    //! to the operation waited for.
+    class scoped_wait_site
+    {
+        bool pushed;
+
+    public:
+        //! \param site name of the call site, a string literal
+        explicit scoped_wait_site(const char* site)
+            : pushed(false)
+        {
+            if (stats::get_instance()->is_detailed()) {
+                stats::get_instance()->push_wait_site(site);
+                pushed = true;
+            }
+        }
+
+        ~scoped_wait_site()
+        {
+            if (pushed)
+                stats::get_instance()->pop_wait_site();
+        }
+    };
+
 public:
     //! Returns total number of reads.
     //! \return total number of reads
@@ -317,6 +371,36 @@ public:
         return c_volume_written;
     }
 
+    //! Returns number of bytes read from compressed files.
+    //! \return number of uncompressed bytes read
+    int64 get_compressed_read_volume() const
+    {
+        return z_volume_read;
+    }
+
+    //! Returns number of bytes written to compressed files.
+    //! \return number of uncompressed bytes written
+    int64 get_compressed_written_volume() const
+    {
+        return z_volume_written;
+    }
+
+    //! Returns number of bytes the reads from compressed files transferred
+    //! from their backend files.
+    //! \return number of stored bytes read
+    int64 get_compressed_stored_read_volume() const
+    {
+        return z_stored_read;
+    }
+
+    //! Returns number of bytes the writes to compressed files transferred to
+    //! their backend files.
+    //! \return number of stored bytes written
+    int64 get_compressed_stored_written_volume() const
+    {
+        return z_stored_written;
+    }
+
     //! Time that would be spent in read syscalls if all parallel reads were serialized.
     //! \return seconds spent in reading
     double get_read_time() const
@@ -385,15 +469,54 @@ public:
     //! Resets I/O wait time counter.
     STXXL_DEPRECATED(void _reset_io_wait_time());
 
+    //! Switches collecting detailed statistics on or off. Requests posted
+    //! while switched off are not recorded.
+    void set_detailed(bool on)
+    {
+        detailed = on;
+    }
+
+    //! Returns whether detailed statistics are collected.
+    bool is_detailed() const
+    {
+#if STXXL_IO_STATS
+        return detailed;
+#else
+        return false;
+#endif
+    }
+
+    //! Returns a snapshot of the detailed statistics.
+    stats_detail get_detail() const;
+
+    // for library use
+    void requests_queued(request* const* reqs, size_t n)
+    {
+        if (is_detailed())
+            detail_queued(reqs, n);
+    }
+    void request_served(const request& req, double service_time)
+    {
+        if (is_detailed())
+            detail_served(req, service_time);
+    }
+    //! called for requests recorded by requests_queued() only
+    void request_finished(request& req, bool canceled);
+    void wait_attributed(wait_op_type wait_op, double wait_time);
+    void push_wait_site(const char* site);
+    void pop_wait_site();
+
     // for library use
     void write_started(unsigned_type size_, double now = 0.0);
     void write_canceled(unsigned_type size_);
     void write_finished();
     void write_cached(unsigned_type size_);
+    void write_compressed(unsigned_type size_, unsigned_type stored_size);
     void read_started(unsigned_type size_, double now = 0.0);
     void read_canceled(unsigned_type size_);
     void read_finished();
     void read_cached(unsigned_type size_);
+    void read_compressed(unsigned_type size_, unsigned_type stored_size);
     void wait_started(wait_op_type wait_op);
     void wait_finished(wait_op_type wait_op);
 };
@@ -408,6 +531,11 @@ inline void stats::write_cached(unsigned_type size_)
 {
     STXXL_UNUSED(size_);
 }
+inline void stats::write_compressed(unsigned_type size_, unsigned_type stored_size)
+{
+    STXXL_UNUSED(size_);
+    STXXL_UNUSED(stored_size);
+}
 inline void stats::write_finished() { }
 inline void stats::read_started(unsigned_type size_, double now)
 {
@@ -418,6 +546,11 @@ inline void stats::read_cached(unsigned_type size_)
 {
     STXXL_UNUSED(size_);
 }
+inline void stats::read_compressed(unsigned_type size_, unsigned_type stored_size)
+{
+    STXXL_UNUSED(size_);
+    STXXL_UNUSED(stored_size);
+}
 inline void stats::read_finished() { }
 #endif
 #ifdef STXXL_DO_NOT_COUNT_WAIT_TIME
@@ -425,6 +558,91 @@ inline void stats::wait_started(wait_op_type) { }
 inline void stats::wait_finished(wait_op_type) { }
 #endif
 
+//! Collects I/O statistics of a single file, which are used to estimate the
+//! throughput of the underlying device.
+class file_stats : private noncopyable
+{
+    unsigned m_reads, m_writes;                 // number of operations
+    int64 m_volume_read, m_volume_written;      // number of bytes read/written
+    double m_p_ios;                             // seconds spent in parallel operations on the file
+    double m_p_begin_io;                        // start time of parallel operation
+    int m_acc_ios;                              // number of requests, participating in parallel operation
+    mutable mutex m_mutex;
+
+public:
+    file_stats();
+
+    //! Returns number of reads from the file.
+    unsigned get_reads() const
+    {
+        scoped_mutex_lock ReadLock(m_mutex);
+        return m_reads;
+    }
+
+    //! Returns number of writes to the file.
+    unsigned get_writes() const
+    {
+        scoped_mutex_lock WriteLock(m_mutex);
+        return m_writes;
+    }
+
+    //! Returns number of bytes read from the file.
+    int64 get_read_volume() const
+    {
+        scoped_mutex_lock ReadLock(m_mutex);
+        return m_volume_read;
+    }
+
+    //! Returns number of bytes written to the file.
+    int64 get_written_volume() const
+    {
+        scoped_mutex_lock WriteLock(m_mutex);
+        return m_volume_written;
+    }
+
+    //! Time in seconds during which at least one I/O on the file was in
+    //! progress.
+    double get_pio_time() const
+    {
+        scoped_mutex_lock IOLock(m_mutex);
+        return m_p_ios;
+    }
+
+    //! Returns the number of bytes transferred per second of I/O time, or 0.0
+    //! if no finished I/O has been measured yet.
+    double get_throughput() const;
+
+    // for library use
+    void write_started(unsigned_type size_, double now = 0.0);
+    void write_canceled(unsigned_type size_);
+    void read_started(unsigned_type size_, double now = 0.0);
+    void read_canceled(unsigned_type size_);
+    void io_finished();
+};
+
+#if !STXXL_IO_STATS
+inline double file_stats::get_throughput() const { return 0.0; }
+inline void file_stats::write_started(unsigned_type size_, double now)
+{
+    STXXL_UNUSED(size_);
+    STXXL_UNUSED(now);
+}
+inline void file_stats::write_canceled(unsigned_type size_)
+{
+    STXXL_UNUSED(size_);
+}
+inline void file_stats::read_started(unsigned_type size_, double now)
+{
+    STXXL_UNUSED(size_);
+    STXXL_UNUSED(now);
+}
+inline void file_stats::read_canceled(unsigned_type size_)
+{
+    STXXL_UNUSED(size_);
+}
+inline void file_stats::io_finished() { }
+#endif
+
 class stats_data
 {
     //! number of operations
@@ -435,6 +653,10 @@ class stats_data
     unsigned c_reads, c_writes;
     //! number of bytes read/written from/to cache
     int64 c_volume_read, c_volume_written;
+    //! number of bytes read/written through compressed files
+    int64 z_volume_read, z_volume_written;
+    //! number of bytes these occupied in the backend files
+    int64 z_stored_read, z_stored_written;
     //! seconds spent in operations
     double t_reads, t_writes;
     //! seconds spent in parallel operations
@@ -445,6 +667,8 @@ class stats_data
     double t_wait;
     double t_wait_read, t_wait_write;
     double elapsed;
+    //! latency histograms, queue depths and wait sites, if collected
+    stats_detail detail;
 
 public:
     stats_data()
@@ -456,6 +680,10 @@ public:
           c_writes(0),
           c_volume_read(0),
           c_volume_written(0),
+          z_volume_read(0),
+          z_volume_written(0),
+          z_stored_read(0),
+          z_stored_written(0),
           t_reads(0.0),
           t_writes(0.0),
           p_reads(0.0),
@@ -476,6 +704,10 @@ public:
           c_writes(s.get_cached_writes()),
           c_volume_read(s.get_cached_read_volume()),
           c_volume_written(s.get_cached_written_volume()),
+          z_volume_read(s.get_compressed_read_volume()),
+          z_volume_written(s.get_compressed_written_volume()),
+          z_stored_read(s.get_compressed_stored_read_volume()),
+          z_stored_written(s.get_compressed_stored_written_volume()),
           t_reads(s.get_read_time()),
           t_writes(s.get_write_time()),
           p_reads(s.get_pread_time()),
@@ -484,7 +716,8 @@ public:
           t_wait(s.get_io_wait_time()),
           t_wait_read(s.get_wait_read_time()),
           t_wait_write(s.get_wait_write_time()),
-          elapsed(timestamp() - s.get_last_reset_time())
+          elapsed(timestamp() - s.get_last_reset_time()),
+          detail(s.get_detail())
     { }
 
     stats_data operator + (const stats_data& a) const
@@ -498,6 +731,10 @@ public:
         s.c_writes = c_writes + a.c_writes;
         s.c_volume_read = c_volume_read + a.c_volume_read;
         s.c_volume_written = c_volume_written + a.c_volume_written;
+        s.z_volume_read = z_volume_read + a.z_volume_read;
+        s.z_volume_written = z_volume_written + a.z_volume_written;
+        s.z_stored_read = z_stored_read + a.z_stored_read;
+        s.z_stored_written = z_stored_written + a.z_stored_written;
         s.t_reads = t_reads + a.t_reads;
         s.t_writes = t_writes + a.t_writes;
         s.p_reads = p_reads + a.p_reads;
@@ -507,6 +744,7 @@ public:
         s.t_wait_read = t_wait_read + a.t_wait_read;
         s.t_wait_write = t_wait_write + a.t_wait_write;
         s.elapsed = elapsed + a.elapsed;
+        s.detail = detail + a.detail;
         return s;
     }
 
@@ -521,6 +759,10 @@ public:
         s.c_writes = c_writes - a.c_writes;
         s.c_volume_read = c_volume_read - a.c_volume_read;
         s.c_volume_written = c_volume_written - a.c_volume_written;
+        s.z_volume_read = z_volume_read - a.z_volume_read;
+        s.z_volume_written = z_volume_written - a.z_volume_written;
+        s.z_stored_read = z_stored_read - a.z_stored_read;
+        s.z_stored_written = z_stored_written - a.z_stored_written;
         s.t_reads = t_reads - a.t_reads;
         s.t_writes = t_writes - a.t_writes;
         s.p_reads = p_reads - a.p_reads;
@@ -530,6 +772,7 @@ public:
         s.t_wait_read = t_wait_read - a.t_wait_read;
         s.t_wait_write = t_wait_write - a.t_wait_write;
         s.elapsed = elapsed - a.elapsed;
+        s.detail = detail - a.detail;
         return s;
     }
 
@@ -573,6 +816,26 @@ public:
         return c_volume_written;
     }
 
+    int64 get_compressed_read_volume() const
+    {
+        return z_volume_read;
+    }
+
+    int64 get_compressed_written_volume() const
+    {
+        return z_volume_written;
+    }
+
+    int64 get_compressed_stored_read_volume() const
+    {
+        return z_stored_read;
+    }
+
+    int64 get_compressed_stored_written_volume() const
+    {
+        return z_stored_written;
+    }
+
     double get_read_time() const
     {
         return t_reads;
@@ -617,6 +880,14 @@ public:
     {
         return t_wait_write;
     }
+
+    const stats_detail & get_detail() const
+    {
+        return detail;
+    }
+
+    //! Prints all counters and the detailed statistics as a JSON object.
+    void print_json(std::ostream& o) const;
 };
 
 std::ostream& operator << (std::ostream& o, const stats_data& s);
@@ -0,0 +1,273 @@
+/***************************************************************************
+ *  include/stxxl/bits/io/iostats_detail.h
+ *
+ *  latency histograms and queue depth traces of the detailed I/O statistics
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_IO_IOSTATS_DETAIL_HEADER
+#define STXXL_IO_IOSTATS_DETAIL_HEADER
+
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/common/types.h>
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup iolayer
+//!
+//! \{
+
+//! Histogram of latencies with buckets of logarithmically growing width, in
+//! the manner of HdrHistogram.
+//!
+//! Latencies are counted in microseconds, exactly below 32 us and above in
+//! sub_buckets buckets per power of two, i.e. with a relative error of less
+//! than 1/sub_buckets. Latencies of 2^max_magnitude us (19 hours) and more
+//! are counted in the last bucket.
+class latency_histogram
+{
+public:
+    enum {
+        sub_bucket_bits = 4,
+        sub_buckets = 1 << sub_bucket_bits,
+        max_magnitude = 36,
+        num_buckets = (max_magnitude - sub_bucket_bits + 1) * sub_buckets
+    };
+
+private:
+    //! number of latencies per bucket, empty until the first one is recorded
+    std::vector<uint64> m_buckets;
+    //! number of latencies recorded
+    uint64 m_count;
+    //! sum, minimum and maximum of the latencies in microseconds
+    uint64 m_sum, m_min, m_max;
+
+public:
+    latency_histogram()
+        : m_count(0), m_sum(0), m_min(0), m_max(0)
+    { }
+
+    //! Counts a latency.
+    //! \param seconds latency in seconds
+    void record(double seconds);
+
+    //! Returns the number of latencies counted.
+    uint64 get_count() const
+    {
+        return m_count;
+    }
+
+    //! Returns the sum of the latencies in seconds.
+    double get_sum() const
+    {
+        return double(m_sum) * 1e-6;
+    }
+
+    //! Returns the mean latency in seconds.
+    double get_mean() const
+    {
+        return m_count ? double(m_sum) * 1e-6 / double(m_count) : 0.0;
+    }
+
+    //! Returns the minimum latency in seconds.
+    double get_min() const
+    {
+        return double(m_min) * 1e-6;
+    }
+
+    //! Returns the maximum latency in seconds.
+    double get_max() const
+    {
+        return double(m_max) * 1e-6;
+    }
+
+    //! Returns the latency in seconds which the fraction q of the latencies
+    //! does not exceed, up to the width of its bucket.
+    //! \param q fraction in [0,1], e.g. 0.99 for the 99th percentile
+    double get_percentile(double q) const;
+
+    //! Returns the number of latencies in bucket i.
+    uint64 get_bucket(unsigned i) const
+    {
+        return m_buckets.empty() ? 0 : m_buckets[i];
+    }
+
+    //! Returns the bucket counting a latency of us microseconds.
+    static unsigned bucket_index(uint64 us);
+
+    //! Returns the smallest latency in microseconds counted in bucket i.
+    static uint64 bucket_lower(unsigned i);
+
+    //! Returns the number of microseconds counted in bucket i.
+    static uint64 bucket_width(unsigned i);
+
+    //! Adds the latencies of h.
+    latency_histogram& operator += (const latency_histogram& h);
+
+    //! Returns the latencies counted in addition to those of an earlier
+    //! snapshot h. Minimum and maximum are those of this histogram.
+    latency_histogram operator - (const latency_histogram& h) const;
+
+    //! Prints count, sum, extremes, percentiles and the non-empty buckets as
+    //! a JSON object.
+    void print_json(std::ostream& o) const;
+};
+
+//! Records the number of outstanding requests of a disk over time.
+//!
+//! The time since the trace started is divided into intervals, for each the
+//! maximum depth and the integral of the depth over time are stored. If more
+//! than max_intervals are needed, adjacent intervals are merged and the
+//! interval length is doubled.
+class queue_depth_trace
+{
+public:
+    enum { max_intervals = 1024 };
+
+    struct interval_type
+    {
+        //! maximum depth during the interval
+        unsigned max_depth;
+        //! integral of the depth over the interval in seconds
+        double depth_time;
+    };
+
+private:
+    //! start of the trace and length of the intervals in seconds
+    double m_begin, m_interval;
+    //! time of the last depth change
+    double m_last_change;
+    //! current and maximum depth
+    unsigned m_depth, m_max_depth;
+    //! integral of the depth over the whole trace
+    double m_depth_time;
+    std::vector<interval_type> m_intervals;
+
+    void account(double now);
+    void compact();
+
+public:
+    //! Constructs an empty trace.
+    //! \param interval initial length of the intervals in seconds
+    explicit queue_depth_trace(double interval = 0.01)
+        : m_begin(0.0), m_interval(interval), m_last_change(0.0),
+          m_depth(0), m_max_depth(0), m_depth_time(0.0)
+    { }
+
+    //! Changes the depth by delta at time now.
+    void change(int delta, double now);
+
+    //! Returns the current depth.
+    unsigned get_depth() const
+    {
+        return m_depth;
+    }
+
+    //! Returns the maximum depth.
+    unsigned get_max_depth() const
+    {
+        return m_max_depth;
+    }
+
+    //! Returns the mean depth from the start of the trace until the last
+    //! change.
+    double get_mean_depth() const;
+
+    //! Returns the start of the trace, a timestamp().
+    double get_begin() const
+    {
+        return m_begin;
+    }
+
+    //! Returns the length of the intervals in seconds.
+    double get_interval() const
+    {
+        return m_interval;
+    }
+
+    const std::vector<interval_type> & get_intervals() const
+    {
+        return m_intervals;
+    }
+
+    //! Prints the maximum and mean depth and the depth per interval as a
+    //! JSON object.
+    void print_json(std::ostream& o) const;
+};
+
+//! Detailed statistics of the requests of one disk.
+struct disk_detail
+{
+    //! time from posting a request until its completion
+    latency_histogram read_latency, write_latency;
+    //! time a file spent serving a request, for files served by a request
+    //! queue's worker threads
+    latency_histogram read_service, write_service;
+    //! number of posted, uncompleted requests
+    queue_depth_trace queue_depth;
+};
+
+//! Detailed I/O statistics: latency histograms and queue depth traces per
+//! disk, and the time spent waiting for requests per call site.
+//!
+//! Disks are identified by the queue ids of their files, which are the disk
+//! numbers of the disks configured in .stxxl. Call sites are labeled by
+//! stats::scoped_wait_site objects.
+class stats_detail
+{
+public:
+    typedef std::map<int64, disk_detail> disk_map;
+    typedef std::map<std::string, latency_histogram> wait_site_map;
+
+private:
+    friend class stats;
+
+    disk_map m_disks;
+    wait_site_map m_wait_sites;
+
+public:
+    //! Returns whether nothing was recorded.
+    bool empty() const
+    {
+        return m_disks.empty() && m_wait_sites.empty();
+    }
+
+    const disk_map & get_disks() const
+    {
+        return m_disks;
+    }
+
+    const wait_site_map & get_wait_sites() const
+    {
+        return m_wait_sites;
+    }
+
+    stats_detail operator + (const stats_detail& a) const;
+
+    //! Returns the requests and waits recorded in addition to those of an
+    //! earlier snapshot a. The queue depth traces are those of this object.
+    stats_detail operator - (const stats_detail& a) const;
+
+    //! Prints percentiles of the latencies and waits as a table.
+    void print(std::ostream& o) const;
+
+    //! Prints all histograms and traces as a JSON object.
+    void print_json(std::ostream& o) const;
+};
+
+//! \}
+
+STXXL_END_NAMESPACE
+
+#endif // !STXXL_IO_IOSTATS_DETAIL_HEADER
+// vim: et:ts=4:sw=4
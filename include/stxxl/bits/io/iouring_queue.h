@@ -0,0 +1,116 @@
+/***************************************************************************
+ *  include/stxxl/bits/io/iouring_queue.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_IO_IOURING_QUEUE_HEADER
+#define STXXL_IO_IOURING_QUEUE_HEADER
+
+#include <stxxl/bits/io/iouring_file.h>
+
+#if STXXL_HAVE_IOURING_FILE
+
+#include <linux/io_uring.h>
+#include <list>
+#include <vector>
+
+#include <stxxl/bits/io/request_queue_impl_worker.h>
+#include <stxxl/bits/common/condition_variable.h>
+#include <stxxl/bits/common/mutex.h>
+
+//! number of times the completion thread polls the completion ring before
+//! blocking in the kernel, while requests are in flight.
+#ifndef STXXL_IOURING_POLL_SPINS
+#define STXXL_IOURING_POLL_SPINS 4096
+#endif
+
+STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup reqlayer
+//! \{
+
+//! Queue for iouring_file(s)
+//!
+//! One queue (and kernel ring) exists per disk. A posting thread moves all
+//! waiting requests into the submission ring and hands them to the kernel
+//! with a single io_uring_enter() call, while a second thread reaps the
+//! completion ring, polling it for a while before blocking.
+class iouring_queue : public request_queue_impl_worker
+{
+    friend class iouring_request;
+
+    typedef iouring_queue self_type;
+
+private:
+    //! ring file descriptor
+    int ring_fd;
+
+    //! \name Memory Mapped Ring Structures
+    //! \{
+    void* sq_ring_ptr, * cq_ring_ptr;
+    size_t sq_ring_size, cq_ring_size;
+    unsigned* sq_head, * sq_tail, * sq_mask, * sq_array;
+    unsigned* cq_head, * cq_tail, * cq_mask;
+    io_uring_sqe* sqes;
+    io_uring_cqe* cqes;
+    size_t sqes_size;
+    //! \}
+
+    //! storing iouring_request* would drop ownership
+    typedef std::list<request_ptr> queue_type;
+
+    // "waiting" request have submitted to this queue, but not yet to the OS,
+    // those are "posted"
+    mutex waiting_mtx;
+    queue_type waiting_requests;
+
+    //! max number of OS requests
+    int max_events;
+    //! number of requests in waitings_requests
+    semaphore num_waiting_requests, num_free_events, num_posted_requests;
+
+    //! number of requests handed to the kernel and reaped from the
+    //! completion ring, the posting thread waits for the latter to advance
+    //! if the kernel refuses new entries
+    mutex reap_mtx;
+    condition_variable reap_cond;
+    uint64 num_submitted, num_reaped;
+
+    // two threads, one for posting, one for waiting
+    thread_type post_thread, wait_thread;
+    state<thread_state> post_thread_state, wait_thread_state;
+
+    static void * post_async(void* arg);   // thread start callback
+    static void * wait_async(void* arg);   // thread start callback
+    void post_requests();
+    unsigned reap_completions();
+    void wait_requests();
+    void requeue(request_ptr& req);
+    //! wait until more than reaped completions have been reaped, unless the
+    //! kernel holds no request which could complete.
+    void wait_reaped(uint64 reaped);
+
+public:
+    //! Construct queue. Requests max number of requests simultaneously
+    //! submitted to disk, 0 means a default of 256.
+    iouring_queue(int desired_queue_length = 0);
+
+    void add_request(request_ptr& req);
+    void add_requests(request_ptr* reqs, size_t n);
+    bool cancel_request(request_ptr& req);
+    ~iouring_queue();
+};
+
+//! \}
+
+STXXL_END_NAMESPACE
+
+#endif // #if STXXL_HAVE_IOURING_FILE
+
+#endif // !STXXL_IO_IOURING_QUEUE_HEADER
+// vim: et:ts=4:sw=4
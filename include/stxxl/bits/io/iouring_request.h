@@ -0,0 +1,73 @@
+/***************************************************************************
+ *  include/stxxl/bits/io/iouring_request.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_IO_IOURING_REQUEST_HEADER
+#define STXXL_IO_IOURING_REQUEST_HEADER
+
+#include <stxxl/bits/io/iouring_file.h>
+
+#if STXXL_HAVE_IOURING_FILE
+
+#include <linux/io_uring.h>
+#include <stxxl/bits/io/request_with_state.h>
+
+#define STXXL_VERBOSE_IOURING(msg) STXXL_VERBOSE2(msg)
+
+STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup reqlayer
+//! \{
+
+//! Request for an iouring_file.
+class iouring_request : public request_with_state
+{
+    friend class iouring_queue;
+
+    //! bytes already transferred, short transfers are resubmitted
+    size_type m_done;
+
+    //! set once the request was first handed to the kernel
+    bool m_posted;
+
+    //! fill submission queue entry for the outstanding part of the request
+    void fill_sqe(io_uring_sqe* sqe);
+
+public:
+    iouring_request(
+        const completion_handler& on_cmpl,
+        file* file,
+        void* buffer,
+        offset_type offset,
+        size_type bytes,
+        request_type type)
+        : request_with_state(on_cmpl, file, buffer, offset, bytes, type),
+          m_done(0), m_posted(false)
+    {
+        assert(dynamic_cast<iouring_file*>(file));
+        STXXL_VERBOSE_IOURING("iouring_request[" << this << "]" <<
+                              " iouring_request" <<
+                              "(file=" << file << " buffer=" << buffer <<
+                              " offset=" << offset << " bytes=" << bytes <<
+                              " type=" << type << ")");
+    }
+
+    bool cancel();
+    void completed(bool posted, bool canceled);
+    void completed(bool canceled) { completed(true, canceled); }
+};
+
+//! \}
+
+STXXL_END_NAMESPACE
+
+#endif // #if STXXL_HAVE_IOURING_FILE
+
+#endif // !STXXL_IO_IOURING_REQUEST_HEADER
+// vim: et:ts=4:sw=4
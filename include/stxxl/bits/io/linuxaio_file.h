@@ -64,6 +64,12 @@ public:
                       const completion_handler& on_cmpl = completion_handler());
     request_ptr awrite(void* buffer, offset_type pos, size_type bytes,
                        const completion_handler& on_cmpl = completion_handler());
+    void aread_batch(void* const* buffers, const offset_type* offsets,
+                     size_type bytes, size_t n, request_ptr* reqs,
+                     const completion_handler& on_cmpl = completion_handler());
+    void awrite_batch(void* const* buffers, const offset_type* offsets,
+                      size_type bytes, size_t n, request_ptr* reqs,
+                      const completion_handler& on_cmpl = completion_handler());
     const char * io_type() const;
 
     int get_desired_queue_length() const
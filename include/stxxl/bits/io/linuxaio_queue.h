@@ -85,6 +85,7 @@ public:
     linuxaio_queue(int desired_queue_length = 0);
 
     void add_request(request_ptr& req);
+    void add_requests(request_ptr* reqs, size_t n);
     bool cancel_request(request_ptr& req);
     void complete_request(request_ptr& req);
     ~linuxaio_queue();
@@ -38,6 +38,8 @@ class file;
 class request : virtual public request_interface, public atomic_counted_object
 {
     friend class linuxaio_queue;
+    friend class request_queue_impl_prio;
+    friend class stats;
 
 protected:
     completion_handler m_on_complete;
@@ -49,6 +51,9 @@ protected:
     offset_type m_offset;
     size_type m_bytes;
     request_type m_type;
+    priority_type m_priority;
+    //! time the request was posted, if recorded in the detailed stats
+    double m_time_queued;
 
 public:
     request(const completion_handler& on_compl,
@@ -65,6 +70,7 @@ public:
     offset_type get_offset() const { return m_offset; }
     size_type get_size() const { return m_bytes; }
     request_type get_type() const { return m_type; }
+    priority_type get_priority() const { return m_priority; }
 
     void check_alignment() const;
 
@@ -39,6 +39,10 @@ public:
     typedef stxxl::external_size_type offset_type;
     typedef stxxl::internal_size_type size_type;
     enum request_type { READ, WRITE };
+    //! Scheduling classes, served in this order by queues supporting them:
+    //! DEMAND - somebody waits for the request, PREFETCH - read ahead,
+    //! WRITE_BEHIND - asynchronous write-back.
+    enum priority_type { DEMAND = 0, PREFETCH = 1, WRITE_BEHIND = 2 };
 
 public:
     virtual bool add_waiter(onoff_switch* sw) = 0;
@@ -63,6 +67,12 @@ public:
     //! \return \c true iff the request was canceled successfully
     virtual bool cancel() = 0;
 
+    //! Raise the scheduling class of a queued request, e.g. because the
+    //! application has to wait for it now. Requests are never demoted.
+    //! \return \c true iff the request's queue took the new priority into
+    //! account
+    virtual bool raise_priority(priority_type prio) = 0;
+
     //! Polls the status of the request.
     //! \return \c true if request is completed, otherwise \c false
     virtual bool poll() = 0;
@@ -17,6 +17,13 @@
 #include <stxxl/bits/noncopyable.h>
 #include <stxxl/bits/io/request.h>
 
+//! Use request_queue_impl_prio as queue for disk_queued_file(s), which serves
+//! requests somebody waits for first, instead of request_queue_impl_qwqr.
+//! Enabled by the CMake option of the same name.
+#ifndef STXXL_PRIORITY_REQUEST_QUEUE
+#define STXXL_PRIORITY_REQUEST_QUEUE 0
+#endif
+
 STXXL_BEGIN_NAMESPACE
 
 //! \addtogroup reqlayer
@@ -30,9 +37,24 @@ public:
 
 public:
     virtual void add_request(request_ptr& req) = 0;
+    //! Add n requests at once. Implementations should take their locks and
+    //! wake up their worker threads only once for the whole batch.
+    virtual void add_requests(request_ptr* reqs, size_t n)
+    {
+        for (size_t i = 0; i < n; ++i)
+            add_request(reqs[i]);
+    }
     virtual bool cancel_request(request_ptr& req) = 0;
     virtual ~request_queue() noexcept(false) { }
     virtual void set_priority_op(priority_op p) { STXXL_UNUSED(p); }
+    //! Raise the scheduling class of a queued request, see
+    //! request_interface::raise_priority. Ignored by most queues.
+    virtual bool raise_priority(request_ptr& req, request::priority_type prio)
+    {
+        STXXL_UNUSED(req);
+        STXXL_UNUSED(prio);
+        return false;
+    }
 };
 
 //! \}
@@ -0,0 +1,166 @@
+/***************************************************************************
+ *  include/stxxl/bits/io/request_queue_impl_prio.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_IO_REQUEST_QUEUE_IMPL_PRIO_HEADER
+#define STXXL_IO_REQUEST_QUEUE_IMPL_PRIO_HEADER
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <stxxl/bits/io/request_queue_impl_worker.h>
+#include <stxxl/bits/compat/hash_map.h>
+#include <stxxl/bits/common/condition_variable.h>
+#include <stxxl/bits/common/mutex.h>
+
+//! maximum time in seconds a queued PREFETCH or WRITE_BEHIND request may be
+//! overtaken by requests of higher priority before it is served anyway.
+#ifndef STXXL_PRIO_QUEUE_MAX_DELAY
+#define STXXL_PRIO_QUEUE_MAX_DELAY 0.25
+#endif
+
+//! maximum number of adjacent requests coalesced into one vectored I/O.
+#ifndef STXXL_COALESCE_MAX_REQUESTS
+#define STXXL_COALESCE_MAX_REQUESTS 64
+#endif
+
+//! maximum number of bytes transferred by one coalesced vectored I/O.
+#ifndef STXXL_COALESCE_MAX_BYTES
+#define STXXL_COALESCE_MAX_BYTES (16 * 1024 * 1024)
+#endif
+
+STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup reqlayer
+//! \{
+
+//! Implementation of a request queue with a pool of worker threads, which
+//! serves requests by their scheduling class (request::priority_type): DEMAND
+//! requests (which somebody waits for) first, then PREFETCH reads and
+//! WRITE_BEHIND writes in the order given by set_priority_op().
+//!
+//! Requests of the same class are served in submission order. A request is
+//! never served before an earlier submitted request for an overlapping region
+//! of the same file, if one of them is a write, nor concurrently with such a
+//! request served by another worker. Requests which have been overtaken for
+//! longer than STXXL_PRIO_QUEUE_MAX_DELAY are served next.
+//!
+//! If the file supports vectored I/O, queued requests of the same type for
+//! regions adjacent to the one served next are coalesced with it into a
+//! single system call.
+//!
+//! Queued requests are indexed by their address and by their file regions, so
+//! lookups, conflict checks and coalescing do not scan the queues.
+class request_queue_impl_prio : public request_queue_impl_worker
+{
+private:
+    typedef request_queue_impl_prio self;
+
+    struct entry
+    {
+        request_ptr req;
+        //! submission sequence number
+        unsigned_type seq;
+        //! submission time
+        double time;
+        //! scheduling class, i.e. the queue holding the entry
+        int prio;
+
+        entry(const request_ptr& r, unsigned_type s, double t, int p)
+            : req(r), seq(s), time(t), prio(p) { }
+    };
+
+    typedef std::list<entry> queue_type;
+    //! queued requests by address
+    typedef compat_hash_map<const request*, queue_type::iterator>::result request_index_type;
+    //! file and offset of a queued request
+    typedef std::pair<file*, request::offset_type> region_key_type;
+    //! queued requests by file and offset
+    typedef std::multimap<region_key_type, queue_type::iterator> region_index_type;
+
+    //! number of scheduling classes
+    static const int num_classes = 3;
+
+    mutex m_mutex;
+    //! one FIFO queue per scheduling class, each ordered by seq
+    queue_type m_queues[num_classes];
+    //! all queued requests by address
+    request_index_type m_requests;
+    //! all queued requests by file and offset
+    region_index_type m_regions;
+    //! size of the largest request queued so far, bounds the offsets of
+    //! requests overlapping a region
+    request::size_type m_max_size;
+    //! next submission sequence number
+    unsigned_type m_seq;
+    //! relative order of PREFETCH and WRITE_BEHIND classes
+    priority_op m_priority_op;
+
+    //! requests being served by the workers
+    std::vector<request_ptr> m_in_flight;
+    //! signaled when requests in flight are finished
+    condition_variable m_in_flight_cond;
+
+    state<thread_state> m_thread_state;
+    std::vector<thread_type> m_threads;
+    semaphore m_sem;
+
+    static void * worker(void* arg);
+
+    //! enqueue request, m_mutex must be held.
+    void push(request_ptr& req, double now);
+
+    //! remove queued request from its queue and the indexes, m_mutex must
+    //! be held.
+    void erase(queue_type::iterator pos);
+
+    //! find queued request, m_mutex must be held.
+    bool find(const request_ptr& req, queue_type::iterator& pos);
+
+    //! find the earliest queued request which must be served before e,
+    //! m_mutex must be held.
+    bool find_blocking(const entry& e, queue_type::iterator& pos);
+
+    //! true if all queues are empty, m_mutex must be held.
+    bool empty() const;
+
+    //! remove the request to serve next, m_mutex must be held. Returns an
+    //! empty request_ptr if it has to wait for a request in flight.
+    request_ptr pop(double now);
+
+    //! true if an earlier queued request must be served before e.
+    bool is_blocked(const entry& e);
+
+    //! true if a request in flight must be finished before req.
+    bool is_blocked_in_flight(const request_ptr& req) const;
+
+    //! remove queued requests adjacent to batch[0] and add them to batch in
+    //! ascending offset order, m_mutex must be held.
+    void coalesce(std::vector<request_ptr>& batch);
+
+public:
+    //! \param n max number of requests simultaneously submitted to disk,
+    //! i.e. the number of worker threads
+    request_queue_impl_prio(int n = 1);
+
+    void set_priority_op(priority_op op);
+    void add_request(request_ptr& req);
+    void add_requests(request_ptr* reqs, size_t n);
+    bool cancel_request(request_ptr& req);
+    bool raise_priority(request_ptr& req, request::priority_type prio);
+    ~request_queue_impl_prio();
+};
+
+//! \}
+
+STXXL_END_NAMESPACE
+
+#endif // !STXXL_IO_REQUEST_QUEUE_IMPL_PRIO_HEADER
+// vim: et:ts=4:sw=4
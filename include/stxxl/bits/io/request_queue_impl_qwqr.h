@@ -27,8 +27,9 @@ STXXL_BEGIN_NAMESPACE
 //! \{
 
 //! Implementation of a local request queue having two queues, one for read and
-//! one for write requests, thus having two threads. This is the default
-//! implementation.
+//! one for write requests, which are served alternately by one worker thread.
+//! The thread serves the requests of each queue in order, a second one could
+//! reorder writes to the same block.
 class request_queue_impl_qwqr : public request_queue_impl_worker
 {
 private:
@@ -41,15 +42,19 @@ private:
     queue_type m_read_queue;
 
     state<thread_state> m_thread_state;
-    thread_type m_thread;
+    std::vector<thread_type> m_threads;
     semaphore m_sem;
 
     static const priority_op m_priority_op = WRITE;
 
     static void * worker(void* arg);
 
+    //! true if both queues are empty.
+    bool empty();
+
 public:
-    // \param n max number of requests simultaneously submitted to disk
+    // \param n max number of requests simultaneously submitted to disk,
+    // ignored as only one request is served at a time
     request_queue_impl_qwqr(int n = 1);
 
     // in a multi-threaded setup this does not work as intended
@@ -62,6 +67,7 @@ public:
         STXXL_UNUSED(op);
     }
     void add_request(request_ptr& req);
+    void add_requests(request_ptr* reqs, size_t n);
     bool cancel_request(request_ptr& req);
     ~request_queue_impl_qwqr();
 };
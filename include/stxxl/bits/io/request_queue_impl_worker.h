@@ -28,6 +28,8 @@
  #error "Thread implementation not detected."
 #endif
 
+#include <vector>
+
 #include <stxxl/bits/io/request_queue.h>
 #include <stxxl/bits/common/semaphore.h>
 #include <stxxl/bits/common/state.h>
@@ -40,6 +42,10 @@ STXXL_BEGIN_NAMESPACE
 //! Implementation of request queue worker threads. Worker threads can be
 //! started by start_thread and stopped with stop_thread. The queue state is
 //! checked before termination and updated afterwards.
+//!
+//! A pool of workers sharing one queue is started by start_threads and
+//! stopped by stop_threads. Its workers terminate once the queue is empty and
+//! pass the single wake up on to the others.
 class request_queue_impl_worker : public request_queue
 {
 protected:
@@ -53,9 +59,15 @@ protected:
     typedef pthread_t thread_type;
 #endif
 
+private:
+    static void create_thread(void* (*worker)(void*), void* arg, thread_type& t);
+    static void join_thread(thread_type& t);
+
 protected:
     void start_thread(void* (*worker)(void*), void* arg, thread_type& t, state<thread_state>& s);
     void stop_thread(thread_type& t, state<thread_state>& s, semaphore& sem);
+    void start_threads(void* (*worker)(void*), void* arg, std::vector<thread_type>& t, int n, state<thread_state>& s);
+    void stop_threads(std::vector<thread_type>& t, state<thread_state>& s, semaphore& sem);
 };
 
 //! \}
@@ -51,6 +51,7 @@ public:
     void wait(bool measure_time = true);
     bool poll();
     bool cancel();
+    bool raise_priority(priority_type prio);
 
 protected:
     void completed(bool canceled);
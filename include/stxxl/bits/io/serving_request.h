@@ -28,6 +28,7 @@ class serving_request : public request_with_state
     friend class fileperblock_file;
     friend class request_queue_impl_qwqr;
     friend class request_queue_impl_1q;
+    friend class request_queue_impl_prio;
 
 public:
     serving_request(
@@ -41,6 +42,10 @@ public:
 protected:
     virtual void serve();
 
+    //! Serve n requests of one type for adjacent, ascending regions of the
+    //! same file with a single file::serve_vectored() call.
+    static void serve_coalesced(serving_request* const* reqs, size_t n);
+
 public:
     const char * io_type() const;
 };
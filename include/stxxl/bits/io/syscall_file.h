@@ -46,6 +46,12 @@ public:
     { }
     void serve(void* buffer, offset_type offset, size_type bytes,
                request::request_type type);
+#if STXXL_HAVE_PREADV
+    void serve_vectored(void* const* buffers, const size_type* sizes,
+                        size_t n, offset_type offset,
+                        request::request_type type);
+    bool has_vectored_io() const { return true; }
+#endif
     const char * io_type() const;
 };
 
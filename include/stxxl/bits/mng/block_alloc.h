@@ -15,6 +15,8 @@
 #define STXXL_MNG_BLOCK_ALLOC_HEADER
 
 #include <algorithm>
+#include <string>
+#include <vector>
 #include <stxxl/bits/parallel.h>
 #include <stxxl/bits/common/rand.h>
 #include <stxxl/bits/mng/config.h>
@@ -191,6 +193,67 @@ struct RC_flash : public RC
     }
 };
 
+//! Load-balancing disk allocation scheme functor.
+//!
+//! Assigns blocks to the disks in proportion to their weight, which is the
+//! product of the free space and the throughput measured so far on the disk
+//! (see file_stats::get_throughput()). Hence faster and emptier disks receive
+//! more blocks. Disks without measurements are assumed to be as fast as the
+//! average measured disk, disks which may grow count as having as much free
+//! space as the emptiest disk. The weights are determined on construction,
+//! by refresh(), and recomputed after each period() of assigned blocks, so
+//! the assignment follows the throughput measured while the disks fill up.
+//! \remarks model of \b allocation_strategy concept
+struct load_balancing : public striping
+{
+private:
+    //! sequence of disks, each occurring according to its weight
+    mutable std::vector<unsigned_type> seq;
+    unsigned_type offset;
+    //! number of blocks assigned since the weights were computed
+    mutable unsigned_type assigned;
+
+    //! computes the weights and seq from the current free space and
+    //! throughput of the disks.
+    void update_weights() const;
+
+public:
+    load_balancing(unsigned_type b, unsigned_type e) : striping(b, e)
+    {
+        refresh();
+    }
+
+    load_balancing() : striping()
+    {
+        refresh();
+    }
+
+    //! Recomputes the disk weights from the current free space and
+    //! throughput of the disks.
+    void refresh();
+
+    //! Returns the length of the periodic disk sequence.
+    unsigned_type period() const
+    {
+        return seq.size();
+    }
+
+    unsigned_type operator () (unsigned_type i) const
+    {
+        if (assigned == seq.size()) {
+            update_weights();
+            assigned = 0;
+        }
+        ++assigned;
+        return begin + seq[(i + offset) % seq.size()];
+    }
+
+    static const char * name()
+    {
+        return "load-balancing striping";
+    }
+};
+
 //! 'Single disk' disk allocation scheme functor.
 //! \remarks model of \b allocation_strategy concept
 struct single_disk
@@ -213,6 +276,144 @@ struct single_disk
     }
 };
 
+//! Interface of disk allocation scheme functors selected at run time, see
+//! dynamic_alloc_strategy.
+struct basic_dynamic_alloc_strategy
+{
+    virtual ~basic_dynamic_alloc_strategy()
+    { }
+
+    virtual unsigned_type operator () (unsigned_type i) const = 0;
+
+    //! Returns name of the wrapped allocation strategy.
+    virtual const char * get_name() const = 0;
+
+    //! Returns a copy of the object allocated with new.
+    virtual basic_dynamic_alloc_strategy * clone() const = 0;
+};
+
+//! Wraps a model of \b allocation_strategy concept into a
+//! basic_dynamic_alloc_strategy.
+template <class Strategy>
+struct dynamic_alloc_strategy_impl : public basic_dynamic_alloc_strategy
+{
+    Strategy strategy;
+
+    dynamic_alloc_strategy_impl(const Strategy& s) : strategy(s)
+    { }
+
+    unsigned_type operator () (unsigned_type i) const
+    {
+        return strategy(i);
+    }
+
+    const char * get_name() const
+    {
+        return Strategy::name();
+    }
+
+    basic_dynamic_alloc_strategy * clone() const
+    {
+        return new dynamic_alloc_strategy_impl(*this);
+    }
+};
+
+//! Run-time selected disk allocation scheme functor.
+//!
+//! Forwards to one of the other allocation strategies, which is chosen by
+//! name ("striping", "FR", "SR", "RC", "RC_disk", "RC_flash",
+//! "load_balancing" or "single_disk"), or given as object. If default
+//! constructed, the strategy named by config::get_alloc_strategy() is used,
+//! which can be set with an \c alloc= line in the disk configuration file.
+//! Hence containers instantiated with this strategy can change the block
+//! layout without recompilation, at the cost of one virtual function call
+//! per allocated block. Only stxxl::vector takes a strategy object in its
+//! constructor; the other containers default construct theirs.
+//! \remarks model of \b allocation_strategy concept
+class dynamic_alloc_strategy
+{
+    basic_dynamic_alloc_strategy* m_impl;
+
+public:
+    //! Creates the configured strategy on all disks.
+    dynamic_alloc_strategy()
+        : m_impl(create(config::get_instance()->get_alloc_strategy()))
+    { }
+
+    //! Creates the configured strategy on disks [b, e).
+    dynamic_alloc_strategy(unsigned_type b, unsigned_type e)
+        : m_impl(create(config::get_instance()->get_alloc_strategy(), b, e))
+    { }
+
+    //! Creates the strategy with the given name on its default disks.
+    explicit dynamic_alloc_strategy(const std::string& name)
+        : m_impl(create(name))
+    { }
+
+    //! Creates the strategy with the given name on disks [b, e).
+    dynamic_alloc_strategy(const std::string& name, unsigned_type b, unsigned_type e)
+        : m_impl(create(name, b, e))
+    { }
+
+    //! Wraps a copy of the given strategy object.
+    template <class Strategy>
+    static dynamic_alloc_strategy wrap(const Strategy& s)
+    {
+        return dynamic_alloc_strategy(new dynamic_alloc_strategy_impl<Strategy>(s));
+    }
+
+    dynamic_alloc_strategy(const dynamic_alloc_strategy& other)
+        : m_impl(other.m_impl->clone())
+    { }
+
+    dynamic_alloc_strategy& operator = (const dynamic_alloc_strategy& other)
+    {
+        dynamic_alloc_strategy copy(other);
+        swap(copy);
+        return *this;
+    }
+
+    ~dynamic_alloc_strategy()
+    {
+        delete m_impl;
+    }
+
+    void swap(dynamic_alloc_strategy& other)
+    {
+        std::swap(m_impl, other.m_impl);
+    }
+
+    unsigned_type operator () (unsigned_type i) const
+    {
+        return (*m_impl)(i);
+    }
+
+    //! Returns name of the selected allocation strategy.
+    const char * get_name() const
+    {
+        return m_impl->get_name();
+    }
+
+    static const char * name()
+    {
+        return "run-time selected allocation strategy";
+    }
+
+    //! Returns true if a strategy with the given name exists.
+    static bool is_valid_name(const std::string& name);
+
+protected:
+    //! takes ownership of impl
+    explicit dynamic_alloc_strategy(basic_dynamic_alloc_strategy* impl)
+        : m_impl(impl)
+    { }
+
+    static basic_dynamic_alloc_strategy * create(const std::string& name);
+
+    static basic_dynamic_alloc_strategy * create(const std::string& name,
+                                                 unsigned_type b, unsigned_type e);
+};
+
 //! Allocator functor adaptor.
 //!
 //! Gives offset to disk number sequence defined in constructor
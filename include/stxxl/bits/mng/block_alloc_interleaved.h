@@ -103,6 +103,49 @@ struct interleaved_RC : public interleaved_striping
     }
 };
 
+struct interleaved_load_balancing : public interleaved_striping
+{
+    load_balancing base;
+    std::vector<unsigned_type> offsets;
+
+    interleaved_load_balancing(int_type _nruns, const load_balancing& strategy)
+        : interleaved_striping(_nruns, strategy.begin, strategy.diff),
+          base(strategy)
+    {
+        typedef random_number<random_uniform_fast> rnd_type;
+        rnd_type rnd;
+        for (int_type i = 0; i < nruns; i++)
+            offsets.push_back(rnd(rnd_type::value_type(base.period())));
+    }
+
+    unsigned_type operator () (unsigned_type i) const
+    {
+        return base(i / nruns + offsets[i % nruns]);
+    }
+};
+
+struct interleaved_dynamic
+{
+    int_type nruns;
+    dynamic_alloc_strategy base;
+    std::vector<unsigned_type> offsets;
+
+    interleaved_dynamic(int_type _nruns, const dynamic_alloc_strategy& strategy)
+        : nruns(_nruns), base(strategy)
+    {
+        // each run follows the wrapped strategy from a random start
+        typedef random_number<random_uniform_fast> rnd_type;
+        rnd_type rnd;
+        for (int_type i = 0; i < nruns; i++)
+            offsets.push_back(rnd(rnd_type::value_type(1) << 20));
+    }
+
+    unsigned_type operator () (unsigned_type i) const
+    {
+        return base(i / nruns + offsets[i % nruns]);
+    }
+};
+
 struct first_disk_only : public interleaved_striping
 {
     first_disk_only(int_type _nruns, const single_disk& strategy)
@@ -157,6 +200,18 @@ struct interleaved_alloc_traits<RC_flash>
     typedef interleaved_RC strategy;
 };
 
+template <>
+struct interleaved_alloc_traits<load_balancing>
+{
+    typedef interleaved_load_balancing strategy;
+};
+
+template <>
+struct interleaved_alloc_traits<dynamic_alloc_strategy>
+{
+    typedef interleaved_dynamic strategy;
+};
+
 template <>
 struct interleaved_alloc_traits<single_disk>
 {
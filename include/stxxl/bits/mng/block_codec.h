@@ -0,0 +1,161 @@
+/***************************************************************************
+ *  include/stxxl/bits/mng/block_codec.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_MNG_BLOCK_CODEC_HEADER
+#define STXXL_MNG_BLOCK_CODEC_HEADER
+
+#include <cstring>
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/common/types.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/io/request.h>
+
+STXXL_BEGIN_NAMESPACE
+
+//! \addtogroup mnglayer
+//! \{
+
+//! Codec which stores blocks unchanged, the default of block_prefetcher.
+struct no_block_codec
+{
+    enum { enabled = false };
+
+    template <typename ValueType>
+    static unsigned_type max_encoded_size(unsigned_type n)
+    {
+        return n * sizeof(ValueType);
+    }
+
+    template <typename ValueType>
+    static unsigned_type encode(const ValueType* in, unsigned_type n, unsigned char* out)
+    {
+        std::memcpy(out, static_cast<const void*>(in), n * sizeof(ValueType));
+        return n * sizeof(ValueType);
+    }
+
+    template <typename ValueType>
+    static void decode(const unsigned char* in, unsigned_type n, ValueType* out)
+    {
+        std::memcpy(static_cast<void*>(out), in, n * sizeof(ValueType));
+    }
+};
+
+//! Codec for blocks of integers of at most 64 bits, which stores the
+//! differences of consecutive elements zigzag and varint encoded. Sorted
+//! data, e.g. sort runs, with small gaps compresses to few bytes per element.
+//!
+//! A codec provides max_encoded_size(), encode() and decode() with the
+//! signatures of this class and may be selected for the runs of a sort by
+//! the comparator, see sort_helper::run_codec_of.
+class delta_varint_codec
+{
+public:
+    enum { enabled = true };
+
+    //! Upper bound of the number of bytes encode() writes for n elements.
+    template <typename ValueType>
+    static unsigned_type max_encoded_size(unsigned_type n)
+    {
+        return n * ((sizeof(ValueType) * 8 + 6) / 7 + 1);
+    }
+
+    //! Encodes in[0,n) into out and returns the number of bytes written.
+    template <typename ValueType>
+    static unsigned_type encode(const ValueType* in, unsigned_type n, unsigned char* out)
+    {
+        unsigned char* const begin = out;
+        uint64 prev = 0;
+        for (unsigned_type i = 0; i < n; ++i)
+        {
+            const uint64 curr = uint64(in[i]);
+            const uint64 delta = curr - prev;
+            // zigzag: small negative deltas become small numbers as well
+            uint64 x = (delta << 1) ^ (0 - (delta >> 63));
+            prev = curr;
+
+            while (x >= 0x80)
+            {
+                *out++ = (unsigned char)(x | 0x80);
+                x >>= 7;
+            }
+            *out++ = (unsigned char)x;
+        }
+        return unsigned_type(out - begin);
+    }
+
+    //! Decodes n elements from in into out[0,n).
+    template <typename ValueType>
+    static void decode(const unsigned char* in, unsigned_type n, ValueType* out)
+    {
+        uint64 prev = 0;
+        for (unsigned_type i = 0; i < n; ++i)
+        {
+            uint64 x = 0;
+            unsigned shift = 0;
+            while (*in & 0x80)
+            {
+                x |= uint64(*in++ & 0x7f) << shift;
+                shift += 7;
+            }
+            x |= uint64(*in++) << shift;
+
+            prev += (x >> 1) ^ (0 - (x & 1));
+            out[i] = ValueType(prev);
+        }
+    }
+};
+
+//! Size of the scratch memory needed by encode_block() and decode_block().
+template <typename Codec, typename BlockType>
+inline unsigned_type block_codec_scratch_size()
+{
+    return STXXL_MAX<unsigned_type>(
+        Codec::template max_encoded_size<typename BlockType::value_type>(BlockType::size),
+        BlockType::raw_size);
+}
+
+//! Encodes the elements of block into its own memory using scratch, which
+//! must hold block_codec_scratch_size() bytes.
+//! \return the number of bytes to store, a multiple of STXXL_BLOCK_ALIGN, or
+//! BlockType::raw_size if the block is stored unchanged
+template <typename Codec, typename BlockType>
+inline unsigned_type encode_block(BlockType& block, unsigned char* scratch)
+{
+    if (!Codec::enabled)
+        return BlockType::raw_size;
+
+    const unsigned_type bytes = div_ceil(
+        Codec::encode(block.elem, BlockType::size, scratch),
+        STXXL_BLOCK_ALIGN) * STXXL_BLOCK_ALIGN;
+    if (bytes >= unsigned_type(BlockType::raw_size))
+        return BlockType::raw_size;
+
+    std::memcpy(static_cast<void*>(block.elem), scratch, bytes);
+    return bytes;
+}
+
+//! Restores a block encoded by encode_block() into stored_size bytes, using
+//! scratch, which must hold block_codec_scratch_size() bytes.
+template <typename Codec, typename BlockType>
+inline void decode_block(BlockType& block, unsigned_type stored_size, unsigned char* scratch)
+{
+    if (!Codec::enabled || stored_size >= unsigned_type(BlockType::raw_size))
+        return;
+
+    std::memcpy(scratch, static_cast<const void*>(block.elem), stored_size);
+    Codec::decode(scratch, BlockType::size, block.elem);
+}
+
+//! \}
+
+STXXL_END_NAMESPACE
+
+#endif // !STXXL_MNG_BLOCK_CODEC_HEADER
+// vim: et:ts=4:sw=4
@@ -87,6 +87,27 @@ protected:
         unsigned_type offset,
         BIDIteratorClass out);
 
+    template <class BlockType>
+    void aio_blocks(
+        request::request_type type,
+        BlockType* const* blocks,
+        const typename BlockType::bid_type* bids,
+        size_t n,
+        request_ptr* reqs,
+        const completion_handler& on_cmpl);
+
+    //! Submits n requests of equal size, grouping them by file and passing
+    //! each group to file::aread_batch() or file::awrite_batch().
+    void aio_batch(
+        request::request_type type,
+        file* const* files,
+        void* const* buffers,
+        const file::offset_type* offsets,
+        file::size_type bytes,
+        size_t n,
+        request_ptr* reqs,
+        const completion_handler& on_cmpl);
+
 public:
     //! return total number of bytes available in all disks
     uint64 get_total_bytes() const;
@@ -94,6 +115,12 @@ public:
     //! Return total number of free disk allocations
     uint64 get_free_bytes() const;
 
+    //! Return number of free bytes on the given disk
+    uint64 get_free_bytes(size_t disk) const;
+
+    //! Return the I/O statistics of the given disk
+    const file_stats & get_file_stats(size_t disk) const;
+
     //! Allocates new blocks.
     //!
     //! Allocates new blocks according to the strategy
@@ -165,6 +192,37 @@ public:
     template <unsigned BLK_SIZE>
     void delete_block(const BID<BLK_SIZE>& bid);
 
+    //! Reads blocks.
+    //!
+    //! Reads bids[i] into blocks[i] for all i < n. Requests for blocks on the
+    //! same file are enqueued together with a single lock acquisition and
+    //! wakeup of the disk queue, see file::aread_batch().
+    //! \param blocks array of n pointers to blocks
+    //! \param bids array of n block identifiers
+    //! \param n number of blocks
+    //! \param reqs array receiving the n request objects
+    //! \param on_cmpl completion handler, called for each block
+    template <class BlockType>
+    void read_blocks(BlockType* const* blocks,
+                     const typename BlockType::bid_type* bids,
+                     size_t n, request_ptr* reqs,
+                     const completion_handler& on_cmpl = completion_handler())
+    {
+        aio_blocks(request::READ, blocks, bids, n, reqs, on_cmpl);
+    }
+
+    //! Writes blocks.
+    //!
+    //! Writes blocks[i] to bids[i] for all i < n, see read_blocks().
+    template <class BlockType>
+    void write_blocks(BlockType* const* blocks,
+                      const typename BlockType::bid_type* bids,
+                      size_t n, request_ptr* reqs,
+                      const completion_handler& on_cmpl = completion_handler())
+    {
+        aio_blocks(request::WRITE, blocks, bids, n, reqs, on_cmpl);
+    }
+
     ~block_manager();
 
 #if STXXL_MNG_COUNT_ALLOCATION
@@ -265,6 +323,34 @@ void block_manager::delete_blocks(
     }
 }
 
+template <class BlockType>
+void block_manager::aio_blocks(
+    request::request_type type,
+    BlockType* const* blocks,
+    const typename BlockType::bid_type* bids,
+    size_t n,
+    request_ptr* reqs,
+    const completion_handler& on_cmpl)
+{
+    if (n == 0)
+        return;
+
+    simple_vector<file*> files(n);
+    simple_vector<void*> buffers(n);
+    simple_vector<file::offset_type> offsets(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        STXXL_VERBOSE_BLOCK_LIFE_CYCLE((type == request::READ ? "BLC:read   " : "BLC:write  ") << FMT_BID(bids[i]));
+        files[i] = bids[i].storage;
+        buffers[i] = blocks[i];
+        offsets[i] = bids[i].offset;
+    }
+
+    aio_batch(type, files.begin(), buffers.begin(), offsets.begin(),
+              BlockType::raw_size, n, reqs, on_cmpl);
+}
+
 // in bytes
 #ifndef STXXL_DEFAULT_BLOCK_SIZE
     #define STXXL_DEFAULT_BLOCK_SIZE(type) (2 * 1024 * 1024) // use traits
@@ -21,6 +21,8 @@
 #include <stxxl/bits/common/onoff_switch.h>
 #include <stxxl/bits/io/request.h>
 #include <stxxl/bits/io/iostats.h>
+#include <stxxl/bits/mng/block_codec.h>
+#include <stxxl/bits/common/simple_vector.h>
 #include <stxxl/bits/noncopyable.h>
 
 STXXL_BEGIN_NAMESPACE
@@ -47,11 +49,42 @@ public:
     }
 };
 
+//! Completion handler for a batch of reads into an array of buffers, sets the
+//! switch of the block read into the buffer of the request.
+template <typename BlockType>
+class set_batch_switch_handler
+{
+    const BlockType* buffers;
+    onoff_switch* switches;
+    //! index of the switch for each buffer
+    const int_type* switch_of_buffer;
+    completion_handler on_compl;
+
+public:
+    set_batch_switch_handler(const BlockType* _buffers, onoff_switch* _switches,
+                             const int_type* _switch_of_buffer,
+                             const completion_handler& on_compl)
+        : buffers(_buffers), switches(_switches),
+          switch_of_buffer(_switch_of_buffer), on_compl(on_compl)
+    { }
+
+    void operator () (request* req)
+    {
+        const int_type ibuffer = static_cast<const BlockType*>(req->get_buffer()) - buffers;
+        on_compl(req);
+        switches[switch_of_buffer[ibuffer]].on();
+    }
+};
+
 //! Encapsulates asynchronous prefetching engine.
 //!
 //! \c block_prefetcher overlaps I/Os with consumption of read data.
 //! Utilizes optimal asynchronous prefetch scheduling (by Peter Sanders et.al.)
-template <typename BlockType, typename BidIteratorType>
+//!
+//! Blocks written by encode_block() are read partially and decoded with
+//! BlockCodec before they are handed out, see the constructor.
+template <typename BlockType, typename BidIteratorType,
+          typename BlockCodec = no_block_codec>
 class block_prefetcher : private noncopyable
 {
 public:
@@ -81,18 +114,52 @@ protected:
 
     completion_handler do_after_fetch;
 
+    //! number of bytes stored of each block of the consumption sequence, see
+    //! encode_block(), or NULL if all blocks are stored unchanged
+    const unsigned_type* stored_sizes;
+
+    //! scratch memory for decode_block()
+    simple_vector<unsigned char> decode_scratch;
+
+    //! Starts reading block iblock of the consumption sequence into buffer
+    //! ibuffer, only the stored bytes of encoded blocks are read.
+    request_ptr read_block(int_type ibuffer, int_type iblock)
+    {
+        read_bids[ibuffer] = *(consume_seq_begin + iblock);
+        if (stored_sizes && stored_sizes[iblock] < unsigned_type(block_type::raw_size))
+        {
+            return read_bids[ibuffer].storage->aread(
+                read_buffers + ibuffer, read_bids[ibuffer].offset, stored_sizes[iblock],
+                set_switch_handler(*(completed + iblock), do_after_fetch));
+        }
+        return read_buffers[ibuffer].read(
+            read_bids[ibuffer],
+            set_switch_handler(*(completed + iblock), do_after_fetch));
+    }
+
     block_type * wait(int_type iblock)
     {
         STXXL_VERBOSE1("block_prefetcher: waiting block " << iblock);
         {
+            stats::scoped_wait_site wait_site("block_prefetcher");
             stats::scoped_wait_timer wait_timer(stats::WAIT_OP_READ);
 
+            if (!completed[iblock].is_on())
+            {
+                // demand miss: the block is needed now, not just prefetched
+                request_ptr& req = read_reqs[pref_buffer[iblock]];
+                if (req.valid())
+                    req->raise_priority(request::DEMAND);
+            }
+
             completed[iblock].wait_for_on();
         }
         STXXL_VERBOSE1("block_prefetcher: finished waiting block " << iblock);
         int_type ibuffer = pref_buffer[iblock];
         STXXL_VERBOSE1("block_prefetcher: returning buffer " << ibuffer);
         assert(ibuffer >= 0 && ibuffer < nreadblocks);
+        if (stored_sizes)
+            decode_block<BlockCodec>(read_buffers[ibuffer], stored_sizes[iblock], decode_scratch.begin());
         return (read_buffers + ibuffer);
     }
 
@@ -104,12 +171,16 @@ public:
     //!        the indices of the blocks in the consumption sequence
     //! \param _prefetch_buf_size amount of prefetch buffers to use
     //! \param do_after_fetch unknown
+    //! \param _stored_sizes number of bytes stored of each block of the
+    //!        consumption sequence, if they were written by encode_block() with
+    //!        BlockCodec, otherwise NULL
     block_prefetcher(
         bid_iterator_type _cons_begin,
         bid_iterator_type _cons_end,
         int_type* _pref_seq,
         int_type _prefetch_buf_size,
-        completion_handler do_after_fetch = completion_handler())
+        completion_handler do_after_fetch = completion_handler(),
+        const unsigned_type* _stored_sizes = NULL)
         : consume_seq_begin(_cons_begin),
           consume_seq_end(_cons_end),
           seq_length(_cons_end - _cons_begin),
@@ -117,7 +188,9 @@ public:
           nextread(STXXL_MIN(unsigned_type(_prefetch_buf_size), seq_length)),
           nextconsume(0),
           nreadblocks(nextread),
-          do_after_fetch(do_after_fetch)
+          do_after_fetch(do_after_fetch),
+          stored_sizes(_stored_sizes),
+          decode_scratch(_stored_sizes ? block_codec_scratch_size<BlockCodec, block_type>() : 0)
     {
         STXXL_VERBOSE1("block_prefetcher: seq_length=" << seq_length);
         STXXL_VERBOSE1("block_prefetcher: _prefetch_buf_size=" << _prefetch_buf_size);
@@ -133,20 +206,32 @@ public:
 
         completed = new onoff_switch[seq_length];
 
+        simple_vector<block_type*> blocks(stored_sizes ? 0 : nreadblocks);
+
         for (i = 0; i < nreadblocks; ++i)
         {
             assert(prefetch_seq[i] < int_type(seq_length));
             assert(prefetch_seq[i] >= 0);
-            read_bids[i] = *(consume_seq_begin + prefetch_seq[i]);
+            pref_buffer[prefetch_seq[i]] = i;
+            if (stored_sizes) {
+                read_reqs[i] = read_block(i, prefetch_seq[i]);
+            }
+            else {
+                read_bids[i] = *(consume_seq_begin + prefetch_seq[i]);
+                blocks[i] = read_buffers + i;
+            }
             STXXL_VERBOSE1("block_prefetcher: reading block " << i <<
                            " prefetch_seq[" << i << "]=" << prefetch_seq[i] <<
                            " @ " << &read_buffers[i] <<
                            " @ " << read_bids[i]);
-            read_reqs[i] = read_buffers[i].read(
-                read_bids[i],
-                set_switch_handler(*(completed + prefetch_seq[i]), do_after_fetch));
-            pref_buffer[prefetch_seq[i]] = i;
         }
+
+        // blocks stored unchanged are submitted as one batch
+        if (!stored_sizes)
+            block_type::read_batch(
+                blocks.begin(), read_bids, nreadblocks, read_reqs,
+                set_batch_switch_handler<block_type>(
+                    read_buffers, completed, prefetch_seq, do_after_fetch));
     }
     //! Pulls next unconsumed block from the consumption sequence.
     //! \return Pointer to the already prefetched block from the internal buffer pool
@@ -179,11 +264,7 @@ public:
             assert(!completed[next_2_prefetch].is_on());
 
             pref_buffer[next_2_prefetch] = ibuffer;
-            read_bids[ibuffer] = *(consume_seq_begin + next_2_prefetch);
-            read_reqs[ibuffer] = read_buffers[ibuffer].read(
-                read_bids[ibuffer],
-                set_switch_handler(*(completed + next_2_prefetch), do_after_fetch)
-                );
+            read_reqs[ibuffer] = read_block(ibuffer, next_2_prefetch);
         }
 
         if (nextconsume >= seq_length)
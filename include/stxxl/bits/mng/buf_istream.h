@@ -128,6 +128,36 @@ public:
         return *this;
     }
 
+    //! Returns the number of records which can be read through
+    //! batch_begin() before advance() has to be called.
+    unsigned_type batch_length() const
+    {
+        return block_type::size - current_elem;
+    }
+
+    //! Returns pointer to the current record, which is followed by the
+    //! remaining records of the current block.
+    const typename block_type::value_type * batch_begin() const
+    {
+        return current_blk->elem + current_elem;
+    }
+
+    //! Moves n records ahead, at most to the end of the current block.
+    //! \return reference to itself after the advance
+    self_type & advance(unsigned_type n)
+    {
+#ifdef BUF_ISTREAM_CHECK_END
+        assert(not_finished);
+#endif
+        assert(n <= batch_length());
+
+        current_elem += n;
+
+        if (UNLIKELY(current_elem >= block_type::size))
+            next_block();
+        return *this;
+    }
+
     //! Returns reference to the current block
     const BlockType& block() const
     {
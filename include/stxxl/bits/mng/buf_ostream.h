@@ -94,6 +94,34 @@ public:
         return *this;
     }
 
+    //! Returns the number of records which can be written through
+    //! batch_begin() before advance() has to be called.
+    unsigned_type batch_length() const
+    {
+        return block_type::size - current_elem;
+    }
+
+    //! Returns pointer to the current record, which is followed by the
+    //! remaining records of the current block.
+    typename block_type::value_type * batch_begin()
+    {
+        return current_blk->elem + current_elem;
+    }
+
+    //! Moves n records ahead, at most to the end of the current block.
+    //! \return reference to itself after the advance
+    self_type & advance(unsigned_type n)
+    {
+        assert(n <= batch_length());
+        current_elem += n;
+        if (UNLIKELY(current_elem >= block_type::size))
+        {
+            current_elem = 0;
+            current_blk = writer.write(current_blk, *(current_bid++));
+        }
+        return *this;
+    }
+
     //! Fill current block with padding and flush
     self_type & fill(const_reference record)
     {
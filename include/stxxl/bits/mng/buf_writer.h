@@ -18,6 +18,7 @@
 
 #include <stxxl/bits/io/request_operations.h>
 #include <stxxl/bits/io/disk_queues.h>
+#include <stxxl/bits/common/simple_vector.h>
 #include <stxxl/bits/noncopyable.h>
 
 STXXL_BEGIN_NAMESPACE
@@ -66,6 +67,41 @@ protected:
     typedef std::priority_queue<batch_entry, std::vector<batch_entry>, batch_entry_cmp> batch_type;
     batch_type batch_write_blocks;      // sorted sequence of blocks to write
 
+    //! Submits all blocks of the batch in offset order with a single
+    //! block_type::write_batch() call.
+    void flush_batch()
+    {
+        const size_t n = batch_write_blocks.size();
+        if (n == 0)
+            return;
+
+        simple_vector<block_type*> blocks(n);
+        simple_vector<bid_type> bids(n);
+        simple_vector<int_type> ibuffers(n);
+        simple_vector<request_ptr> reqs(n);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            int_type ibuffer = batch_write_blocks.top().ibuffer;
+            batch_write_blocks.pop();
+
+            if (write_reqs[ibuffer].valid())
+                write_reqs[ibuffer]->wait();
+
+            ibuffers[i] = ibuffer;
+            blocks[i] = write_buffers + ibuffer;
+            bids[i] = write_bids[ibuffer];
+        }
+
+        block_type::write_batch(blocks.begin(), bids.begin(), n, reqs.begin());
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            write_reqs[ibuffers[i]] = reqs[i];
+            busy_write_blocks.push_back(ibuffers[i]);
+        }
+    }
+
 public:
     //! Constructs an object.
     //! \param write_buf_size number of write buffers to use
@@ -110,6 +146,7 @@ public:
             {
                 reqs[i] = write_reqs[busy_write_blocks[i]];
             }
+            stats::scoped_wait_site wait_site("buffered_writer");
             int_type completed = wait_any(reqs, size);
             int_type completed_global = busy_write_blocks[completed];
             delete[] reqs;
@@ -130,21 +167,7 @@ public:
     block_type * write(block_type* filled_block, const bid_type& bid)          // writes filled_block and returns a new block
     {
         if (batch_write_blocks.size() >= writebatchsize)
-        {
-            // flush batch
-            while (!batch_write_blocks.empty())
-            {
-                int_type ibuffer = batch_write_blocks.top().ibuffer;
-                batch_write_blocks.pop();
-
-                if (write_reqs[ibuffer].valid())
-                    write_reqs[ibuffer]->wait();
-
-                write_reqs[ibuffer] = write_buffers[ibuffer].write(write_bids[ibuffer]);
-
-                busy_write_blocks.push_back(ibuffer);
-            }
-        }
+            flush_batch();
         //    STXXL_MSG("Adding write request to batch");
 
         int_type ibuffer = filled_block - write_buffers;
@@ -157,18 +180,7 @@ public:
     void flush()
     {
         int_type ibuffer;
-        while (!batch_write_blocks.empty())
-        {
-            ibuffer = batch_write_blocks.top().ibuffer;
-            batch_write_blocks.pop();
-
-            if (write_reqs[ibuffer].valid())
-                write_reqs[ibuffer]->wait();
-
-            write_reqs[ibuffer] = write_buffers[ibuffer].write(write_bids[ibuffer]);
-
-            busy_write_blocks.push_back(ibuffer);
-        }
+        flush_batch();
         for (std::vector<int_type>::const_iterator it =
                  busy_write_blocks.begin();
              it != busy_write_blocks.end(); it++)
@@ -189,18 +201,7 @@ public:
     ~buffered_writer()
     {
         int_type ibuffer;
-        while (!batch_write_blocks.empty())
-        {
-            ibuffer = batch_write_blocks.top().ibuffer;
-            batch_write_blocks.pop();
-
-            if (write_reqs[ibuffer].valid())
-                write_reqs[ibuffer]->wait();
-
-            write_reqs[ibuffer] = write_buffers[ibuffer].write(write_bids[ibuffer]);
-
-            busy_write_blocks.push_back(ibuffer);
-        }
+        flush_batch();
         for (std::vector<int_type>::const_iterator it =
                  busy_write_blocks.begin();
              it != busy_write_blocks.end(); it++)
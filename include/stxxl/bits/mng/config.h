@@ -100,9 +100,15 @@ public:
     //! unlink file immediately after opening (available on most Unix)
     bool unlink_on_open;
 
-    //! desired queue length for linuxaio_file and linuxaio_queue
+    //! desired queue length for linuxaio_file and linuxaio_queue, or ring
+    //! size for iouring_file and iouring_queue, or number of worker threads
+    //! of the request queue for the other fileio implementations
     int queue_length;
 
+    //! store the blocks compressed via a compressed_file on top of the
+    //! fileio implementation
+    bool compress;
+
     //! \}
 };
 
@@ -125,10 +131,14 @@ class config : public singleton<config>
     //! Finished initializing config
     bool is_initialized;
 
+    //! name of allocation strategy used by dynamic_alloc_strategy
+    std::string m_alloc_strategy;
+
     //! Constructor: this must be inlined to print the header version
     //! string.
     inline config()
-        : is_initialized(false)
+        : is_initialized(false),
+          m_alloc_strategy("RC")
     {
         logger::get_instance();
         STXXL_MSG(get_version_string_long());
@@ -173,6 +183,27 @@ public:
         return *this;
     }
 
+    //! Set the allocation strategy used by default constructed
+    //! dynamic_alloc_strategy objects, see there for valid names.
+    config & set_alloc_strategy(const std::string& name);
+
+    //! Returns name of the allocation strategy used by default constructed
+    //! dynamic_alloc_strategy objects. Loads the disk configuration file
+    //! first, which may set it.
+    const std::string & get_alloc_strategy()
+    {
+        check_initialized();
+        return m_alloc_strategy;
+    }
+
+    //! Returns name of the allocation strategy used by default constructed
+    //! dynamic_alloc_strategy objects.
+    const std::string & get_alloc_strategy() const
+    {
+        assert(is_initialized);
+        return m_alloc_strategy;
+    }
+
     //! \}
 
 protected:
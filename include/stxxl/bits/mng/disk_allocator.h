@@ -30,9 +30,9 @@
 
 #include <algorithm>
 #include <cassert>
-#include <functional>
 #include <map>
 #include <ostream>
+#include <set>
 #include <utility>
 
 STXXL_BEGIN_NAMESPACE
@@ -40,24 +40,26 @@ STXXL_BEGIN_NAMESPACE
 //! \ingroup mnglayer
 //! \{
 
+//! Manages the free space of a disk.
+//!
+//! Free regions are kept in a map ordered by offset, which is used to
+//! coalesce adjacent regions on deallocation, and in a set ordered by
+//! (size, offset), which is used to find the smallest region that fits an
+//! allocation in logarithmic time.
 class disk_allocator : private noncopyable
 {
+    //! (size, offset) of a free region
     typedef std::pair<stxxl::int64, stxxl::int64> place;
 
-    struct first_fit : public std::binary_function<place, stxxl::int64, bool>
-    {
-        bool operator () (
-            const place& entry,
-            const stxxl::int64 size) const
-        {
-            return (entry.second >= size);
-        }
-    };
-
+    //! offset -> size of free regions
     typedef std::map<stxxl::int64, stxxl::int64> sortseq;
 
+    //! free regions ordered by size, then offset
+    typedef std::set<place> size_index;
+
     stxxl::mutex mutex;
     sortseq free_space;
+    size_index free_size_index;
     stxxl::int64 free_bytes;
     stxxl::int64 disk_bytes;
     stxxl::int64 cfg_bytes;
@@ -73,6 +75,37 @@ class disk_allocator : private noncopyable
     // expects the mutex to be locked to prevent concurrent access
     void add_free_region(stxxl::int64 block_pos, stxxl::int64 block_size);
 
+    // expects the mutex to be locked to prevent concurrent access
+    void insert_free(stxxl::int64 region_pos, stxxl::int64 region_size)
+    {
+        free_space[region_pos] = region_size;
+        free_size_index.insert(place(region_size, region_pos));
+    }
+
+    // expects the mutex to be locked to prevent concurrent access
+    void erase_free(sortseq::iterator region)
+    {
+        free_size_index.erase(place(region->second, region->first));
+        free_space.erase(region);
+    }
+
+    // removes the smallest free region of at least size bytes and returns
+    // its offset and size, or returns false if there is none.
+    // expects the mutex to be locked to prevent concurrent access
+    bool take_best_fit(stxxl::int64 size,
+                       stxxl::int64& region_pos, stxxl::int64& region_size)
+    {
+        size_index::iterator it = free_size_index.lower_bound(place(size, 0));
+        if (it == free_size_index.end())
+            return false;
+
+        region_size = it->first;
+        region_pos = it->second;
+        free_size_index.erase(it);
+        free_space.erase(region_pos);
+        return true;
+    }
+
     // expects the mutex to be locked to prevent concurrent access
     void grow_file(stxxl::int64 extend_bytes)
     {
@@ -187,11 +220,10 @@ void disk_allocator::new_blocks(BID<BlockSize>* begin, BID<BlockSize>* end)
 
     // dump();
 
-    sortseq::iterator space;
-    space = std::find_if(free_space.begin(), free_space.end(),
-                         bind2nd(first_fit(), requested_size) _STXXL_FORCE_SEQUENTIAL);
+    stxxl::int64 region_pos, region_size;
+    bool found = take_best_fit(requested_size, region_pos, region_size);
 
-    if (space == free_space.end() && requested_size == BlockSize)
+    if (!found && requested_size == BlockSize)
     {
         assert(end - begin == 1);
 
@@ -206,17 +238,13 @@ void disk_allocator::new_blocks(BID<BlockSize>* begin, BID<BlockSize>* end)
 
         grow_file(BlockSize);
 
-        space = std::find_if(free_space.begin(), free_space.end(),
-                             bind2nd(first_fit(), requested_size) _STXXL_FORCE_SEQUENTIAL);
+        found = take_best_fit(requested_size, region_pos, region_size);
     }
 
-    if (space != free_space.end())
+    if (found)
     {
-        stxxl::int64 region_pos = (*space).first;
-        stxxl::int64 region_size = (*space).second;
-        free_space.erase(space);
         if (region_size > requested_size)
-            free_space[region_pos + requested_size] = region_size - requested_size;
+            insert_free(region_pos + requested_size, region_size - requested_size);
 
         for (stxxl::int64 pos = region_pos; begin != end; ++begin)
         {
@@ -236,11 +264,37 @@ void disk_allocator::new_blocks(BID<BlockSize>* begin, BID<BlockSize>* end)
     assert(requested_size > BlockSize);
     assert(end - begin > 1);
 
-    lock.unlock();
+    // fill the blocks into the largest free regions, so they are split into
+    // as few contiguous pieces as possible.
+    while (begin != end)
+    {
+        if (free_size_index.empty() ||
+            free_size_index.rbegin()->first < begin->size)
+        {
+            // the free space is fragmented into pieces smaller than a block
+            if (!autogrow) {
+                STXXL_ERRMSG("Warning: Severe external memory space fragmentation!");
+                dump();
+            }
+            grow_file(begin->size);
+            continue;
+        }
+
+        region_size = free_size_index.rbegin()->first;
+        region_pos = free_size_index.rbegin()->second;
+        erase_free(free_space.find(region_pos));
 
-    BID<BlockSize>* middle = begin + ((end - begin) / 2);
-    new_blocks(begin, middle);
-    new_blocks(middle, end);
+        stxxl::int64 pos = region_pos;
+        for ( ; begin != end && pos + begin->size <= region_pos + region_size; ++begin)
+        {
+            begin->offset = pos;
+            pos += begin->size;
+            free_bytes -= begin->size;
+        }
+
+        if (pos < region_pos + region_size)
+            insert_free(pos, region_pos + region_size - pos);
+    }
 }
 
 //! \}
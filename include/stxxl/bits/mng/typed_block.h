@@ -22,6 +22,7 @@
 #include <stxxl/bits/io/request.h>
 #include <stxxl/bits/common/aligned_alloc.h>
 #include <stxxl/bits/mng/bid.h>
+#include <stxxl/bits/mng/block_manager.h>
 
 #ifndef STXXL_VERBOSE_TYPED_BLOCK
 #define STXXL_VERBOSE_TYPED_BLOCK STXXL_VERBOSE2
@@ -304,6 +305,34 @@ public:
         return bid.storage->aread(this, bid.offset, raw_size, on_cmpl);
     }
 
+    /*! Writes n blocks to the disk(s) as one batch.
+     *! \param blocks array of n blocks to write
+     *! \param bids array of n block identifiers
+     *! \param n number of blocks
+     *! \param reqs array receiving the n request objects
+     *! \param on_cmpl completion handler
+     */
+    static void write_batch(typed_block* const* blocks, const bid_type* bids,
+                            size_t n, request_ptr* reqs,
+                            completion_handler on_cmpl = completion_handler())
+    {
+        block_manager::get_instance()->write_blocks(blocks, bids, n, reqs, on_cmpl);
+    }
+
+    /*! Reads n blocks from the disk(s) as one batch.
+     *! \param blocks array of n blocks to read into
+     *! \param bids array of n block identifiers
+     *! \param n number of blocks
+     *! \param reqs array receiving the n request objects
+     *! \param on_cmpl completion handler
+     */
+    static void read_batch(typed_block* const* blocks, const bid_type* bids,
+                           size_t n, request_ptr* reqs,
+                           completion_handler on_cmpl = completion_handler())
+    {
+        block_manager::get_instance()->read_blocks(blocks, bids, n, reqs, on_cmpl);
+    }
+
     static void* operator new (size_t bytes)
     {
         unsigned_type meta_info_size = bytes % raw_size;
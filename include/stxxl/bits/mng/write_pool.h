@@ -147,6 +147,7 @@ public:
             return p;
         }
         STXXL_VERBOSE_WPOOL("::steal : all " << busy_blocks.size() << " are busy");
+        stats::scoped_wait_site wait_site("write_pool");
         busy_blocks_iterator completed = wait_any(busy_blocks.begin(), busy_blocks.end());
         assert(completed != busy_blocks.end()); // we got something reasonable from wait_any
         assert(completed->req->poll());         // and it is *really* completed
@@ -102,7 +102,11 @@ inline void check_sort_settings()
 inline bool do_parallel_merge()
 {
 #if STXXL_PARALLEL_MULTIWAY_MERGE && defined(STXXL_PARALLEL_MODE)
-    return !stxxl::SETTINGS::native_merge && omp_get_max_threads() >= 1;
+    // inside an inactive nested region the parallel merge would only get
+    // one thread for the work split among all, e.g. in concurrent merges of
+    // stxxl::sort.
+    return !stxxl::SETTINGS::native_merge && omp_get_max_threads() >= 1 &&
+           (!omp_in_parallel() || omp_get_nested());
 #else
     return false;
 #endif
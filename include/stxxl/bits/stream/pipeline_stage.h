@@ -0,0 +1,333 @@
+/***************************************************************************
+ *  include/stxxl/bits/stream/pipeline_stage.h
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#ifndef STXXL_STREAM_PIPELINE_STAGE_HEADER
+#define STXXL_STREAM_PIPELINE_STAGE_HEADER
+
+#include <stxxl/bits/config.h>
+
+#if STXXL_STD_THREADS
+ #include <thread>
+#elif STXXL_BOOST_THREADS
+ #include <boost/thread/thread.hpp>
+ #include <boost/bind.hpp>
+#elif STXXL_POSIX_THREADS
+ #include <pthread.h>
+#else
+ #error "Thread implementation not detected."
+#endif
+
+#include <algorithm>
+#include <vector>
+#if __cplusplus >= 201103L || (STXXL_MSVC && _MSC_VER >= 1900)
+ #include <exception>
+#else
+ #include <stdexcept>
+ #include <string>
+#endif
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/common/semaphore.h>
+#include <stxxl/bits/stream/stream.h>
+
+STXXL_BEGIN_NAMESPACE
+
+//! Stream package subnamespace.
+namespace stream {
+
+//! \addtogroup streampack
+//! \{
+
+////////////////////////////////////////////////////////////////////////
+//     PIPELINE STAGE                                                 //
+////////////////////////////////////////////////////////////////////////
+
+//! Evaluates an input stream asynchronously in a thread of its own.
+//!
+//! The thread pulls the input in blocks of block_length elements (using the
+//! batch protocol, see pull_batch()) into a ring of num_blocks blocks, from
+//! which they are handed out by the standard stream methods and fill().
+//! Hence the input stage, e.g. a runs_merger, and the consuming stage, e.g.
+//! the runs_creator of another sort, run concurrently, synchronizing only
+//! once per block. The ring bounds the memory used by the stage to
+//! block_length * num_blocks elements.
+//!
+//! The input must not be accessed otherwise while the stage exists, it is
+//! drained until its end or the destruction of the stage. An exception thrown
+//! by the input in the thread ends the stream and is rethrown to the consumer
+//! by empty(), operator * and operator ++, after the elements pulled before.
+template <class Input>
+class pipeline_stage : private noncopyable
+{
+public:
+    //! Standard stream typedef.
+    typedef typename Input::value_type value_type;
+
+    //! Supports the batch stream protocol, see fill().
+    typedef batch_fill_tag batch_category;
+
+private:
+#if STXXL_STD_THREADS
+    typedef std::thread* thread_type;
+#elif STXXL_BOOST_THREADS
+    typedef boost::thread* thread_type;
+#else
+    typedef pthread_t thread_type;
+#endif
+
+    //! input stream, pulled by the thread only
+    Input& m_input;
+
+    //! number of elements per block
+    unsigned_type m_block_length;
+
+    //! number of blocks in the ring
+    unsigned_type m_num_blocks;
+
+    //! ring of blocks
+    std::vector<value_type> m_ring;
+
+    //! number of elements in each block, less than m_block_length for the
+    //! last block of the stream
+    std::vector<unsigned_type> m_filled;
+
+    //! blocks of the ring which may be filled by the thread
+    semaphore m_free_blocks;
+
+    //! blocks of the ring which have been filled by the thread
+    semaphore m_full_blocks;
+
+    //! set by the destructor to make the thread stop early
+    bool m_stop;
+
+    //! mutex protecting m_stop
+    mutex m_stop_mutex;
+
+    //! block of the ring currently consumed
+    unsigned_type m_current_block;
+
+    //! current element and end of the current block
+    const value_type* m_current;
+    const value_type* m_current_end;
+
+    //! true if the current block is the last one
+    bool m_last_block;
+
+    //! set by the thread if pulling the input threw, before the block is
+    //! handed over, which ends the stream
+    bool m_failed;
+
+#if __cplusplus >= 201103L || (STXXL_MSVC && _MSC_VER >= 1900)
+    //! exception thrown by the input in the thread
+    std::exception_ptr m_error;
+#else
+    //! message of the exception thrown by the input in the thread
+    std::string m_error;
+#endif
+
+    //! true once the consumer reached the failed block
+    bool m_rethrow;
+
+    thread_type m_thread;
+
+    static void * worker(void* arg)
+    {
+        static_cast<pipeline_stage*>(arg)->produce();
+        return NULL;
+    }
+
+    void produce()
+    {
+        for (unsigned_type b = 0; ; b = (b + 1) % m_num_blocks)
+        {
+            m_free_blocks--;
+            {
+                scoped_mutex_lock lock(m_stop_mutex);
+                if (m_stop)
+                    return;
+            }
+
+            try
+            {
+                m_filled[b] = pull_batch(m_input, &m_ring[b * m_block_length], m_block_length);
+            }
+#if __cplusplus >= 201103L || (STXXL_MSVC && _MSC_VER >= 1900)
+            catch (...)
+            {
+                m_error = std::current_exception();
+                m_failed = true;
+            }
+#else
+            catch (std::exception& e)
+            {
+                m_error = e.what();
+                m_failed = true;
+            }
+            catch (...)
+            {
+                m_error = "unknown exception in pipeline_stage input";
+                m_failed = true;
+            }
+#endif
+            if (m_failed)
+                m_filled[b] = 0;
+
+            m_full_blocks++;
+            if (m_filled[b] < m_block_length)
+                return;
+        }
+    }
+
+    //! Rethrows the exception of the input in the consumer's thread.
+    void rethrow() const
+    {
+#if __cplusplus >= 201103L || (STXXL_MSVC && _MSC_VER >= 1900)
+        std::rethrow_exception(m_error);
+#else
+        throw std::runtime_error(m_error);
+#endif
+    }
+
+    //! Releases the current block to the thread and waits for the next one.
+    void next_block()
+    {
+        assert(!m_last_block);
+
+        m_free_blocks++;
+        m_current_block = (m_current_block + 1) % m_num_blocks;
+        fetch_block();
+    }
+
+    void fetch_block()
+    {
+        m_full_blocks--;
+
+        m_current = &m_ring[m_current_block * m_block_length];
+        m_current_end = m_current + m_filled[m_current_block];
+        m_last_block = (m_filled[m_current_block] < m_block_length);
+        // m_failed is written by the thread before releasing the block
+        m_rethrow = m_last_block && m_failed;
+    }
+
+public:
+    //! Starts evaluating the input in a new thread.
+    //! \param input input stream
+    //! \param block_length number of elements handed over at once
+    //! \param num_blocks number of blocks buffered between the threads, at
+    //! least 2
+    pipeline_stage(Input& input, unsigned_type block_length,
+                   unsigned_type num_blocks = 4)
+        : m_input(input),
+          m_block_length(STXXL_MAX<unsigned_type>(block_length, 1)),
+          m_num_blocks(STXXL_MAX<unsigned_type>(num_blocks, 2)),
+          m_ring(m_block_length * m_num_blocks),
+          m_filled(m_num_blocks, 0),
+          m_free_blocks((int)m_num_blocks),
+          m_full_blocks(0),
+          m_stop(false),
+          m_current_block(0),
+          m_failed(false),
+          m_rethrow(false)
+    {
+#if STXXL_STD_THREADS
+        m_thread = new std::thread(worker, static_cast<void*>(this));
+#elif STXXL_BOOST_THREADS
+        m_thread = new boost::thread(boost::bind(worker, static_cast<void*>(this)));
+#else
+        STXXL_CHECK_PTHREAD_CALL(pthread_create(&m_thread, NULL, worker, static_cast<void*>(this)));
+#endif
+        fetch_block();
+    }
+
+    //! Stops the thread, even if the input is not drained.
+    ~pipeline_stage()
+    {
+        {
+            scoped_mutex_lock lock(m_stop_mutex);
+            m_stop = true;
+        }
+        m_free_blocks.signal((int)m_num_blocks);
+#if STXXL_STD_THREADS
+        m_thread->join();
+        delete m_thread;
+#elif STXXL_BOOST_THREADS
+        m_thread->join();
+        delete m_thread;
+#else
+        STXXL_CHECK_PTHREAD_CALL(pthread_join(m_thread, NULL));
+#endif
+    }
+
+    //! Standard stream method.
+    bool empty() const
+    {
+        if (UNLIKELY(m_rethrow))
+            rethrow();
+        return m_current == m_current_end;
+    }
+
+    //! Standard stream method.
+    const value_type& operator * () const
+    {
+        if (UNLIKELY(m_rethrow))
+            rethrow();
+        assert(!empty());
+        return *m_current;
+    }
+
+    const value_type* operator -> () const
+    {
+        return &(operator * ());
+    }
+
+    //! Standard stream method.
+    pipeline_stage& operator ++ ()
+    {
+        if (UNLIKELY(m_rethrow))
+            rethrow();
+        assert(!empty());
+        ++m_current;
+        if (UNLIKELY(m_current == m_current_end && !m_last_block))
+            next_block();
+        return *this;
+    }
+
+    //! Batch stream method: moves the next up to n elements to out and
+    //! returns their number. An exception of the input is rethrown by the
+    //! first call which moves no elements.
+    unsigned_type fill(value_type* out, unsigned_type n)
+    {
+        unsigned_type done = 0;
+        while (done < n && m_current != m_current_end)
+        {
+            const unsigned_type k =
+                STXXL_MIN<unsigned_type>(n - done, unsigned_type(m_current_end - m_current));
+            std::copy(m_current, m_current + k, out + done);
+            m_current += k;
+            done += k;
+            if (m_current == m_current_end && !m_last_block)
+                next_block();
+        }
+        if (UNLIKELY(done == 0 && m_rethrow))
+            rethrow();
+        return done;
+    }
+};
+
+//! \}
+
+} // namespace stream
+
+STXXL_END_NAMESPACE
+
+#endif // !STXXL_STREAM_PIPELINE_STAGE_HEADER
+// vim: et:ts=4:sw=4
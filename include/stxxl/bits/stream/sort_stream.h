@@ -63,6 +63,7 @@ public:
     typedef sorted_runs<trigger_entry_type, cmp_type> sorted_runs_data_type;
     typedef typename sorted_runs_data_type::run_type run_type;
     typedef counting_ptr<sorted_runs_data_type> sorted_runs_type;
+    typedef typename sort_helper::run_codec_of<cmp_type>::type codec_type;
 
     typedef typename element_iterator_traits<block_type, external_size_type>::element_iterator element_iterator;
 
@@ -95,15 +96,16 @@ private:
         return curr_idx;
     }
 
-    //! fill the rest of the block with max values
+    //! fill the rest of the block with max values, see sort_helper::padding_value()
     void fill_with_max_value(block_type* blocks, unsigned_type num_blocks,
                              unsigned_type first_idx)
     {
         unsigned_type last_idx = num_blocks * block_type::size;
         if (first_idx < last_idx) {
+            const value_type padding = sort_helper::padding_value(m_cmp, blocks[0][0]);
             element_iterator curr = make_element_iterator(blocks, first_idx);
             while (first_idx != last_idx) {
-                *curr = m_cmp.max_value();
+                *curr = padding;
                 ++curr;
                 ++first_idx;
             }
@@ -113,10 +115,9 @@ private:
     //! Sort a specific run, contained in a sequences of blocks.
     void sort_run(block_type* run, unsigned_type elements)
     {
-        check_sort_settings();
-        potentially_parallel::sort(make_element_iterator(run, 0),
-                                   make_element_iterator(run, elements),
-                                   m_cmp);
+        sort_helper::sort_run_elements(make_element_iterator(run, 0),
+                                       make_element_iterator(run, elements),
+                                       m_cmp);
     }
 
     void compute_result();
@@ -132,11 +133,11 @@ public:
         : m_input(input),
           m_cmp(cmp),
           m_result(new sorted_runs_data_type),
-          m_memsize(memory_to_use / BlockSize / sort_memory_usage_factor()),
+          m_memsize(memory_to_use / BlockSize / sort_helper::memory_usage_factor<element_iterator>(cmp)),
           m_result_computed(false)
     {
         sort_helper::verify_sentinel_strict_weak_ordering(cmp);
-        if (!(2 * BlockSize * sort_memory_usage_factor() <= memory_to_use)) {
+        if (!(2 * BlockSize * sort_helper::memory_usage_factor<element_iterator>(cmp) <= memory_to_use)) {
             throw bad_parameter("stxxl::runs_creator<>:runs_creator(): "
                                 "INSUFFICIENT MEMORY provided, "
                                 "please increase parameter 'memory_to_use'");
@@ -234,10 +235,8 @@ void basic_runs_creator<Input, CompareType, BlockSize, AllocStr>::compute_result
     fill_with_max_value(Blocks1, cur_run_size, blocks1_length);
 
     for (i = 0; i < cur_run_size; ++i)
-    {
         run[i].value = Blocks1[i][0];
-        write_reqs[i] = Blocks1[i].write(run[i].bid);
-    }
+    sort_helper::write_run_blocks<codec_type>(Blocks1, run, cur_run_size, write_reqs);
     m_result->runs.push_back(run);
     m_result->runs_sizes.push_back(blocks1_length);
     m_result->elements += blocks1_length;
@@ -259,8 +258,9 @@ void basic_runs_creator<Input, CompareType, BlockSize, AllocStr>::compute_result
         // optimization if the whole set fits into both halves
         // (re)sort internally and return
         blocks2_length += el_in_run;
-        sort_run(Blocks1, blocks2_length);      // sort first an second run together
         wait_all(write_reqs, write_reqs + cur_run_size);
+        sort_helper::restore_run_blocks<codec_type>(Blocks1, run, cur_run_size);
+        sort_run(Blocks1, blocks2_length);      // sort first an second run together
         bm->delete_blocks(make_bid_iterator(run.begin()), make_bid_iterator(run.end()));
 
         cur_run_size = div_ceil(blocks2_length, block_type::size);
@@ -272,29 +272,19 @@ void basic_runs_creator<Input, CompareType, BlockSize, AllocStr>::compute_result
 
         assert(cur_run_size > m2);
 
-        for (i = 0; i < m2; ++i)
-        {
+        for (i = 0; i < cur_run_size; ++i)
             run[i].value = Blocks1[i][0];
-            write_reqs[i]->wait();
-            write_reqs[i] = Blocks1[i].write(run[i].bid);
-        }
-
-        request_ptr* write_reqs1 = new request_ptr[cur_run_size - m2];
 
-        for ( ; i < cur_run_size; ++i)
-        {
-            run[i].value = Blocks1[i][0];
-            write_reqs1[i - m2] = Blocks1[i].write(run[i].bid);
-        }
+        delete[] write_reqs;
+        write_reqs = new request_ptr[cur_run_size];
+        sort_helper::write_run_blocks<codec_type>(Blocks1, run, cur_run_size, write_reqs);
 
         m_result->runs[0] = run;
         m_result->runs_sizes[0] = blocks2_length;
         m_result->elements = blocks2_length;
 
-        wait_all(write_reqs, write_reqs + m2);
+        wait_all(write_reqs, write_reqs + cur_run_size);
         delete[] write_reqs;
-        wait_all(write_reqs1, write_reqs1 + cur_run_size - m2);
-        delete[] write_reqs1;
 
         delete[] Blocks1;
 
@@ -313,8 +303,8 @@ void basic_runs_creator<Input, CompareType, BlockSize, AllocStr>::compute_result
     {
         run[i].value = Blocks2[i][0];
         write_reqs[i]->wait();
-        write_reqs[i] = Blocks2[i].write(run[i].bid);
     }
+    sort_helper::write_run_blocks<codec_type>(Blocks2, run, cur_run_size, write_reqs);
     assert((blocks2_length % el_in_run) == 0);
 
     m_result->add_run(run, blocks2_length);
@@ -334,8 +324,8 @@ void basic_runs_creator<Input, CompareType, BlockSize, AllocStr>::compute_result
         {
             run[i].value = Blocks1[i][0];
             write_reqs[i]->wait();
-            write_reqs[i] = Blocks1[i].write(run[i].bid);
         }
+        sort_helper::write_run_blocks<codec_type>(Blocks1, run, cur_run_size, write_reqs);
         m_result->add_run(run, blocks1_length);
 
         std::swap(Blocks1, Blocks2);
@@ -401,6 +391,11 @@ struct use_push
 //! allows to create sorted runs
 //! data structure usable for \c runs_merger from
 //! elements passed in sorted push() method. <BR>
+//! As long as the pushed elements fit into half of memory_to_use, they are
+//! kept in main memory and handed to the \c runs_merger as one internally
+//! sorted small run, without any disk I/O. The small run is copied after the
+//! other half is released, so it stays within memory_to_use. Larger inputs are
+//! spilled to disk in runs of half the memory size.
 //! \tparam ValueType type of values (parameter for \c use_push strategy)
 //! \tparam CompareType type of comparison object used for sorting the runs
 //! \tparam BlockSize size of blocks used to store the runs
@@ -426,6 +421,7 @@ public:
     typedef sorted_runs<trigger_entry_type, cmp_type> sorted_runs_data_type;
     typedef counting_ptr<sorted_runs_data_type> sorted_runs_type;
     typedef sorted_runs_type result_type;
+    typedef typename sort_helper::run_codec_of<cmp_type>::type codec_type;
 
     typedef typename element_iterator_traits<block_type, external_size_type>::element_iterator element_iterator;
 
@@ -459,7 +455,8 @@ private:
     //! accumulation buffer of size m_m2 blocks, half the available memory size
     block_type* m_blocks1;
 
-    //! accumulation buffer that is currently being written to disk
+    //! accumulation buffer that is currently being written to disk, released
+    //! by compute_result() if nothing was spilled
     block_type* m_blocks2;
 
     //! reference to write requests transporting the last accumulation buffer
@@ -470,15 +467,16 @@ private:
     run_type run;
 
 protected:
-    //!  fill the rest of the block with max values
+    //! fill the rest of the block with max values, see sort_helper::padding_value()
     void fill_with_max_value(block_type* blocks, unsigned_type num_blocks,
                              unsigned_type first_idx)
     {
         unsigned_type last_idx = num_blocks * block_type::size;
         if (first_idx < last_idx) {
+            const value_type padding = sort_helper::padding_value(m_cmp, blocks[0][0]);
             element_iterator curr = make_element_iterator(blocks, first_idx);
             while (first_idx != last_idx) {
-                *curr = m_cmp.max_value();
+                *curr = padding;
                 ++curr;
                 ++first_idx;
             }
@@ -488,10 +486,9 @@ protected:
     //! Sort a specific run, contained in a sequences of blocks.
     void sort_run(block_type* run, unsigned_type elements)
     {
-        check_sort_settings();
-        potentially_parallel::sort(make_element_iterator(run, 0),
-                                   make_element_iterator(run, elements),
-                                   m_cmp);
+        sort_helper::sort_run_elements(make_element_iterator(run, 0),
+                                       make_element_iterator(run, elements),
+                                       m_cmp);
     }
 
     void compute_result()
@@ -501,11 +498,21 @@ protected:
 
         sort_run(m_blocks1, m_cur_el);
 
-        if (m_cur_el <= block_type::size && m_result->elements == 0)
+        if (m_result->elements == 0)
         {
-            // small input, do not flush it on the disk(s)
+            // nothing was spilled, the input fits into half of the memory: do
+            // not flush it on the disk(s). The unused second buffer is
+            // released first, so the small run takes its place.
             STXXL_VERBOSE1("runs_creator(use_push): Small input optimization, input length: " << m_cur_el);
-            m_result->small_run.assign(m_blocks1[0].begin(), m_blocks1[0].begin() + m_cur_el);
+            delete[] m_blocks2;
+            m_blocks2 = NULL;
+            m_result->small_run.reserve(m_cur_el);
+            for (unsigned_type i = 0; i < m_cur_el; i += block_type::size)
+            {
+                const block_type& block = m_blocks1[i / block_type::size];
+                const unsigned_type length = STXXL_MIN<unsigned_type>(block_type::size, m_cur_el - i);
+                m_result->small_run.insert(m_result->small_run.end(), block.begin(), block.begin() + length);
+            }
             m_result->elements = m_cur_el;
             return;
         }
@@ -526,9 +533,8 @@ protected:
             run[i].value = m_blocks1[i][0];
             if (m_write_reqs[i].get())
                 m_write_reqs[i]->wait();
-
-            m_write_reqs[i] = m_blocks1[i].write(run[i].bid);
         }
+        sort_helper::write_run_blocks<codec_type>(m_blocks1, run, cur_run_size, m_write_reqs);
         m_result->add_run(run, m_cur_el);
 
         for (i = 0; i < m_m2; ++i)
@@ -545,14 +551,14 @@ public:
     runs_creator(CompareType cmp, unsigned_type memory_to_use)
         : m_cmp(cmp),
           m_memory_to_use(memory_to_use),
-          m_memsize(memory_to_use / BlockSize / sort_memory_usage_factor()),
+          m_memsize(memory_to_use / BlockSize / sort_helper::memory_usage_factor<element_iterator>(cmp)),
           m_m2(m_memsize / 2),
           m_el_in_run(m_m2 * block_type::size),
           m_blocks1(NULL), m_blocks2(NULL),
           m_write_reqs(NULL)
     {
         sort_helper::verify_sentinel_strict_weak_ordering(m_cmp);
-        if (!(2 * BlockSize * sort_memory_usage_factor() <= m_memory_to_use)) {
+        if (!(2 * BlockSize * sort_helper::memory_usage_factor<element_iterator>(cmp) <= m_memory_to_use)) {
             throw bad_parameter("stxxl::runs_creator<>:runs_creator(): "
                                 "INSUFFICIENT MEMORY provided, "
                                 "please increase parameter 'memory_to_use'");
@@ -579,10 +585,18 @@ public:
         m_result_computed = false;
         m_cur_el = 0;
 
+        // compute_result() releases m_blocks2 for a small run
+        if (m_blocks1 && !m_blocks2)
+            m_blocks2 = new block_type[m_m2];
+
         for (unsigned_type i = 0; i < m_m2; ++i)
         {
             if (m_write_reqs[i].get())
+            {
                 m_write_reqs[i]->cancel();
+                m_write_reqs[i]->wait();
+                m_write_reqs[i] = request_ptr();
+            }
         }
     }
 
@@ -591,8 +605,7 @@ public:
     {
         if (!m_blocks1)
         {
-            m_blocks1 = new block_type[m_m2 * 2];
-            m_blocks2 = m_blocks1 + m_m2;
+            m_blocks1 = new block_type[m_m2];
 
             m_write_reqs = new request_ptr[m_m2];
         }
@@ -607,7 +620,8 @@ public:
 
         if (m_blocks1)
         {
-            delete[] ((m_blocks1 < m_blocks2) ? m_blocks1 : m_blocks2);
+            delete[] m_blocks1;
+            delete[] m_blocks2;
             m_blocks1 = m_blocks2 = NULL;
 
             delete[] m_write_reqs;
@@ -628,9 +642,17 @@ public:
         }
 
         assert(m_el_in_run == m_cur_el);
+        spill_run();
         m_cur_el = 0;
 
-        // sort and store m_blocks1
+        push(val);
+    }
+
+protected:
+    //! Sorts the m_el_in_run elements of m_blocks1, writes them to disk as a
+    //! new run and swaps the buffers.
+    void spill_run()
+    {
         sort_run(m_blocks1, m_el_in_run);
 
         const unsigned_type cur_run_blocks = div_ceil(m_el_in_run, block_type::size);        // in blocks
@@ -645,17 +667,15 @@ public:
             run[i].value = m_blocks1[i][0];
             if (m_write_reqs[i].get())
                 m_write_reqs[i]->wait();
-
-            m_write_reqs[i] = m_blocks1[i].write(run[i].bid);
         }
+        sort_helper::write_run_blocks<codec_type>(m_blocks1, run, cur_run_blocks, m_write_reqs);
 
         m_result->add_run(run, m_el_in_run);
 
         std::swap(m_blocks1, m_blocks2);
-
-        push(val);
     }
 
+public:
     //! Returns the sorted runs object.
     //! \return Sorted runs object.
     //! \remark Returned object is intended to be used by \c runs_merger object as input
@@ -824,9 +844,10 @@ public:
 
         if (offset)        // if current block is partially filled
         {
+            const value_type padding = sort_helper::padding_value(cmp, (*cur_block)[0]);
             while (offset != block_type::size)
             {
-                (*cur_block)[offset] = cmp.max_value();
+                (*cur_block)[offset] = padding;
                 ++offset;
             }
             offset = 0;
@@ -874,6 +895,7 @@ bool check_sorted_runs(const RunsType& sruns, CompareType cmp)
 {
     sort_helper::verify_sentinel_strict_weak_ordering(cmp);
     typedef typename RunsType::element_type::block_type block_type;
+    typedef typename sort_helper::run_codec_of<CompareType>::type codec_type;
     STXXL_VERBOSE2("Elements: " << sruns->elements);
     unsigned_type nruns = sruns->runs.size();
     STXXL_VERBOSE2("Runs: " << nruns);
@@ -889,6 +911,7 @@ bool check_sorted_runs(const RunsType& sruns, CompareType cmp)
         }
         wait_all(reqs, reqs + nblocks);
         delete[] reqs;
+        sort_helper::restore_run_blocks<codec_type>(blocks, sruns->runs[irun], nblocks);
 
         for (unsigned_type j = 0; j < nblocks; ++j)
         {
@@ -944,7 +967,8 @@ public:
     typedef typename sorted_runs_data_type::block_type block_type;
     typedef block_type out_block_type;
     typedef typename run_type::value_type trigger_entry_type;
-    typedef block_prefetcher<block_type, typename run_type::iterator> prefetcher_type;
+    typedef typename sort_helper::run_codec_of<value_cmp>::type codec_type;
+    typedef block_prefetcher<block_type, typename run_type::iterator, codec_type> prefetcher_type;
     typedef run_cursor2<block_type, prefetcher_type> run_cursor_type;
     typedef sort_helper::run_cursor2_cmp<block_type, prefetcher_type, value_cmp> run_cursor2_cmp_type;
     typedef loser_tree<run_cursor_type, run_cursor2_cmp_type> loser_tree_type;
@@ -956,6 +980,9 @@ public:
     //! Standard stream typedef.
     typedef typename sorted_runs_data_type::value_type value_type;
 
+    //! Supports the batch stream protocol, see fill().
+    typedef batch_fill_tag batch_category;
+
 private:
     //! comparator object to sort runs
     value_cmp m_cmp;
@@ -981,6 +1008,12 @@ private:
     //! sequence of block needed for merging
     run_type m_consume_seq;
 
+    //! number of elements in each block of m_consume_seq
+    std::vector<unsigned_type> m_block_sizes;
+
+    //! number of bytes stored of each block of m_consume_seq
+    std::vector<unsigned_type> m_stored_sizes;
+
     //! precalculated order of blocks in which they are prefetched
     int_type* m_prefetch_seq;
 
@@ -990,11 +1023,14 @@ private:
     //! loser tree used for native merging
     loser_tree_type* m_losers;
 
-#if STXXL_PARALLEL_MULTIWAY_MERGE
+    //! true if the runs are merged as sequences by multiway_merge() instead
+    //! of the loser tree
+    bool m_merge_sequences;
+
+    //! sequences of elements merged by multiway_merge()
     std::vector<sequence>* seqs;
     std::vector<block_type*>* buffers;
     diff_type num_currently_mergeable;
-#endif
 
 #if STXXL_CHECK_ORDER_IN_SORTS
     //! previous element to ensure the current output ordering
@@ -1010,24 +1046,26 @@ private:
         if (m_prefetcher)
         {
             delete m_losers;
-#if STXXL_PARALLEL_MULTIWAY_MERGE
             delete seqs;
             delete buffers;
-#endif
             delete m_prefetcher;
             delete[] m_prefetch_seq;
+            m_losers = NULL;
+            seqs = NULL;
+            buffers = NULL;
             m_prefetcher = NULL;
         }
     }
 
-    void fill_buffer_block()
+    //! Merges the next n elements of the runs to out, n must not exceed the
+    //! number of elements that are neither merged nor buffered.
+    void merge_to(value_type* out, size_type n)
     {
-        STXXL_VERBOSE1("fill_buffer_block");
-        if (do_parallel_merge())
+        STXXL_VERBOSE1("merge_to " << n);
+        if (m_merge_sequences)
         {
-#if STXXL_PARALLEL_MULTIWAY_MERGE
 // begin of STL-style merging
-            diff_type rest = out_block_type::size;              // elements still to merge for this output block
+            diff_type rest = n;                                 // elements still to merge
 
             do                                                  // while rest > 0 and still elements available
             {
@@ -1049,9 +1087,14 @@ private:
 
                 STXXL_VERBOSE1("before merge " << output_size);
 
-                potentially_parallel::multiway_merge(
-                    (*seqs).begin(), (*seqs).end(),
-                    m_buffer_block->end() - rest, output_size, m_cmp);
+                if (do_parallel_merge())
+                    potentially_parallel::multiway_merge(
+                        (*seqs).begin(), (*seqs).end(),
+                        out + (n - rest), output_size, m_cmp);
+                else
+                    parallel::sequential_multiway_merge<false, false>(
+                        (*seqs).begin(), (*seqs).end(),
+                        out + (n - rest), output_size, m_cmp);
                 // sequence iterators are progressed appropriately
 
                 rest -= output_size;
@@ -1059,41 +1102,46 @@ private:
 
                 STXXL_VERBOSE1("after merge");
 
-                sort_helper::refill_or_remove_empty_sequences(*seqs, *buffers, *m_prefetcher);
+                sort_helper::refill_or_remove_empty_sequences(*seqs, *buffers, *m_prefetcher, m_block_sizes);
             } while (rest > 0 && (*seqs).size() > 0);
 
 #if STXXL_CHECK_ORDER_IN_SORTS
-            if (!stxxl::is_sorted(m_buffer_block->begin(), m_buffer_block->end(), cmp))
+            if (!stxxl::is_sorted(out, out + n, m_cmp))
             {
-                for (value_type* i = m_buffer_block->begin() + 1; i != m_buffer_block->end(); ++i)
-                    if (cmp(*i, *(i - 1)))
+                for (value_type* i = out + 1; i != out + n; ++i)
+                    if (m_cmp(*i, *(i - 1)))
                     {
-                        STXXL_VERBOSE1("Error at position " << (i - m_buffer_block->begin()));
+                        STXXL_VERBOSE1("Error at position " << (i - out));
                     }
                 assert(false);
             }
 #endif          //STXXL_CHECK_ORDER_IN_SORTS
 
 // end of STL-style merging
-#else
-            STXXL_THROW_UNREACHABLE();
-#endif          //STXXL_PARALLEL_MULTIWAY_MERGE
         }
         else
         {
 // begin of native merging procedure
-            m_losers->multi_merge(m_buffer_block->elem, m_buffer_block->elem + STXXL_MIN<size_type>(out_block_type::size, m_elements_remaining));
+            m_losers->multi_merge(out, out + n);
 // end of native merging procedure
         }
-        STXXL_VERBOSE1("current block filled");
+        STXXL_VERBOSE1("merged " << n);
 
-        m_current_ptr = m_buffer_block->elem;
-        m_current_end = m_buffer_block->elem + STXXL_MIN<size_type>(out_block_type::size, m_elements_remaining);
-
-        if (m_elements_remaining <= out_block_type::size)
+        if (n == m_elements_remaining)
             deallocate_prefetcher();
     }
 
+    void fill_buffer_block()
+    {
+        STXXL_VERBOSE1("fill_buffer_block");
+        const size_type n = STXXL_MIN<size_type>(out_block_type::size, m_elements_remaining);
+
+        merge_to(m_buffer_block->elem, n);
+
+        m_current_ptr = m_buffer_block->elem;
+        m_current_end = m_buffer_block->elem + n;
+    }
+
 public:
     //! Creates a runs merger object.
     //! \param c comparison object
@@ -1104,15 +1152,11 @@ public:
           m_buffer_block(new out_block_type),
           m_prefetch_seq(NULL),
           m_prefetcher(NULL),
-          m_losers(NULL)
-#if STXXL_PARALLEL_MULTIWAY_MERGE
-          , seqs(NULL),
+          m_losers(NULL),
+          m_merge_sequences(false),
+          seqs(NULL),
           buffers(NULL),
           num_currently_mergeable(0)
-#endif
-#if STXXL_CHECK_ORDER_IN_SORTS
-          , m_last_element(m_cmp.min_value())
-#endif  //STXXL_CHECK_ORDER_IN_SORTS
     {
         sort_helper::verify_sentinel_strict_weak_ordering(m_cmp);
     }
@@ -1141,6 +1185,9 @@ public:
             m_current_ptr = &m_sruns->small_run[0];
             m_current_end = m_current_ptr + m_sruns->small_run.size();
 
+#if STXXL_CHECK_ORDER_IN_SORTS
+            m_last_element = *m_current_ptr;
+#endif      //STXXL_CHECK_ORDER_IN_SORTS
             return;
         }
 
@@ -1198,18 +1245,39 @@ public:
         }
 
         m_consume_seq.resize(prefetch_seq_size);
+        m_block_sizes.resize(prefetch_seq_size);
+        m_stored_sizes.resize(prefetch_seq_size);
         m_prefetch_seq = new int_type[prefetch_seq_size];
 
-        typename run_type::iterator copy_start = m_consume_seq.begin();
+        // collect the blocks of all runs, only the last block of a run may
+        // be incomplete
+        run_type blocks(prefetch_seq_size);
+        std::vector<unsigned_type> block_sizes(prefetch_seq_size);
+        unsigned_type b = 0;
         for (unsigned_type i = 0; i < nruns; ++i)
         {
-            copy_start = std::copy(m_sruns->runs[i].begin(),
-                                   m_sruns->runs[i].end(),
-                                   copy_start);
+            for (unsigned_type j = 0; j < m_sruns->runs[i].size(); ++j, ++b)
+            {
+                blocks[b] = m_sruns->runs[i][j];
+                block_sizes[b] = (unsigned_type)STXXL_MIN<size_type>(
+                    block_type::size, m_sruns->runs_sizes[i] - size_type(j) * block_type::size);
+            }
         }
 
-        std::stable_sort(m_consume_seq.begin(), m_consume_seq.end(),
-                         sort_helper::trigger_entry_cmp<trigger_entry_type, value_cmp>(m_cmp) _STXXL_SORT_TRIGGER_FORCE_SEQUENTIAL);
+        // the blocks are consumed in the order of their first elements
+        std::vector<unsigned_type> order(prefetch_seq_size);
+        for (unsigned_type i = 0; i < prefetch_seq_size; ++i)
+            order[i] = i;
+
+        std::stable_sort(order.begin(), order.end(),
+                         sort_helper::trigger_entry_index_cmp<trigger_entry_type, value_cmp>(&blocks[0], m_cmp) _STXXL_SORT_TRIGGER_FORCE_SEQUENTIAL);
+
+        for (unsigned_type i = 0; i < prefetch_seq_size; ++i)
+        {
+            m_consume_seq[i] = blocks[order[i]];
+            m_block_sizes[i] = block_sizes[order[i]];
+            m_stored_sizes[i] = blocks[order[i]].stored_size;
+        }
 
         const unsigned_type n_prefetch_buffers = STXXL_MAX(min_prefetch_buffers, input_buffers - nruns);
 
@@ -1231,24 +1299,29 @@ public:
             m_consume_seq.begin(),
             m_consume_seq.end(),
             m_prefetch_seq,
-            STXXL_MIN(nruns + n_prefetch_buffers, prefetch_seq_size));
+            STXXL_MIN(nruns + n_prefetch_buffers, prefetch_seq_size),
+            completion_handler(),
+            codec_type::enabled ? &m_stored_sizes[0] : NULL);
+
+        // the loser tree of run cursors relies on the sentinels to pad the
+        // last blocks of the runs, multiway_merge() on sequences does not.
+        m_merge_sequences = do_parallel_merge() ||
+                            !sort_helper::has_sentinels<value_cmp>::value;
 
-        if (do_parallel_merge())
+        if (m_merge_sequences)
         {
-#if STXXL_PARALLEL_MULTIWAY_MERGE
 // begin of STL-style merging
             seqs = new std::vector<sequence>(nruns);
             buffers = new std::vector<block_type*>(nruns);
+            num_currently_mergeable = 0;
 
             for (unsigned_type i = 0; i < nruns; ++i)                                           //initialize sequences
             {
                 (*buffers)[i] = m_prefetcher->pull_block();                                     //get first block of each run
-                (*seqs)[i] = std::make_pair((*buffers)[i]->begin(), (*buffers)[i]->end());      //this memory location stays the same, only the data is exchanged
+                (*seqs)[i] = std::make_pair((*buffers)[i]->begin(),                             //this memory location stays the same, only the data is exchanged
+                                            (*buffers)[i]->begin() + m_block_sizes[i]);
             }
 // end of STL-style merging
-#else
-            STXXL_THROW_UNREACHABLE();
-#endif          //STXXL_PARALLEL_MULTIWAY_MERGE
         }
         else
         {
@@ -1258,6 +1331,10 @@ public:
         }
 
         fill_buffer_block();
+
+#if STXXL_CHECK_ORDER_IN_SORTS
+        m_last_element = *m_current_ptr;
+#endif  //STXXL_CHECK_ORDER_IN_SORTS
     }
 
     //! Deallocate temporary structures freeing memory prior to next initialize().
@@ -1322,6 +1399,43 @@ public:
         return *this;
     }
 
+    //! Batch stream method: moves the next up to n elements to out and
+    //! returns their number. Elements not yet buffered are merged directly
+    //! into out, in parallel if do_parallel_merge() holds, hence large
+    //! batches save the copy and amortize the setup of the parallel merge.
+    unsigned_type fill(value_type* out, unsigned_type n)
+    {
+        n = (unsigned_type)STXXL_MIN<size_type>(n, m_elements_remaining);
+
+        // hand out the buffered elements first
+        const unsigned_type buffered =
+            STXXL_MIN<unsigned_type>(n, unsigned_type(m_current_end - m_current_ptr));
+        std::copy(m_current_ptr, m_current_ptr + buffered, out);
+        m_current_ptr += buffered;
+        m_elements_remaining -= buffered;
+
+        if (buffered < n)
+        {
+            assert(m_current_ptr == m_current_end);
+            merge_to(out + buffered, n - buffered);
+            m_elements_remaining -= n - buffered;
+        }
+
+#if STXXL_CHECK_ORDER_IN_SORTS
+        if (n > 0)
+        {
+            assert(!m_cmp(out[0], m_last_element));
+            assert(stxxl::is_sorted(out, out + n, m_cmp));
+            m_last_element = out[n - 1];
+        }
+#endif      //STXXL_CHECK_ORDER_IN_SORTS
+
+        if (m_current_ptr == m_current_end && !empty())
+            fill_buffer_block();
+
+        return n;
+    }
+
     //! Destructor.
     //! \remark Deallocates blocks of the input sorted runs object
     virtual ~basic_runs_merger()
@@ -1439,9 +1553,11 @@ void basic_runs_merger<RunsType, CompareType, AllocStr>::merge_recursively()
                     }
                     assert(merger.empty());
 
+                    const value_type padding = sort_helper::padding_value(
+                        m_cmp, new_runs.runs[cur_out_run][0].value);
                     while (cnt % block_type::size)
                     {
-                        *out = m_cmp.max_value();
+                        *out = padding;
                         ++out, ++cnt;
                     }
                 }
@@ -1547,6 +1663,9 @@ public:
     //! Standard stream typedef.
     typedef typename Input::value_type value_type;
 
+    //! Supports the batch stream protocol, see fill().
+    typedef batch_fill_tag batch_category;
+
     //! Creates the object.
     //! \param in input stream
     //! \param c comparator object
@@ -1596,6 +1715,12 @@ public:
         ++merger;
         return *this;
     }
+
+    //! Batch stream method, see basic_runs_merger::fill().
+    unsigned_type fill(value_type* out, unsigned_type n)
+    {
+        return merger.fill(out, n);
+    }
 };
 
 //! Computes sorted runs type from value type and block size.
@@ -57,9 +57,9 @@ struct sorted_runs : private noncopyable, public counted_object
     std::vector<size_type> runs_sizes;
 
     //! Small sort optimization:
-    // if the input is small such that its total size is at most B
-    // (block_type::size) then input is sorted internally and kept in the
-    // array "small_run"
+    // if the input fits into the memory of the runs creator, then it is
+    // sorted internally and kept in the array "small_run" instead of being
+    // written to disk
     small_run_type small_run;
 
 public:
@@ -80,7 +80,7 @@ public:
         elements = 0;
         runs.clear();
         runs_sizes.clear();
-        small_run.clear();
+        small_run_type().swap(small_run);
     }
 
     //! Add a new run with given number of elements
@@ -15,10 +15,14 @@
 #ifndef STXXL_STREAM_STREAM_HEADER
 #define STXXL_STREAM_STREAM_HEADER
 
+#include <algorithm>
+#include <limits>
+#include <vector>
 #include <stxxl/bits/namespace.h>
 #include <stxxl/bits/mng/buf_istream.h>
 #include <stxxl/bits/mng/buf_ostream.h>
 #include <stxxl/bits/common/tuple.h>
+#include <stxxl/bits/common/tmeta.h>
 #include <stxxl/bits/common/error_handling.h>
 #include <stxxl/vector>
 #include <stxxl/bits/compat/unique_ptr.h>
@@ -35,6 +39,172 @@ namespace stream {
 //! \addtogroup streampack
 //! \{
 
+////////////////////////////////////////////////////////////////////////
+//     BATCH PROTOCOLS                                                //
+////////////////////////////////////////////////////////////////////////
+
+//! Batch category of streams providing only the standard stream methods.
+struct no_batch_tag { };
+
+//! Tag of streams which, in addition to the standard stream methods,
+//! provide <tt>unsigned_type fill(value_type* out, unsigned_type n)</tt>.
+//! It moves the next up to n elements of the stream to out and returns
+//! their number, which is less than n only at the end of the stream. Such
+//! streams declare <tt>typedef batch_fill_tag batch_category;</tt>.
+struct batch_fill_tag { };
+
+//! Tag of streams which, in addition to the standard stream methods, give
+//! access to their next elements in contiguous memory without copying them.
+//! <tt>const value_type* peek_batch(unsigned_type& length)</tt> returns the
+//! next length elements, length is zero only at the end of the stream. The
+//! elements remain valid until the stream is advanced beyond them.
+//! <tt>void consume(unsigned_type n)</tt> skips the next n elements, n must
+//! not exceed the length returned by the last call of peek_batch(). Such
+//! streams declare <tt>typedef batch_span_tag batch_category;</tt>.
+struct batch_span_tag { };
+
+template <class Type>
+struct batch_void
+{
+    typedef void type;
+};
+
+//! Determines the batch category of a stream: its batch_category typedef,
+//! or no_batch_tag if there is none.
+template <class StreamAlgorithm, class Enable = void>
+struct batch_category_of
+{
+    typedef no_batch_tag type;
+};
+
+template <class StreamAlgorithm>
+struct batch_category_of<
+    StreamAlgorithm,
+    typename batch_void<typename StreamAlgorithm::batch_category>::type
+    >
+{
+    typedef typename StreamAlgorithm::batch_category type;
+};
+
+template <class Tag1, class Tag2>
+struct is_same_batch_category
+{
+    enum { value = false };
+};
+
+template <class Tag>
+struct is_same_batch_category<Tag, Tag>
+{
+    enum { value = true };
+};
+
+//! Determines whether a stream supports one of the batch protocols.
+template <class StreamAlgorithm>
+struct is_batch_stream
+{
+    enum { value = !is_same_batch_category<
+               typename batch_category_of<StreamAlgorithm>::type, no_batch_tag>::value };
+};
+
+//! Determines whether a stream supports the span protocol, see
+//! batch_span_tag.
+template <class StreamAlgorithm>
+struct is_span_stream
+{
+    enum { value = is_same_batch_category<
+               typename batch_category_of<StreamAlgorithm>::type, batch_span_tag>::value };
+};
+
+//! Selects batch_span_tag if Span holds, no_batch_tag otherwise.
+template <bool Span>
+struct span_category_if
+{
+    typedef no_batch_tag type;
+};
+
+template <>
+struct span_category_if<true>
+{
+    typedef batch_span_tag type;
+};
+
+template <class StreamAlgorithm>
+unsigned_type pull_batch(StreamAlgorithm& in,
+                         typename StreamAlgorithm::value_type* out,
+                         unsigned_type n, no_batch_tag)
+{
+    unsigned_type i = 0;
+    for ( ; i < n && !in.empty(); ++i, ++in)
+        out[i] = *in;
+    return i;
+}
+
+template <class StreamAlgorithm>
+unsigned_type pull_batch(StreamAlgorithm& in,
+                         typename StreamAlgorithm::value_type* out,
+                         unsigned_type n, batch_fill_tag)
+{
+    return in.fill(out, n);
+}
+
+template <class StreamAlgorithm>
+unsigned_type pull_batch(StreamAlgorithm& in,
+                         typename StreamAlgorithm::value_type* out,
+                         unsigned_type n, batch_span_tag)
+{
+    unsigned_type done = 0, length;
+    while (done < n)
+    {
+        const typename StreamAlgorithm::value_type* span = in.peek_batch(length);
+        if (length == 0)
+            break;
+
+        length = STXXL_MIN(length, n - done);
+        std::copy(span, span + length, out + done);
+        in.consume(length);
+        done += length;
+    }
+    return done;
+}
+
+//! Moves the next up to n elements of a stream to out, using the batch
+//! protocols if the stream supports them.
+//! \return number of elements moved, less than n only at the end of the stream
+template <class StreamAlgorithm>
+unsigned_type pull_batch(StreamAlgorithm& in,
+                         typename StreamAlgorithm::value_type* out,
+                         unsigned_type n)
+{
+    return pull_batch(in, out, n, typename batch_category_of<StreamAlgorithm>::type());
+}
+
+//! Number of elements moved per call by pull_batch() if the destination
+//! is not block-structured.
+template <class ValueType>
+struct default_batch_length
+{
+    enum { value = (256 * 1024 + sizeof(ValueType) - 1) / sizeof(ValueType) };
+};
+
+//! Batch category of iterator2stream: pointers give spans.
+template <class InputIterator>
+struct iterator_batch_category
+{
+    typedef no_batch_tag type;
+};
+
+template <class ValueType>
+struct iterator_batch_category<ValueType*>
+{
+    typedef batch_span_tag type;
+};
+
+template <class ValueType>
+struct iterator_batch_category<const ValueType*>
+{
+    typedef batch_span_tag type;
+};
+
 ////////////////////////////////////////////////////////////////////////
 //     STREAMIFY                                                      //
 ////////////////////////////////////////////////////////////////////////
@@ -51,6 +221,9 @@ public:
     //! Standard stream typedef.
     typedef typename std::iterator_traits<InputIterator>::value_type value_type;
 
+    //! Supports the span protocol if InputIterator is a pointer.
+    typedef typename iterator_batch_category<InputIterator>::type batch_category;
+
     iterator2stream(InputIterator begin, InputIterator end)
         : m_current(begin), m_end(end)
     { }
@@ -83,6 +256,20 @@ public:
     {
         return (m_current == m_end);
     }
+
+    //! Span stream method, available if InputIterator is a pointer.
+    const value_type * peek_batch(unsigned_type& length) const
+    {
+        length = unsigned_type(m_end - m_current);
+        return m_current;
+    }
+
+    //! Span stream method, available if InputIterator is a pointer.
+    void consume(unsigned_type n)
+    {
+        assert(n <= unsigned_type(m_end - m_current));
+        m_current += n;
+    }
 };
 
 //! Input iterator range to stream converter.
@@ -128,6 +315,9 @@ public:
     //! Standard stream typedef.
     typedef typename std::iterator_traits<InputIterator>::value_type value_type;
 
+    //! Supports the span protocol, spans are the rest of the current block.
+    typedef batch_span_tag batch_category;
+
     vector_iterator2stream(InputIterator begin, InputIterator end,
                            unsigned_type nbuffers = 0)
         : m_current(begin), m_end(end),
@@ -188,6 +378,33 @@ public:
     {
         return (m_current == m_end);
     }
+
+    //! Span stream method: returns the remaining elements of the current
+    //! block.
+    const value_type * peek_batch(unsigned_type& length) const
+    {
+        if (empty()) {
+            length = 0;
+            return NULL;
+        }
+        length = (unsigned_type)STXXL_MIN<typename InputIterator::difference_type>(
+            in->batch_length(), m_end - m_current);
+        return in->batch_begin();
+    }
+
+    //! Span stream method.
+    void consume(unsigned_type n)
+    {
+        assert(n <= unsigned_type(m_end - m_current));
+        if (n == 0)
+            return;
+
+        m_current += n;
+        in->advance(n);
+        if (UNLIKELY(empty()))
+            delete_stream();
+    }
+
     virtual ~vector_iterator2stream()
     {
         delete_stream();          // not needed actually
@@ -418,6 +635,48 @@ streamify_sr(
 //     MATERIALIZE                                                    //
 ////////////////////////////////////////////////////////////////////////
 
+template <class OutputIterator, class StreamAlgorithm>
+OutputIterator materialize(StreamAlgorithm& in, OutputIterator out,
+                           no_batch_tag)
+{
+    while (!in.empty())
+    {
+        *out = *in;
+        ++out;
+        ++in;
+    }
+    return out;
+}
+
+template <class OutputIterator, class StreamAlgorithm>
+OutputIterator materialize(StreamAlgorithm& in, OutputIterator out,
+                           batch_fill_tag)
+{
+    typedef typename StreamAlgorithm::value_type value_type;
+    const unsigned_type length = default_batch_length<value_type>::value;
+
+    std::vector<value_type> buffer(length);
+    while (unsigned_type n = in.fill(&buffer[0], length))
+        out = std::copy(buffer.begin(), buffer.begin() + n, out);
+
+    return out;
+}
+
+template <class OutputIterator, class StreamAlgorithm>
+OutputIterator materialize(StreamAlgorithm& in, OutputIterator out,
+                           batch_span_tag)
+{
+    unsigned_type length;
+    while (const typename StreamAlgorithm::value_type* span = in.peek_batch(length))
+    {
+        if (length == 0)
+            break;
+        out = std::copy(span, span + length, out);
+        in.consume(length);
+    }
+    return out;
+}
+
 //! Stores consecutively stream content to an output iterator.
 //! \param in stream to be stored used as source
 //! \param out output iterator used as destination
@@ -428,13 +687,7 @@ template <class OutputIterator, class StreamAlgorithm>
 OutputIterator materialize(StreamAlgorithm& in, OutputIterator out)
 {
     STXXL_VERBOSE_MATERIALIZE(STXXL_PRETTY_FUNCTION_NAME);
-    while (!in.empty())
-    {
-        *out = *in;
-        ++out;
-        ++in;
-    }
-    return out;
+    return materialize(in, out, typename batch_category_of<StreamAlgorithm>::type());
 }
 
 //! Stores consecutively stream content to an output iterator range \b until end of the stream or end of the iterator range is reached.
@@ -460,6 +713,55 @@ OutputIterator materialize(StreamAlgorithm& in,
     return outbegin;
 }
 
+//! Writes at most limit elements of the stream to outstream, which writes
+//! the blocks of the vector starting at the block boundary out. Calls
+//! block_externally_updated() for each block but the last one written.
+template <class StreamAlgorithm, class ExtIterator, class ConstExtIterator,
+          class BufOstream>
+void materialize_blocks(StreamAlgorithm& in, ExtIterator& out,
+                        ConstExtIterator& prev_block, BufOstream& outstream,
+                        uint64 limit, no_batch_tag)
+{
+    for ( ; !in.empty() && limit > 0; --limit)
+    {
+        if (out.block_offset() == 0) {
+            if (prev_block != out) {
+                prev_block.block_externally_updated();
+                prev_block = out;
+            }
+        }
+
+        *outstream = *in;
+        ++out;
+        ++outstream;
+        ++in;
+    }
+}
+
+template <class StreamAlgorithm, class ExtIterator, class ConstExtIterator,
+          class BufOstream, class BatchTag>
+void materialize_blocks(StreamAlgorithm& in, ExtIterator& out,
+                        ConstExtIterator& prev_block, BufOstream& outstream,
+                        uint64 limit, BatchTag)
+{
+    while (!in.empty() && limit > 0)
+    {
+        if (out.block_offset() == 0) {
+            if (prev_block != out) {
+                prev_block.block_externally_updated();
+                prev_block = out;
+            }
+        }
+
+        // the stream writes directly into the block of the output stream
+        unsigned_type n = (unsigned_type)STXXL_MIN<uint64>(limit, outstream.batch_length());
+        n = pull_batch(in, outstream.batch_begin(), n, BatchTag());
+        out += n;
+        outstream.advance(n);
+        limit -= n;
+    }
+}
+
 //! Stores consecutively stream content to an output \c stxxl::vector iterator \b until end of the stream or end of the iterator range is reached.
 //! \param in stream to be stored used as source
 //! \param outbegin output \c stxxl::vector iterator used as destination
@@ -513,20 +815,8 @@ materialize(StreamAlgorithm& in,
     // completely filled (and written out) in outstream
     ConstExtIterator prev_block = outbegin;
 
-    while (!in.empty() && outend != outbegin)
-    {
-        if (outbegin.block_offset() == 0) {
-            if (prev_block != outbegin) {
-                prev_block.block_externally_updated();
-                prev_block = outbegin;
-            }
-        }
-
-        *outstream = *in;
-        ++outbegin;
-        ++outstream;
-        ++in;
-    }
+    materialize_blocks(in, outbegin, prev_block, outstream, outend - outbegin,
+                       typename batch_category_of<StreamAlgorithm>::type());
 
     ConstExtIterator const_out = outbegin;
 
@@ -598,21 +888,9 @@ materialize(StreamAlgorithm& in,
     // completely filled (and written out) in outstream
     ConstExtIterator prev_block = out;
 
-    while (!in.empty())
-    {
-        if (out.block_offset() == 0) {
-            if (prev_block != out) {
-                prev_block.block_externally_updated();
-                prev_block = out;
-            }
-        }
-
-        // tells the vector that the block was modified
-        *outstream = *in;
-        ++out;
-        ++outstream;
-        ++in;
-    }
+    materialize_blocks(in, out, prev_block, outstream,
+                       std::numeric_limits<uint64>::max(),
+                       typename batch_category_of<StreamAlgorithm>::type());
 
     ConstExtIterator const_out = out;
 
@@ -814,12 +1092,28 @@ public:
     //! Standard stream typedef.
     typedef typename Operation::value_type value_type;
 
+    //! Supports the span protocol if the input does, otherwise fill(), see
+    //! peek_batch() and fill().
+    typedef typename IF<is_span_stream<Input1>::value,
+                        batch_span_tag, batch_fill_tag>::result batch_category;
+
 private:
-    value_type current;
+    mutable value_type current;
+
+    //! whether current is still to be computed, see consume()
+    mutable bool m_pending;
+
+    //! buffer for batches of input elements
+    std::vector<typename Input1::value_type> m_batch;
+
+    //! results of the current span, see peek_batch()
+    std::vector<value_type> m_span;
+    unsigned_type m_span_pos, m_span_length;
 
 public:
     //! Construction.
-    transform(Operation& o, Input1& i1_) : op(o), i1(i1_)
+    transform(Operation& o, Input1& i1_)
+        : op(o), i1(i1_), m_pending(false), m_span_pos(0), m_span_length(0)
     {
         if (!empty())
             current = op(*i1);
@@ -828,19 +1122,24 @@ public:
     //! Standard stream method.
     const value_type& operator * () const
     {
+        evaluate();
         return current;
     }
 
     const value_type* operator -> () const
     {
+        evaluate();
         return &current;
     }
 
     //! Standard stream method.
     transform& operator ++ ()
     {
+        evaluate();
         ++i1;
-        if (!empty())
+        if (m_span_pos < m_span_length && ++m_span_pos < m_span_length)
+            current = m_span[m_span_pos];
+        else if (!empty())
             current = op(*i1);
 
         return *this;
@@ -851,6 +1150,98 @@ public:
     {
         return i1.empty();
     }
+
+    //! Span stream method, available if the input supports the span
+    //! protocol: returns the results for the next span of the input. The
+    //! operation is applied to a whole span at once, except to the current
+    //! element, whose result is reused, so it is applied once per element.
+    const value_type * peek_batch(unsigned_type& length)
+    {
+        if (m_span_pos == m_span_length)
+        {
+            const typename Input1::value_type* in = i1.peek_batch(m_span_length);
+            if (m_span.size() < m_span_length)
+                m_span.resize(m_span_length);
+            if (m_span_length > 0)
+            {
+                evaluate();
+                m_span[0] = current;
+            }
+            for (unsigned_type i = 1; i < m_span_length; ++i)
+                m_span[i] = op(in[i]);
+            m_span_pos = 0;
+        }
+        length = m_span_length - m_span_pos;
+        return length ? &m_span[m_span_pos] : NULL;
+    }
+
+    //! Span stream method.
+    void consume(unsigned_type n)
+    {
+        assert(n <= m_span_length - m_span_pos);
+        i1.consume(n);
+        m_span_pos += n;
+        if (m_span_pos < m_span_length)
+            current = m_span[m_span_pos];
+        else
+            m_pending = !empty();
+    }
+
+    //! Batch stream method: moves the next up to n results to out and
+    //! returns their number. Results already computed by peek_batch() are
+    //! moved first, then the input is pulled in batches, see pull_batch().
+    unsigned_type fill(value_type* out, unsigned_type n)
+    {
+        if (n == 0 || empty())
+            return 0;
+
+        unsigned_type k = 0;
+        if (m_span_pos < m_span_length)
+        {
+            k = std::min(n, m_span_length - m_span_pos);
+            std::copy(m_span.begin() + m_span_pos,
+                      m_span.begin() + m_span_pos + k, out);
+            for (unsigned_type i = 0; i < k; ++i)
+                ++i1;
+            m_span_pos += k;
+            if (m_span_pos < m_span_length) {
+                current = m_span[m_span_pos];
+                return k;
+            }
+            m_pending = !empty();
+            if (k == n || empty())
+                return k;
+        }
+
+        m_span_pos = m_span_length = 0;
+
+        evaluate();
+        out[k++] = current;
+        ++i1;
+
+        if (m_batch.size() < n - k)
+            m_batch.resize(n - k);
+
+        const unsigned_type m = (n > k) ? pull_batch(i1, &m_batch[0], n - k) : 0;
+        for (unsigned_type i = 0; i < m; ++i)
+            out[k + i] = op(m_batch[i]);
+
+        if (!empty())
+            current = op(*i1);
+
+        return k + m;
+    }
+
+private:
+    //! Computes the result for the current element after consume().
+    void evaluate() const
+    {
+        if (m_pending)
+        {
+            current = op(*i1);
+            m_pending = false;
+        }
+    }
 };
 
 ////////////////////////////////////////////////////////////////////////
@@ -1180,9 +1571,23 @@ public:
             typename Input6::value_type
             > value_type;
 
+    //! Supports the span protocol if all inputs do, see peek_batch().
+    typedef typename span_category_if<
+            is_span_stream<Input1>::value &&
+            is_span_stream<Input2>::value &&
+            is_span_stream<Input3>::value &&
+            is_span_stream<Input4>::value &&
+            is_span_stream<Input5>::value &&
+            is_span_stream<Input6>::value
+            >::type batch_category;
+
 private:
     value_type current;
 
+    //! tuples of the current span, see peek_batch()
+    std::vector<value_type> m_span;
+    unsigned_type m_span_pos, m_span_length;
+
 public:
     //! Construction.
     make_tuple(Input1& i1_,
@@ -1191,7 +1596,8 @@ public:
                Input4& i4_,
                Input5& i5_,
                Input6& i6_)
-        : i1(i1_), i2(i2_), i3(i3_), i4(i4_), i5(i5_), i6(i6_)
+        : i1(i1_), i2(i2_), i3(i3_), i4(i4_), i5(i5_), i6(i6_),
+          m_span_pos(0), m_span_length(0)
     {
         if (!empty())
             current = value_type(*i1, *i2, *i3, *i4, *i5, *i6);
@@ -1218,6 +1624,9 @@ public:
         ++i5;
         ++i6;
 
+        if (m_span_pos < m_span_length)
+            ++m_span_pos;
+
         if (!empty())
             current = value_type(*i1, *i2, *i3, *i4, *i5, *i6);
 
@@ -1230,6 +1639,50 @@ public:
         return i1.empty() || i2.empty() || i3.empty() ||
                i4.empty() || i5.empty() || i6.empty();
     }
+
+    //! Span stream method, available if all inputs support the span
+    //! protocol: returns the tuples of the next spans of the inputs.
+    const value_type * peek_batch(unsigned_type& length)
+    {
+        if (m_span_pos == m_span_length)
+        {
+            const typename Input1::value_type* p1 = i1.peek_batch(m_span_length);
+            const typename Input2::value_type* p2 = i2.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input3::value_type* p3 = i3.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input4::value_type* p4 = i4.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input5::value_type* p5 = i5.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input6::value_type* p6 = i6.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            if (m_span.size() < m_span_length)
+                m_span.resize(m_span_length);
+            for (unsigned_type i = 0; i < m_span_length; ++i)
+                m_span[i] = value_type(p1[i], p2[i], p3[i], p4[i], p5[i], p6[i]);
+            m_span_pos = 0;
+        }
+        length = m_span_length - m_span_pos;
+        return length ? &m_span[m_span_pos] : NULL;
+    }
+
+    //! Span stream method.
+    void consume(unsigned_type n)
+    {
+        assert(n <= m_span_length - m_span_pos);
+        i1.consume(n);
+        i2.consume(n);
+        i3.consume(n);
+        i4.consume(n);
+        i5.consume(n);
+        i6.consume(n);
+        m_span_pos += n;
+        if (m_span_pos < m_span_length)
+            current = m_span[m_span_pos];
+        else if (!empty())
+            current = value_type(*i1, *i2, *i3, *i4, *i5, *i6);
+    }
 };
 
 //! Creates stream of 2-tuples (pairs) from 2 input streams.
@@ -1252,14 +1705,25 @@ public:
             typename Input2::value_type
             > value_type;
 
+    //! Supports the span protocol if all inputs do, see peek_batch().
+    typedef typename span_category_if<
+            is_span_stream<Input1>::value &&
+            is_span_stream<Input2>::value
+            >::type batch_category;
+
 private:
     value_type current;
 
+    //! tuples of the current span, see peek_batch()
+    std::vector<value_type> m_span;
+    unsigned_type m_span_pos, m_span_length;
+
 public:
     //! Construction.
     make_tuple(Input1& i1_,
                Input2& i2_)
-        : i1(i1_), i2(i2_)
+        : i1(i1_), i2(i2_),
+          m_span_pos(0), m_span_length(0)
     {
         if (!empty())
             current = value_type(*i1, *i2);
@@ -1282,6 +1746,9 @@ public:
         ++i1;
         ++i2;
 
+        if (m_span_pos < m_span_length)
+            ++m_span_pos;
+
         if (!empty())
             current = value_type(*i1, *i2);
 
@@ -1293,6 +1760,38 @@ public:
     {
         return i1.empty() || i2.empty();
     }
+
+    //! Span stream method, available if all inputs support the span
+    //! protocol: returns the tuples of the next spans of the inputs.
+    const value_type * peek_batch(unsigned_type& length)
+    {
+        if (m_span_pos == m_span_length)
+        {
+            const typename Input1::value_type* p1 = i1.peek_batch(m_span_length);
+            const typename Input2::value_type* p2 = i2.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            if (m_span.size() < m_span_length)
+                m_span.resize(m_span_length);
+            for (unsigned_type i = 0; i < m_span_length; ++i)
+                m_span[i] = value_type(p1[i], p2[i]);
+            m_span_pos = 0;
+        }
+        length = m_span_length - m_span_pos;
+        return length ? &m_span[m_span_pos] : NULL;
+    }
+
+    //! Span stream method.
+    void consume(unsigned_type n)
+    {
+        assert(n <= m_span_length - m_span_pos);
+        i1.consume(n);
+        i2.consume(n);
+        m_span_pos += n;
+        if (m_span_pos < m_span_length)
+            current = m_span[m_span_pos];
+        else if (!empty())
+            current = value_type(*i1, *i2);
+    }
 };
 
 //! Creates stream of 3-tuples from 3 input streams.
@@ -1319,15 +1818,27 @@ public:
             typename Input3::value_type
             > value_type;
 
+    //! Supports the span protocol if all inputs do, see peek_batch().
+    typedef typename span_category_if<
+            is_span_stream<Input1>::value &&
+            is_span_stream<Input2>::value &&
+            is_span_stream<Input3>::value
+            >::type batch_category;
+
 private:
     value_type current;
 
+    //! tuples of the current span, see peek_batch()
+    std::vector<value_type> m_span;
+    unsigned_type m_span_pos, m_span_length;
+
 public:
     //! Construction.
     make_tuple(Input1& i1_,
                Input2& i2_,
                Input3& i3_)
-        : i1(i1_), i2(i2_), i3(i3_)
+        : i1(i1_), i2(i2_), i3(i3_),
+          m_span_pos(0), m_span_length(0)
     {
         if (!empty())
             current = value_type(*i1, *i2, *i3);
@@ -1351,6 +1862,9 @@ public:
         ++i2;
         ++i3;
 
+        if (m_span_pos < m_span_length)
+            ++m_span_pos;
+
         if (!empty())
             current = value_type(*i1, *i2, *i3);
 
@@ -1362,6 +1876,41 @@ public:
     {
         return i1.empty() || i2.empty() || i3.empty();
     }
+
+    //! Span stream method, available if all inputs support the span
+    //! protocol: returns the tuples of the next spans of the inputs.
+    const value_type * peek_batch(unsigned_type& length)
+    {
+        if (m_span_pos == m_span_length)
+        {
+            const typename Input1::value_type* p1 = i1.peek_batch(m_span_length);
+            const typename Input2::value_type* p2 = i2.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input3::value_type* p3 = i3.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            if (m_span.size() < m_span_length)
+                m_span.resize(m_span_length);
+            for (unsigned_type i = 0; i < m_span_length; ++i)
+                m_span[i] = value_type(p1[i], p2[i], p3[i]);
+            m_span_pos = 0;
+        }
+        length = m_span_length - m_span_pos;
+        return length ? &m_span[m_span_pos] : NULL;
+    }
+
+    //! Span stream method.
+    void consume(unsigned_type n)
+    {
+        assert(n <= m_span_length - m_span_pos);
+        i1.consume(n);
+        i2.consume(n);
+        i3.consume(n);
+        m_span_pos += n;
+        if (m_span_pos < m_span_length)
+            current = m_span[m_span_pos];
+        else if (!empty())
+            current = value_type(*i1, *i2, *i3);
+    }
 };
 
 //! Creates stream of 4-tuples from 4 input streams.
@@ -1392,16 +1941,29 @@ public:
             typename Input4::value_type
             > value_type;
 
+    //! Supports the span protocol if all inputs do, see peek_batch().
+    typedef typename span_category_if<
+            is_span_stream<Input1>::value &&
+            is_span_stream<Input2>::value &&
+            is_span_stream<Input3>::value &&
+            is_span_stream<Input4>::value
+            >::type batch_category;
+
 private:
     value_type current;
 
+    //! tuples of the current span, see peek_batch()
+    std::vector<value_type> m_span;
+    unsigned_type m_span_pos, m_span_length;
+
 public:
     //! Construction.
     make_tuple(Input1& i1_,
                Input2& i2_,
                Input3& i3_,
                Input4& i4_)
-        : i1(i1_), i2(i2_), i3(i3_), i4(i4_)
+        : i1(i1_), i2(i2_), i3(i3_), i4(i4_),
+          m_span_pos(0), m_span_length(0)
     {
         if (!empty())
             current = value_type(*i1, *i2, *i3, *i4);
@@ -1426,6 +1988,9 @@ public:
         ++i3;
         ++i4;
 
+        if (m_span_pos < m_span_length)
+            ++m_span_pos;
+
         if (!empty())
             current = value_type(*i1, *i2, *i3, *i4);
 
@@ -1438,6 +2003,44 @@ public:
         return i1.empty() || i2.empty() || i3.empty() ||
                i4.empty();
     }
+
+    //! Span stream method, available if all inputs support the span
+    //! protocol: returns the tuples of the next spans of the inputs.
+    const value_type * peek_batch(unsigned_type& length)
+    {
+        if (m_span_pos == m_span_length)
+        {
+            const typename Input1::value_type* p1 = i1.peek_batch(m_span_length);
+            const typename Input2::value_type* p2 = i2.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input3::value_type* p3 = i3.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input4::value_type* p4 = i4.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            if (m_span.size() < m_span_length)
+                m_span.resize(m_span_length);
+            for (unsigned_type i = 0; i < m_span_length; ++i)
+                m_span[i] = value_type(p1[i], p2[i], p3[i], p4[i]);
+            m_span_pos = 0;
+        }
+        length = m_span_length - m_span_pos;
+        return length ? &m_span[m_span_pos] : NULL;
+    }
+
+    //! Span stream method.
+    void consume(unsigned_type n)
+    {
+        assert(n <= m_span_length - m_span_pos);
+        i1.consume(n);
+        i2.consume(n);
+        i3.consume(n);
+        i4.consume(n);
+        m_span_pos += n;
+        if (m_span_pos < m_span_length)
+            current = m_span[m_span_pos];
+        else if (!empty())
+            current = value_type(*i1, *i2, *i3, *i4);
+    }
 };
 
 //! Creates stream of 5-tuples from 5 input streams.
@@ -1473,9 +2076,22 @@ public:
             typename Input5::value_type
             > value_type;
 
+    //! Supports the span protocol if all inputs do, see peek_batch().
+    typedef typename span_category_if<
+            is_span_stream<Input1>::value &&
+            is_span_stream<Input2>::value &&
+            is_span_stream<Input3>::value &&
+            is_span_stream<Input4>::value &&
+            is_span_stream<Input5>::value
+            >::type batch_category;
+
 private:
     value_type current;
 
+    //! tuples of the current span, see peek_batch()
+    std::vector<value_type> m_span;
+    unsigned_type m_span_pos, m_span_length;
+
 public:
     //! Construction.
     make_tuple(Input1& i1_,
@@ -1483,7 +2099,8 @@ public:
                Input3& i3_,
                Input4& i4_,
                Input5& i5_)
-        : i1(i1_), i2(i2_), i3(i3_), i4(i4_), i5(i5_)
+        : i1(i1_), i2(i2_), i3(i3_), i4(i4_), i5(i5_),
+          m_span_pos(0), m_span_length(0)
     {
         if (!empty())
             current = value_type(*i1, *i2, *i3, *i4, *i5);
@@ -1509,6 +2126,9 @@ public:
         ++i4;
         ++i5;
 
+        if (m_span_pos < m_span_length)
+            ++m_span_pos;
+
         if (!empty())
             current = value_type(*i1, *i2, *i3, *i4, *i5);
 
@@ -1521,6 +2141,47 @@ public:
         return i1.empty() || i2.empty() || i3.empty() ||
                i4.empty() || i5.empty();
     }
+
+    //! Span stream method, available if all inputs support the span
+    //! protocol: returns the tuples of the next spans of the inputs.
+    const value_type * peek_batch(unsigned_type& length)
+    {
+        if (m_span_pos == m_span_length)
+        {
+            const typename Input1::value_type* p1 = i1.peek_batch(m_span_length);
+            const typename Input2::value_type* p2 = i2.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input3::value_type* p3 = i3.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input4::value_type* p4 = i4.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            const typename Input5::value_type* p5 = i5.peek_batch(length);
+            m_span_length = STXXL_MIN(m_span_length, length);
+            if (m_span.size() < m_span_length)
+                m_span.resize(m_span_length);
+            for (unsigned_type i = 0; i < m_span_length; ++i)
+                m_span[i] = value_type(p1[i], p2[i], p3[i], p4[i], p5[i]);
+            m_span_pos = 0;
+        }
+        length = m_span_length - m_span_pos;
+        return length ? &m_span[m_span_pos] : NULL;
+    }
+
+    //! Span stream method.
+    void consume(unsigned_type n)
+    {
+        assert(n <= m_span_length - m_span_pos);
+        i1.consume(n);
+        i2.consume(n);
+        i3.consume(n);
+        i4.consume(n);
+        i5.consume(n);
+        m_span_pos += n;
+        if (m_span_pos < m_span_length)
+            current = m_span[m_span_pos];
+        else if (!empty())
+            current = value_type(*i1, *i2, *i3, *i4, *i5);
+    }
 };
 
 //! \}
@@ -0,0 +1,456 @@
+/***************************************************************************
+ *  lib/io/compressed_file.cpp
+ *
+ *  a pseudo file storing blocks compressed in a backend file
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/bits/io/compressed_file.h>
+#include <stxxl/bits/io/iostats.h>
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/utils.h>
+#include <stxxl/bits/noncopyable.h>
+#include <stxxl/aligned_alloc>
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef STXXL_VERBOSE_COMPRESSED
+#define STXXL_VERBOSE_COMPRESSED STXXL_VERBOSE2
+#endif
+
+STXXL_BEGIN_NAMESPACE
+
+namespace {
+
+//! shortest run of equal bytes which is encoded as a run
+const unsigned min_run = 8;
+
+//! aligned memory for transfers to and from the backend
+class aligned_buffer : private noncopyable
+{
+    char* m_ptr;
+
+public:
+    explicit aligned_buffer(size_t bytes)
+        : m_ptr(static_cast<char*>(aligned_alloc<STXXL_BLOCK_ALIGN>(bytes)))
+    { }
+
+    ~aligned_buffer()
+    {
+        aligned_dealloc<STXXL_BLOCK_ALIGN>(m_ptr);
+    }
+
+    char * get() const
+    {
+        return m_ptr;
+    }
+};
+
+inline char * put_varint(char* out, uint64 x)
+{
+    while (x >= 0x80)
+    {
+        *out++ = (char)(x | 0x80);
+        x >>= 7;
+    }
+    *out++ = (char)x;
+    return out;
+}
+
+inline uint64 get_varint(const char*& in)
+{
+    uint64 x = 0;
+    unsigned shift = 0;
+    while ((unsigned char)*in & 0x80)
+    {
+        x |= uint64((unsigned char)*in++ & 0x7f) << shift;
+        shift += 7;
+    }
+    x |= uint64((unsigned char)*in++) << shift;
+    return x;
+}
+
+} // namespace
+
+compressed_file::compressed_file(
+    file* backend_file,
+    int queue_id, int allocator_id, unsigned int device_id)
+    : file(device_id),
+      disk_queued_file(queue_id, allocator_id),
+      storage(backend_file), sz(0),
+      m_physical_end(0), m_stored_bytes(0)
+{ }
+
+compressed_file::~compressed_file()
+{
+    delete storage;
+    storage = 0;
+}
+
+// The stream of tokens: a varint t, followed by the byte repeated
+// (t >> 1) + min_run times if t is odd, or by t >> 1 literal bytes otherwise.
+compressed_file::size_type compressed_file::encode(
+    const char* in, size_type bytes, char* out, size_type limit)
+{
+    const char* const end = in + bytes;
+    char* const begin = out;
+    char* const out_end = out + limit;
+
+    const char* literal = in;
+    const char* p = in;
+    while (p != end)
+    {
+        const char* q = p + 1;
+        while (q != end && *q == *p)
+            ++q;
+
+        if (q - p >= (ptrdiff_t)min_run)
+        {
+            if (literal != p)
+            {
+                const size_type n = p - literal;
+                if (size_type(out_end - out) < 10 + n)
+                    return 0;
+                out = put_varint(out, uint64(n) << 1);
+                std::memcpy(out, literal, n);
+                out += n;
+            }
+            if (out_end - out < 11)
+                return 0;
+            out = put_varint(out, (uint64(q - p - min_run) << 1) | 1);
+            *out++ = *p;
+            literal = q;
+        }
+        p = q;
+    }
+
+    if (literal != end)
+    {
+        const size_type n = end - literal;
+        if (size_type(out_end - out) < 10 + n)
+            return 0;
+        out = put_varint(out, uint64(n) << 1);
+        std::memcpy(out, literal, n);
+        out += n;
+    }
+    return out - begin;
+}
+
+void compressed_file::decode(const char* in, char* out, size_type bytes)
+{
+    char* const end = out + bytes;
+    while (out < end)
+    {
+        const uint64 t = get_varint(in);
+        if (t & 1) {
+            const size_type n = size_type(t >> 1) + min_run;
+            std::memset(out, *in++, n);
+            out += n;
+        }
+        else {
+            const size_type n = size_type(t >> 1);
+            std::memcpy(out, in, n);
+            in += n;
+            out += n;
+        }
+    }
+    assert(out == end);
+}
+
+void compressed_file::serve(void* buffer, offset_type offset, size_type bytes,
+                            request::request_type type)
+{
+    scoped_mutex_lock lock(m_mutex);
+    if (type == request::READ)
+        sread(static_cast<char*>(buffer), offset, bytes);
+    else
+        swrite(static_cast<const char*>(buffer), offset, bytes);
+}
+
+void compressed_file::sread(char* buffer, offset_type offset, size_type bytes)
+{
+    const offset_type end = offset + bytes;
+
+    // first block which ends behind offset
+    extent_map::iterator it = m_extents.upper_bound(offset);
+    if (it != m_extents.begin()) {
+        --it;
+        if (it->first + it->second.bytes <= offset)
+            ++it;
+    }
+
+    offset_type pos = offset;
+    while (pos < end)
+    {
+        if (it == m_extents.end() || it->first >= end) {
+            // never written
+            std::memset(buffer + (pos - offset), 0, size_type(end - pos));
+            break;
+        }
+        if (it->first > pos) {
+            std::memset(buffer + (pos - offset), 0, size_type(it->first - pos));
+            pos = it->first;
+        }
+
+        const extent& e = it->second;
+        const offset_type stop = std::min(end, it->first + e.bytes);
+        STXXL_VERBOSE_COMPRESSED("compressed:sread l" << pos << "/" << stop - pos <<
+                                 " @ p" << e.physical << "/" << e.stored);
+
+        const bool whole = (pos == it->first && stop == it->first + e.bytes);
+        if (whole && pos == offset && e.stored == e.bytes) {
+            // whole block stored unchanged, read into the aligned buffer
+            storage->serve(buffer, e.physical, e.stored, request::READ);
+        }
+        else if (whole) {
+            read_extent(e, buffer + (pos - offset));
+        }
+        else {
+            aligned_buffer block(e.bytes);
+            read_extent(e, block.get());
+            std::memcpy(buffer + (pos - offset), block.get() + (pos - it->first),
+                        size_type(stop - pos));
+        }
+        stats::get_instance()->read_compressed(size_type(stop - pos), e.stored);
+
+        pos = stop;
+        ++it;
+    }
+}
+
+void compressed_file::read_extent(const extent& e, char* buffer)
+{
+    aligned_buffer stored(e.stored);
+    storage->serve(stored.get(), e.physical, e.stored, request::READ);
+    if (e.compressed)
+        decode(stored.get(), buffer, e.bytes);
+    else
+        std::memcpy(buffer, stored.get(), e.bytes);
+}
+
+void compressed_file::swrite(const char* buffer, offset_type offset, size_type bytes)
+{
+    if (bytes == 0)
+        return;
+
+    const offset_type end = offset + bytes;
+
+    // find the blocks overlapping the written range
+    extent_map::iterator first = m_extents.lower_bound(offset);
+    if (first != m_extents.begin()) {
+        extent_map::iterator pred = first;
+        --pred;
+        if (pred->first + pred->second.bytes > offset)
+            first = pred;
+    }
+
+    offset_type lo = offset, hi = end;
+    for (extent_map::iterator it = first;
+         it != m_extents.end() && it->first < end; ++it)
+    {
+        lo = std::min(lo, it->first);
+        hi = std::max(hi, it->first + it->second.bytes);
+    }
+
+    if (lo != offset || hi != end) {
+        // partially overwritten blocks are merged with the new data
+        aligned_buffer merged(size_type(hi - lo));
+        sread(merged.get(), lo, size_type(hi - lo));
+        std::memcpy(merged.get() + (offset - lo), buffer, bytes);
+        swrite(merged.get(), lo, size_type(hi - lo));
+        return;
+    }
+
+    while (first != m_extents.end() && first->first < end)
+        free_extent(first++);
+
+    // compress, keep the block unchanged if it does not shrink
+    const size_type aligned = div_ceil(bytes, STXXL_BLOCK_ALIGN) * STXXL_BLOCK_ALIGN;
+    aligned_buffer scratch(aligned);
+
+    extent e;
+    e.bytes = bytes;
+    const size_type length =
+        encode(buffer, bytes, scratch.get(), aligned - STXXL_BLOCK_ALIGN);
+    const char* data = scratch.get();
+
+    if (length != 0) {
+        e.compressed = true;
+        e.stored = div_ceil(length, STXXL_BLOCK_ALIGN) * STXXL_BLOCK_ALIGN;
+        std::memset(scratch.get() + length, 0, e.stored - length);
+    }
+    else {
+        e.compressed = false;
+        e.stored = aligned;
+        if (aligned == bytes) {
+            data = buffer;
+        }
+        else {
+            std::memcpy(scratch.get(), buffer, bytes);
+            std::memset(scratch.get() + bytes, 0, aligned - bytes);
+        }
+    }
+
+    e.physical = allocate(e.stored);
+    STXXL_VERBOSE_COMPRESSED("compressed:swrite l" << offset << "/" << bytes <<
+                             " @ p" << e.physical << "/" << e.stored);
+
+    storage->serve(const_cast<char*>(data), e.physical, e.stored, request::WRITE);
+    m_extents[offset] = e;
+    m_stored_bytes += e.stored;
+
+    stats::get_instance()->write_compressed(bytes, e.stored);
+}
+
+void compressed_file::free_extent(extent_map::iterator it)
+{
+    // m_mutex has to be acquired by caller
+    const extent& e = it->second;
+    storage->discard(e.physical, e.stored);
+    add_free_region(e.physical, e.stored);
+    m_stored_bytes -= e.stored;
+    m_extents.erase(it);
+}
+
+compressed_file::offset_type compressed_file::allocate(size_type bytes)
+{
+    // m_mutex has to be acquired by caller, best fit
+    free_size_set::iterator fit =
+        m_free_sizes.lower_bound(std::make_pair(offset_type(bytes), offset_type(0)));
+    if (fit != m_free_sizes.end())
+    {
+        const offset_type region_size = fit->first;
+        const offset_type region_pos = fit->second;
+        erase_free_region(m_free_space.find(region_pos));
+        if (region_size > offset_type(bytes)) {
+            m_free_space[region_pos + bytes] = region_size - bytes;
+            m_free_sizes.insert(std::make_pair(region_size - bytes, region_pos + bytes));
+        }
+        return region_pos;
+    }
+
+    // append, growing the backend geometrically
+    const offset_type region_pos = m_physical_end;
+    m_physical_end += bytes;
+    const offset_type backend_size = storage->size();
+    if (m_physical_end > backend_size)
+        storage->set_size(std::max(m_physical_end, backend_size + backend_size / 2));
+    return region_pos;
+}
+
+void compressed_file::erase_free_region(free_map::iterator it)
+{
+    // m_mutex has to be acquired by caller
+    m_free_sizes.erase(std::make_pair(it->second, it->first));
+    m_free_space.erase(it);
+}
+
+void compressed_file::add_free_region(offset_type offset, offset_type size)
+{
+    // m_mutex has to be acquired by caller
+    free_map::iterator succ = m_free_space.lower_bound(offset);
+    if (succ != m_free_space.end() && offset + size == succ->first) {
+        // coalesce with successor
+        size += succ->second;
+        erase_free_region(succ++);
+    }
+    if (succ != m_free_space.begin()) {
+        free_map::iterator pred = succ;
+        --pred;
+        if (pred->first + pred->second == offset) {
+            // coalesce with predecessor
+            offset = pred->first;
+            size += pred->second;
+            erase_free_region(pred);
+        }
+    }
+
+    if (offset + size == m_physical_end) {
+        m_physical_end = offset;
+    }
+    else {
+        m_free_space[offset] = size;
+        m_free_sizes.insert(std::make_pair(size, offset));
+    }
+}
+
+void compressed_file::discard(offset_type offset, offset_type size)
+{
+    scoped_mutex_lock lock(m_mutex);
+
+    // free the blocks lying completely in the range
+    extent_map::iterator it = m_extents.lower_bound(offset);
+    while (it != m_extents.end() && it->first + it->second.bytes <= offset + size)
+        free_extent(it++);
+}
+
+void compressed_file::lock()
+{
+    storage->lock();
+}
+
+compressed_file::offset_type compressed_file::size()
+{
+    return sz;
+}
+
+void compressed_file::set_size(offset_type newsize)
+{
+    scoped_mutex_lock lock(m_mutex);
+
+    if (newsize < sz)
+    {
+        // free the blocks behind the new end, truncate the one across it
+        extent_map::iterator it = m_extents.lower_bound(newsize);
+        if (it != m_extents.begin()) {
+            extent_map::iterator pred = it;
+            --pred;
+            if (pred->first + pred->second.bytes > newsize)
+                it = pred;
+        }
+
+        if (it != m_extents.end() && it->first < newsize)
+        {
+            const offset_type begin = it->first;
+            const size_type bytes = size_type(newsize - begin);
+            aligned_buffer head(bytes);
+            sread(head.get(), begin, bytes);
+            free_extent(it++);
+            swrite(head.get(), begin, bytes);
+        }
+
+        while (it != m_extents.end())
+            free_extent(it++);
+
+        // the backend grows with the stored blocks, and shrinks with them
+        if (m_physical_end < storage->size())
+            storage->set_size(m_physical_end);
+    }
+
+    sz = newsize;
+}
+
+compressed_file::offset_type compressed_file::physical_size()
+{
+    scoped_mutex_lock lock(m_mutex);
+    return m_stored_bytes;
+}
+
+void compressed_file::close_remove()
+{
+    storage->close_remove();
+}
+
+const char* compressed_file::io_type() const
+{
+    return "compressed";
+}
+
+STXXL_END_NAMESPACE
+// vim: et:ts=4:sw=4
@@ -67,6 +67,29 @@ file * create_file(disk_config& cfg, int mode, int disk_allocator_id)
         config::get_instance()->update_max_device_id(cfg.device_id);
     }
 
+    // *** Wrap the fileio Implementation for compressed storage
+
+    if (cfg.compress)
+    {
+        cfg.compress = false;
+        file* backend = create_file(cfg, mode, file::NO_ALLOCATOR);
+        cfg.compress = true;
+
+        // the backend is served synchronously from the queue of the wrapper
+        compressed_file* result =
+            new compressed_file(backend, cfg.queue, disk_allocator_id,
+                                cfg.device_id);
+        return result;
+    }
+
+    // *** Set the number of workers serving synchronous fileio concurrently
+
+    if (cfg.queue_length > 0 &&
+        cfg.io_impl != "linuxaio" && cfg.io_impl != "io_uring")
+    {
+        disk_queues::get_instance()->set_queue_threads(cfg.queue, cfg.queue_length);
+    }
+
     // *** Select fileio Implementation
 
     if (cfg.io_impl == "syscall")
@@ -146,6 +169,43 @@ file * create_file(disk_config& cfg, int mode, int disk_allocator_id)
         return result;
     }
 #endif
+#if STXXL_HAVE_IOURING_FILE
+    // io_uring can have the desired ring size, specified as queue_length=?
+    else if (cfg.io_impl == "io_uring")
+    {
+        // io_uring rings are cheap, default to one per disk as for syscall,
+        // but never share the default queue with other fileio methods.
+        if (cfg.queue == file::DEFAULT_QUEUE)
+            cfg.queue = file::DEFAULT_IOURING_QUEUE;
+
+        ufs_file_base* result =
+            new iouring_file(cfg.path, mode, cfg.queue, disk_allocator_id,
+                             cfg.device_id, cfg.queue_length);
+
+        result->lock();
+
+        // if marked as device but file is not -> throw!
+        if (cfg.raw_device && !result->is_device())
+        {
+            delete result;
+            STXXL_THROW(io_error, "Disk " << cfg.path << " was expected to be "
+                        "a raw block device, but it is a normal file!");
+        }
+
+        // if is raw_device -> get size and remove some flags.
+        if (result->is_device())
+        {
+            cfg.raw_device = true;
+            cfg.size = result->size();
+            cfg.autogrow = cfg.delete_on_exit = cfg.unlink_on_open = false;
+        }
+
+        if (cfg.unlink_on_open)
+            result->unlink();
+
+        return result;
+    }
+#endif
 #if STXXL_HAVE_MMAP_FILE
     else if (cfg.io_impl == "mmap")
     {
@@ -49,5 +49,35 @@ request_ptr disk_queued_file::awrite(
     return req;
 }
 
+void disk_queued_file::aread_batch(
+    void* const* buffers,
+    const offset_type* offsets,
+    size_type bytes,
+    size_t n,
+    request_ptr* reqs,
+    const completion_handler& on_cmpl)
+{
+    for (size_t i = 0; i < n; ++i)
+        reqs[i] = new serving_request(on_cmpl, this, buffers[i], offsets[i],
+                                      bytes, request::READ);
+
+    disk_queues::get_instance()->add_requests(reqs, n, get_queue_id());
+}
+
+void disk_queued_file::awrite_batch(
+    void* const* buffers,
+    const offset_type* offsets,
+    size_type bytes,
+    size_t n,
+    request_ptr* reqs,
+    const completion_handler& on_cmpl)
+{
+    for (size_t i = 0; i < n; ++i)
+        reqs[i] = new serving_request(on_cmpl, this, buffers[i], offsets[i],
+                                      bytes, request::WRITE);
+
+    disk_queues::get_instance()->add_requests(reqs, n, get_queue_id());
+}
+
 STXXL_END_NAMESPACE
 // vim: et:ts=4:sw=4
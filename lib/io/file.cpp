@@ -15,6 +15,33 @@
 
 STXXL_BEGIN_NAMESPACE
 
+void file::aread_batch(void* const* buffers, const offset_type* offsets,
+                       size_type bytes, size_t n, request_ptr* reqs,
+                       const completion_handler& on_cmpl)
+{
+    for (size_t i = 0; i < n; ++i)
+        reqs[i] = aread(buffers[i], offsets[i], bytes, on_cmpl);
+}
+
+void file::awrite_batch(void* const* buffers, const offset_type* offsets,
+                        size_type bytes, size_t n, request_ptr* reqs,
+                        const completion_handler& on_cmpl)
+{
+    for (size_t i = 0; i < n; ++i)
+        reqs[i] = awrite(buffers[i], offsets[i], bytes, on_cmpl);
+}
+
+void file::serve_vectored(void* const* buffers, const size_type* sizes,
+                          size_t n, offset_type offset,
+                          request::request_type type)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        serve(buffers[i], offset, sizes[i], type);
+        offset += sizes[i];
+    }
+}
+
 int file::unlink(const char* path)
 {
     return ::unlink(path);
@@ -13,6 +13,8 @@
  **************************************************************************/
 
 #include <stxxl/bits/io/iostats.h>
+#include <stxxl/bits/io/file.h>
+#include <stxxl/bits/io/request.h>
 #include <stxxl/bits/common/log.h>
 #include <stxxl/bits/verbose.h>
 #include <stxxl/bits/common/mutex.h>
@@ -20,12 +22,49 @@
 #include <stxxl/bits/common/types.h>
 #include <stxxl/bits/namespace.h>
 
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <map>
 #include <string>
 #include <sstream>
 #include <iomanip>
+#include <vector>
+
+#if STXXL_STD_THREADS
+ #include <thread>
+#elif STXXL_BOOST_THREADS
+ #include <boost/thread.hpp>
+#else
+ #include <pthread.h>
+#endif
 
 STXXL_BEGIN_NAMESPACE
 
+namespace {
+
+#if STXXL_STD_THREADS
+typedef std::thread::id thread_key;
+inline thread_key this_thread_key() { return std::this_thread::get_id(); }
+#elif STXXL_BOOST_THREADS
+typedef boost::thread::id thread_key;
+inline thread_key this_thread_key() { return boost::this_thread::get_id(); }
+#else
+typedef pthread_t thread_key;
+inline thread_key this_thread_key() { return pthread_self(); }
+#endif
+
+//! the wait sites entered by each thread, innermost last
+typedef std::map<thread_key, std::vector<const char*> > wait_site_stacks;
+
+wait_site_stacks& get_wait_site_stacks()
+{
+    static wait_site_stacks stacks;
+    return stacks;
+}
+
+} // namespace
+
 stats::stats()
     : reads(0),
       writes(0),
@@ -35,6 +74,10 @@ stats::stats()
       c_writes(0),
       c_volume_read(0),
       c_volume_written(0),
+      z_volume_read(0),
+      z_volume_written(0),
+      z_stored_read(0),
+      z_stored_written(0),
       t_reads(0.0),
       t_writes(0.0),
       p_reads(0.0),
@@ -56,8 +99,13 @@ stats::stats()
       acc_ios(0),
       acc_waits(0),
       acc_wait_read(0), acc_wait_write(0),
-      last_reset(timestamp())
-{ }
+      last_reset(timestamp()),
+      detailed(false)
+{
+    const char* env = getenv("STXXL_IOSTATS_DETAIL");
+    if (env && *env && strcmp(env, "0") != 0)
+        detailed = true;
+}
 
 #ifndef STXXL_IO_STATS_RESET_FORBIDDEN
 void stats::reset()
@@ -74,6 +122,8 @@ void stats::reset()
         volume_read = 0;
         c_reads = 0;
         c_volume_read = 0;
+        z_volume_read = 0;
+        z_stored_read = 0;
         t_reads = 0;
         p_reads = 0.0;
     }
@@ -89,6 +139,8 @@ void stats::reset()
         volume_written = 0;
         c_writes = 0;
         c_volume_written = 0;
+        z_volume_written = 0;
+        z_stored_written = 0;
         t_writes = 0.0;
         p_writes = 0.0;
     }
@@ -117,6 +169,20 @@ void stats::reset()
         t_wait_write = 0.0;
         p_wait_write = 0.0;
     }
+    {
+        scoped_mutex_lock DetailLock(detail_mutex);
+
+        // keep the current queue depths of the disks
+        for (stats_detail::disk_map::iterator d = detail.m_disks.begin();
+             d != detail.m_disks.end(); ++d)
+        {
+            const unsigned depth = d->second.queue_depth.get_depth();
+            d->second = disk_detail();
+            if (depth)
+                d->second.queue_depth.change(int(depth), timestamp());
+        }
+        detail.m_wait_sites.clear();
+    }
 
     last_reset = timestamp();
 }
@@ -185,6 +251,14 @@ void stats::write_cached(unsigned_type size_)
     c_volume_written += size_;
 }
 
+void stats::write_compressed(unsigned_type size_, unsigned_type stored_size)
+{
+    scoped_mutex_lock WriteLock(write_mutex);
+
+    z_volume_written += size_;
+    z_stored_written += stored_size;
+}
+
 void stats::read_started(unsigned_type size_, double now)
 {
     if (now == 0.0)
@@ -246,6 +320,184 @@ void stats::read_cached(unsigned_type size_)
     ++c_reads;
     c_volume_read += size_;
 }
+
+void stats::read_compressed(unsigned_type size_, unsigned_type stored_size)
+{
+    scoped_mutex_lock ReadLock(read_mutex);
+
+    z_volume_read += size_;
+    z_stored_read += stored_size;
+}
+#endif
+
+stats_detail stats::get_detail() const
+{
+    scoped_mutex_lock DetailLock(detail_mutex);
+    return detail;
+}
+
+void stats::detail_queued(request* const* reqs, size_t n)
+{
+    const double now = timestamp();
+    scoped_mutex_lock DetailLock(detail_mutex);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        reqs[i]->m_time_queued = now;
+        detail.m_disks[reqs[i]->get_file()->get_queue_id()]
+        .queue_depth.change(1, now);
+    }
+}
+
+void stats::detail_served(const request& req, double service_time)
+{
+    if (req.m_time_queued == 0.0)
+        return;
+
+    scoped_mutex_lock DetailLock(detail_mutex);
+
+    disk_detail& d = detail.m_disks[req.get_file()->get_queue_id()];
+    if (req.get_type() == request::READ)
+        d.read_service.record(service_time);
+    else
+        d.write_service.record(service_time);
+}
+
+void stats::request_finished(request& req, bool canceled)
+{
+    const double now = timestamp();
+    scoped_mutex_lock DetailLock(detail_mutex);
+
+    disk_detail& d = detail.m_disks[req.get_file()->get_queue_id()];
+    if (!canceled) {
+        if (req.get_type() == request::READ)
+            d.read_latency.record(now - req.m_time_queued);
+        else
+            d.write_latency.record(now - req.m_time_queued);
+    }
+    d.queue_depth.change(-1, now);
+    req.m_time_queued = 0.0;
+}
+
+void stats::push_wait_site(const char* site)
+{
+    scoped_mutex_lock DetailLock(detail_mutex);
+    get_wait_site_stacks()[this_thread_key()].push_back(site);
+}
+
+void stats::pop_wait_site()
+{
+    scoped_mutex_lock DetailLock(detail_mutex);
+
+    wait_site_stacks& stacks = get_wait_site_stacks();
+    wait_site_stacks::iterator it = stacks.find(this_thread_key());
+    assert(it != stacks.end());
+    it->second.pop_back();
+    if (it->second.empty())
+        stacks.erase(it);
+}
+
+void stats::wait_attributed(wait_op_type wait_op, double wait_time)
+{
+    scoped_mutex_lock DetailLock(detail_mutex);
+
+    wait_site_stacks& stacks = get_wait_site_stacks();
+    wait_site_stacks::const_iterator it = stacks.find(this_thread_key());
+
+    const char* site;
+    if (it != stacks.end())
+        site = it->second.back();
+    else if (wait_op == WAIT_OP_READ)
+        site = "(read)";
+    else if (wait_op == WAIT_OP_WRITE)
+        site = "(write)";
+    else
+        site = "(any)";
+
+    detail.m_wait_sites[site].record(wait_time);
+}
+
+file_stats::file_stats()
+    : m_reads(0),
+      m_writes(0),
+      m_volume_read(0),
+      m_volume_written(0),
+      m_p_ios(0.0),
+      m_p_begin_io(0.0),
+      m_acc_ios(0)
+{ }
+
+#if STXXL_IO_STATS
+double file_stats::get_throughput() const
+{
+    scoped_mutex_lock IOLock(m_mutex);
+
+    if (m_p_ios <= 0.0)
+        return 0.0;
+
+    return double(m_volume_read + m_volume_written) / m_p_ios;
+}
+
+void file_stats::write_started(unsigned_type size_, double now)
+{
+    if (now == 0.0)
+        now = timestamp();
+
+    scoped_mutex_lock IOLock(m_mutex);
+
+    ++m_writes;
+    m_volume_written += size_;
+    double diff = now - m_p_begin_io;
+    m_p_ios += (m_acc_ios++) ? diff : 0.0;
+    m_p_begin_io = now;
+}
+
+void file_stats::write_canceled(unsigned_type size_)
+{
+    {
+        scoped_mutex_lock IOLock(m_mutex);
+
+        --m_writes;
+        m_volume_written -= size_;
+    }
+    io_finished();
+}
+
+void file_stats::read_started(unsigned_type size_, double now)
+{
+    if (now == 0.0)
+        now = timestamp();
+
+    scoped_mutex_lock IOLock(m_mutex);
+
+    ++m_reads;
+    m_volume_read += size_;
+    double diff = now - m_p_begin_io;
+    m_p_ios += (m_acc_ios++) ? diff : 0.0;
+    m_p_begin_io = now;
+}
+
+void file_stats::read_canceled(unsigned_type size_)
+{
+    {
+        scoped_mutex_lock IOLock(m_mutex);
+
+        --m_reads;
+        m_volume_read -= size_;
+    }
+    io_finished();
+}
+
+void file_stats::io_finished()
+{
+    double now = timestamp();
+
+    scoped_mutex_lock IOLock(m_mutex);
+
+    double diff = now - m_p_begin_io;
+    m_p_ios += (m_acc_ios--) ? diff : 0.0;
+    m_p_begin_io = now;
+}
 #endif
 
 #ifndef STXXL_DO_NOT_COUNT_WAIT_TIME
@@ -377,6 +629,18 @@ std::ostream& operator << (std::ostream& o, const stats_data& s)
         o << " average block size (cached write)          : " << hr(s.get_cached_written_volume() / s.get_cached_writes(), "B") << std::endl;
         o << " number of bytes written to cache           : " << hr(s.get_cached_written_volume(), "B") << std::endl;
     }
+    if (s.get_compressed_read_volume()) {
+        o << " number of bytes read from compressed files : " << hr(s.get_compressed_read_volume(), "B") << std::endl;
+        o << " stored bytes read for compressed files     : " << hr(s.get_compressed_stored_read_volume(), "B")
+          << " (" << (double)s.get_compressed_stored_read_volume() / (double)s.get_compressed_read_volume() * 100.0 << " %)"
+          << std::endl;
+    }
+    if (s.get_compressed_written_volume()) {
+        o << " number of bytes written to compressed files: " << hr(s.get_compressed_written_volume(), "B") << std::endl;
+        o << " stored bytes written for compressed files  : " << hr(s.get_compressed_stored_written_volume(), "B")
+          << " (" << (double)s.get_compressed_stored_written_volume() / (double)s.get_compressed_written_volume() * 100.0 << " %)"
+          << std::endl;
+    }
     o << " total number of writes                     : " << hr(s.get_writes()) << std::endl;
     o << " average block size (write)                 : "
       << hr(s.get_writes() ? s.get_written_volume() / s.get_writes() : 0, "B") << std::endl;
@@ -401,9 +665,38 @@ std::ostream& operator << (std::ostream& o, const stats_data& s)
         o << " I/O wait4write time                        : " << s.get_wait_write_time() << " s" << std::endl;
 #endif
     o << " Time since the last reset                  : " << s.get_elapsed_time() << " s" << std::endl;
+    s.get_detail().print(o);
     return o;
 #undef hr
 }
 
+void stats_data::print_json(std::ostream& o) const
+{
+    o << "{\"reads\": " << reads
+      << ", \"writes\": " << writes
+      << ", \"read_volume\": " << volume_read
+      << ", \"written_volume\": " << volume_written
+      << ", \"cached_reads\": " << c_reads
+      << ", \"cached_writes\": " << c_writes
+      << ", \"cached_read_volume\": " << c_volume_read
+      << ", \"cached_written_volume\": " << c_volume_written
+      << ", \"compressed_read_volume\": " << z_volume_read
+      << ", \"compressed_written_volume\": " << z_volume_written
+      << ", \"compressed_stored_read_volume\": " << z_stored_read
+      << ", \"compressed_stored_written_volume\": " << z_stored_written
+      << ", \"read_time\": " << t_reads
+      << ", \"write_time\": " << t_writes
+      << ", \"pread_time\": " << p_reads
+      << ", \"pwrite_time\": " << p_writes
+      << ", \"pio_time\": " << p_ios
+      << ", \"io_wait_time\": " << t_wait
+      << ", \"wait_read_time\": " << t_wait_read
+      << ", \"wait_write_time\": " << t_wait_write
+      << ", \"elapsed\": " << elapsed
+      << ", \"detail\": ";
+    detail.print_json(o);
+    o << "}";
+}
+
 STXXL_END_NAMESPACE
 // vim: et:ts=4:sw=4
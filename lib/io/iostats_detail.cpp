@@ -0,0 +1,397 @@
+/***************************************************************************
+ *  lib/io/iostats_detail.cpp
+ *
+ *  latency histograms and queue depth traces of the detailed I/O statistics
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/bits/io/iostats_detail.h>
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+
+STXXL_BEGIN_NAMESPACE
+
+namespace {
+
+//! position of the most significant bit of x > 0
+inline unsigned msb(uint64 x)
+{
+    unsigned r = 0;
+    while (x >>= 1)
+        ++r;
+    return r;
+}
+
+//! prints a string as JSON string literal
+void print_json_string(std::ostream& o, const std::string& s)
+{
+    o << '"';
+    for (std::string::const_iterator c = s.begin(); c != s.end(); ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            o << '\\' << *c;
+        else if ((unsigned char)*c < 0x20)
+            o << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+              << int(*c) << std::dec << std::setfill(' ');
+        else
+            o << *c;
+    }
+    o << '"';
+}
+
+} // namespace
+
+/******************************************************************************/
+// latency_histogram
+
+unsigned latency_histogram::bucket_index(uint64 us)
+{
+    if (us < sub_buckets)
+        return unsigned(us);
+
+    const uint64 limit = uint64(1) << max_magnitude;
+    if (us >= limit)
+        us = limit - 1;
+
+    // values with msb e are counted in sub_buckets buckets of width
+    // 2^(e - sub_bucket_bits) starting at index (e - sub_bucket_bits + 1) *
+    // sub_buckets
+    const unsigned shift = msb(us) - sub_bucket_bits;
+    return (shift << sub_bucket_bits) + unsigned(us >> shift);
+}
+
+uint64 latency_histogram::bucket_lower(unsigned i)
+{
+    if (i < 2 * sub_buckets)
+        return i;
+
+    const unsigned shift = (i >> sub_bucket_bits) - 1;
+    return uint64((i & (sub_buckets - 1)) + sub_buckets) << shift;
+}
+
+uint64 latency_histogram::bucket_width(unsigned i)
+{
+    if (i < 2 * sub_buckets)
+        return 1;
+
+    return uint64(1) << ((i >> sub_bucket_bits) - 1);
+}
+
+void latency_histogram::record(double seconds)
+{
+    const uint64 us = seconds > 0.0 ? uint64(seconds * 1e6 + 0.5) : 0;
+
+    if (m_buckets.empty())
+        m_buckets.resize(num_buckets, 0);
+
+    ++m_buckets[bucket_index(us)];
+    if (m_count == 0 || us < m_min)
+        m_min = us;
+    if (us > m_max)
+        m_max = us;
+    ++m_count;
+    m_sum += us;
+}
+
+double latency_histogram::get_percentile(double q) const
+{
+    if (m_count == 0)
+        return 0.0;
+
+    // number of latencies which do not exceed the result
+    uint64 rank = uint64(q * double(m_count) + 0.5);
+    rank = std::max<uint64>(1, std::min(rank, m_count));
+
+    uint64 sum = 0;
+    for (unsigned i = 0; i < num_buckets; ++i)
+    {
+        sum += m_buckets[i];
+        if (sum >= rank) {
+            // the highest latency of the bucket, but no more than the maximum
+            const uint64 us = bucket_lower(i) + bucket_width(i) - 1;
+            return double(std::max(m_min, std::min(us, m_max))) * 1e-6;
+        }
+    }
+    return get_max();
+}
+
+latency_histogram& latency_histogram::operator += (const latency_histogram& h)
+{
+    if (h.m_count == 0)
+        return *this;
+
+    if (m_buckets.empty())
+        m_buckets.resize(num_buckets, 0);
+    for (unsigned i = 0; i < num_buckets; ++i)
+        m_buckets[i] += h.m_buckets[i];
+
+    m_min = (m_count == 0) ? h.m_min : std::min(m_min, h.m_min);
+    m_max = std::max(m_max, h.m_max);
+    m_count += h.m_count;
+    m_sum += h.m_sum;
+    return *this;
+}
+
+latency_histogram latency_histogram::operator - (const latency_histogram& h) const
+{
+    latency_histogram d(*this);
+    if (h.m_count == 0)
+        return d;
+
+    assert(h.m_count <= m_count);
+    for (unsigned i = 0; i < num_buckets; ++i)
+        d.m_buckets[i] -= h.m_buckets[i];
+    d.m_count -= h.m_count;
+    d.m_sum -= h.m_sum;
+    if (d.m_count == 0)
+        d.m_min = d.m_max = 0;
+    return d;
+}
+
+void latency_histogram::print_json(std::ostream& o) const
+{
+    o << "{\"count\": " << m_count
+      << ", \"sum_us\": " << m_sum
+      << ", \"min_us\": " << m_min
+      << ", \"max_us\": " << m_max;
+
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    static const char* names[] = { "p50_us", "p90_us", "p99_us", "p999_us" };
+    for (unsigned q = 0; q < 4; ++q)
+        o << ", \"" << names[q] << "\": "
+          << uint64(get_percentile(quantiles[q]) * 1e6 + 0.5);
+
+    // non-empty buckets as [lowest latency, count] pairs
+    o << ", \"buckets\": [";
+    bool first = true;
+    for (unsigned i = 0; i < num_buckets && m_count; ++i)
+    {
+        if (m_buckets[i] == 0) continue;
+        o << (first ? "" : ", ") << '[' << bucket_lower(i) << ", " << m_buckets[i] << ']';
+        first = false;
+    }
+    o << "]}";
+}
+
+/******************************************************************************/
+// queue_depth_trace
+
+void queue_depth_trace::compact()
+{
+    const size_t n = (m_intervals.size() + 1) / 2;
+    for (size_t i = 0; i < n; ++i)
+    {
+        interval_type& t = m_intervals[i];
+        t = m_intervals[2 * i];
+        if (2 * i + 1 < m_intervals.size()) {
+            t.max_depth = std::max(t.max_depth, m_intervals[2 * i + 1].max_depth);
+            t.depth_time += m_intervals[2 * i + 1].depth_time;
+        }
+    }
+    m_intervals.resize(n);
+    m_interval *= 2;
+}
+
+void queue_depth_trace::account(double now)
+{
+    // add the current depth to the intervals from the last change until now
+    size_t last = size_t((now - m_begin) / m_interval);
+    while (last >= max_intervals) {
+        compact();
+        last = size_t((now - m_begin) / m_interval);
+    }
+    if (m_intervals.size() <= last) {
+        const interval_type empty = { 0, 0.0 };
+        m_intervals.resize(last + 1, empty);
+    }
+
+    double t = m_last_change;
+    for (size_t i = size_t((t - m_begin) / m_interval); t < now && i <= last; ++i)
+    {
+        const double end = std::min(now, m_begin + double(i + 1) * m_interval);
+        m_intervals[i].max_depth = std::max(m_intervals[i].max_depth, m_depth);
+        m_intervals[i].depth_time += double(m_depth) * (end - t);
+        t = end;
+    }
+
+    m_depth_time += double(m_depth) * (now - m_last_change);
+    m_last_change = now;
+}
+
+void queue_depth_trace::change(int delta, double now)
+{
+    if (m_begin == 0.0)
+        m_begin = m_last_change = now;
+    // timestamps of different threads may be slightly out of order
+    now = std::max(now, m_last_change);
+
+    account(now);
+
+    assert(delta >= 0 || m_depth >= unsigned(-delta));
+    m_depth += delta;
+    m_max_depth = std::max(m_max_depth, m_depth);
+
+    interval_type& current = m_intervals.back();
+    current.max_depth = std::max(current.max_depth, m_depth);
+}
+
+double queue_depth_trace::get_mean_depth() const
+{
+    const double elapsed = m_last_change - m_begin;
+    return elapsed > 0.0 ? m_depth_time / elapsed : double(m_depth);
+}
+
+void queue_depth_trace::print_json(std::ostream& o) const
+{
+    o << "{\"max\": " << m_max_depth
+      << ", \"mean\": " << get_mean_depth()
+      << ", \"interval_s\": " << m_interval
+      << ", \"max_depth\": [";
+    for (size_t i = 0; i < m_intervals.size(); ++i)
+        o << (i ? ", " : "") << m_intervals[i].max_depth;
+    o << "], \"mean_depth\": [";
+    for (size_t i = 0; i < m_intervals.size(); ++i)
+    {
+        // the last interval lasts until the last change only
+        const double length = (i + 1 < m_intervals.size())
+                              ? m_interval : m_last_change - m_begin - double(i) * m_interval;
+        o << (i ? ", " : "") << (length > 0.0 ? m_intervals[i].depth_time / length : 0.0);
+    }
+    o << "]}";
+}
+
+/******************************************************************************/
+// stats_detail
+
+stats_detail stats_detail::operator + (const stats_detail& a) const
+{
+    stats_detail s(*this);
+    for (disk_map::const_iterator d = a.m_disks.begin(); d != a.m_disks.end(); ++d)
+    {
+        disk_map::iterator sd = s.m_disks.find(d->first);
+        if (sd == s.m_disks.end()) {
+            s.m_disks.insert(*d);
+            continue;
+        }
+        sd->second.read_latency += d->second.read_latency;
+        sd->second.write_latency += d->second.write_latency;
+        sd->second.read_service += d->second.read_service;
+        sd->second.write_service += d->second.write_service;
+    }
+    for (wait_site_map::const_iterator w = a.m_wait_sites.begin();
+         w != a.m_wait_sites.end(); ++w)
+        s.m_wait_sites[w->first] += w->second;
+    return s;
+}
+
+stats_detail stats_detail::operator - (const stats_detail& a) const
+{
+    stats_detail s(*this);
+    for (disk_map::const_iterator d = a.m_disks.begin(); d != a.m_disks.end(); ++d)
+    {
+        disk_map::iterator sd = s.m_disks.find(d->first);
+        if (sd == s.m_disks.end())
+            continue;
+        sd->second.read_latency = sd->second.read_latency - d->second.read_latency;
+        sd->second.write_latency = sd->second.write_latency - d->second.write_latency;
+        sd->second.read_service = sd->second.read_service - d->second.read_service;
+        sd->second.write_service = sd->second.write_service - d->second.write_service;
+    }
+    for (wait_site_map::const_iterator w = a.m_wait_sites.begin();
+         w != a.m_wait_sites.end(); ++w)
+    {
+        wait_site_map::iterator sw = s.m_wait_sites.find(w->first);
+        if (sw != s.m_wait_sites.end())
+            sw->second = sw->second - w->second;
+    }
+    return s;
+}
+
+namespace {
+
+void print_latency_row(std::ostream& o, const std::string& name,
+                       const latency_histogram& h)
+{
+    if (h.get_count() == 0)
+        return;
+
+    o << ' ' << std::left << std::setw(24) << name << std::right
+      << std::setw(10) << h.get_count()
+      << std::fixed << std::setprecision(3)
+      << std::setw(11) << h.get_mean() * 1e3
+      << std::setw(11) << h.get_percentile(0.5) * 1e3
+      << std::setw(11) << h.get_percentile(0.9) * 1e3
+      << std::setw(11) << h.get_percentile(0.99) * 1e3
+      << std::setw(11) << h.get_percentile(0.999) * 1e3
+      << std::setw(11) << h.get_max() * 1e3
+      << std::endl;
+    o.unsetf(std::ios_base::floatfield);
+    o << std::setprecision(6);
+}
+
+} // namespace
+
+void stats_detail::print(std::ostream& o) const
+{
+    if (empty())
+        return;
+
+    o << " latencies in ms               count       mean        p50"
+      << "        p90        p99      p99.9        max" << std::endl;
+    for (disk_map::const_iterator d = m_disks.begin(); d != m_disks.end(); ++d)
+    {
+        std::ostringstream disk;
+        disk << "disk " << d->first;
+        print_latency_row(o, disk.str() + " read", d->second.read_latency);
+        print_latency_row(o, disk.str() + " read serve", d->second.read_service);
+        print_latency_row(o, disk.str() + " write", d->second.write_latency);
+        print_latency_row(o, disk.str() + " write serve", d->second.write_service);
+        o << ' ' << std::left << std::setw(24) << (disk.str() + " queue depth")
+          << std::right << " max " << d->second.queue_depth.get_max_depth()
+          << ", mean " << d->second.queue_depth.get_mean_depth() << std::endl;
+    }
+    for (wait_site_map::const_iterator w = m_wait_sites.begin();
+         w != m_wait_sites.end(); ++w)
+        print_latency_row(o, "wait " + w->first, w->second);
+}
+
+void stats_detail::print_json(std::ostream& o) const
+{
+    o << "{\"disks\": {";
+    for (disk_map::const_iterator d = m_disks.begin(); d != m_disks.end(); ++d)
+    {
+        o << (d == m_disks.begin() ? "" : ", ") << "\"" << d->first << "\": {";
+        o << "\"read_latency\": ";
+        d->second.read_latency.print_json(o);
+        o << ", \"read_service\": ";
+        d->second.read_service.print_json(o);
+        o << ", \"write_latency\": ";
+        d->second.write_latency.print_json(o);
+        o << ", \"write_service\": ";
+        d->second.write_service.print_json(o);
+        o << ", \"queue_depth\": ";
+        d->second.queue_depth.print_json(o);
+        o << "}";
+    }
+    o << "}, \"wait_sites\": {";
+    for (wait_site_map::const_iterator w = m_wait_sites.begin();
+         w != m_wait_sites.end(); ++w)
+    {
+        o << (w == m_wait_sites.begin() ? "" : ", ");
+        print_json_string(o, w->first);
+        o << ": ";
+        w->second.print_json(o);
+    }
+    o << "}}";
+}
+
+STXXL_END_NAMESPACE
+// vim: et:ts=4:sw=4
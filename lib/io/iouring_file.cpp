@@ -0,0 +1,93 @@
+/***************************************************************************
+ *  lib/io/iouring_file.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/bits/io/iouring_file.h>
+
+#if STXXL_HAVE_IOURING_FILE
+
+#include <stxxl/bits/io/iouring_queue.h>
+#include <stxxl/bits/io/iouring_request.h>
+#include <stxxl/bits/io/disk_queues.h>
+
+STXXL_BEGIN_NAMESPACE
+
+request_ptr iouring_file::aread(
+    void* buffer,
+    offset_type pos,
+    size_type bytes,
+    const completion_handler& on_cmpl)
+{
+    request_ptr req(new iouring_request(on_cmpl, this, buffer, pos, bytes, request::READ));
+
+    disk_queues::get_instance()->add_request(req, get_queue_id());
+
+    return req;
+}
+
+request_ptr iouring_file::awrite(
+    void* buffer,
+    offset_type pos,
+    size_type bytes,
+    const completion_handler& on_cmpl)
+{
+    request_ptr req(new iouring_request(on_cmpl, this, buffer, pos, bytes, request::WRITE));
+
+    disk_queues::get_instance()->add_request(req, get_queue_id());
+
+    return req;
+}
+
+void iouring_file::aread_batch(
+    void* const* buffers,
+    const offset_type* offsets,
+    size_type bytes,
+    size_t n,
+    request_ptr* reqs,
+    const completion_handler& on_cmpl)
+{
+    for (size_t i = 0; i < n; ++i)
+        reqs[i] = new iouring_request(on_cmpl, this, buffers[i], offsets[i], bytes, request::READ);
+
+    disk_queues::get_instance()->add_requests(reqs, n, get_queue_id());
+}
+
+void iouring_file::awrite_batch(
+    void* const* buffers,
+    const offset_type* offsets,
+    size_type bytes,
+    size_t n,
+    request_ptr* reqs,
+    const completion_handler& on_cmpl)
+{
+    for (size_t i = 0; i < n; ++i)
+        reqs[i] = new iouring_request(on_cmpl, this, buffers[i], offsets[i], bytes, request::WRITE);
+
+    disk_queues::get_instance()->add_requests(reqs, n, get_queue_id());
+}
+
+void iouring_file::serve(void* buffer, offset_type offset, size_type bytes,
+                         request::request_type type)
+{
+    // req need not be an iouring_request
+    if (type == request::READ)
+        aread(buffer, offset, bytes)->wait();
+    else
+        awrite(buffer, offset, bytes)->wait();
+}
+
+const char* iouring_file::io_type() const
+{
+    return "io_uring";
+}
+
+STXXL_END_NAMESPACE
+
+#endif // #if STXXL_HAVE_IOURING_FILE
+// vim: et:ts=4:sw=4
@@ -0,0 +1,468 @@
+/***************************************************************************
+ *  lib/io/iouring_queue.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/bits/io/iouring_queue.h>
+
+#if STXXL_HAVE_IOURING_FILE
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <stxxl/bits/verbose.h>
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/io/iostats.h>
+#include <stxxl/bits/io/iouring_request.h>
+#include <stxxl/bits/parallel.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+STXXL_BEGIN_NAMESPACE
+
+iouring_queue::iouring_queue(int desired_queue_length)
+    : ring_fd(-1),
+      sq_ring_ptr(NULL), cq_ring_ptr(NULL), sqes(NULL),
+      num_waiting_requests(0), num_free_events(0), num_posted_requests(0),
+      num_submitted(0), num_reaped(0),
+      post_thread_state(NOT_RUNNING), wait_thread_state(NOT_RUNNING)
+{
+    if (desired_queue_length == 0) {
+        // default value, 256 entries per queue (i.e. per disk) keep NVMe
+        // devices busy even with small blocks
+        max_events = 256;
+    }
+    else
+        max_events = desired_queue_length;
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring_fd = (int)syscall(SYS_io_uring_setup, max_events, &params);
+    if (ring_fd < 0) {
+        STXXL_THROW_ERRNO(io_error, "iouring_queue::iouring_queue"
+                          " io_uring_setup() entries=" << max_events);
+    }
+
+    // kernel rounds up to a power of two
+    max_events = (int)params.sq_entries;
+
+    // map submission and completion rings, which may share one mapping
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+
+    sq_ring_ptr = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ptr == MAP_FAILED) {
+        ::close(ring_fd);
+        STXXL_THROW_ERRNO(io_error, "iouring_queue::iouring_queue"
+                          " mmap() of submission ring");
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring_ptr = sq_ring_ptr;
+    }
+    else {
+        cq_ring_ptr = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring_ptr == MAP_FAILED) {
+            munmap(sq_ring_ptr, sq_ring_size);
+            ::close(ring_fd);
+            STXXL_THROW_ERRNO(io_error, "iouring_queue::iouring_queue"
+                              " mmap() of completion ring");
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(
+        mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+        if (cq_ring_ptr != sq_ring_ptr)
+            munmap(cq_ring_ptr, cq_ring_size);
+        munmap(sq_ring_ptr, sq_ring_size);
+        ::close(ring_fd);
+        STXXL_THROW_ERRNO(io_error, "iouring_queue::iouring_queue"
+                          " mmap() of submission queue entries");
+    }
+
+    char* sq = static_cast<char*>(sq_ring_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char* cq = static_cast<char*>(cq_ring_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    for (int e = 0; e < max_events; ++e)
+        num_free_events++;  // cannot set semaphore to value directly
+
+    STXXL_MSG("Set up an io_uring queue with " << max_events << " entries.");
+
+    start_thread(post_async, static_cast<void*>(this), post_thread, post_thread_state);
+    start_thread(wait_async, static_cast<void*>(this), wait_thread, wait_thread_state);
+}
+
+iouring_queue::~iouring_queue()
+{
+    stop_thread(post_thread, post_thread_state, num_waiting_requests);
+    stop_thread(wait_thread, wait_thread_state, num_posted_requests);
+
+    munmap(sqes, sqes_size);
+    if (cq_ring_ptr != sq_ring_ptr)
+        munmap(cq_ring_ptr, cq_ring_size);
+    munmap(sq_ring_ptr, sq_ring_size);
+    ::close(ring_fd);
+}
+
+void iouring_queue::add_request(request_ptr& req)
+{
+    if (req.empty())
+        STXXL_THROW_INVALID_ARGUMENT("Empty request submitted to disk_queue.");
+    if (post_thread_state() != RUNNING)
+        STXXL_ERRMSG("Request submitted to stopped queue.");
+    if (!dynamic_cast<iouring_request*>(req.get()))
+        STXXL_ERRMSG("Non-io_uring request submitted to io_uring queue.");
+
+    scoped_mutex_lock lock(waiting_mtx);
+
+    waiting_requests.push_back(req);
+    num_waiting_requests++;
+}
+
+void iouring_queue::add_requests(request_ptr* reqs, size_t n)
+{
+    if (post_thread_state() != RUNNING)
+        STXXL_ERRMSG("Request submitted to stopped queue.");
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (reqs[i].empty())
+            STXXL_THROW_INVALID_ARGUMENT("Empty request submitted to disk_queue.");
+        if (!dynamic_cast<iouring_request*>(reqs[i].get()))
+            STXXL_ERRMSG("Non-io_uring request submitted to io_uring queue.");
+    }
+
+    scoped_mutex_lock lock(waiting_mtx);
+
+    waiting_requests.insert(waiting_requests.end(), reqs, reqs + n);
+    num_waiting_requests.signal((int)n);
+}
+
+bool iouring_queue::cancel_request(request_ptr& req)
+{
+    if (req.empty())
+        STXXL_THROW_INVALID_ARGUMENT("Empty request canceled disk_queue.");
+    if (post_thread_state() != RUNNING)
+        STXXL_ERRMSG("Request canceled in stopped queue.");
+    if (!dynamic_cast<iouring_request*>(req.get()))
+        STXXL_ERRMSG("Non-io_uring request submitted to io_uring queue.");
+
+    scoped_mutex_lock lock(waiting_mtx);
+
+    queue_type::iterator pos =
+        std::find(waiting_requests.begin(), waiting_requests.end(),
+                  req _STXXL_FORCE_SEQUENTIAL);
+
+    // only requests not yet posted to the kernel can be canceled. Requests
+    // requeued after a short transfer must not be canceled.
+    if (pos == waiting_requests.end() ||
+        dynamic_cast<iouring_request*>(req.get())->m_posted)
+        return false;
+
+    waiting_requests.erase(pos);
+
+    // request is canceled, but was not yet posted.
+    dynamic_cast<iouring_request*>(req.get())->completed(false, true);
+
+    num_waiting_requests--; // will never block
+    return true;
+}
+
+void iouring_queue::requeue(request_ptr& req)
+{
+    scoped_mutex_lock lock(waiting_mtx);
+
+    // put short transfers in front, they have waited long enough
+    waiting_requests.push_front(req);
+    num_waiting_requests++;
+}
+
+// internal routines, run by the posting thread
+void iouring_queue::post_requests()
+{
+    std::vector<request_ptr> batch;
+    batch.reserve(max_events);
+
+    for ( ; ; ) // as long as thread is running
+    {
+        // might block until next request or message comes in
+        int num_currently_waiting_requests = num_waiting_requests--;
+
+        // terminate if termination has been requested
+        if (post_thread_state() == TERMINATING && num_currently_waiting_requests == 0)
+            break;
+
+        {
+            scoped_mutex_lock lock(waiting_mtx);
+            if (waiting_requests.empty())
+            {
+                lock.unlock();
+
+                // num_waiting_requests-- was premature, compensate for that
+                num_waiting_requests++;
+                continue;
+            }
+
+            // grab all waiting requests at once, every additional one still
+            // has its token in the semaphore.
+            batch.push_back(waiting_requests.front());
+            waiting_requests.pop_front();
+
+            while (!waiting_requests.empty() && (int)batch.size() < max_events)
+            {
+                batch.push_back(waiting_requests.front());
+                waiting_requests.pop_front();
+                num_waiting_requests.decrement(); // will never block
+            }
+        }
+
+        // fill submission queue entries, we are the only producer.
+        unsigned tail = *sq_tail;
+        const unsigned mask = *sq_mask;
+        double now = timestamp();
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            num_free_events--; // might block because too many requests are posted
+
+            iouring_request* ureq = dynamic_cast<iouring_request*>(batch[i].get());
+
+            if (!ureq->m_posted)
+            {
+                ureq->m_posted = true;
+
+                file_stats& fs = ureq->get_file()->get_file_stats();
+                if (ureq->get_type() == request::READ)
+                {
+                    stats::get_instance()->read_started(ureq->get_size(), now);
+                    fs.read_started(ureq->get_size(), now);
+                }
+                else
+                {
+                    stats::get_instance()->write_started(ureq->get_size(), now);
+                    fs.write_started(ureq->get_size(), now);
+                }
+            }
+
+            unsigned index = tail & mask;
+            ureq->fill_sqe(&sqes[index]);
+            // indirection, so the I/O system retains a counting_ptr reference
+            sqes[index].user_data = reinterpret_cast<uint64>(new request_ptr(batch[i]));
+            sq_array[index] = index;
+            ++tail;
+
+            num_posted_requests++;
+        }
+
+        // publish entries to the kernel
+        __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+
+        // hand over whole batch with (usually) one system call
+        unsigned to_submit = (unsigned)batch.size();
+        while (to_submit > 0)
+        {
+            uint64 reaped;
+            {
+                scoped_mutex_lock lock(reap_mtx);
+                reaped = num_reaped;
+            }
+
+            long r = syscall(SYS_io_uring_enter, ring_fd, to_submit, 0, 0, NULL, 0);
+            if (r < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EBUSY) {
+                    // completion ring full or out of resources: let the
+                    // waiting thread reap some completions first
+                    wait_reaped(reaped);
+                    continue;
+                }
+
+                STXXL_THROW_ERRNO(io_error, "iouring_queue::post_requests"
+                                  " io_uring_enter() to_submit=" << to_submit);
+            }
+            if (r == 0) {
+                STXXL_THROW(io_error, "iouring_queue::post_requests"
+                            " io_uring_enter() to_submit=" << to_submit <<
+                            " consumed no submission queue entry");
+            }
+            to_submit -= (unsigned)r;
+
+            scoped_mutex_lock lock(reap_mtx);
+            num_submitted += (uint64)r;
+        }
+
+        batch.clear();
+    }
+}
+
+void iouring_queue::wait_reaped(uint64 reaped)
+{
+    scoped_mutex_lock lock(reap_mtx);
+    while (num_reaped == reaped && num_reaped < num_submitted)
+        reap_cond.wait(lock);
+}
+
+unsigned iouring_queue::reap_completions()
+{
+    unsigned head = *cq_head; // we are the only consumer
+    unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    const unsigned mask = *cq_mask;
+    unsigned count = 0;
+
+    while (head != tail)
+    {
+        const io_uring_cqe& cqe = cqes[head & mask];
+
+        // unsigned_type is as long as a pointer, and like this, we avoid an icpc warning
+        request_ptr* r = reinterpret_cast<request_ptr*>(static_cast<unsigned_type>(cqe.user_data));
+        int res = cqe.res;
+
+        // release completion slot
+        __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+
+        num_free_events++;
+        num_posted_requests--; // will never block
+        ++count;
+
+        iouring_request* ureq = dynamic_cast<iouring_request*>(r->get());
+
+        if (res == -EAGAIN || res == -EINTR)
+        {
+            requeue(*r);
+        }
+        else if (res < 0)
+        {
+            std::ostringstream msg;
+            msg << "Error in iouring_queue: " << *ureq
+                << " completed with error " << -res << ": " << strerror(-res);
+            ureq->error_occured(msg.str());
+            ureq->completed(false);
+        }
+        else
+        {
+            ureq->m_done += (request::size_type)res;
+
+            if (ureq->m_done < ureq->get_size() &&
+                ureq->get_type() == request::READ && res == 0)
+            {
+                // read request extends past end-of-file, fill remainder
+                // with zeroes
+                memset(static_cast<char*>(ureq->get_buffer()) + ureq->m_done,
+                       0, ureq->get_size() - ureq->m_done);
+                ureq->completed(false);
+            }
+            else if (ureq->m_done < ureq->get_size())
+            {
+                // short transfer: submit remaining part again
+                requeue(*r);
+            }
+            else
+            {
+                ureq->completed(false);
+            }
+        }
+
+        delete r;              // release auto_ptr reference
+
+        tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    }
+
+    if (count > 0)
+    {
+        {
+            scoped_mutex_lock lock(reap_mtx);
+            num_reaped += count;
+        }
+        reap_cond.notify_all();
+    }
+
+    return count;
+}
+
+// internal routines, run by the waiting thread
+void iouring_queue::wait_requests()
+{
+    for ( ; ; ) // as long as thread is running
+    {
+        // might block until next request is posted or message comes in
+        int num_currently_posted_requests = num_posted_requests--;
+
+        // terminate if termination has been requested
+        if (wait_thread_state() == TERMINATING && num_currently_posted_requests == 0)
+            break;
+
+        // poll the completion ring for a while, fast devices complete
+        // requests within microseconds, then wait for at least one
+        unsigned spins = 0;
+        while (*cq_head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+        {
+            if (spins < STXXL_IOURING_POLL_SPINS) {
+                ++spins;
+                continue;
+            }
+
+            long r = syscall(SYS_io_uring_enter, ring_fd, 0, 1,
+                             IORING_ENTER_GETEVENTS, NULL, 0);
+            if (r < 0 && errno != EINTR) {
+                STXXL_THROW_ERRNO(io_error, "iouring_queue::wait_requests"
+                                  " io_uring_enter() min_complete=1");
+            }
+        }
+
+        num_posted_requests++; // compensate for the one eaten prematurely above
+
+        reap_completions();
+    }
+}
+
+void* iouring_queue::post_async(void* arg)
+{
+    (static_cast<iouring_queue*>(arg))->post_requests();
+
+    self_type* pthis = static_cast<self_type*>(arg);
+    pthis->post_thread_state.set_to(TERMINATED);
+
+    return NULL;
+}
+
+void* iouring_queue::wait_async(void* arg)
+{
+    (static_cast<iouring_queue*>(arg))->wait_requests();
+
+    self_type* pthis = static_cast<self_type*>(arg);
+    pthis->wait_thread_state.set_to(TERMINATED);
+
+    return NULL;
+}
+
+STXXL_END_NAMESPACE
+
+#endif // #if STXXL_HAVE_IOURING_FILE
+// vim: et:ts=4:sw=4
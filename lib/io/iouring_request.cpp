@@ -0,0 +1,88 @@
+/***************************************************************************
+ *  lib/io/iouring_request.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/bits/io/iouring_request.h>
+
+#if STXXL_HAVE_IOURING_FILE
+
+#include <stxxl/bits/io/disk_queues.h>
+#include <stxxl/bits/io/iouring_queue.h>
+#include <stxxl/bits/verbose.h>
+
+#include <cstring>
+#include <limits>
+
+STXXL_BEGIN_NAMESPACE
+
+void iouring_request::completed(bool posted, bool canceled)
+{
+    STXXL_VERBOSE_IOURING("iouring_request[" << this << "] completed(" <<
+                          posted << "," << canceled << ")");
+
+    if (!canceled)
+    {
+        if (m_type == READ)
+            stats::get_instance()->read_finished();
+        else
+            stats::get_instance()->write_finished();
+        m_file->get_file_stats().io_finished();
+    }
+    else if (posted)
+    {
+        if (m_type == READ)
+        {
+            stats::get_instance()->read_canceled(m_bytes);
+            m_file->get_file_stats().read_canceled(m_bytes);
+        }
+        else
+        {
+            stats::get_instance()->write_canceled(m_bytes);
+            m_file->get_file_stats().write_canceled(m_bytes);
+        }
+    }
+    request_with_state::completed(canceled);
+}
+
+void iouring_request::fill_sqe(io_uring_sqe* sqe)
+{
+    iouring_file* uf = dynamic_cast<iouring_file*>(m_file);
+
+    size_type remaining = m_bytes - m_done;
+    assert(remaining <= std::numeric_limits<__u32>::max());
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (m_type == READ) ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe->fd = uf->file_des;
+    sqe->addr = reinterpret_cast<__u64>(static_cast<char*>(m_buffer) + m_done);
+    sqe->len = (__u32)remaining;
+    sqe->off = m_offset + m_done;
+}
+
+//! Cancel the request
+//!
+//! Routine is called by user, as part of the request interface. Only requests
+//! not yet handed to the kernel can be canceled.
+bool iouring_request::cancel()
+{
+    STXXL_VERBOSE_IOURING("iouring_request[" << this << "] cancel()");
+
+    if (!m_file) return false;
+
+    request_ptr req(this);
+    iouring_queue* queue = dynamic_cast<iouring_queue*>(
+        disk_queues::get_instance()->get_queue(m_file->get_queue_id())
+        );
+    return queue->cancel_request(req);
+}
+
+STXXL_END_NAMESPACE
+
+#endif // #if STXXL_HAVE_IOURING_FILE
+// vim: et:ts=4:sw=4
@@ -88,6 +88,24 @@ void linuxaio_queue::add_request(request_ptr& req)
     num_waiting_requests++;
 }
 
+void linuxaio_queue::add_requests(request_ptr* reqs, size_t n)
+{
+    if (post_thread_state() != RUNNING)
+        STXXL_ERRMSG("Request submitted to stopped queue.");
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (reqs[i].empty())
+            STXXL_THROW_INVALID_ARGUMENT("Empty request submitted to disk_queue.");
+        if (!dynamic_cast<linuxaio_request*>(reqs[i].get()))
+            STXXL_ERRMSG("Non-LinuxAIO request submitted to LinuxAIO queue.");
+    }
+
+    scoped_mutex_lock lock(waiting_mtx);
+
+    waiting_requests.insert(waiting_requests.end(), reqs, reqs + n);
+    num_waiting_requests.signal((int)n);
+}
+
 bool linuxaio_queue::cancel_request(request_ptr& req)
 {
     if (req.empty())
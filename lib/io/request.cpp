@@ -30,7 +30,9 @@ request::request(
       m_buffer(buffer),
       m_offset(offset),
       m_bytes(bytes),
-      m_type(type)
+      m_type(type),
+      m_priority(type == READ ? PREFETCH : WRITE_BEHIND),
+      m_time_queued(0.0)
 {
     STXXL_VERBOSE3_THIS("request::(...), ref_cnt=" << get_reference_count());
     m_file->add_request_ref();
@@ -76,6 +76,37 @@ void request_queue_impl_1q::add_request(request_ptr& req)
     m_sem++;
 }
 
+void request_queue_impl_1q::add_requests(request_ptr* reqs, size_t n)
+{
+    if (m_thread_state() != RUNNING)
+        STXXL_THROW_INVALID_ARGUMENT("Request submitted to not running queue.");
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (reqs[i].empty())
+            STXXL_THROW_INVALID_ARGUMENT("Empty request submitted to disk_queue.");
+        if (!dynamic_cast<serving_request*>(reqs[i].get()))
+            STXXL_ERRMSG("Incompatible request submitted to running queue.");
+    }
+
+    scoped_mutex_lock Lock(m_queue_mutex);
+    for (size_t i = 0; i < n; ++i)
+    {
+#if STXXL_CHECK_FOR_PENDING_REQUESTS_ON_SUBMISSION
+        if (std::find_if(m_queue.begin(), m_queue.end(),
+                         bind2nd(file_offset_match(), reqs[i]) _STXXL_FORCE_SEQUENTIAL)
+            != m_queue.end())
+        {
+            STXXL_ERRMSG("request submitted for a BID with a pending request");
+        }
+#endif
+        m_queue.push_back(reqs[i]);
+    }
+    Lock.unlock();
+
+    m_sem.signal((int)n);
+}
+
 bool request_queue_impl_1q::cancel_request(request_ptr& req)
 {
     if (req.empty())
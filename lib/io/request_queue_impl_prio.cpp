@@ -0,0 +1,431 @@
+/***************************************************************************
+ *  lib/io/request_queue_impl_prio.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <algorithm>
+
+#include <stxxl/bits/config.h>
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/timer.h>
+#include <stxxl/bits/io/file.h>
+#include <stxxl/bits/io/request_queue_impl_prio.h>
+#include <stxxl/bits/io/serving_request.h>
+
+#if STXXL_STD_THREADS && STXXL_MSVC >= 1700
+ #include <windows.h>
+#endif
+
+STXXL_BEGIN_NAMESPACE
+
+//! true if a must not be overtaken by b: same file, overlapping regions and
+//! at least one of them writes.
+static inline bool must_precede(const request_ptr& a, const request_ptr& b)
+{
+    return (a->get_file() == b->get_file()) &&
+           (a->get_type() == request::WRITE || b->get_type() == request::WRITE) &&
+           (a->get_offset() < b->get_offset() + b->get_size()) &&
+           (b->get_offset() < a->get_offset() + a->get_size());
+}
+
+request_queue_impl_prio::request_queue_impl_prio(int n)
+    : m_max_size(0), m_seq(0), m_priority_op(WRITE),
+      m_thread_state(NOT_RUNNING), m_sem(0)
+{
+    start_threads(worker, static_cast<void*>(this), m_threads, n, m_thread_state);
+}
+
+void request_queue_impl_prio::set_priority_op(priority_op op)
+{
+    scoped_mutex_lock Lock(m_mutex);
+    m_priority_op = op;
+}
+
+void request_queue_impl_prio::push(request_ptr& req, double now)
+{
+    const int prio = req->get_priority();
+    queue_type::iterator pos = m_queues[prio].insert(
+        m_queues[prio].end(), entry(req, m_seq++, now, prio));
+    m_requests[req.get()] = pos;
+    m_regions.insert(std::make_pair(
+                         region_key_type(req->get_file(), req->get_offset()), pos));
+    m_max_size = std::max(m_max_size, req->get_size());
+}
+
+void request_queue_impl_prio::erase(queue_type::iterator pos)
+{
+    m_requests.erase(pos->req.get());
+    std::pair<region_index_type::iterator, region_index_type::iterator> range =
+        m_regions.equal_range(region_key_type(pos->req->get_file(), pos->req->get_offset()));
+    for (region_index_type::iterator it = range.first; it != range.second; ++it)
+    {
+        if (it->second == pos) {
+            m_regions.erase(it);
+            break;
+        }
+    }
+    m_queues[pos->prio].erase(pos);
+}
+
+void request_queue_impl_prio::add_request(request_ptr& req)
+{
+    if (req.empty())
+        STXXL_THROW_INVALID_ARGUMENT("Empty request submitted to disk_queue.");
+    if (m_thread_state() != RUNNING)
+        STXXL_THROW_INVALID_ARGUMENT("Request submitted to not running queue.");
+    if (!dynamic_cast<serving_request*>(req.get()))
+        STXXL_ERRMSG("Incompatible request submitted to running queue.");
+
+    scoped_mutex_lock Lock(m_mutex);
+    push(req, timestamp());
+    Lock.unlock();
+
+    m_sem++;
+}
+
+void request_queue_impl_prio::add_requests(request_ptr* reqs, size_t n)
+{
+    if (m_thread_state() != RUNNING)
+        STXXL_THROW_INVALID_ARGUMENT("Request submitted to not running queue.");
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (reqs[i].empty())
+            STXXL_THROW_INVALID_ARGUMENT("Empty request submitted to disk_queue.");
+        if (!dynamic_cast<serving_request*>(reqs[i].get()))
+            STXXL_ERRMSG("Incompatible request submitted to running queue.");
+    }
+
+    double now = timestamp();
+
+    scoped_mutex_lock Lock(m_mutex);
+    for (size_t i = 0; i < n; ++i)
+        push(reqs[i], now);
+    Lock.unlock();
+
+    m_sem.signal((int)n);
+}
+
+bool request_queue_impl_prio::find(const request_ptr& req, queue_type::iterator& pos)
+{
+    request_index_type::iterator it = m_requests.find(req.get());
+    if (it == m_requests.end())
+        return false;
+    pos = it->second;
+    return true;
+}
+
+bool request_queue_impl_prio::find_blocking(const entry& e, queue_type::iterator& pos)
+{
+    // requests starting more than m_max_size before e cannot overlap it
+    file* f = e.req->get_file();
+    const request::offset_type offset = e.req->get_offset();
+    region_index_type::iterator it = m_regions.lower_bound(
+        region_key_type(f, (offset > m_max_size) ? offset - m_max_size : 0));
+    region_index_type::iterator end = m_regions.lower_bound(
+        region_key_type(f, offset + e.req->get_size()));
+
+    bool found = false;
+    for ( ; it != end; ++it)
+    {
+        const entry& other = *it->second;
+        if (other.seq < e.seq && must_precede(other.req, e.req) &&
+            (!found || other.seq < pos->seq))
+        {
+            pos = it->second;
+            found = true;
+        }
+    }
+    return found;
+}
+
+bool request_queue_impl_prio::cancel_request(request_ptr& req)
+{
+    if (req.empty())
+        STXXL_THROW_INVALID_ARGUMENT("Empty request canceled disk_queue.");
+    if (m_thread_state() != RUNNING)
+        STXXL_THROW_INVALID_ARGUMENT("Request canceled to not running queue.");
+    if (!dynamic_cast<serving_request*>(req.get()))
+        STXXL_ERRMSG("Incompatible request submitted to running queue.");
+
+    bool was_still_in_queue = false;
+    {
+        scoped_mutex_lock Lock(m_mutex);
+        queue_type::iterator pos;
+        if (find(req, pos))
+        {
+            erase(pos);
+            was_still_in_queue = true;
+            // a worker may hold the wake up already, do not block
+            m_sem.decrement();
+        }
+    }
+
+    return was_still_in_queue;
+}
+
+bool request_queue_impl_prio::raise_priority(request_ptr& req,
+                                             request::priority_type new_prio)
+{
+    scoped_mutex_lock Lock(m_mutex);
+
+    queue_type::iterator pos;
+    if (!find(req, pos))
+        return false;
+
+    const int prio = pos->prio;
+    if (prio <= new_prio)
+        return true;
+
+    // keep the target queue ordered by submission, raised requests are
+    // usually the most recent ones
+    queue_type& target = m_queues[new_prio];
+    queue_type::iterator ins = target.end();
+    while (ins != target.begin())
+    {
+        queue_type::iterator prev = ins;
+        if ((--prev)->seq < pos->seq)
+            break;
+        ins = prev;
+    }
+    target.splice(ins, m_queues[prio], pos);
+    pos->prio = new_prio;
+    req->m_priority = new_prio;
+
+    STXXL_VERBOSE2("request_queue_impl_prio: raised " << req.get() <<
+                   " from " << prio << " to " << new_prio);
+    return true;
+}
+
+bool request_queue_impl_prio::empty() const
+{
+    return m_queues[request::DEMAND].empty() &&
+           m_queues[request::PREFETCH].empty() &&
+           m_queues[request::WRITE_BEHIND].empty();
+}
+
+request_ptr request_queue_impl_prio::pop(double now)
+{
+    int prio = -1;
+
+    // serve overtaken requests first
+    for (int i = request::PREFETCH; i < num_classes; ++i)
+    {
+        if (!m_queues[i].empty() &&
+            now - m_queues[i].front().time > STXXL_PRIO_QUEUE_MAX_DELAY &&
+            (prio < 0 || m_queues[i].front().seq < m_queues[prio].front().seq))
+            prio = i;
+    }
+
+    if (prio < 0)
+    {
+        const int first = (m_priority_op == READ)
+                          ? request::PREFETCH : request::WRITE_BEHIND;
+        const int second = (first == request::PREFETCH)
+                           ? request::WRITE_BEHIND : request::PREFETCH;
+
+        if (!m_queues[request::DEMAND].empty())
+            prio = request::DEMAND;
+        else if (m_queues[first].empty())
+            prio = second;
+        else if (m_queues[second].empty())
+            prio = first;
+        else if (m_priority_op == NONE)
+            prio = (m_queues[first].front().seq < m_queues[second].front().seq)
+                   ? first : second;
+        else
+            prio = first;
+    }
+
+    queue_type::iterator pos = m_queues[prio].begin();
+    assert(pos != m_queues[prio].end());
+
+    // never overtake an earlier conflicting request, go back to the earliest
+    // one.
+    queue_type::iterator earlier;
+    while (find_blocking(*pos, earlier))
+        pos = earlier;
+
+    // another worker serves a conflicting request
+    if (is_blocked_in_flight(pos->req))
+        return request_ptr();
+
+    request_ptr req = pos->req;
+    erase(pos);
+    return req;
+}
+
+bool request_queue_impl_prio::is_blocked(const entry& e)
+{
+    queue_type::iterator pos;
+    return find_blocking(e, pos);
+}
+
+bool request_queue_impl_prio::is_blocked_in_flight(const request_ptr& req) const
+{
+    for (size_t i = 0; i < m_in_flight.size(); ++i)
+    {
+        if (must_precede(m_in_flight[i], req))
+            return true;
+    }
+    return false;
+}
+
+struct offset_less
+{
+    bool operator () (const request_ptr& a, const request_ptr& b) const
+    {
+        return a->get_offset() < b->get_offset();
+    }
+};
+
+void request_queue_impl_prio::coalesce(std::vector<request_ptr>& batch)
+{
+    file* f = batch[0]->get_file();
+    if (!f->has_vectored_io())
+        return;
+
+    const request::request_type type = batch[0]->get_type();
+    request::offset_type begin = batch[0]->get_offset();
+    request::offset_type end = begin + batch[0]->get_size();
+
+    for (bool found = true; found && batch.size() < STXXL_COALESCE_MAX_REQUESTS; )
+    {
+        found = false;
+        // requests ending at begin start at most m_max_size before it, those
+        // following the batch start at end
+        region_index_type::iterator ranges[2][2] = {
+            { m_regions.lower_bound(region_key_type(f, (begin > m_max_size) ? begin - m_max_size : 0)),
+              m_regions.lower_bound(region_key_type(f, begin)) },
+            { m_regions.lower_bound(region_key_type(f, end)),
+              m_regions.upper_bound(region_key_type(f, end)) }
+        };
+        for (int k = 0; k < 2 && !found; ++k)
+        {
+            for (region_index_type::iterator it = ranges[k][0]; it != ranges[k][1]; ++it)
+            {
+                const request_ptr r = it->second->req;
+                if (r->get_type() != type)
+                    continue;
+                if (r->get_offset() != end && r->get_offset() + r->get_size() != begin)
+                    continue;
+                if (end - begin + r->get_size() > STXXL_COALESCE_MAX_BYTES)
+                    continue;
+                if (is_blocked(*it->second) || is_blocked_in_flight(r))
+                    continue;
+
+                if (r->get_offset() == end)
+                    end += r->get_size();
+                else
+                    begin = r->get_offset();
+
+                batch.push_back(r);
+                erase(it->second);
+                // count the request as taken from the queue
+                m_sem.decrement();
+                found = true;
+                break;
+            }
+        }
+    }
+
+    if (batch.size() > 1)
+        std::sort(batch.begin(), batch.end(), offset_less());
+}
+
+request_queue_impl_prio::~request_queue_impl_prio()
+{
+    stop_threads(m_threads, m_thread_state, m_sem);
+}
+
+void* request_queue_impl_prio::worker(void* arg)
+{
+    self* pthis = static_cast<self*>(arg);
+
+    std::vector<request_ptr> batch;
+    std::vector<serving_request*> batch_reqs;
+
+    for ( ; ; )
+    {
+        pthis->m_sem--;
+
+        {
+            scoped_mutex_lock Lock(pthis->m_mutex);
+
+            request_ptr req;
+            while (!pthis->empty() && !(req = pthis->pop(timestamp())).valid())
+            {
+                // wait for the conflicting request in flight
+                pthis->m_in_flight_cond.wait(Lock);
+            }
+
+            if (req.valid())
+            {
+                batch.push_back(req);
+                pthis->coalesce(batch);
+                pthis->m_in_flight.insert(pthis->m_in_flight.end(),
+                                          batch.begin(), batch.end());
+
+                Lock.unlock();
+
+                if (batch.size() == 1)
+                {
+                    dynamic_cast<serving_request*>(batch[0].get())->serve();
+                }
+                else
+                {
+                    for (size_t i = 0; i < batch.size(); ++i)
+                        batch_reqs.push_back(dynamic_cast<serving_request*>(batch[i].get()));
+
+                    serving_request::serve_coalesced(&batch_reqs[0], batch_reqs.size());
+                    batch_reqs.clear();
+                }
+
+                {
+                    scoped_mutex_lock InFlightLock(pthis->m_mutex);
+                    for (size_t i = 0; i < batch.size(); ++i)
+                    {
+                        pthis->m_in_flight.erase(
+                            std::find(pthis->m_in_flight.begin(),
+                                      pthis->m_in_flight.end(), batch[i]));
+                    }
+                }
+                pthis->m_in_flight_cond.notify_all();
+                batch.clear();
+            }
+            else
+            {
+                Lock.unlock();
+
+                pthis->m_sem++;
+            }
+        }
+
+        // terminate if it has been requested and queues are empty, the wake
+        // up is left for the other workers, which may find the state
+        // TERMINATED already
+        if (pthis->m_thread_state() != RUNNING) {
+            scoped_mutex_lock Lock(pthis->m_mutex);
+            if (pthis->empty())
+                break;
+        }
+    }
+
+    pthis->m_thread_state.set_to(TERMINATED);
+
+#if STXXL_STD_THREADS && STXXL_MSVC >= 1700
+    // Workaround for deadlock bug in Visual C++ Runtime 2012 and 2013, see
+    // request_queue_impl_worker.cpp. -tb
+    ExitThread(NULL);
+#else
+    return NULL;
+#endif
+}
+
+STXXL_END_NAMESPACE
+// vim: et:ts=4:sw=4
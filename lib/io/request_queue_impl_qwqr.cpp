@@ -46,7 +46,7 @@ request_queue_impl_qwqr::request_queue_impl_qwqr(int n)
     : m_thread_state(NOT_RUNNING), m_sem(0)
 {
     STXXL_UNUSED(n);
-    start_thread(worker, static_cast<void*>(this), m_thread, m_thread_state);
+    start_threads(worker, static_cast<void*>(this), m_threads, 1, m_thread_state);
 }
 
 void request_queue_impl_qwqr::add_request(request_ptr& req)
@@ -94,6 +94,77 @@ void request_queue_impl_qwqr::add_request(request_ptr& req)
     m_sem++;
 }
 
+void request_queue_impl_qwqr::add_requests(request_ptr* reqs, size_t n)
+{
+    if (m_thread_state() != RUNNING)
+        STXXL_THROW_INVALID_ARGUMENT("Request submitted to not running queue.");
+
+    size_t num_reads = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (reqs[i].empty())
+            STXXL_THROW_INVALID_ARGUMENT("Empty request submitted to disk_queue.");
+        if (!dynamic_cast<serving_request*>(reqs[i].get()))
+            STXXL_ERRMSG("Incompatible request submitted to running queue.");
+        if (reqs[i]->get_type() == request::READ)
+            ++num_reads;
+    }
+
+    if (num_reads > 0)
+    {
+#if STXXL_CHECK_FOR_PENDING_REQUESTS_ON_SUBMISSION
+        {
+            scoped_mutex_lock Lock(m_write_mutex);
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (reqs[i]->get_type() != request::READ)
+                    continue;
+                if (std::find_if(m_write_queue.begin(), m_write_queue.end(),
+                                 bind2nd(file_offset_match(), reqs[i]) _STXXL_FORCE_SEQUENTIAL)
+                    != m_write_queue.end())
+                {
+                    STXXL_ERRMSG("READ request submitted for a BID with a pending WRITE request");
+                }
+            }
+        }
+#endif
+        scoped_mutex_lock Lock(m_read_mutex);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (reqs[i]->get_type() == request::READ)
+                m_read_queue.push_back(reqs[i]);
+        }
+    }
+
+    if (num_reads < n)
+    {
+#if STXXL_CHECK_FOR_PENDING_REQUESTS_ON_SUBMISSION
+        {
+            scoped_mutex_lock Lock(m_read_mutex);
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (reqs[i]->get_type() == request::READ)
+                    continue;
+                if (std::find_if(m_read_queue.begin(), m_read_queue.end(),
+                                 bind2nd(file_offset_match(), reqs[i]) _STXXL_FORCE_SEQUENTIAL)
+                    != m_read_queue.end())
+                {
+                    STXXL_ERRMSG("WRITE request submitted for a BID with a pending READ request");
+                }
+            }
+        }
+#endif
+        scoped_mutex_lock Lock(m_write_mutex);
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (reqs[i]->get_type() != request::READ)
+                m_write_queue.push_back(reqs[i]);
+        }
+    }
+
+    m_sem.signal((int)n);
+}
+
 bool request_queue_impl_qwqr::cancel_request(request_ptr& req)
 {
     if (req.empty())
@@ -114,7 +185,8 @@ bool request_queue_impl_qwqr::cancel_request(request_ptr& req)
         {
             m_read_queue.erase(pos);
             was_still_in_queue = true;
-            m_sem--;
+            // a worker may hold the wake up already, do not block
+            m_sem.decrement();
         }
     }
     else
@@ -127,7 +199,7 @@ bool request_queue_impl_qwqr::cancel_request(request_ptr& req)
         {
             m_write_queue.erase(pos);
             was_still_in_queue = true;
-            m_sem--;
+            m_sem.decrement();
         }
     }
 
@@ -136,7 +208,18 @@ bool request_queue_impl_qwqr::cancel_request(request_ptr& req)
 
 request_queue_impl_qwqr::~request_queue_impl_qwqr()
 {
-    stop_thread(m_thread, m_thread_state, m_sem);
+    stop_threads(m_threads, m_thread_state, m_sem);
+}
+
+bool request_queue_impl_qwqr::empty()
+{
+    {
+        scoped_mutex_lock ReadLock(m_read_mutex);
+        if (!m_read_queue.empty())
+            return false;
+    }
+    scoped_mutex_lock WriteLock(m_write_mutex);
+    return m_write_queue.empty();
 }
 
 void* request_queue_impl_qwqr::worker(void* arg)
@@ -204,13 +287,11 @@ void* request_queue_impl_qwqr::worker(void* arg)
                 write_phase = true;
         }
 
-        // terminate if it has been requested and queues are empty
-        if (pthis->m_thread_state() == TERMINATING) {
-            if ((pthis->m_sem--) == 0)
-                break;
-            else
-                pthis->m_sem++;
-        }
+        // terminate if it has been requested and queues are empty, the wake
+        // up is left for the other workers, which may find the state
+        // TERMINATED already
+        if (pthis->m_thread_state() != RUNNING && pthis->empty())
+            break;
     }
 
     pthis->m_thread_state.set_to(TERMINATED);
@@ -32,9 +32,8 @@
 
 STXXL_BEGIN_NAMESPACE
 
-void request_queue_impl_worker::start_thread(void* (*worker)(void*), void* arg, thread_type& t, state<thread_state>& s)
+void request_queue_impl_worker::create_thread(void* (*worker)(void*), void* arg, thread_type& t)
 {
-    assert(s() == NOT_RUNNING);
 #if STXXL_STD_THREADS
     t = new std::thread(worker, arg);
 #elif STXXL_BOOST_THREADS
@@ -42,14 +41,10 @@ void request_queue_impl_worker::start_thread(void* (*worker)(void*), void* arg,
 #else
     STXXL_CHECK_PTHREAD_CALL(pthread_create(&t, NULL, worker, arg));
 #endif
-    s.set_to(RUNNING);
 }
 
-void request_queue_impl_worker::stop_thread(thread_type& t, state<thread_state>& s, semaphore& sem)
+void request_queue_impl_worker::join_thread(thread_type& t)
 {
-    assert(s() == RUNNING);
-    s.set_to(TERMINATING);
-    sem++;
 #if STXXL_STD_THREADS
 #if STXXL_MSVC >= 1700
     // In the Visual C++ Runtime 2012 and 2013, there is a deadlock bug, which
@@ -76,6 +71,44 @@ void request_queue_impl_worker::stop_thread(thread_type& t, state<thread_state>&
 #else
     STXXL_CHECK_PTHREAD_CALL(pthread_join(t, NULL));
 #endif
+}
+
+void request_queue_impl_worker::start_thread(void* (*worker)(void*), void* arg, thread_type& t, state<thread_state>& s)
+{
+    assert(s() == NOT_RUNNING);
+    create_thread(worker, arg, t);
+    s.set_to(RUNNING);
+}
+
+void request_queue_impl_worker::stop_thread(thread_type& t, state<thread_state>& s, semaphore& sem)
+{
+    assert(s() == RUNNING);
+    s.set_to(TERMINATING);
+    sem++;
+    join_thread(t);
+    assert(s() == TERMINATED);
+    s.set_to(NOT_RUNNING);
+}
+
+void request_queue_impl_worker::start_threads(void* (*worker)(void*), void* arg, std::vector<thread_type>& t, int n, state<thread_state>& s)
+{
+    assert(s() == NOT_RUNNING);
+    assert(n >= 1);
+    t.resize(n);
+    for (int i = 0; i < n; ++i)
+        create_thread(worker, arg, t[i]);
+    s.set_to(RUNNING);
+}
+
+void request_queue_impl_worker::stop_threads(std::vector<thread_type>& t, state<thread_state>& s, semaphore& sem)
+{
+    assert(s() == RUNNING);
+    s.set_to(TERMINATING);
+    // one wake up is passed on from worker to worker
+    sem++;
+    for (size_t i = 0; i < t.size(); ++i)
+        join_thread(t[i]);
+    t.clear();
     assert(s() == TERMINATED);
     s.set_to(NOT_RUNNING);
 }
@@ -44,6 +44,10 @@ void request_with_state::wait(bool measure_time)
 
     stats::scoped_wait_timer wait_timer(m_type == READ ? stats::WAIT_OP_READ : stats::WAIT_OP_WRITE, measure_time);
 
+    // somebody is blocked on us now, let the queue serve us first
+    if (m_state() == OP)
+        raise_priority(DEMAND);
+
     m_state.wait_for(READY2DIE);
 
     check_errors();
@@ -58,6 +62,8 @@ bool request_with_state::cancel()
         request_ptr rp(this);
         if (disk_queues::get_instance()->cancel_request(rp, m_file->get_queue_id()))
         {
+            if (m_time_queued != 0.0)
+                stats::get_instance()->request_finished(*this, true);
             m_state.set_to(DONE);
             notify_waiters();
             m_file->delete_request_ref();
@@ -69,6 +75,18 @@ bool request_with_state::cancel()
     return false;
 }
 
+bool request_with_state::raise_priority(priority_type prio)
+{
+    // the queue compares with the current priority under its lock
+    file* f = m_file;
+    if (f)
+    {
+        request_ptr rp(this);
+        return disk_queues::get_instance()->raise_priority(rp, prio, f->get_queue_id());
+    }
+    return false;
+}
+
 bool request_with_state::poll()
 {
     const request_state s = m_state();
@@ -81,6 +99,8 @@ bool request_with_state::poll()
 void request_with_state::completed(bool canceled)
 {
     STXXL_VERBOSE3_THIS("request_with_state::completed()");
+    if (m_time_queued != 0.0)
+        stats::get_instance()->request_finished(*this, canceled);
     m_state.set_to(DONE);
     if (!canceled)
         m_on_complete(this);
@@ -12,8 +12,11 @@
  **************************************************************************/
 
 #include <stxxl/bits/common/exceptions.h>
+#include <stxxl/bits/common/simple_vector.h>
 #include <stxxl/bits/common/state.h>
+#include <stxxl/bits/common/timer.h>
 #include <stxxl/bits/io/file.h>
+#include <stxxl/bits/io/iostats.h>
 #include <stxxl/bits/io/request_interface.h>
 #include <stxxl/bits/io/request_with_state.h>
 #include <stxxl/bits/io/serving_request.h>
@@ -52,6 +55,14 @@ void serving_request::serve()
         m_offset << "/0x" << m_bytes <<
         ((m_type == request::READ) ? " READ" : " WRITE"));
 
+    file_stats& fs = m_file->get_file_stats();
+    if (m_type == READ)
+        fs.read_started(m_bytes);
+    else
+        fs.write_started(m_bytes);
+
+    const double begin = (m_time_queued != 0.0) ? timestamp() : 0.0;
+
     try
     {
         m_file->serve(m_buffer, m_offset, m_bytes, m_type);
@@ -61,11 +72,71 @@ void serving_request::serve()
         error_occured(ex.what());
     }
 
+    fs.io_finished();
+    if (begin != 0.0)
+        stats::get_instance()->request_served(*this, timestamp() - begin);
+
     check_nref(true);
 
     completed(false);
 }
 
+void serving_request::serve_coalesced(serving_request* const* reqs, size_t n)
+{
+    simple_vector<void*> buffers(n);
+    simple_vector<size_type> sizes(n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        reqs[i]->check_nref();
+        assert(reqs[i]->m_file == reqs[0]->m_file);
+        assert(reqs[i]->m_type == reqs[0]->m_type);
+        assert(i == 0 || reqs[i]->m_offset == reqs[i - 1]->m_offset + reqs[i - 1]->m_bytes);
+        buffers[i] = reqs[i]->m_buffer;
+        sizes[i] = reqs[i]->m_bytes;
+    }
+
+    STXXL_VERBOSE2("serving_request::serve_coalesced(): " << n <<
+                   " requests @ [" << reqs[0]->m_file << "]0x" <<
+                   std::hex << reqs[0]->m_offset <<
+                   ((reqs[0]->m_type == request::READ) ? " READ" : " WRITE"));
+
+    file_stats& fs = reqs[0]->m_file->get_file_stats();
+    double now = timestamp();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (reqs[i]->m_type == READ)
+            fs.read_started(sizes[i], now);
+        else
+            fs.write_started(sizes[i], now);
+    }
+
+    try
+    {
+        reqs[0]->m_file->serve_vectored(buffers.begin(), sizes.begin(), n,
+                                        reqs[0]->m_offset, reqs[0]->m_type);
+    }
+    catch (const io_error& ex)
+    {
+        for (size_t i = 0; i < n; ++i)
+            reqs[i]->error_occured(ex.what());
+    }
+
+    for (size_t i = 0; i < n; ++i)
+        fs.io_finished();
+
+    // all requests were served by the one vectored call
+    const double service_time = timestamp() - now;
+    for (size_t i = 0; i < n; ++i)
+        stats::get_instance()->request_served(*reqs[i], service_time);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        reqs[i]->check_nref(true);
+        reqs[i]->completed(false);
+    }
+}
+
 const char* serving_request::io_type() const
 {
     return m_file->io_type();
@@ -13,6 +13,7 @@
  **************************************************************************/
 
 #include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/simple_vector.h>
 #include <stxxl/bits/common/mutex.h>
 #include <stxxl/bits/config.h>
 #include <stxxl/bits/io/iostats.h>
@@ -21,12 +22,31 @@
 #include <stxxl/bits/io/syscall_file.h>
 #include "ufs_platform.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#if STXXL_HAVE_PREADV
+ #include <sys/uio.h>
+#endif
+
 STXXL_BEGIN_NAMESPACE
 
+#if STXXL_HAVE_PREAD
+static const char* const read_call = "::pread(fd,buffer,bytes,offset)";
+static const char* const write_call = "::pwrite(fd,buffer,bytes,offset)";
+#else
+static const char* const read_call = "::read(fd,buffer,bytes)";
+static const char* const write_call = "::write(fd,buffer,bytes)";
+#endif
+
 void syscall_file::serve(void* buffer, offset_type offset, size_type bytes,
                          request::request_type type)
 {
+#if !STXXL_HAVE_PREAD
+    // lseek() and read()/write() must not be interleaved with other requests
     scoped_mutex_lock fd_lock(fd_mutex);
+#endif
 
     char* cbuffer = static_cast<char*>(buffer);
 
@@ -34,7 +54,9 @@ void syscall_file::serve(void* buffer, offset_type offset, size_type bytes,
 
     while (bytes > 0)
     {
-        off_t rc = ::lseek(file_des, offset, SEEK_SET);
+        off_t rc;
+#if !STXXL_HAVE_PREAD
+        rc = ::lseek(file_des, offset, SEEK_SET);
         if (rc < 0)
         {
             STXXL_THROW_ERRNO
@@ -49,10 +71,13 @@ void syscall_file::serve(void* buffer, offset_type offset, size_type bytes,
                 " type=" << ((type == request::READ) ? "READ" : "WRITE") <<
                 " rc=" << rc);
         }
+#endif
 
         if (type == request::READ)
         {
-#if STXXL_MSVC
+#if STXXL_HAVE_PREAD
+            if ((rc = ::pread(file_des, cbuffer, bytes, offset)) <= 0)
+#elif STXXL_MSVC
             assert(bytes <= std::numeric_limits<unsigned int>::max());
             if ((rc = ::read(file_des, cbuffer, (unsigned int)bytes)) <= 0)
 #else
@@ -62,7 +87,7 @@ void syscall_file::serve(void* buffer, offset_type offset, size_type bytes,
                 STXXL_THROW_ERRNO
                     (io_error,
                     " this=" << this <<
-                    " call=::read(fd,buffer,bytes)" <<
+                    " call=" << read_call <<
                     " path=" << filename <<
                     " fd=" << file_des <<
                     " offset=" << offset <<
@@ -75,7 +100,11 @@ void syscall_file::serve(void* buffer, offset_type offset, size_type bytes,
             offset += rc;
             cbuffer += rc;
 
+#if STXXL_HAVE_PREAD
+            if (bytes > 0 && offset == size())
+#else
             if (bytes > 0 && offset == this->_size())
+#endif
             {
                 // read request extends past end-of-file
                 // fill reminder with zeroes
@@ -85,7 +114,9 @@ void syscall_file::serve(void* buffer, offset_type offset, size_type bytes,
         }
         else
         {
-#if STXXL_MSVC
+#if STXXL_HAVE_PREAD
+            if ((rc = ::pwrite(file_des, cbuffer, bytes, offset)) <= 0)
+#elif STXXL_MSVC
             assert(bytes <= std::numeric_limits<unsigned int>::max());
             if ((rc = ::write(file_des, cbuffer, (unsigned int)bytes)) <= 0)
 #else
@@ -95,7 +126,7 @@ void syscall_file::serve(void* buffer, offset_type offset, size_type bytes,
                 STXXL_THROW_ERRNO
                     (io_error,
                     " this=" << this <<
-                    " call=::write(fd,buffer,bytes)" <<
+                    " call=" << write_call <<
                     " path=" << filename <<
                     " fd=" << file_des <<
                     " offset=" << offset <<
@@ -111,6 +142,75 @@ void syscall_file::serve(void* buffer, offset_type offset, size_type bytes,
     }
 }
 
+#if STXXL_HAVE_PREADV
+void syscall_file::serve_vectored(void* const* buffers, const size_type* sizes,
+                                  size_t n, offset_type offset,
+                                  request::request_type type)
+{
+    // positional I/O, concurrent requests need not be serialized
+
+    simple_vector<struct iovec> iov(n);
+    size_type bytes = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        iov[i].iov_base = buffers[i];
+        iov[i].iov_len = sizes[i];
+        bytes += sizes[i];
+    }
+
+    stats::scoped_read_write_timer read_write_timer(bytes, type == request::WRITE);
+
+    struct iovec* cur = iov.begin();
+    size_t left = n;
+
+    while (left > 0)
+    {
+        int cnt = (int)std::min<size_t>(left, IOV_MAX);
+        ssize_t rc = (type == request::READ)
+                     ? ::preadv(file_des, cur, cnt, offset)
+                     : ::pwritev(file_des, cur, cnt, offset);
+        if (rc <= 0)
+        {
+            STXXL_THROW_ERRNO
+                (io_error,
+                " this=" << this <<
+                " call=" << ((type == request::READ) ? "::preadv" : "::pwritev") <<
+                "(fd,iov,cnt,offset)" <<
+                " path=" << filename <<
+                " fd=" << file_des <<
+                " offset=" << offset <<
+                " cnt=" << cnt <<
+                " bytes=" << bytes <<
+                " type=" << ((type == request::READ) ? "READ" : "WRITE") <<
+                " rc=" << rc);
+        }
+        bytes = (size_type)(bytes - rc);
+        offset += rc;
+
+        // skip completely transferred buffers, shorten partial one
+        while (left > 0 && (size_t)rc >= cur->iov_len)
+        {
+            rc -= cur->iov_len;
+            ++cur;
+            --left;
+        }
+        if (left > 0)
+        {
+            cur->iov_base = static_cast<char*>(cur->iov_base) + rc;
+            cur->iov_len -= rc;
+        }
+
+        if (type == request::READ && bytes > 0 && offset == size())
+        {
+            // read request extends past end-of-file
+            // fill reminder with zeroes
+            for ( ; left > 0; ++cur, --left)
+                memset(cur->iov_base, 0, cur->iov_len);
+        }
+    }
+}
+#endif // STXXL_HAVE_PREADV
+
 const char* syscall_file::io_type() const
 {
     return "syscall";
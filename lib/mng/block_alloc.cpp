@@ -0,0 +1,175 @@
+/***************************************************************************
+ *  lib/mng/block_alloc.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/bits/common/error_handling.h>
+#include <stxxl/bits/common/rand.h>
+#include <stxxl/bits/io/iostats.h>
+#include <stxxl/bits/mng/block_alloc.h>
+#include <stxxl/bits/mng/block_manager.h>
+#include <stxxl/bits/mng/config.h>
+#include <stxxl/bits/namespace.h>
+#include <stxxl/bits/verbose.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+STXXL_BEGIN_NAMESPACE
+
+void load_balancing::update_weights() const
+{
+    // number of entries in seq per disk, the smallest weight a disk can
+    // receive is 1/period_factor of the average weight.
+    static const unsigned_type period_factor = 64;
+
+    config* cfg = config::get_instance();
+    block_manager* bm = block_manager::get_instance();
+
+    std::vector<double> speed(diff, 0.0), space(diff, 0.0);
+    std::vector<bool> grows(diff, false);
+    double total_speed = 0.0, max_space = 0.0;
+    unsigned_type measured = 0;
+
+    for (unsigned_type d = 0; d < diff; ++d)
+    {
+        // disks outside the configured range are treated as unknown
+        if (begin + d >= cfg->disks_number())
+            continue;
+
+        speed[d] = bm->get_file_stats(begin + d).get_throughput();
+        space[d] = (double)bm->get_free_bytes(begin + d);
+        grows[d] = cfg->disk(begin + d).autogrow;
+
+        if (speed[d] > 0.0) {
+            total_speed += speed[d];
+            ++measured;
+        }
+        max_space = std::max(max_space, space[d]);
+    }
+
+    std::vector<double> weight(diff);
+    double total_weight = 0.0;
+
+    for (unsigned_type d = 0; d < diff; ++d)
+    {
+        if (speed[d] <= 0.0)
+            speed[d] = measured ? total_speed / double(measured) : 1.0;
+        if (grows[d] || begin + d >= cfg->disks_number() || max_space <= 0.0)
+            space[d] = std::max(space[d], max_space);
+
+        weight[d] = speed[d] * space[d];
+        total_weight += weight[d];
+    }
+
+    // no disk has any free space, they will have to grow anyway
+    if (total_weight <= 0.0) {
+        std::fill(weight.begin(), weight.end(), 1.0);
+        total_weight = double(diff);
+    }
+
+    // smooth weighted round-robin: spreads the blocks of each disk evenly
+    // over the sequence instead of placing them consecutively.
+    seq.resize(period_factor * diff);
+    std::vector<double> current(diff, 0.0);
+    for (unsigned_type i = 0; i < seq.size(); ++i)
+    {
+        unsigned_type best = 0;
+        for (unsigned_type d = 0; d < diff; ++d)
+        {
+            current[d] += weight[d];
+            if (current[d] > current[best])
+                best = d;
+        }
+        current[best] -= total_weight;
+        seq[i] = best;
+    }
+
+    STXXL_VERBOSE1("load_balancing: disks [" << begin << "," << begin + diff <<
+                   "), " << measured << " with throughput measurements");
+}
+
+void load_balancing::refresh()
+{
+    update_weights();
+    assigned = 0;
+
+    typedef random_number<random_uniform_fast> rnd_type;
+    rnd_type rnd;
+    offset = rnd(rnd_type::value_type(seq.size()));
+}
+
+namespace {
+
+template <class Strategy>
+basic_dynamic_alloc_strategy * make_dynamic(const Strategy& s)
+{
+    return new dynamic_alloc_strategy_impl<Strategy>(s);
+}
+
+} // namespace
+
+bool dynamic_alloc_strategy::is_valid_name(const std::string& name)
+{
+    return name == "striping" || name == "FR" || name == "SR" ||
+           name == "RC" || name == "RC_disk" || name == "RC_flash" ||
+           name == "load_balancing" || name == "single_disk";
+}
+
+basic_dynamic_alloc_strategy*
+dynamic_alloc_strategy::create(const std::string& name)
+{
+    if (name == "striping")
+        return make_dynamic(striping());
+    else if (name == "FR")
+        return make_dynamic(FR());
+    else if (name == "SR")
+        return make_dynamic(SR());
+    else if (name == "RC")
+        return make_dynamic(RC());
+    else if (name == "RC_disk")
+        return make_dynamic(RC_disk());
+    else if (name == "RC_flash")
+        return make_dynamic(RC_flash());
+    else if (name == "load_balancing")
+        return make_dynamic(load_balancing());
+    else if (name == "single_disk")
+        return make_dynamic(single_disk());
+
+    STXXL_THROW(std::runtime_error,
+                "Unknown allocation strategy '" << name << "'.");
+}
+
+basic_dynamic_alloc_strategy*
+dynamic_alloc_strategy::create(const std::string& name,
+                               unsigned_type b, unsigned_type e)
+{
+    if (name == "striping")
+        return make_dynamic(striping(b, e));
+    else if (name == "FR")
+        return make_dynamic(FR(b, e));
+    else if (name == "SR")
+        return make_dynamic(SR(b, e));
+    else if (name == "RC")
+        return make_dynamic(RC(b, e));
+    else if (name == "RC_disk")
+        return make_dynamic(RC_disk(b, e));
+    else if (name == "RC_flash")
+        return make_dynamic(RC_flash(b, e));
+    else if (name == "load_balancing")
+        return make_dynamic(load_balancing(b, e));
+    else if (name == "single_disk")
+        return make_dynamic(single_disk(b, e));
+
+    STXXL_THROW(std::runtime_error,
+                "Unknown allocation strategy '" << name << "'.");
+}
+
+STXXL_END_NAMESPACE
+// vim: et:ts=4:sw=4
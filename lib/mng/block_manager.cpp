@@ -21,14 +21,33 @@
 #include <stxxl/bits/namespace.h>
 #include <stxxl/bits/verbose.h>
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>
+#include <functional>
 #include <fstream>
 #include <string>
+#include <vector>
 
 STXXL_BEGIN_NAMESPACE
 
 class io_error;
 
+namespace {
+
+//! orders request indexes by their target file
+struct file_order
+{
+    file* const* files;
+    explicit file_order(file* const* f) : files(f) { }
+    bool operator () (size_t a, size_t b) const
+    {
+        return std::less<file*>()(files[a], files[b]);
+    }
+};
+
+} // namespace
+
 block_manager::block_manager()
 {
     config* config = config::get_instance();
@@ -119,5 +138,79 @@ uint64 block_manager::get_free_bytes() const
     return total;
 }
 
+uint64 block_manager::get_free_bytes(size_t disk) const
+{
+    assert(disk < ndisks);
+    return disk_allocators[disk]->get_free_bytes();
+}
+
+const file_stats& block_manager::get_file_stats(size_t disk) const
+{
+    assert(disk < ndisks);
+    return disk_files[disk]->get_file_stats();
+}
+
+void block_manager::aio_batch(
+    request::request_type type,
+    file* const* files,
+    void* const* buffers,
+    const file::offset_type* offsets,
+    file::size_type bytes,
+    size_t n,
+    request_ptr* reqs,
+    const completion_handler& on_cmpl)
+{
+    // common case: all requests go to the same file
+    size_t i = 1;
+    while (i < n && files[i] == files[0])
+        ++i;
+
+    if (i >= n)
+    {
+        if (n == 0)
+            return;
+        if (type == request::READ)
+            files[0]->aread_batch(buffers, offsets, bytes, n, reqs, on_cmpl);
+        else
+            files[0]->awrite_batch(buffers, offsets, bytes, n, reqs, on_cmpl);
+        return;
+    }
+
+    // group requests by file, keeping their relative order
+    std::vector<size_t> order(n);
+    for (i = 0; i < n; ++i)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), file_order(files));
+
+    std::vector<void*> group_buffers;
+    std::vector<file::offset_type> group_offsets;
+    std::vector<request_ptr> group_reqs;
+
+    for (size_t begin = 0, end; begin < n; begin = end)
+    {
+        file* f = files[order[begin]];
+
+        group_buffers.clear();
+        group_offsets.clear();
+        for (end = begin; end < n && files[order[end]] == f; ++end)
+        {
+            group_buffers.push_back(buffers[order[end]]);
+            group_offsets.push_back(offsets[order[end]]);
+        }
+        group_reqs.resize(end - begin);
+
+        if (type == request::READ)
+            f->aread_batch(&group_buffers[0], &group_offsets[0], bytes,
+                           end - begin, &group_reqs[0], on_cmpl);
+        else
+            f->awrite_batch(&group_buffers[0], &group_offsets[0], bytes,
+                            end - begin, &group_reqs[0], on_cmpl);
+
+        for (i = begin; i < end; ++i)
+            reqs[order[i]] = group_reqs[i - begin];
+    }
+}
+
 STXXL_END_NAMESPACE
 // vim: et:ts=4:sw=4
@@ -17,6 +17,8 @@
 #include <stxxl/bits/common/error_handling.h>
 #include <stxxl/bits/config.h>
 #include <stxxl/bits/io/file.h>
+#include <stxxl/bits/io/request_queue.h>
+#include <stxxl/bits/mng/block_alloc.h>
 #include <stxxl/bits/mng/config.h>
 #include <stxxl/bits/common/utils.h>
 #include <stxxl/version.h>
@@ -154,6 +156,12 @@ void config::load_config_file(const std::string& config_path)
         // skip comments
         if (line.size() == 0 || line[0] == '#') continue;
 
+        // allocation strategy of dynamic_alloc_strategy
+        if (line.compare(0, 6, "alloc=") == 0) {
+            set_alloc_strategy(line.substr(6));
+            continue;
+        }
+
         disk_config entry;
         entry.parse_line(line); // throws on errors
 
@@ -174,6 +182,16 @@ void config::load_config_file(const std::string& config_path)
     }
 }
 
+config& config::set_alloc_strategy(const std::string& name)
+{
+    if (!dynamic_alloc_strategy::is_valid_name(name))
+        STXXL_THROW(std::runtime_error,
+                    "Unknown allocation strategy '" << name << "'.");
+
+    m_alloc_strategy = name;
+    return *this;
+}
+
 //! Returns automatic physical device id counter
 unsigned int config::get_max_device_id()
 {
@@ -220,7 +238,8 @@ disk_config::disk_config()
       device_id(file::DEFAULT_DEVICE_ID),
       raw_device(false),
       unlink_on_open(false),
-      queue_length(0)
+      queue_length(0),
+      compress(false)
 { }
 
 disk_config::disk_config(const std::string& _path, uint64 _size,
@@ -236,7 +255,8 @@ disk_config::disk_config(const std::string& _path, uint64 _size,
       device_id(file::DEFAULT_DEVICE_ID),
       raw_device(false),
       unlink_on_open(false),
-      queue_length(0)
+      queue_length(0),
+      compress(false)
 {
     parse_fileio();
 }
@@ -251,7 +271,8 @@ disk_config::disk_config(const std::string& line)
       device_id(file::DEFAULT_DEVICE_ID),
       raw_device(false),
       unlink_on_open(false),
-      queue_length(0)
+      queue_length(0),
+      compress(false)
 {
     parse_line(line);
 }
@@ -281,6 +302,7 @@ void disk_config::parse_line(const std::string& line)
     queue = file::DEFAULT_QUEUE;
     device_id = file::DEFAULT_DEVICE_ID;
     unlink_on_open = false;
+    compress = false;
 
     // *** Save Basic Options ***
 
@@ -364,6 +386,17 @@ void disk_config::parse_fileio()
                             "Invalid parameter '" << *p << "' in disk configuration file.");
             }
         }
+        else if (*p == "compress")
+        {
+            if (!(io_impl == "syscall" || io_impl == "mmap" ||
+                  io_impl == "memory" || io_impl == "boostfd" ||
+                  io_impl == "wincall"))
+            {
+                STXXL_THROW(std::runtime_error, "Parameter '" << *p << "' invalid for fileio '" << io_impl << "' in disk configuration file.");
+            }
+
+            compress = true;
+        }
         else if (*p == "delete" || *p == "delete_on_exit")
         {
             delete_on_exit = true;
@@ -401,18 +434,20 @@ void disk_config::parse_fileio()
         }
         else if (eq[0] == "queue_length")
         {
-            if (io_impl != "linuxaio") {
-                STXXL_THROW(std::runtime_error, "Parameter '" << *p << "' "
-                            "is only valid for fileio linuxaio "
-                            "in disk configuration file.");
-            }
-
             char* endp;
             queue_length = (int)strtoul(eq[1].c_str(), &endp, 10);
             if (endp && *endp != 0) {
                 STXXL_THROW(std::runtime_error,
                             "Invalid parameter '" << *p << "' in disk configuration file.");
             }
+#if !STXXL_PRIORITY_REQUEST_QUEUE
+            // request_queue_impl_qwqr serves synchronous fileio by one thread
+            if (queue_length > 1 &&
+                io_impl != "linuxaio" && io_impl != "io_uring")
+            {
+                STXXL_THROW(std::runtime_error, "Parameter '" << *p << "' invalid for fileio '" << io_impl << "' with request_queue_impl_qwqr in disk configuration file.");
+            }
+#endif
         }
         else if (eq[0] == "device_id" || eq[0] == "devid")
         {
@@ -425,7 +460,7 @@ void disk_config::parse_fileio()
         }
         else if (*p == "raw_device")
         {
-            if (!(io_impl == "syscall")) {
+            if (!(io_impl == "syscall" || io_impl == "io_uring")) {
                 STXXL_THROW(std::runtime_error, "Parameter '" << *p << "' invalid for fileio '" << io_impl << "' in disk configuration file.");
             }
 
@@ -434,7 +469,8 @@ void disk_config::parse_fileio()
         else if (*p == "unlink" || *p == "unlink_on_open")
         {
             if (!(io_impl == "syscall" || io_impl == "linuxaio" ||
-                  io_impl == "mmap" || io_impl == "wbtl"))
+                  io_impl == "io_uring" || io_impl == "mmap" ||
+                  io_impl == "wbtl"))
             {
                 STXXL_THROW(std::runtime_error, "Parameter '" << *p << "' invalid for fileio '" << io_impl << "' in disk configuration file.");
             }
@@ -458,6 +494,9 @@ std::string disk_config::fileio_string() const
     if (!autogrow)
         oss << " autogrow=no";
 
+    if (compress)
+        oss << " compress";
+
     if (delete_on_exit)
         oss << " delete_on_exit";
 
@@ -474,7 +513,8 @@ std::string disk_config::fileio_string() const
     if (flash)
         oss << " flash";
 
-    if (queue != file::DEFAULT_QUEUE && queue != file::DEFAULT_LINUXAIO_QUEUE)
+    if (queue != file::DEFAULT_QUEUE && queue != file::DEFAULT_LINUXAIO_QUEUE &&
+        queue != file::DEFAULT_IOURING_QUEUE)
         oss << " queue=" << queue;
 
     if (device_id != file::DEFAULT_DEVICE_ID)
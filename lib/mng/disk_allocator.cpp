@@ -102,7 +102,7 @@ void disk_allocator::add_free_region(stxxl::int64 block_pos, stxxl::int64 block_
                 // coalesce with predecessor
                 region_size += (*pred).second;
                 region_pos = (*pred).first;
-                free_space.erase(pred);
+                erase_free(pred);
             }
         }
         else
@@ -121,7 +121,7 @@ void disk_allocator::add_free_region(stxxl::int64 block_pos, stxxl::int64 block_
                 {
                     // coalesce with successor
                     region_size += (*succ).second;
-                    free_space.erase(succ);
+                    erase_free(succ);
                     //-tb: set succ to pred afterwards due to iterator invalidation
                     succ = pred;
                 }
@@ -137,7 +137,7 @@ void disk_allocator::add_free_region(stxxl::int64 block_pos, stxxl::int64 block_
                         // coalesce with predecessor
                         region_size += (*pred).second;
                         region_pos = (*pred).first;
-                        free_space.erase(pred);
+                        erase_free(pred);
                     }
                 }
             }
@@ -147,13 +147,13 @@ void disk_allocator::add_free_region(stxxl::int64 block_pos, stxxl::int64 block_
                 {
                     // coalesce with successor
                     region_size += (*succ).second;
-                    free_space.erase(succ);
+                    erase_free(succ);
                 }
             }
         }
     }
 
-    free_space[region_pos] = region_size;
+    insert_free(region_pos, region_size);
     free_bytes += block_size;
 
     //dump();
@@ -80,44 +80,63 @@ int main()
 #if STXXL_PARALLEL_MULTIWAY_MERGE
     STXXL_MSG("STXXL_PARALLEL_MULTIWAY_MERGE");
 #endif
+    // the run formation decides on the number of bytes the keys differ in
+    STXXL_CHECK(stxxl::prefer_radix_sort_lsd(stxxl::uint64(0xffffffff)));
+    STXXL_CHECK(!stxxl::prefer_radix_sort_lsd(stxxl::uint64(0x7fffffffffffffffULL)));
+    STXXL_CHECK(!stxxl::prefer_radix_sort_lsd(~stxxl::uint64(0)));
+
     unsigned memory_to_use = 32 * 1024 * 1024;
     typedef stxxl::VECTOR_GENERATOR<my_type, 4, 4>::result vector_type;
     const stxxl::int64 n_records = 3 * 32 * stxxl::int64(1024 * 1024) / sizeof(my_type);
     vector_type v(n_records);
 
     stxxl::random_number32 rnd;
-    STXXL_MSG("Filling vector... ");
-    for (vector_type::size_type i = 0; i < v.size(); i++)
-    {
-        v[i].m_key = rnd() + 1;
-        v[i].m_key_copy = v[i].m_key;
-    }
-
-    STXXL_MSG("Checking order...");
-    STXXL_CHECK(!stxxl::is_sorted(v.begin(), v.end()));
-
-    STXXL_MSG("Sorting...");
-    stxxl::ksort(v.begin(), v.end(), get_key(), memory_to_use);
-    //stxxl::ksort(v.begin(),v.end(),memory_to_use);
 
-    STXXL_MSG("Checking order...");
-    STXXL_CHECK(stxxl::is_sorted(v.begin(), v.end()));
-    STXXL_MSG("Checking content...");
-    my_type prev;
-    for (vector_type::size_type i = 0; i < v.size(); i++)
+    // short keys are sorted by least significant digit radix sort in the runs,
+    // 63 bit keys and keys spread over the whole range by most significant
+    // digit classification
+    const char* key_names[] = { "32 bit keys", "63 bit keys", "keys spread over the whole key range" };
+    for (int key_bits = 0; key_bits < 3; ++key_bits)
     {
-        if (v[i].m_key != v[i].m_key_copy)
+        STXXL_MSG("Filling vector... " << key_names[key_bits]);
+        for (vector_type::size_type i = 0; i < v.size(); i++)
         {
-            STXXL_MSG("Bug at position " << i);
-            abort();
+            if (key_bits == 2)
+                v[i].m_key = (stxxl::uint64(rnd()) << 32) | (rnd() | 1);
+            else if (key_bits == 1)
+                v[i].m_key = (stxxl::uint64(rnd() >> 1) << 32) | (rnd() | 1);
+            else
+                v[i].m_key = rnd() + 1;
+            v[i].m_key_copy = v[i].m_key;
         }
-        if (i > 0 && prev.m_key == v[i].m_key)
+
+        STXXL_MSG("Checking order...");
+        STXXL_CHECK(!stxxl::is_sorted(v.begin(), v.end()));
+
+        STXXL_MSG("Sorting...");
+        stxxl::ksort(v.begin(), v.end(), get_key(), memory_to_use);
+        //stxxl::ksort(v.begin(),v.end(),memory_to_use);
+
+        STXXL_MSG("Checking order...");
+        STXXL_CHECK(stxxl::is_sorted(v.begin(), v.end()));
+        STXXL_MSG("Checking content...");
+        my_type prev;
+        for (vector_type::size_type i = 0; i < v.size(); i++)
         {
-            STXXL_MSG("Duplicate at position " << i << " key=" << v[i].m_key);
-            //abort();
+            if (v[i].m_key != v[i].m_key_copy)
+            {
+                STXXL_MSG("Bug at position " << i);
+                abort();
+            }
+            if (i > 0 && prev.m_key == v[i].m_key)
+            {
+                STXXL_MSG("Duplicate at position " << i << " key=" << v[i].m_key);
+                //abort();
+            }
+            prev = v[i];
         }
-        prev = v[i];
     }
+
     STXXL_MSG("OK");
 
     return 0;
@@ -84,6 +84,17 @@ struct cmp : public std::less<my_type>
     }
 };
 
+//! comparator without min_value() and max_value(): the keys may span the
+//! whole key range
+struct plain_cmp : public std::less<my_type>
+{ };
+
+#if __cplusplus >= 201103L
+//! final comparators cannot be derived from to detect their sentinels
+struct final_cmp final : public cmp
+{ };
+#endif
+
 int main()
 {
 #if STXXL_PARALLEL_MULTIWAY_MERGE
@@ -92,6 +103,12 @@ int main()
     unsigned memory_to_use = 128 * 1024 * 1024;
     typedef stxxl::vector<my_type> vector_type;
 
+    STXXL_CHECK(stxxl::sort_helper::has_sentinels<cmp>::value);
+    STXXL_CHECK(!stxxl::sort_helper::has_sentinels<plain_cmp>::value);
+#if __cplusplus >= 201103L
+    STXXL_CHECK(stxxl::sort_helper::has_sentinels<final_cmp>::value);
+#endif
+
     {
         // test small vector that can be sorted internally
         vector_type v(3);
@@ -125,6 +142,82 @@ int main()
 
     STXXL_MSG("Done, output size=" << v.size());
 
+    {
+        // exceptions in the parallel loops of the sort reach the caller
+        stxxl::sort_local::parallel_exception error;
+        int iterations = 0;
+#if STXXL_PARALLEL
+#pragma omp parallel for reduction(+:iterations)
+#endif
+        for (int i = 0; i < 64; ++i)
+        {
+            try
+            {
+                ++iterations;
+                if (i % 16 == 3)
+                    throw stxxl::io_error("injected");
+            }
+            catch (...)
+            {
+                error.capture();
+            }
+        }
+        STXXL_CHECK(iterations == 64);
+
+        bool caught = false;
+        try {
+            error.rethrow();
+        }
+        catch (std::exception& e) {
+            caught = (std::string(e.what()).find("injected") != std::string::npos);
+        }
+        STXXL_CHECK(caught);
+    }
+
+    {
+        // concurrent merges get at least the minimal memory of a merge each
+        for (unsigned runs = 2; runs <= 4096; runs *= 3)
+        {
+            for (unsigned m = 16; m <= 1024; m *= 2)
+            {
+                stxxl::merge_plan plan = stxxl::plan_merge(runs, m, 8, 16, 1.0, 4.0);
+                STXXL_CHECK(plan.merge_factor >= 2 && plan.num_parallel >= 1);
+                if (plan.num_parallel > 1)
+                    STXXL_CHECK(m / plan.num_parallel >= plan.merge_factor + 8);
+            }
+        }
+    }
+
+    {
+        // little memory and small blocks: many runs, several merge passes
+        // with independent merges
+        typedef stxxl::vector<my_type, 4, stxxl::lru_pager<8>, 64* 1024> small_vector_type;
+        small_vector_type w(stxxl::int64(64) * 1024 * 1024 / sizeof(my_type));
+
+        for (unsigned mem = 2; mem <= 4; mem *= 2)
+        {
+            for (small_vector_type::size_type i = 0; i < w.size(); i++)
+                w[i].m_key = 1 + (rnd() % 0xfffffff);
+
+            STXXL_MSG("Sorting " << (w.size() * sizeof(my_type) >> 20) << " MiB using " << mem << " MiB of memory...");
+            stxxl::sort(w.begin(), w.end(), cmp(), mem * 1024 * 1024);
+            STXXL_CHECK(stxxl::is_sorted(w.begin(), w.end(), cmp()));
+        }
+
+        // sentinel-free sort of a range with incomplete first and last
+        // blocks, containing the smallest and largest keys
+        for (small_vector_type::size_type i = 0; i < w.size(); i++)
+            w[i].m_key = rnd();
+        w[w.size() / 2].m_key = std::numeric_limits<my_type::key_type>::min();
+        w[w.size() / 3].m_key = std::numeric_limits<my_type::key_type>::max();
+
+        STXXL_MSG("Sorting " << (w.size() * sizeof(my_type) >> 20) << " MiB without sentinels...");
+        stxxl::sort(w.begin() + 3, w.end() - 5, plain_cmp(), 4 * 1024 * 1024);
+        STXXL_CHECK(stxxl::is_sorted(w.begin() + 3, w.end() - 5, plain_cmp()));
+        STXXL_CHECK(w[3].m_key == std::numeric_limits<my_type::key_type>::min());
+        STXXL_CHECK(w[w.size() - 6].m_key == std::numeric_limits<my_type::key_type>::max());
+    }
+
     return 0;
 }
 
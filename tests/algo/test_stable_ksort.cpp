@@ -23,7 +23,8 @@ struct my_type
     typedef unsigned key_type;
 
     key_type m_key;
-    char m_data[128 - sizeof(key_type)];
+    stxxl::uint64 m_index;
+    char m_data[128 - 2 * sizeof(stxxl::uint64)];
 
     key_type key() const
     {
@@ -48,20 +49,37 @@ bool operator < (const my_type& a, const my_type& b)
     return a.key() < b.key();
 }
 
+typedef stxxl::vector<my_type> vector_type;
+
+// checks that the keys are sorted and equal keys are in input order
+void check_stable(vector_type& v)
+{
+    STXXL_MSG("Checking order...");
+    vector_type::const_iterator it = v.cbegin();
+    my_type prev = *it;
+    for (++it; it != v.cend(); ++it)
+    {
+        STXXL_CHECK(prev.key() < it->key() ||
+                    (prev.key() == it->key() && prev.m_index < it->m_index));
+        prev = *it;
+    }
+}
+
 int main()
 {
 #if STXXL_PARALLEL_MULTIWAY_MERGE
     STXXL_MSG("STXXL_PARALLEL_MULTIWAY_MERGE");
 #endif
     unsigned memory_to_use = 44 * 1024 * 1024;
-    typedef stxxl::vector<my_type> vector_type;
     const stxxl::int64 n_records = 2 * 32 * stxxl::int64(1024 * 1024) / sizeof(my_type);
     vector_type v(n_records);
 
     stxxl::random_number32 rnd;
     STXXL_MSG("Filling vector... " << rnd() << " " << rnd() << " " << rnd());
-    for (vector_type::size_type i = 0; i < v.size(); i++)
+    for (vector_type::size_type i = 0; i < v.size(); i++) {
         v[i].m_key = (rnd() / 2) * 2;
+        v[i].m_index = i;
+    }
 
     STXXL_MSG("Checking order...");
     STXXL_CHECK(!stxxl::is_sorted(v.begin(), v.end()));
@@ -69,8 +87,20 @@ int main()
     STXXL_MSG("Sorting...");
     stxxl::stable_ksort(v.begin(), v.end(), memory_to_use);
 
-    STXXL_MSG("Checking order...");
-    STXXL_CHECK(stxxl::is_sorted(v.begin(), v.end()));
+    check_stable(v);
+
+    // skewed keys: a quarter of the records share one key, the rest follow a
+    // power law. With less memory some buckets have to be distributed again.
+    STXXL_MSG("Filling vector with skewed keys...");
+    for (vector_type::size_type i = 0; i < v.size(); i++) {
+        v[i].m_key = (rnd() % 4 == 0) ? 7 : rnd() % (1 + rnd() % 1024);
+        v[i].m_index = i;
+    }
+
+    STXXL_MSG("Sorting...");
+    stxxl::stable_ksort(v.begin(), v.end(), 24 * 1024 * 1024);
+
+    check_stable(v);
 
     return 0;
 }
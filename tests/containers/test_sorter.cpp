@@ -85,6 +85,8 @@ struct Comparator : public std::less<my_type>
 
 // forced instantiation
 template class stxxl::sorter<my_type, Comparator, 8192>;
+template class stxxl::sorter<my_type, Comparator, 8192, stxxl::dynamic_alloc_strategy>;
+template class stxxl::sorter<unsigned, std::less<unsigned>, 8192>;
 
 int main()
 {
@@ -190,6 +192,87 @@ int main()
         STXXL_MSG("Done");
     }
 
+    {
+        // comparator without min_value() and max_value(): all keys allowed
+
+        typedef stxxl::sorter<unsigned, std::less<unsigned>, block_size> plain_sorter_type;
+
+        const stxxl::uint64 n_records = 4 * 1024 * 1024 + 123;
+        plain_sorter_type s(std::less<unsigned>(), 1024 * 1024);
+
+        stxxl::random_number32 rnd;
+        for (stxxl::uint64 i = 0; i < n_records; i++)
+            s.push((i % 1000 == 0) ? std::numeric_limits<unsigned>::max() * (i % 2000 == 0) : rnd());
+
+        s.sort();
+
+        STXXL_MSG("Checking order of sentinel-free sort...");
+
+        STXXL_CHECK(s.size() == n_records);
+        STXXL_CHECK(*s == 0);
+
+        unsigned prev = *s;
+        ++s;
+        while (!s.empty())
+        {
+            STXXL_CHECK(prev <= *s);
+            prev = *s;
+            ++s;
+        }
+        STXXL_CHECK(prev == std::numeric_limits<unsigned>::max());
+        STXXL_MSG("OK");
+    }
+
+    {
+        // inputs fitting into the memory are sorted without disk I/O, larger
+        // ones are spilled on demand
+
+        typedef stxxl::sorter<unsigned, std::less<unsigned>, block_size> plain_sorter_type;
+
+        const unsigned small_memory = 4 * 1024 * 1024;
+        // elements fitting into half of the memory of the runs creator
+        const stxxl::uint64 capacity =
+            small_memory / block_size / stxxl::sort_memory_usage_factor() / 2
+            * (block_size / sizeof(unsigned));
+
+        plain_sorter_type s(std::less<unsigned>(), small_memory);
+        stxxl::random_number32 rnd;
+
+        for (int round = 0; round < 3; ++round)
+        {
+            const stxxl::uint64 n_records =
+                (round == 0) ? capacity * 3 / 4 : (round == 1) ? capacity : capacity + 1000;
+
+            s.clear();
+            const unsigned writes = stxxl::stats::get_instance()->get_writes();
+
+            for (stxxl::uint64 i = 0; i < n_records; i++)
+                s.push(rnd());
+
+            s.sort();
+
+            const bool spilled = (stxxl::stats::get_instance()->get_writes() != writes);
+            STXXL_CHECK(spilled == (n_records > capacity));
+
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                STXXL_CHECK(s.size() == n_records);
+
+                unsigned prev = *s;
+                stxxl::uint64 count = 0;
+                for ( ; !s.empty(); ++s, ++count)
+                {
+                    STXXL_CHECK(prev <= *s);
+                    prev = *s;
+                }
+                STXXL_CHECK(count == n_records);
+
+                s.rewind();
+            }
+        }
+        STXXL_MSG("OK");
+    }
+
     return 0;
 }
 // vim: et:ts=4:sw=4
@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <algorithm>
+#include <vector>
 #include <stxxl/vector>
 #include <stxxl/scan>
 
@@ -162,10 +163,185 @@ void test_resize_shrink()
     vector.flush();
 }
 
+//! check vector with allocation strategy selected at run time
+void test_dynamic_alloc_strategy()
+{
+    typedef stxxl::VECTOR_GENERATOR<int, 2, 4, 4096, stxxl::dynamic_alloc_strategy>::result vector_type;
+
+    vector_type v1(1 << 16);
+    vector_type v2(1 << 16, stxxl::dynamic_alloc_strategy("striping"));
+
+    for (int i = 0; i < (1 << 16); ++i)
+        v1[i] = v2[i] = i;
+
+    std::swap(v1, v2);
+    v1.resize(1 << 17);
+
+    for (int i = 0; i < (1 << 16); ++i)
+        STXXL_CHECK(v1[i] == i && v2[i] == i);
+}
+
+//! check vector with strided accesses read ahead
+void test_read_ahead()
+{
+    typedef stxxl::VECTOR_GENERATOR<int, 2, 8, 4096>::result vector_type;
+    const int n = 1 << 18;
+    const int num_blocks = n / vector_type::block_type::size;
+
+    vector_type v(n);
+    STXXL_CHECK(v.get_read_ahead() == 4);
+    for (int i = 0; i < n; ++i)
+        v[i] = i;
+    v.flush();
+
+    stxxl::stats* stats = stxxl::stats::get_instance();
+
+    // a scan reads each block once, read-ahead may coalesce the reads
+    stxxl::stats_data before(*stats);
+    const vector_type& cv = v;
+    for (vector_type::const_iterator it = cv.begin(); it != cv.end(); ++it)
+        STXXL_CHECK(*it == int(it - cv.begin()));
+    STXXL_CHECK((stxxl::stats_data(*stats) - before).get_read_volume() ==
+                stxxl::uint64(num_blocks) * vector_type::block_type::raw_size);
+
+    // backwards and strided while modifying
+    for (int i = n - 1; i >= 0; i -= 1000)
+        STXXL_CHECK(v[i] == i);
+    for (int i = 0; i < n; i += 3 * 2 * vector_type::block_type::size)
+        v[i] = -v[i];
+    for (int i = 0; i < n; ++i)
+        STXXL_CHECK(v[i] == ((i % (3 * 2 * vector_type::block_type::size)) ? i : -i));
+
+    // shrinking while pages are being read ahead
+    v.flush();
+    for (int i = 0; i < n / 2; ++i)
+        STXXL_CHECK(cv[i] == ((i % (3 * 2 * vector_type::block_type::size)) ? i : -i));
+    v.resize(n / 4, true);
+    STXXL_CHECK(v[n / 4 - 1] == n / 4 - 1);
+
+    // a sequential update writes the dirty victims of read-ahead back
+    // asynchronously instead of waiting for them in read_ahead()
+    v.resize(n, true);
+    v.flush();
+    stats->set_detailed(true);
+    before = stxxl::stats_data(*stats);
+    for (vector_type::iterator it = v.begin(); it != v.end(); ++it)
+        *it = int(it - v.begin()) + 1;
+    stxxl::stats_data d = stxxl::stats_data(*stats) - before;
+    stats->set_detailed(false);
+    STXXL_CHECK(d.get_detail().get_wait_sites().count("vector::write_page") == 0);
+    for (int i = 0; i < n; ++i)
+        STXXL_CHECK(cv[i] == i + 1);
+
+    v.set_read_ahead(0);
+    STXXL_CHECK(v.get_read_ahead() == 0);
+}
+
+//! check vector writing back dirty pages asynchronously
+void test_write_back()
+{
+    typedef stxxl::VECTOR_GENERATOR<int, 2, 8, 4096>::result vector_type;
+    const int n = 1 << 18;
+
+    vector_type v(n);
+    std::vector<int> expected(n);
+    // all pages but the two most recently accessed ones
+    STXXL_CHECK(v.get_dirty_budget() == 6);
+
+    for (int i = 0; i < n; ++i)
+        v[i] = expected[i] = i;
+
+    stxxl::random_number32_r rnd(42);
+    for (unsigned budget = 1; budget <= 8; budget *= 2)
+    {
+        v.set_dirty_budget(budget);
+        STXXL_CHECK(v.get_dirty_budget() == budget);
+        for (int k = 0; k < 20000; ++k)
+        {
+            int i = rnd() % n;
+            if (k % 3 == 0)
+                STXXL_CHECK(v[i] == expected[i]);
+            else
+                v[i] = expected[i] = -i - k;
+        }
+    }
+
+    const vector_type& cv = v;
+    for (int i = 0; i < n; ++i)
+        STXXL_CHECK(cv[i] == expected[i]);
+
+    v.set_dirty_budget(2);
+    for (int i = 0; i < n; i += 1000)
+        v[i] = expected[i] = i;
+    v.flush();
+    for (int i = n - 1; i >= 0; --i)
+        STXXL_CHECK(cv[i] == expected[i]);
+
+    // shrinking while pages are being written back
+    for (int i = 0; i < n; i += 1000)
+        v[i] = expected[i] = 2 * i;
+    v.resize(n / 2, true);
+    for (int i = 0; i < n / 2; ++i)
+        STXXL_CHECK(cv[i] == expected[i]);
+}
+
+//! check that writing back or evicting pages does not lose stores through
+//! references taken before other pages were accessed, as in v[i] = v[j] or
+//! iter_swap()
+template <stxxl::pager_type Pager>
+void test_write_back_references()
+{
+    typedef typename stxxl::VECTOR_GENERATOR<int, 1, 4, 4096, STXXL_DEFAULT_ALLOC_STRATEGY, Pager>::result vector_type;
+    const int per = vector_type::block_type::size;
+    const int num_pages = 16;
+
+    vector_type v(num_pages * per);
+    v.set_read_ahead(0);
+    v.set_dirty_budget(1);
+    for (int i = 0; i < num_pages * per; ++i)
+        v[i] = 1;
+
+    const vector_type& cv = v;
+    for (int k = 0; k < 4 * num_pages; ++k)
+    {
+        int a = (k % num_pages) * per, b = ((k + 1) % num_pages) * per;
+        int& r = v[a];
+        int x = v[b];
+        v[b + 1] = x;
+        // get_concurrent() waits for the pages being written back
+        STXXL_CHECK(cv.get_concurrent(b + 1) == x);
+        r = 42 + k;
+    }
+    v.flush();
+
+    for (int k = 3 * num_pages; k < 4 * num_pages; ++k)
+        STXXL_CHECK(cv[(k % num_pages) * per] == 42 + k);
+
+    std::vector<int> expected(num_pages * per);
+    for (int i = 0; i < num_pages * per; ++i)
+        expected[i] = cv[i];
+    for (int k = 0; k < 4 * num_pages; ++k)
+        std::iter_swap(v.begin() + (k % num_pages) * per,
+                       v.begin() + ((k * 7 + 3) % num_pages) * per + 2);
+    for (int k = 0; k < 4 * num_pages; ++k)
+        std::iter_swap(expected.begin() + (k % num_pages) * per,
+                       expected.begin() + ((k * 7 + 3) % num_pages) * per + 2);
+    v.flush();
+    for (int i = 0; i < num_pages * per; ++i)
+        STXXL_CHECK(cv[i] == expected[i]);
+}
+
 int main()
 {
     test_vector1();
     test_resize_shrink();
+    test_dynamic_alloc_strategy();
+    test_read_ahead();
+    test_write_back();
+    test_write_back_references<stxxl::lru>();
+    test_write_back_references<stxxl::second_chance>();
+    test_write_back_references<stxxl::two_queue>();
+    test_write_back_references<stxxl::random>();
 
     return 0;
 }
@@ -173,6 +349,7 @@ int main()
 // forced instantiation
 template struct stxxl::VECTOR_GENERATOR<element, 2, 2, (1024* 1024), stxxl::striping>;
 template class stxxl::vector<double>;
+template class stxxl::vector<double, 4, stxxl::lru_pager<8>, STXXL_DEFAULT_BLOCK_SIZE(double), stxxl::dynamic_alloc_strategy>;
 template class stxxl::vector_iterator<double, STXXL_DEFAULT_ALLOC_STRATEGY, stxxl::uint64, stxxl::int64, STXXL_DEFAULT_BLOCK_SIZE(double), stxxl::lru_pager<8>, 4>;
 template class stxxl::const_vector_iterator<double, STXXL_DEFAULT_ALLOC_STRATEGY, stxxl::uint64, stxxl::int64, STXXL_DEFAULT_BLOCK_SIZE(double), stxxl::lru_pager<8>, 4>;
 
@@ -0,0 +1,68 @@
+/***************************************************************************
+ *  tests/containers/test_vector_concurrent.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example containers/test_vector_concurrent.cpp
+//! This tests concurrent lookups in a \c stxxl::vector with \c
+//! stxxl::vector::get_concurrent from an OpenMP parallel loop.
+
+#include <stxxl/vector>
+#include <stxxl/random>
+
+typedef stxxl::uint64 uint64;
+
+static uint64 value_at(uint64 i)
+{
+    return i * 0x9E3779B97F4A7C15ull;
+}
+
+template <typename VectorType>
+void test_lookups(const VectorType& v, unsigned num_lookups)
+{
+    // random offsets, drawn beforehand to keep the loop deterministic
+    std::vector<uint64> offsets(num_lookups);
+    stxxl::random_number64 rnd;
+    for (unsigned i = 0; i < num_lookups; ++i)
+        offsets[i] = (i % 4 == 0) ? i % v.size() : rnd(v.size());
+
+    long errors = 0;
+
+#if STXXL_PARALLEL
+    #pragma omp parallel for num_threads(8) reduction(+:errors)
+#endif
+    for (long i = 0; i < (long)num_lookups; ++i)
+    {
+        if (v.get_concurrent(offsets[i]) != value_at(offsets[i]))
+            ++errors;
+    }
+
+    STXXL_CHECK(errors == 0);
+}
+
+int main()
+{
+    // small blocks and few pages to make threads contend for the cache
+    typedef stxxl::VECTOR_GENERATOR<uint64, 2, 4, 64* 1024>::result vector_type;
+    vector_type v(4 * 1024 * 1024 / sizeof(uint64));
+
+    for (uint64 i = 0; i < v.size(); ++i)
+        v[i] = value_at(i);
+
+    STXXL_MSG("lookups of pages partly dirty in the cache");
+    test_lookups(v, 50000);
+
+    v.flush();
+
+    STXXL_MSG("lookups of pages on disk");
+    test_lookups(v, 50000);
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
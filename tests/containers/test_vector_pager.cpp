@@ -0,0 +1,177 @@
+/***************************************************************************
+ *  tests/containers/test_vector_pager.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example containers/test_vector_pager.cpp
+//! This measures the hit rate of the pagers of \c stxxl::vector on a mixed
+//! workload: lookups in a small working set interrupted by scans.
+
+#include <stxxl/vector>
+#include <stxxl/random>
+
+static const unsigned num_slots = 16;
+static const unsigned num_hot_pages = 8;
+static const unsigned num_rounds = 20;
+static const unsigned lookups_per_round = 50;
+static const unsigned pages_per_scan = 64;
+
+//! checks that kick() returns valid slots, announced by peek(), and that a
+//! recently hit slot is not kicked
+template <typename PagerType>
+void test_pager(bool recency)
+{
+    PagerType pager(num_slots);
+    STXXL_CHECK(pager.size() == num_slots);
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        stxxl::unsigned_type victim = pager.peek();
+        stxxl::unsigned_type slot = pager.kick();
+        STXXL_CHECK(slot == victim);
+        STXXL_CHECK(slot < num_slots);
+        pager.hit(slot);
+        pager.hit((slot + 1) % num_slots);
+        if (recency)
+            STXXL_CHECK(pager.kick() != (slot + 1) % num_slots);
+    }
+}
+
+//! checks that evicting another slot than the pager's choice keeps the
+//! choice
+template <typename PagerType>
+void test_evict()
+{
+    PagerType pager(num_slots);
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        stxxl::unsigned_type victim = pager.peek();
+        stxxl::unsigned_type other = (victim + 1 + i % (num_slots - 1)) % num_slots;
+        pager.evict(other);
+        pager.hit(other);
+        STXXL_CHECK(pager.peek() < num_slots);
+    }
+}
+
+//! checks that 2Q keeps its protected pages when other slots than its choice
+//! are evicted, and that pages inserted by evict() alone, as read ahead, are
+//! not protected by their first access
+void test_two_queue_evict()
+{
+    stxxl::two_queue_pager<num_slots> pager(num_slots);
+
+    // protect slots 0 and 1 by uncorrelated references
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        pager.hit(0);
+        pager.hit(1);
+    }
+
+    for (unsigned i = 0; i < 10 * num_slots; ++i)
+    {
+        // evict the slot after the choice, as vector does for recent slots
+        stxxl::unsigned_type other = (pager.peek() + 1) % num_slots;
+        if (other < 2)
+            other = 2;
+        pager.evict(other);
+        pager.hit(other);
+
+        // the protected pages are hit in between
+        pager.hit(i % 2);
+
+        // read ahead into the choice, then access it twice
+        stxxl::unsigned_type ahead = pager.peek();
+        STXXL_CHECK(ahead >= 2);
+        pager.evict(ahead);
+        pager.hit(other);
+        pager.hit(ahead);
+        pager.hit(ahead);
+    }
+}
+
+//! returns the hit rate of the lookups
+template <typename PagerType>
+double test_hit_rate(const char* name, unsigned read_ahead = 0)
+{
+    typedef stxxl::vector<int, 1, PagerType, 4096> vector_type;
+    const unsigned page_elements = vector_type::block_type::size;
+    const unsigned num_pages = 1024;
+
+    vector_type v(num_pages * page_elements, num_slots);
+    v.set_read_ahead(read_ahead);
+    for (unsigned i = 0; i < v.size(); ++i)
+        v[i] = i / page_elements;
+    v.flush();
+
+    const vector_type& cv = v;
+    stxxl::random_number32_r rnd(42);
+    stxxl::uint64 misses = 0, lookups = 0;
+
+    for (unsigned round = 0; round < num_rounds; ++round)
+    {
+        for (unsigned i = 0; i < lookups_per_round; ++i, ++lookups)
+        {
+            unsigned page = (rnd() % num_hot_pages * 97) % num_pages;
+            misses += !cv.is_element_cached(page * page_elements);
+            STXXL_CHECK(cv[page * page_elements] == (int)page);
+        }
+
+        unsigned first = (round * pages_per_scan) % num_pages;
+        for (unsigned i = first * page_elements;
+             i < (first + pages_per_scan) * page_elements; i += 64)
+            STXXL_CHECK(cv[i] == int(i / page_elements));
+    }
+
+    double hit_rate = 1.0 - double(misses) / double(lookups);
+    STXXL_MSG(name << (read_ahead ? " with read-ahead" : "") << ": " <<
+              misses << " misses in " << lookups <<
+              " lookups, hit rate " << hit_rate);
+    return hit_rate;
+}
+
+int main()
+{
+    test_pager<stxxl::random_pager<num_slots> >(false);
+    test_pager<stxxl::lru_pager<num_slots> >(true);
+    test_pager<stxxl::clock_pager<num_slots> >(false);
+    test_pager<stxxl::two_queue_pager<num_slots> >(true);
+
+    test_evict<stxxl::random_pager<num_slots> >();
+    test_evict<stxxl::lru_pager<num_slots> >();
+    test_evict<stxxl::clock_pager<num_slots> >();
+    test_evict<stxxl::two_queue_pager<num_slots> >();
+    test_two_queue_evict();
+
+    test_hit_rate<stxxl::random_pager<num_slots> >("random");
+    double lru = test_hit_rate<stxxl::lru_pager<num_slots> >("lru");
+    test_hit_rate<stxxl::clock_pager<num_slots> >("clock");
+    double two_queue = test_hit_rate<stxxl::two_queue_pager<num_slots> >("2Q");
+
+    // scans evict the working set of LRU, but not of 2Q, which faults in
+    // its pages only once
+    STXXL_CHECK(two_queue > lru);
+    STXXL_CHECK(two_queue >= 1.0 - double(num_hot_pages) / (num_rounds * lookups_per_round));
+
+    // the slots read ahead during the scans, and the slots substituted for
+    // recently accessed ones, are the ones inserted into the probationary
+    // queue, the working set stays protected
+    double two_queue_ahead = test_hit_rate<stxxl::two_queue_pager<num_slots> >("2Q", 4);
+    STXXL_CHECK(two_queue_ahead >= 1.0 - double(num_hot_pages) / (num_rounds * lookups_per_round));
+
+    // the pagers can be selected by the vector generator
+    typedef stxxl::VECTOR_GENERATOR<int, 1, num_slots, 4096, stxxl::striping,
+                                    stxxl::two_queue>::result two_queue_vector_type;
+    two_queue_vector_type v(1024 * 1024);
+    for (unsigned i = 0; i < v.size(); i += 1000)
+        v[i] = i;
+    for (unsigned i = 0; i < v.size(); i += 1000)
+        STXXL_CHECK(v[i] == (int)i);
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
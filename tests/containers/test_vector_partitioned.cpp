@@ -0,0 +1,138 @@
+/***************************************************************************
+ *  tests/containers/test_vector_partitioned.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example containers/test_vector_partitioned.cpp
+//! This tests filling and scanning a range of a \c stxxl::vector from an
+//! OpenMP parallel loop with \c stxxl::vector_partitioned_bufwriter and \c
+//! stxxl::vector_partitioned_bufreader.
+
+#include <stxxl/vector>
+#include <vector>
+
+typedef stxxl::uint64 uint64;
+
+// small blocks to get many blocks per partition
+typedef stxxl::VECTOR_GENERATOR<uint64, 2, 4, 64* 1024>::result vector_type;
+typedef vector_type::partitioned_bufwriter_type partitioned_writer_type;
+typedef vector_type::partitioned_bufreader_type partitioned_reader_type;
+
+static const uint64 untouched = 0xDEADBEEF;
+
+static uint64 value_at(uint64 i)
+{
+    return i * 0x9E3779B97F4A7C15ull;
+}
+
+//! writes the first fraction of each partition of [begin,end) in parallel
+//! and checks the whole vector afterwards
+void test_write(vector_type& v, uint64 begin, uint64 end,
+                unsigned num_partitions, double fraction)
+{
+    for (vector_type::iterator it = v.begin(); it != v.end(); ++it)
+        *it = untouched;
+
+    std::vector<uint64> expected(v.size(), untouched);
+    {
+        partitioned_writer_type writer(v.begin() + begin, v.begin() + end,
+                                       num_partitions);
+        STXXL_CHECK(writer.num_partitions() == num_partitions);
+        STXXL_CHECK(writer.partition_begin(0) == v.begin() + begin);
+        STXXL_CHECK(writer.partition_end(num_partitions - 1) == v.begin() + end);
+
+#if STXXL_PARALLEL
+        #pragma omp parallel for num_threads(4)
+#endif
+        for (long p = 0; p < (long)num_partitions; ++p)
+        {
+            partitioned_writer_type::partition_writer& out = writer.partition(p);
+
+            uint64 i = writer.partition_begin(p) - v.begin();
+            const uint64 stop = i + (uint64)(fraction * (double)out.size());
+            for ( ; i < stop; ++i)
+                out << value_at(i);
+        }
+
+        for (unsigned p = 0; p < num_partitions; ++p)
+        {
+            const uint64 pbegin = writer.partition_begin(p) - v.begin();
+            const uint64 pend = writer.partition_end(p) - v.begin();
+            STXXL_CHECK(pbegin <= pend);
+            if (p > 0)
+                STXXL_CHECK(writer.partition_begin(p) == writer.partition_end(p - 1));
+            if (p > 0 && pbegin < end)
+                STXXL_CHECK(pbegin % vector_type::block_type::size == 0);
+
+            const uint64 stop = pbegin + (uint64)(fraction * (double)(pend - pbegin));
+            for (uint64 i = pbegin; i < stop; ++i)
+                expected[i] = value_at(i);
+        }
+    }
+
+    // read through the cache, which was invalidated by finish()
+    for (uint64 i = 0; i < v.size(); ++i)
+        STXXL_CHECK(v[i] == expected[i]);
+}
+
+//! scans [begin,end) in parallel and compares the sums of the partitions
+void test_read(const vector_type& v, uint64 begin, uint64 end,
+               unsigned num_partitions)
+{
+    partitioned_reader_type reader(v.begin() + begin, v.begin() + end,
+                                   num_partitions);
+    STXXL_CHECK(reader.num_partitions() == num_partitions);
+
+    long errors = 0;
+    uint64 count = 0;
+
+#if STXXL_PARALLEL
+    #pragma omp parallel for num_threads(4) reduction(+:errors, count)
+#endif
+    for (long p = 0; p < (long)num_partitions; ++p)
+    {
+        partitioned_reader_type::bufreader_type& in = reader.partition(p);
+
+        uint64 i = reader.partition_begin(p) - v.begin();
+        for ( ; !in.empty(); ++in, ++i, ++count)
+        {
+            if (*in != value_at(i))
+                ++errors;
+        }
+        if (i != (uint64)(reader.partition_end(p) - v.begin()))
+            ++errors;
+    }
+
+    STXXL_CHECK(errors == 0);
+    STXXL_CHECK(count == end - begin);
+}
+
+int main()
+{
+    const uint64 block_elements = vector_type::block_type::size;
+    vector_type v(100 * block_elements + 123);
+
+    STXXL_MSG("whole vector");
+    test_write(v, 0, v.size(), 8, 1.0);
+    test_read(v, 0, v.size(), 8);
+
+    STXXL_MSG("range not aligned to blocks");
+    test_write(v, 1000, v.size() - 777, 7, 1.0);
+    test_read(v, 1000, v.size() - 777, 7);
+
+    STXXL_MSG("partitions written partly");
+    test_write(v, 5 * block_elements + 1, 90 * block_elements - 1, 6, 0.4);
+
+    STXXL_MSG("more partitions than blocks");
+    test_write(v, 10, 2 * block_elements + 10, 16, 1.0);
+    test_read(v, 10, 2 * block_elements + 10, 16);
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
@@ -0,0 +1,172 @@
+/***************************************************************************
+ *  tests/io/test_coalescing.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <climits>
+#include <cstring>
+#include <vector>
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+
+//! \example io/test_coalescing.cpp
+//! Checks that the priority request queue coalesces adjacent requests into
+//! vectored I/O, and that syscall_file::serve_vectored() splits long runs and
+//! zero-fills reads past the end of the file.
+
+using stxxl::file;
+using stxxl::request;
+using stxxl::request_ptr;
+
+#if STXXL_PRIORITY_REQUEST_QUEUE && STXXL_HAVE_PREADV
+
+static const size_t block_size = 4096;
+//! more blocks than fit into one preadv/pwritev call
+static const size_t num_blocks = 2 * IOV_MAX + 5;
+
+//! syscall_file counting the calls which serve requests
+class counting_file : public stxxl::syscall_file
+{
+public:
+    stxxl::mutex mutex;
+    size_t num_serve, num_vectored;
+
+    counting_file(const std::string& filename, int mode, int queue_id)
+        : stxxl::syscall_file(filename, mode, queue_id),
+          num_serve(0), num_vectored(0)
+    { }
+
+    void serve(void* buffer, offset_type offset, size_type bytes,
+               request::request_type type)
+    {
+        {
+            stxxl::scoped_mutex_lock lock(mutex);
+            ++num_serve;
+        }
+        stxxl::syscall_file::serve(buffer, offset, bytes, type);
+    }
+
+    void serve_vectored(void* const* buffers, const size_type* sizes,
+                        size_t n, offset_type offset,
+                        request::request_type type)
+    {
+        {
+            stxxl::scoped_mutex_lock lock(mutex);
+            ++num_vectored;
+        }
+        stxxl::syscall_file::serve_vectored(buffers, sizes, n, offset, type);
+    }
+
+    //! returns and resets the number of serve calls
+    size_t take_serve_calls()
+    {
+        stxxl::scoped_mutex_lock lock(mutex);
+        size_t n = num_serve + num_vectored;
+        num_serve = num_vectored = 0;
+        return n;
+    }
+};
+
+static void fill_blocks(char* buffer, size_t n, int seed)
+{
+    for (size_t i = 0; i < n * block_size; ++i)
+        buffer[i] = (char)((i / 7) + seed);
+}
+
+static bool check_blocks(const char* buffer, size_t n, int seed)
+{
+    for (size_t i = 0; i < n * block_size; ++i)
+        if (buffer[i] != (char)((i / 7) + seed)) return false;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " tempdir" << std::endl;
+        return -1;
+    }
+
+    counting_file file(std::string(argv[1]) + "/test_coalescing.dat",
+                       file::CREAT | file::RDWR, 1001);
+
+    char* wbuffer = (char*)stxxl::aligned_alloc<4096>(block_size * num_blocks);
+    char* rbuffer = (char*)stxxl::aligned_alloc<4096>(block_size * num_blocks);
+
+    std::vector<void*> wbuffers(num_blocks), rbuffers(num_blocks);
+    std::vector<file::offset_type> offsets(num_blocks);
+    std::vector<file::size_type> sizes(num_blocks, block_size);
+    for (size_t i = 0; i < num_blocks; ++i)
+    {
+        wbuffers[i] = wbuffer + i * block_size;
+        rbuffers[i] = rbuffer + i * block_size;
+        offsets[i] = i * block_size;
+    }
+
+    std::vector<request_ptr> reqs(num_blocks);
+
+    // adjacent writes and reads submitted at once are served by fewer calls
+    fill_blocks(wbuffer, num_blocks, 1);
+    file.awrite_batch(&wbuffers[0], &offsets[0], block_size, num_blocks, &reqs[0]);
+    stxxl::wait_all(&reqs[0], num_blocks);
+    size_t write_calls = file.take_serve_calls();
+    STXXL_MSG("coalesced " << num_blocks << " writes into " << write_calls << " calls");
+    STXXL_CHECK(write_calls < num_blocks / 2);
+
+    memset(rbuffer, 0, block_size * num_blocks);
+    file.aread_batch(&rbuffers[0], &offsets[0], block_size, num_blocks, &reqs[0]);
+    stxxl::wait_all(&reqs[0], num_blocks);
+    size_t read_calls = file.take_serve_calls();
+    STXXL_MSG("coalesced " << num_blocks << " reads into " << read_calls << " calls");
+    STXXL_CHECK(read_calls < num_blocks / 2);
+    STXXL_CHECK(check_blocks(rbuffer, num_blocks, 1));
+
+    // a run longer than IOV_MAX is split into several calls
+    fill_blocks(wbuffer, num_blocks, 2);
+    file.serve_vectored(&wbuffers[0], &sizes[0], num_blocks, 0, request::WRITE);
+    memset(rbuffer, 0, block_size * num_blocks);
+    file.serve_vectored(&rbuffers[0], &sizes[0], num_blocks, 0, request::READ);
+    STXXL_CHECK(check_blocks(rbuffer, num_blocks, 2));
+    file.take_serve_calls();
+
+    // a read past the end of the file is a short transfer, which ends in
+    // the middle of a region, the rest is zero-filled
+    const file::offset_type eof = (num_blocks - 3) * block_size - 100;
+    file.set_size(eof);
+    memset(rbuffer, 0xff, block_size * num_blocks);
+    file.serve_vectored(&rbuffers[0], &sizes[0], num_blocks, 0, request::READ);
+    STXXL_CHECK(check_blocks(rbuffer, num_blocks - 4, 2));
+    for (size_t i = (num_blocks - 4) * block_size; i < num_blocks * block_size; ++i)
+        STXXL_CHECK(rbuffer[i] == ((i < eof) ? (char)((i / 7) + 2) : 0));
+
+    // the same through the queue
+    memset(rbuffer, 0xff, block_size * num_blocks);
+    file.aread_batch(&rbuffers[0], &offsets[0], block_size, num_blocks, &reqs[0]);
+    stxxl::wait_all(&reqs[0], num_blocks);
+    STXXL_CHECK(file.take_serve_calls() < num_blocks / 2);
+    for (size_t i = 0; i < num_blocks * block_size; ++i)
+        STXXL_CHECK(rbuffer[i] == ((i < eof) ? (char)((i / 7) + 2) : 0));
+
+    stxxl::aligned_dealloc<4096>(rbuffer);
+    stxxl::aligned_dealloc<4096>(wbuffer);
+
+    file.close_remove();
+
+    return 0;
+}
+
+#else
+
+int main()
+{
+    STXXL_MSG("Coalescing needs the priority request queue and preadv().");
+    return 0;
+}
+
+#endif
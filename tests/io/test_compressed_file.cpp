@@ -0,0 +1,213 @@
+/***************************************************************************
+ *  tests/io/test_compressed_file.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+#include <stxxl/bits/common/rand.h>
+#include <stxxl/bits/mng/config.h>
+#include <cstring>
+#include <vector>
+
+//! \example io/test_compressed_file.cpp
+//! This tests the compressing file wrapper selected by the "compress" option
+//! of a disk configuration line.
+
+using stxxl::file;
+using stxxl::uint64;
+
+const size_t block_size = 256 * 1024;
+
+//! fill a block with sparse records: mostly zeros and a few random words
+void fill_sparse(uint64* block, size_t n, unsigned seed)
+{
+    stxxl::random_number32 rnd;
+    std::fill(block, block + n, 0);
+    for (size_t i = seed % 61; i < n; i += 61)
+        block[i] = uint64(rnd()) << 32 | seed;
+}
+
+void fill_random(uint64* block, size_t n)
+{
+    stxxl::random_number32 rnd;
+    for (size_t i = 0; i < n; ++i)
+        block[i] = uint64(rnd()) << 32 | rnd();
+}
+
+void write(file* f, void* buffer, uint64 offset, size_t bytes)
+{
+    f->awrite(buffer, offset, bytes)->wait();
+}
+
+void check(file* f, const char* expected, uint64 offset, size_t bytes)
+{
+    char* buffer = (char*)stxxl::aligned_alloc<4096>(bytes);
+    std::memset(buffer, 0x55, bytes);
+    f->aread(buffer, offset, bytes)->wait();
+    STXXL_CHECK(std::memcmp(buffer, expected, bytes) == 0);
+    stxxl::aligned_dealloc<4096>(buffer);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " tempfile" << std::endl;
+        return -1;
+    }
+
+    {
+        // codec round trip
+        std::vector<char> in(100000), out(in.size());
+        stxxl::random_number32 rnd;
+        for (size_t i = 0; i < in.size(); ++i)
+            in[i] = (i / 1000 % 3 == 0) ? (char)rnd() : (char)(i / 1000);
+
+        std::vector<char> bytes(in.size());
+        size_t length = stxxl::compressed_file::encode(
+            &in[0], in.size(), &bytes[0], bytes.size());
+        STXXL_CHECK(length > 0 && length < in.size() / 2);
+        stxxl::compressed_file::decode(&bytes[0], &out[0], out.size());
+        STXXL_CHECK(in == out);
+
+        // incompressible data exceeds the limit
+        fill_random((uint64*)&in[0], in.size() / sizeof(uint64));
+        STXXL_CHECK(stxxl::compressed_file::encode(
+                        &in[0], in.size(), &bytes[0], bytes.size()) == 0);
+    }
+
+    stxxl::disk_config cfg(std::string("disk=") + argv[1] + ",0,syscall compress");
+    STXXL_CHECK(cfg.compress);
+    STXXL_CHECK(cfg.fileio_string().find("compress") != std::string::npos);
+
+    file* f = stxxl::create_file(cfg, file::CREAT | file::RDWR | file::DIRECT);
+    STXXL_CHECK(std::string(f->io_type()) == "compressed");
+    stxxl::compressed_file* cf = dynamic_cast<stxxl::compressed_file*>(f);
+    STXXL_CHECK(cf != NULL);
+
+    const size_t n = block_size / sizeof(uint64);
+    const unsigned num_blocks = 16;
+    f->set_size(num_blocks * block_size);
+
+    std::vector<uint64*> blocks(num_blocks);
+    for (unsigned i = 0; i < num_blocks; ++i)
+        blocks[i] = (uint64*)stxxl::aligned_alloc<4096>(block_size);
+
+    stxxl::stats_data stats_begin(*stxxl::stats::get_instance());
+
+    // sparse blocks, and one which does not compress
+    for (unsigned i = 0; i < num_blocks; ++i) {
+        if (i == 5)
+            fill_random(blocks[i], n);
+        else
+            fill_sparse(blocks[i], n, i);
+        write(f, blocks[i], i * block_size, block_size);
+    }
+    for (unsigned i = 0; i < num_blocks; ++i)
+        check(f, (char*)blocks[i], i * block_size, block_size);
+
+    stxxl::stats_data stats = stxxl::stats_data(*stxxl::stats::get_instance()) - stats_begin;
+    STXXL_MSG("written " << stats.get_compressed_written_volume() << " bytes, stored " <<
+              stats.get_compressed_stored_written_volume() << " bytes in " << cf->physical_size());
+    STXXL_CHECK(stats.get_compressed_written_volume() == stxxl::int64(num_blocks * block_size));
+    STXXL_CHECK(stats.get_compressed_read_volume() == stxxl::int64(num_blocks * block_size));
+    STXXL_CHECK(stats.get_compressed_stored_written_volume() < stxxl::int64(4 * block_size));
+    STXXL_CHECK(stats.get_compressed_stored_written_volume() == stxxl::int64(cf->physical_size()));
+    STXXL_CHECK(stats.get_written_volume() == stats.get_compressed_stored_written_volume());
+
+    // parts of blocks, across block boundaries
+    check(f, (char*)blocks[3] + 4096, 3 * block_size + 4096, 8192);
+    {
+        std::vector<char> expected(2 * block_size);
+        std::memcpy(&expected[0], blocks[5], block_size);
+        std::memcpy(&expected[block_size], blocks[6], block_size);
+        check(f, &expected[block_size / 2], 5 * block_size + block_size / 2, block_size);
+    }
+
+    // overwrite a block with incompressible data and back
+    fill_random(blocks[2], n);
+    write(f, blocks[2], 2 * block_size, block_size);
+    check(f, (char*)blocks[2], 2 * block_size, block_size);
+    fill_sparse(blocks[2], n, 42);
+    write(f, blocks[2], 2 * block_size, block_size);
+    check(f, (char*)blocks[2], 2 * block_size, block_size);
+
+    // overwrite parts of two blocks
+    {
+        char* part = (char*)stxxl::aligned_alloc<4096>(block_size);
+        fill_random((uint64*)part, n);
+        write(f, part, 7 * block_size + block_size / 2, block_size);
+        std::memcpy((char*)blocks[7] + block_size / 2, part, block_size / 2);
+        std::memcpy((char*)blocks[8], part + block_size / 2, block_size / 2);
+        stxxl::aligned_dealloc<4096>(part);
+    }
+    for (unsigned i = 0; i < num_blocks; ++i)
+        check(f, (char*)blocks[i], i * block_size, block_size);
+
+    // discarded and never written ranges read as zeros
+    f->discard(10 * block_size, 2 * block_size);
+    std::memset(blocks[10], 0, block_size);
+    check(f, (char*)blocks[10], 10 * block_size, block_size);
+    check(f, (char*)blocks[10], 11 * block_size, block_size);
+    check(f, (char*)blocks[10], num_blocks * block_size, block_size);
+
+    // the space of discarded blocks is freed
+    f->discard(0, num_blocks * block_size);
+    STXXL_CHECK(cf->physical_size() == 0);
+    for (unsigned i = 0; i < num_blocks; ++i) {
+        fill_sparse(blocks[i], n, i + 100);
+        write(f, blocks[i], i * block_size, block_size);
+    }
+    for (unsigned i = 0; i < num_blocks; ++i)
+        check(f, (char*)blocks[i], i * block_size, block_size);
+    STXXL_CHECK(cf->physical_size() < 4 * block_size);
+
+    // shrinking releases the blocks behind the new end and cuts the one
+    // across it, which read as zeros after growing again
+    {
+        const stxxl::int64 stored = cf->physical_size();
+        const uint64 newsize = 4 * block_size + block_size / 2;
+        f->set_size(newsize);
+        STXXL_CHECK(f->size() == newsize);
+        STXXL_CHECK(cf->physical_size() < stored);
+
+        f->set_size(num_blocks * block_size);
+        for (unsigned i = 0; i < 4; ++i)
+            check(f, (char*)blocks[i], i * block_size, block_size);
+        std::memset((char*)blocks[4] + block_size / 2, 0, block_size / 2);
+        for (unsigned i = 5; i < num_blocks; ++i)
+            std::memset(blocks[i], 0, block_size);
+        for (unsigned i = 4; i < num_blocks; ++i)
+            check(f, (char*)blocks[i], i * block_size, block_size);
+
+        // the space released is reused
+        for (unsigned i = 4; i < num_blocks; ++i) {
+            fill_sparse(blocks[i], n, i + 200);
+            write(f, blocks[i], i * block_size, block_size);
+        }
+        for (unsigned i = 0; i < num_blocks; ++i)
+            check(f, (char*)blocks[i], i * block_size, block_size);
+        STXXL_CHECK(cf->physical_size() < 4 * block_size);
+
+        f->set_size(0);
+        STXXL_CHECK(cf->physical_size() == 0);
+    }
+
+    std::cout << stxxl::stats_data(*stxxl::stats::get_instance()) - stats_begin;
+
+    for (unsigned i = 0; i < num_blocks; ++i)
+        stxxl::aligned_dealloc<4096>(blocks[i]);
+
+    f->close_remove();
+    delete f;
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
@@ -69,10 +69,42 @@ int main(int argc, char** argv)
 
     wait_all(req, 16);
 
+    // write and read back 16 blocks with batched submission
+    {
+        const int bsize = size / 16;
+        void* buffers[16];
+        file::offset_type offsets[16];
+        for (i = 0; i < 16; i++)
+        {
+            buffers[i] = buffer + i * bsize;
+            offsets[i] = (15 - i) * bsize;
+            memset(buffers[i], i, bsize);
+        }
+
+        file2.awrite_batch(buffers, offsets, bsize, 16, req, my_handler());
+        wait_all(req, 16);
+
+        memset(buffer, 0xFF, size);
+        file2.aread_batch(buffers, offsets, bsize, 16, req, my_handler());
+        wait_all(req, 16);
+
+        for (i = 0; i < 16; i++)
+            STXXL_CHECK(((unsigned char*)buffers[i])[0] == i &&
+                        ((unsigned char*)buffers[i])[bsize - 1] == i);
+    }
+
     stxxl::aligned_dealloc<4096>(buffer);
 
     std::cout << *(stxxl::stats::get_instance());
 
+    // all requests have been accounted to the file
+    const stxxl::file_stats& fs = file2.get_file_stats();
+    STXXL_CHECK(fs.get_read_volume() == size + size);
+    STXXL_CHECK(fs.get_written_volume() == 31 * size + size);
+    STXXL_CHECK(fs.get_throughput() > 0.0);
+    STXXL_MSG("file throughput: " << stxxl::add_IEC_binary_multiplier(
+                  (stxxl::uint64)fs.get_throughput(), "B/s"));
+
     stxxl::uint64 sz;
     for (sz = 123, i = 0; i < 20; ++i, sz *= 10)
         STXXL_MSG(">>>" << stxxl::add_SI_multiplier(sz) << "<<<");
@@ -0,0 +1,161 @@
+/***************************************************************************
+ *  tests/io/test_iostats_detail.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+#include <cmath>
+#include <sstream>
+
+//! \example io/test_iostats_detail.cpp
+//! This tests the latency histograms, queue depth traces and wait sites of
+//! the detailed I/O statistics.
+
+using stxxl::latency_histogram;
+using stxxl::uint64;
+
+void test_histogram()
+{
+    // buckets are contiguous and of growing width
+    for (unsigned i = 0; i + 1 < latency_histogram::num_buckets; ++i)
+    {
+        STXXL_CHECK(latency_histogram::bucket_lower(i) + latency_histogram::bucket_width(i)
+                    == latency_histogram::bucket_lower(i + 1));
+        STXXL_CHECK(latency_histogram::bucket_index(latency_histogram::bucket_lower(i)) == i);
+    }
+    for (uint64 us = 1; us < (uint64(1) << 40); us = us * 3 + 1)
+    {
+        unsigned i = latency_histogram::bucket_index(us);
+        STXXL_CHECK(i < latency_histogram::num_buckets);
+        if (i + 1 < latency_histogram::num_buckets) {
+            STXXL_CHECK(latency_histogram::bucket_lower(i) <= us);
+            STXXL_CHECK(us - latency_histogram::bucket_lower(i) <= us / latency_histogram::sub_buckets);
+        }
+    }
+
+    // 1..1000 ms
+    latency_histogram h;
+    for (unsigned ms = 1; ms <= 1000; ++ms)
+        h.record(ms * 1e-3);
+
+    STXXL_CHECK(h.get_count() == 1000);
+    STXXL_CHECK(std::fabs(h.get_mean() - 0.5005) < 1e-6);
+    STXXL_CHECK(std::fabs(h.get_min() - 0.001) < 1e-9);
+    STXXL_CHECK(std::fabs(h.get_max() - 1.0) < 1e-9);
+    STXXL_CHECK(std::fabs(h.get_percentile(0.5) - 0.5) < 0.5 / 16);
+    STXXL_CHECK(std::fabs(h.get_percentile(0.99) - 0.99) < 0.99 / 16);
+    STXXL_CHECK(h.get_percentile(1.0) == h.get_max());
+
+    // a later snapshot minus an earlier one
+    latency_histogram later(h);
+    later.record(2.0);
+    latency_histogram diff = later - h;
+    STXXL_CHECK(diff.get_count() == 1);
+    STXXL_CHECK(std::fabs(diff.get_percentile(0.5) - 2.0) < 2.0 / 16);
+
+    later += h;
+    STXXL_CHECK(later.get_count() == 2001);
+}
+
+void test_queue_depth()
+{
+    stxxl::queue_depth_trace t(1.0);
+    t.change(2, 100.0);     // 2 for 0.5 s
+    t.change(2, 100.5);     // 4 for 1 s
+    t.change(-4, 101.5);    // 0 until 102.5
+    t.change(1, 102.5);
+    STXXL_CHECK(t.get_depth() == 1);
+    STXXL_CHECK(t.get_max_depth() == 4);
+    STXXL_CHECK(std::fabs(t.get_mean_depth() - 5.0 / 2.5) < 1e-9);
+    STXXL_CHECK(t.get_intervals().size() == 3);
+    STXXL_CHECK(t.get_intervals()[0].max_depth == 4);
+    STXXL_CHECK(std::fabs(t.get_intervals()[0].depth_time - 3.0) < 1e-9);
+    STXXL_CHECK(t.get_intervals()[1].max_depth == 4);
+    STXXL_CHECK(std::fabs(t.get_intervals()[1].depth_time - 2.0) < 1e-9);
+    STXXL_CHECK(t.get_intervals()[2].max_depth == 1);
+
+    // long traces are merged into fewer, longer intervals
+    t.change(-1, 100.0 + 3000.0);
+    STXXL_CHECK(t.get_intervals().size() <= stxxl::queue_depth_trace::max_intervals);
+    STXXL_CHECK(t.get_interval() == 4.0);
+    STXXL_CHECK(t.get_intervals()[0].max_depth == 4);
+    STXXL_CHECK(std::fabs(t.get_intervals()[0].depth_time - 6.5) < 1e-9);
+}
+
+void test_requests()
+{
+    const size_t block_size = 64 * 1024;
+    const unsigned num_blocks = 16;
+    const int queue_id = 1000;
+
+    stxxl::stats* s = stxxl::stats::get_instance();
+    stxxl::mem_file f(queue_id);
+    f.set_size(block_size * num_blocks);
+    char* buffer = (char*)stxxl::aligned_alloc<4096>(block_size * num_blocks);
+    stxxl::request_ptr reqs[num_blocks];
+
+    // not recorded while switched off
+    s->set_detailed(false);
+    f.awrite(buffer, 0, block_size)->wait();
+    STXXL_CHECK(s->get_detail().get_disks().count(queue_id) == 0);
+
+    s->set_detailed(true);
+    stxxl::stats_data begin(*s);
+
+    for (unsigned i = 0; i < num_blocks; ++i)
+        reqs[i] = f.awrite(buffer + i * block_size, i * block_size, block_size);
+    {
+        stxxl::stats::scoped_wait_site site("test_writes");
+        stxxl::wait_all(reqs, num_blocks);
+    }
+    for (unsigned i = 0; i < num_blocks; ++i)
+        reqs[i] = f.aread(buffer + i * block_size, i * block_size, block_size);
+    stxxl::wait_all(reqs, num_blocks);
+
+    stxxl::stats_data d = stxxl::stats_data(*s) - begin;
+    s->set_detailed(false);
+
+    const stxxl::stats_detail& detail = d.get_detail();
+    STXXL_CHECK(detail.get_disks().count(queue_id) == 1);
+    const stxxl::disk_detail& disk = detail.get_disks().find(queue_id)->second;
+    STXXL_CHECK(disk.write_latency.get_count() == num_blocks);
+    STXXL_CHECK(disk.read_latency.get_count() == num_blocks);
+    STXXL_CHECK(disk.write_service.get_count() == num_blocks);
+    STXXL_CHECK(disk.read_service.get_count() == num_blocks);
+    STXXL_CHECK(disk.read_service.get_max() <= disk.read_latency.get_max());
+    STXXL_CHECK(disk.queue_depth.get_depth() == 0);
+    STXXL_CHECK(disk.queue_depth.get_max_depth() >= 1);
+    STXXL_CHECK(disk.queue_depth.get_max_depth() <= num_blocks);
+
+    STXXL_CHECK(detail.get_wait_sites().count("test_writes") == 1);
+    STXXL_CHECK(detail.get_wait_sites().find("test_writes")->second.get_count() == num_blocks);
+    STXXL_CHECK(detail.get_wait_sites().count("(read)") == 1);
+
+    std::cout << d;
+
+    std::ostringstream json;
+    d.print_json(json);
+    STXXL_MSG(json.str());
+    STXXL_CHECK(json.str().find("\"read_latency\": {\"count\": 16,") != std::string::npos);
+    STXXL_CHECK(json.str().find("\"test_writes\": {\"count\": 16,") != std::string::npos);
+    STXXL_CHECK(json.str().find("\"queue_depth\": {\"max\": ") != std::string::npos);
+
+    stxxl::aligned_dealloc<4096>(buffer);
+}
+
+int main()
+{
+    test_histogram();
+    test_queue_depth();
+    test_requests();
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
@@ -0,0 +1,175 @@
+/***************************************************************************
+ *  tests/io/test_queue_threads.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+#include <stxxl/bits/common/mutex.h>
+#include <stxxl/bits/common/timer.h>
+#include <cstring>
+#include <vector>
+
+//! \example io/test_queue_threads.cpp
+//! Checks that a request queue with several worker threads serves requests
+//! of a synchronous file concurrently, but never conflicting ones.
+
+using stxxl::file;
+using stxxl::request;
+using stxxl::request_ptr;
+
+#if STXXL_PRIORITY_REQUEST_QUEUE
+
+static const size_t block_size = 64 * 1024;
+static const size_t num_blocks = 32;
+
+//! memory file which records the concurrency of its serve() calls
+class counting_file : public stxxl::mem_file
+{
+    struct serving
+    {
+        offset_type offset;
+        size_type bytes;
+        request::request_type type;
+    };
+
+    stxxl::mutex m_mutex;
+    std::vector<serving> m_serving;
+
+public:
+    size_t max_serving;
+    bool conflict;
+
+    counting_file(int queue_id)
+        : stxxl::mem_file(queue_id), max_serving(0), conflict(false)
+    { }
+
+    void serve(void* buffer, offset_type offset, size_type bytes,
+               request::request_type type)
+    {
+        serving s = { offset, bytes, type };
+        {
+            stxxl::scoped_mutex_lock lock(m_mutex);
+            for (size_t i = 0; i < m_serving.size(); ++i)
+            {
+                if ((type == request::WRITE || m_serving[i].type == request::WRITE) &&
+                    offset < m_serving[i].offset + m_serving[i].bytes &&
+                    m_serving[i].offset < offset + bytes)
+                    conflict = true;
+            }
+            m_serving.push_back(s);
+            max_serving = std::max(max_serving, m_serving.size());
+        }
+
+        // simulate the latency of a device
+        double begin = stxxl::timestamp();
+        while (stxxl::timestamp() - begin < 0.004) { }
+
+        stxxl::mem_file::serve(buffer, offset, bytes, type);
+
+        stxxl::scoped_mutex_lock lock(m_mutex);
+        for (size_t i = 0; i < m_serving.size(); ++i)
+        {
+            if (m_serving[i].offset == offset && m_serving[i].type == type) {
+                m_serving.erase(m_serving.begin() + i);
+                break;
+            }
+        }
+    }
+};
+
+static bool check_block(const char* buffer, char value)
+{
+    for (size_t i = 0; i < block_size; ++i)
+        if (buffer[i] != value) return false;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " tempdir" << std::endl;
+        return -1;
+    }
+
+    char* buffer = (char*)stxxl::aligned_alloc<4096>(2 * block_size * num_blocks);
+    char* rbuffer = buffer + block_size * num_blocks;
+    request_ptr reqs[2 * num_blocks];
+
+    {
+        const int queue_id = 1000;
+        stxxl::disk_queues::get_instance()->set_queue_threads(queue_id, 4);
+
+        counting_file f(queue_id);
+        f.set_size(block_size * num_blocks);
+
+        // independent requests are served concurrently
+        for (size_t i = 0; i < num_blocks; ++i)
+            memset(buffer + i * block_size, (char)i, block_size);
+        for (size_t i = 0; i < num_blocks; ++i)
+            reqs[i] = f.awrite(buffer + i * block_size, i * block_size, block_size);
+        stxxl::wait_all(reqs, num_blocks);
+
+        STXXL_MSG("at most " << f.max_serving << " requests were served concurrently");
+        STXXL_CHECK(f.max_serving > 1 && f.max_serving <= 4);
+        STXXL_CHECK(!f.conflict);
+
+        // a read submitted after a write to the same block waits for it
+        for (size_t i = 0; i < num_blocks; ++i)
+        {
+            memset(buffer + i * block_size, (char)(i + 1), block_size);
+            reqs[2 * i] = f.awrite(buffer + i * block_size, i * block_size, block_size);
+            reqs[2 * i + 1] = f.aread(rbuffer + i * block_size, i * block_size, block_size);
+        }
+        stxxl::wait_all(reqs, 2 * num_blocks);
+
+        STXXL_CHECK(!f.conflict);
+        for (size_t i = 0; i < num_blocks; ++i)
+            STXXL_CHECK(check_block(rbuffer + i * block_size, (char)(i + 1)));
+    }
+
+    {
+        // syscall_file with several workers selected by the fileio string
+        file* f = stxxl::create_file("syscall queue_length=4",
+                                     std::string(argv[1]) + "/test_queue_threads.dat",
+                                     file::CREAT | file::RDWR | file::DIRECT, 1001);
+
+        for (size_t i = 0; i < num_blocks; ++i)
+            memset(buffer + i * block_size, (char)(3 * i), block_size);
+        for (size_t i = 0; i < num_blocks; ++i)
+            reqs[i] = f->awrite(buffer + i * block_size, i * block_size, block_size);
+        stxxl::wait_all(reqs, num_blocks);
+
+        for (size_t i = 0; i < num_blocks; ++i)
+            reqs[i] = f->aread(rbuffer + i * block_size, i * block_size, block_size);
+        stxxl::wait_all(reqs, num_blocks);
+
+        for (size_t i = 0; i < num_blocks; ++i)
+            STXXL_CHECK(check_block(rbuffer + i * block_size, (char)(3 * i)));
+
+        f->close_remove();
+        delete f;
+    }
+
+    stxxl::aligned_dealloc<4096>(buffer);
+
+    return 0;
+}
+
+#else
+
+int main()
+{
+    STXXL_MSG("Several queue threads need the priority request queue.");
+    return 0;
+}
+
+#endif
+
+// vim: et:ts=4:sw=4
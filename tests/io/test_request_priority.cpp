@@ -0,0 +1,157 @@
+/***************************************************************************
+ *  tests/io/test_request_priority.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <cstring>
+#include <vector>
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+#include <stxxl/bits/common/semaphore.h>
+
+//! \example io/test_request_priority.cpp
+//! Checks that the priority request queue serves raised requests first,
+//! without reordering conflicting reads and writes.
+
+using stxxl::file;
+using stxxl::request;
+using stxxl::request_ptr;
+
+#if STXXL_PRIORITY_REQUEST_QUEUE
+
+static const size_t block_size = 256 * 1024;
+static const size_t num_blocks = 64;
+
+static bool check_block(const char* buffer, char value)
+{
+    for (size_t i = 0; i < block_size; ++i)
+        if (buffer[i] != value) return false;
+    return true;
+}
+
+//! requests in the order of their completion
+static stxxl::mutex completion_mutex;
+static std::vector<request*> completion_order;
+//! signaled for each completion, waiting on requests would raise them
+static stxxl::semaphore completions(0);
+
+struct record_completion
+{
+    void operator () (request* req)
+    {
+        stxxl::scoped_mutex_lock lock(completion_mutex);
+        completion_order.push_back(req);
+        lock.unlock();
+        completions++;
+    }
+};
+
+//! holds the worker serving the request until released
+struct hold_worker
+{
+    stxxl::semaphore* entered, * release;
+
+    hold_worker(stxxl::semaphore* e, stxxl::semaphore* r) : entered(e), release(r) { }
+
+    void operator () (request*)
+    {
+        (*entered)++;
+        (*release)--;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " tempdir" << std::endl;
+        return -1;
+    }
+
+    stxxl::syscall_file file(std::string(argv[1]) + "/test_request_priority.dat",
+                             file::CREAT | file::RDWR | file::DIRECT, 0);
+
+    char* buffer = (char*)stxxl::aligned_alloc<4096>(block_size * (num_blocks + 1));
+    char* rbuffer = buffer + block_size * num_blocks;
+
+    for (size_t i = 0; i < num_blocks; ++i)
+        memset(buffer + i * block_size, (char)i, block_size);
+
+    request_ptr reqs[num_blocks];
+
+    // a demand read must not overtake the earlier write to the same block,
+    // even if it is raised above the queued write-behind requests.
+    for (size_t i = 0; i < num_blocks; ++i)
+        reqs[i] = file.awrite(buffer + i * block_size, i * block_size, block_size);
+
+    STXXL_CHECK(reqs[num_blocks - 1]->get_priority() == request::WRITE_BEHIND);
+
+    request_ptr rreq = file.aread(rbuffer, (num_blocks - 1) * block_size, block_size);
+    STXXL_CHECK(rreq->get_priority() == request::PREFETCH);
+    rreq->wait();
+    STXXL_CHECK(check_block(rbuffer, (char)(num_blocks - 1)));
+
+    stxxl::wait_all(reqs, num_blocks);
+
+    // a prefetch read must not be overtaken by a later write to the same
+    // block, even though write-behind is preferred by set_priority_op(WRITE).
+    stxxl::disk_queues::get_instance()->set_priority_op(stxxl::request_queue::WRITE);
+
+    for (size_t i = 0; i < num_blocks; ++i)
+        memset(buffer + i * block_size, (char)(i + 1), block_size);
+
+    for (size_t i = 1; i < num_blocks; ++i)
+        reqs[i] = file.awrite(buffer + i * block_size, i * block_size, block_size);
+    rreq = file.aread(rbuffer, 0, block_size);
+    reqs[0] = file.awrite(buffer, 0, block_size);
+
+    rreq->wait();
+    stxxl::wait_all(reqs, num_blocks);
+    STXXL_CHECK(check_block(rbuffer, (char)0));
+
+    // a demand read overtakes the queued write-behind and prefetch requests,
+    // which are queued while the worker is held in a completion handler.
+    stxxl::semaphore entered(0), release(0);
+    request_ptr holder = file.aread(rbuffer, 0, block_size, hold_worker(&entered, &release));
+    entered--;
+
+    for (size_t i = 1; i < num_blocks / 2; ++i)
+        reqs[i] = file.awrite(buffer + i * block_size, i * block_size, block_size,
+                              record_completion());
+    for (size_t i = num_blocks / 2; i < num_blocks; ++i)
+        reqs[i] = file.aread(buffer + i * block_size, i * block_size, block_size,
+                             record_completion());
+    rreq = file.aread(rbuffer, 0, block_size, record_completion());
+    STXXL_CHECK(rreq->raise_priority(request::DEMAND));
+    STXXL_CHECK(rreq->get_priority() == request::DEMAND);
+
+    release++;
+    for (size_t i = 0; i < num_blocks; ++i)
+        completions--;
+    holder->wait();
+    rreq->wait();
+    stxxl::wait_all(reqs + 1, num_blocks - 1);
+    STXXL_CHECK(completion_order.size() == num_blocks);
+    STXXL_CHECK(completion_order[0] == rreq.get());
+
+    stxxl::aligned_dealloc<4096>(buffer);
+
+    file.close_remove();
+
+    return 0;
+}
+
+#else
+
+int main()
+{
+    STXXL_MSG("Request priorities need the priority request queue.");
+    return 0;
+}
+
+#endif
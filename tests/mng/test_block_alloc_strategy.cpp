@@ -60,5 +60,39 @@ int main()
     STXXL_MSG("Flash devices: [" << cfg->flash_range().first << "," << cfg->flash_range().second << ")");
     if (cfg->flash_range().first != cfg->flash_range().second)
         test_strategy<stxxl::RC_flash>();
+    test_strategy<stxxl::load_balancing>();
     test_strategy<stxxl::single_disk>();
+
+    // select the strategy at run time
+    test_strategy<stxxl::dynamic_alloc_strategy>();
+
+    const char* names[] = {
+        "striping", "FR", "SR", "RC", "load_balancing", "single_disk"
+    };
+    for (unsigned i = 0; i < sizeof(names) / sizeof(names[0]); ++i)
+    {
+        cfg->set_alloc_strategy(names[i]);
+        stxxl::dynamic_alloc_strategy s;
+        STXXL_MSG(names[i] << ": " << s.get_name());
+        for (unsigned j = 0; j < 16; ++j)
+            STXXL_CHECK(s(j) < cfg->disks_number());
+    }
+
+    // wrapped strategy objects behave like the original
+    stxxl::striping st(0, 3);
+    stxxl::dynamic_alloc_strategy ds = stxxl::dynamic_alloc_strategy::wrap(st);
+    stxxl::dynamic_alloc_strategy dc(ds);
+    for (unsigned j = 0; j < 16; ++j)
+        STXXL_CHECK(dc(j) == st(j));
+    STXXL_CHECK(std::string(dc.get_name()) == stxxl::striping::name());
+
+    bool caught = false;
+    try {
+        cfg->set_alloc_strategy("no_such_strategy");
+    }
+    catch (std::runtime_error&) {
+        caught = true;
+    }
+    STXXL_CHECK(caught);
+    STXXL_CHECK(cfg->get_alloc_strategy() == "single_disk");
 }
@@ -97,6 +97,62 @@ void testIO2()
     delete[] blocks;
 }
 
+//! counts the completed requests
+struct count_handler
+{
+    stxxl::mutex* mutex;
+    unsigned* count;
+
+    count_handler(stxxl::mutex* m, unsigned* c) : mutex(m), count(c) { }
+
+    void operator () (stxxl::request*)
+    {
+        stxxl::scoped_mutex_lock lock(*mutex);
+        ++*count;
+    }
+};
+
+void testBatch()
+{
+    typedef stxxl::typed_block<128* 1024, int> block_type;
+    const unsigned nblocks = 32;
+    std::vector<block_type::bid_type> bids(nblocks);
+    stxxl::block_manager* bm = stxxl::block_manager::get_instance();
+    bm->new_blocks(stxxl::striping(), bids.begin(), bids.end());
+
+    block_type* blocks = new block_type[nblocks];
+    std::vector<block_type*> block_ptrs(nblocks);
+    std::vector<stxxl::request_ptr> reqs(nblocks);
+    for (unsigned i = 0; i < nblocks; ++i) {
+        for (unsigned j = 0; j < block_type::size; ++j)
+            blocks[i][j] = i * block_type::size + j;
+        block_ptrs[i] = blocks + i;
+    }
+
+    stxxl::mutex mutex;
+    unsigned count = 0;
+    block_type::write_batch(&block_ptrs[0], &bids[0], nblocks, &reqs[0],
+                            count_handler(&mutex, &count));
+    stxxl::wait_all(reqs.begin(), reqs.end());
+    STXXL_CHECK(count == nblocks);
+
+    // read in reverse order
+    for (unsigned i = 0; i < nblocks; ++i)
+        block_ptrs[i] = blocks + nblocks - 1 - i;
+    for (unsigned i = 0; i < nblocks; ++i)
+        std::fill(blocks[i].begin(), blocks[i].end(), -1);
+    block_type::read_batch(&block_ptrs[0], &bids[0], nblocks, &reqs[0],
+                           count_handler(&mutex, &count));
+    stxxl::wait_all(reqs.begin(), reqs.end());
+    STXXL_CHECK(count == 2 * nblocks);
+    for (unsigned i = 0; i < nblocks; ++i)
+        for (unsigned j = 0; j < block_type::size; ++j)
+            STXXL_CHECK(blocks[nblocks - 1 - i][j] == int(i * block_type::size + j));
+
+    bm->delete_blocks(bids.begin(), bids.end());
+    delete[] blocks;
+}
+
 void testPrefetchPool()
 {
     stxxl::prefetch_pool<block_type> pool(2);
@@ -147,6 +203,16 @@ void testStreams()
             STXXL_CHECK(value == int(i));
         }
     }
+    {
+        // the initial prefetch of all buffers is submitted as one batch
+        buf_istream_type in(bids.begin(), bids.end(), 16);
+        for (unsigned i = 0; i < nelements; i++)
+        {
+            int value;
+            in >> value;
+            STXXL_CHECK(value == int(i));
+        }
+    }
     bm->delete_blocks(bids.begin(), bids.end());
 }
 
@@ -154,6 +220,7 @@ int main()
 {
     testIO();
     testIO2();
+    testBatch();
     testPrefetchPool();
     testWritePool();
     testStreams();
@@ -12,6 +12,7 @@
 
 #include <stxxl/mng>
 #include <stxxl/bits/verbose.h>
+#include <stxxl/bits/io/request_queue.h>
 
 void test1()
 {
@@ -35,6 +36,14 @@ void test1()
     STXXL_CHECK_EQUAL(cfg.queue, 5);
     STXXL_CHECK_EQUAL(cfg.direct, stxxl::disk_config::DIRECT_ON);
 
+    // test io_uring ring size parameter
+
+    cfg.parse_line("disk=/var/tmp/stxxl.tmp, 100 GiB , io_uring unlink queue_length=512");
+
+    STXXL_CHECK_EQUAL(cfg.io_impl, "io_uring");
+    STXXL_CHECK_EQUAL(cfg.queue_length, 512);
+    STXXL_CHECK_EQUAL(cfg.fileio_string(), "io_uring unlink_on_open queue_length=512");
+
     // bad configurations
 
     STXXL_CHECK_THROW(
@@ -46,6 +55,13 @@ void test1()
         cfg.parse_line("disk=/var/tmp/stxxl.tmp,0x,syscall"),
         std::runtime_error
         );
+
+#if !STXXL_PRIORITY_REQUEST_QUEUE
+    STXXL_CHECK_THROW(
+        cfg.parse_line("disk=/var/tmp/stxxl.tmp, 100 GiB, syscall queue_length=4"),
+        std::runtime_error
+        );
+#endif
 }
 
 void test2()
@@ -0,0 +1,128 @@
+/***************************************************************************
+ *  tests/mng/test_load_balancing.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example mng/test_load_balancing.cpp
+//! This checks that the load_balancing allocation strategy assigns the blocks
+//! to the disks in proportion to their free space and throughput.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stxxl/mng>
+
+static const stxxl::unsigned_type block_size = 1024 * 1024;
+
+//! counts the blocks per disk in one period of the strategy
+std::vector<stxxl::unsigned_type> count_blocks(const stxxl::load_balancing& lb)
+{
+    std::vector<stxxl::unsigned_type> count(2, 0);
+    for (stxxl::unsigned_type i = 0; i < lb.period(); ++i)
+        ++count[lb(i)];
+    STXXL_MSG("period " << lb.period() << ": " << count[0] << " blocks on disk 0, " <<
+              count[1] << " blocks on disk 1");
+    return count;
+}
+
+//! checks that the disks get within one block their share of the period
+void check_shares(const stxxl::load_balancing& lb, stxxl::unsigned_type share0,
+                  stxxl::unsigned_type share1)
+{
+    std::vector<stxxl::unsigned_type> count = count_blocks(lb);
+    STXXL_CHECK(count[0] + count[1] == lb.period());
+
+    const stxxl::unsigned_type expected0 = lb.period() * share0 / (share0 + share1);
+    STXXL_CHECK(count[0] + 1 >= expected0 && count[0] <= expected0 + 1);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " tempdir" << std::endl;
+        return -1;
+    }
+
+    const std::string tempdir = argv[1];
+    stxxl::config* config = stxxl::config::get_instance();
+
+    // disks without throughput measurements with 1:3 free space
+    stxxl::disk_config disk0(tempdir + "/test_load_balancing_0.dat", 16 * block_size,
+                             "syscall autogrow=no direct=off");
+    disk0.unlink_on_open = true;
+    config->add_disk(disk0);
+
+    stxxl::disk_config disk1(tempdir + "/test_load_balancing_1.dat", 48 * block_size,
+                             "syscall autogrow=no direct=off");
+    disk1.unlink_on_open = true;
+    config->add_disk(disk1);
+
+    stxxl::block_manager* bm = stxxl::block_manager::get_instance();
+    STXXL_CHECK_EQUAL(bm->get_free_bytes(0), 16 * block_size);
+    STXXL_CHECK_EQUAL(bm->get_free_bytes(1), 48 * block_size);
+
+    stxxl::load_balancing lb(0, 2);
+    check_shares(lb, 1, 3);
+
+    // the weights follow the free space: fill disk 1 down to the space of
+    // disk 0, and beyond
+    std::vector<stxxl::BID<block_size> > bids(32);
+    bm->new_blocks(stxxl::single_disk(1), bids.begin(), bids.end());
+    lb.refresh();
+    check_shares(lb, 1, 1);
+
+    std::vector<stxxl::BID<block_size> > more_bids(8);
+    bm->new_blocks(stxxl::single_disk(1), more_bids.begin(), more_bids.end());
+    lb.refresh();
+    check_shares(lb, 2, 1);
+
+    bm->delete_blocks(more_bids.begin(), more_bids.end());
+    bm->delete_blocks(bids.begin(), bids.end());
+    lb.refresh();
+    check_shares(lb, 1, 3);
+
+#if STXXL_IO_STATS
+    // the weights follow the throughput: with equal free space, the disk
+    // measured three times as fast receives three times as many blocks once
+    // the next period starts, without calling refresh().
+    bm->new_blocks(stxxl::single_disk(1), bids.begin(), bids.end());
+    std::vector<stxxl::BID<block_size> > disk_bids(2);
+    bm->new_blocks(stxxl::single_disk(0), disk_bids.begin(), disk_bids.begin() + 1);
+    bm->new_blocks(stxxl::single_disk(1), disk_bids.begin() + 1, disk_bids.end());
+    STXXL_CHECK_EQUAL(bm->get_free_bytes(0), bm->get_free_bytes(1));
+
+    for (unsigned d = 0; d < 2; ++d)
+    {
+        stxxl::file_stats& fs = disk_bids[d].storage->get_file_stats();
+        fs.write_started((d == 0 ? 3 : 1) * block_size, stxxl::timestamp() - 1.0);
+        fs.io_finished();
+    }
+    STXXL_CHECK(bm->get_file_stats(0).get_throughput() >
+                2.0 * bm->get_file_stats(1).get_throughput());
+
+    check_shares(lb, 3, 1);
+
+    // and so do the blocks allocated with the strategy
+    std::vector<stxxl::BID<block_size> > lb_bids(16);
+    bm->new_blocks(lb, lb_bids.begin(), lb_bids.end());
+    stxxl::unsigned_type on_disk0 = 0;
+    for (stxxl::unsigned_type i = 0; i < lb_bids.size(); ++i)
+        on_disk0 += (lb_bids[i].storage == disk_bids[0].storage);
+    STXXL_MSG("allocated " << on_disk0 << " of " << lb_bids.size() << " blocks on disk 0");
+    STXXL_CHECK(on_disk0 + 1 >= 12 && on_disk0 <= 13);
+
+    bm->delete_blocks(lb_bids.begin(), lb_bids.end());
+    bm->delete_blocks(disk_bids.begin(), disk_bids.end());
+    bm->delete_blocks(bids.begin(), bids.end());
+#endif
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
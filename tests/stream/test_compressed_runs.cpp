@@ -0,0 +1,183 @@
+/***************************************************************************
+ *  tests/stream/test_compressed_runs.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example stream/test_compressed_runs.cpp
+//! This is an example of how to store the sorted runs of stream::sort,
+//! stxxl::sorter and stxxl::sort compressed: the comparator selects a codec
+//! for the blocks of the runs by its nested type run_codec.
+
+#include <limits>
+#include <vector>
+#include <stxxl/stream>
+#include <stxxl/sorter>
+#include <stxxl/sort>
+#include <stxxl/vector>
+
+typedef stxxl::uint64 value_type;
+
+const unsigned block_size = 64 * 1024;
+const stxxl::unsigned_type memory_to_use = 8 * 1024 * 1024;
+
+//! comparator with sentinels storing the runs compressed
+struct codec_cmp : public std::less<value_type>
+{
+    typedef stxxl::delta_varint_codec run_codec;
+
+    value_type min_value() const
+    {
+        return std::numeric_limits<value_type>::min();
+    }
+    value_type max_value() const
+    {
+        return std::numeric_limits<value_type>::max();
+    }
+};
+
+//! comparator without sentinels storing the runs compressed
+struct plain_codec_cmp : public std::less<value_type>
+{
+    typedef stxxl::delta_varint_codec run_codec;
+};
+
+//! stream of random numbers from a small range, which has small gaps when
+//! sorted
+struct random_stream
+{
+    typedef ::value_type value_type;
+
+    stxxl::random_number32 rnd;
+    stxxl::uint64 remaining;
+    value_type current;
+
+    random_stream(stxxl::uint64 length)
+        : remaining(length), current(rnd() % (length + 1))
+    { }
+
+    bool empty() const { return remaining == 0; }
+
+    const value_type& operator * () const { return current; }
+
+    random_stream& operator ++ ()
+    {
+        --remaining;
+        current = rnd() % (remaining + 1);
+        return *this;
+    }
+};
+
+template <typename Stream>
+void check_sorted(Stream& s, stxxl::uint64 n)
+{
+    stxxl::uint64 count = 0;
+    value_type prev = 0;
+    for ( ; !s.empty(); ++s, ++count)
+    {
+        STXXL_CHECK(prev <= *s);
+        prev = *s;
+    }
+    STXXL_CHECK(count == n);
+}
+
+int main()
+{
+    {
+        // codec round trip with negative deltas and extreme values
+        std::vector<stxxl::int64> in(10000), out(in.size());
+        stxxl::random_number32 rnd;
+        for (unsigned i = 0; i < in.size(); ++i)
+            in[i] = (i % 3 == 0) ? (stxxl::int64(rnd()) - stxxl::int64(rnd())) * (stxxl::int64(1) << (i % 32))
+                    : (i % 3 == 1) ? std::numeric_limits<stxxl::int64>::min()
+                    : std::numeric_limits<stxxl::int64>::max();
+
+        std::vector<unsigned char> bytes(
+            stxxl::delta_varint_codec::max_encoded_size<stxxl::int64>(in.size()));
+        stxxl::unsigned_type length =
+            stxxl::delta_varint_codec::encode(&in[0], in.size(), &bytes[0]);
+        STXXL_CHECK(length <= bytes.size());
+        stxxl::delta_varint_codec::decode(&bytes[0], out.size(), &out[0]);
+        STXXL_CHECK(in == out);
+    }
+
+    // elements in the first run of the runs creator
+    const stxxl::uint64 el_in_run =
+        memory_to_use / block_size / stxxl::sort_memory_usage_factor() / 2
+        * (block_size / sizeof(value_type));
+
+    // the input fits into both halves of the runs creator's memory, or
+    // several runs are formed
+    const stxxl::uint64 sizes[] = { el_in_run * 3 / 2, 4 * 1024 * 1024 };
+
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        const stxxl::uint64 n = sizes[i];
+        STXXL_MSG("Sorting " << n << " elements with compressed runs");
+
+        stxxl::stats_data stats_begin(*stxxl::stats::get_instance());
+
+        random_stream input(n);
+        stxxl::stream::sort<random_stream, codec_cmp, block_size> sorted(input, codec_cmp(), memory_to_use);
+        check_sorted(sorted, n);
+
+        stxxl::stats_data stats_end(*stxxl::stats::get_instance());
+        const stxxl::int64 written = (stats_end - stats_begin).get_written_volume();
+        STXXL_MSG("wrote " << written << " bytes for " << n * sizeof(value_type) << " bytes of data");
+        STXXL_CHECK(written > 0);
+        STXXL_CHECK(stxxl::uint64(written) < n * sizeof(value_type) / 2);
+    }
+
+    {
+        const stxxl::uint64 n = 4 * 1024 * 1024;
+        STXXL_MSG("Sorting " << n << " elements with compressed runs without sentinels");
+
+        stxxl::sorter<value_type, plain_codec_cmp, block_size> s(plain_codec_cmp(), memory_to_use);
+        random_stream input(n);
+        for ( ; !input.empty(); ++input)
+            s.push(*input);
+        s.push(std::numeric_limits<value_type>::max());
+        s.push(std::numeric_limits<value_type>::min());
+        s.sort();
+
+        STXXL_CHECK(*s == std::numeric_limits<value_type>::min());
+        check_sorted(s, n + 2);
+
+        s.rewind();
+        check_sorted(s, n + 2);
+    }
+
+    {
+        const stxxl::uint64 n = 4 * 1024 * 1024;
+        STXXL_MSG("Sorting " << n << " elements of a vector with compressed runs");
+
+        typedef stxxl::VECTOR_GENERATOR<value_type, 4, 2, block_size>::result vector_type;
+        vector_type v(n);
+        // the sentinel min_value() must not be in the input
+        random_stream input(n);
+        for (vector_type::iterator it = v.begin(); !input.empty(); ++input, ++it)
+            *it = *input + 1;
+        v.flush();
+
+        stxxl::stats_data stats_begin(*stxxl::stats::get_instance());
+
+        stxxl::sort(v.begin(), v.end(), codec_cmp(), memory_to_use);
+
+        // the runs are written compressed, only the merged result is not
+        stxxl::stats_data stats_end(*stxxl::stats::get_instance());
+        const stxxl::int64 written = (stats_end - stats_begin).get_written_volume();
+        STXXL_MSG("wrote " << written << " bytes for " << n * sizeof(value_type) << " bytes of data");
+        STXXL_CHECK(stxxl::uint64(written) < n * sizeof(value_type) * 3 / 2);
+
+        vector_type::bufreader_type reader(v);
+        check_sorted(reader, n);
+    }
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
@@ -11,6 +11,7 @@
  *  http://www.boost.org/LICENSE_1_0.txt)
  **************************************************************************/
 
+#include <algorithm>
 #include <vector>
 #include <stxxl/stream>
 #include <stxxl/vector>
@@ -46,6 +47,65 @@ struct forty_two
     }
 };
 
+//! forty_two supporting the batch protocol
+struct forty_two_batch : public forty_two
+{
+    typedef int value_type;
+    typedef stxxl::stream::batch_fill_tag batch_category;
+
+    forty_two_batch(unsigned l) : forty_two(l) { }
+
+    stxxl::unsigned_type fill(int* out, stxxl::unsigned_type n)
+    {
+        stxxl::unsigned_type i = 0;
+        for ( ; i < n && !empty(); ++i, ++counter)
+            out[i] = counter;
+        return i;
+    }
+
+    forty_two_batch & reset()
+    {
+        counter = 0;
+        return *this;
+    }
+};
+
+struct plus_one
+{
+    typedef int value_type;
+
+    int operator () (int x) const
+    {
+        return x + 1;
+    }
+};
+
+//! plus_one counting its calls
+struct counting_plus_one
+{
+    typedef int value_type;
+
+    unsigned calls;
+
+    counting_plus_one() : calls(0) { }
+
+    int operator () (int x)
+    {
+        ++calls;
+        return x + 1;
+    }
+};
+
+struct add_pair
+{
+    typedef int value_type;
+
+    int operator () (const stxxl::tuple<int, int>& t) const
+    {
+        return t.first + t.second;
+    }
+};
+
 /*
     template <class OutputIterator_, class StreamAlgorithm_>
     OutputIterator_ materialize(StreamAlgorithm_ & in, OutputIterator_ out);
@@ -149,4 +209,135 @@ int main()
         stxxl::stream::materialize(_42mill.reset(), v.begin(), v.end(), 42);
         check_42_fill(v, _42mill.len());
     }
+    {
+        STXXL_CHECK(stxxl::stream::is_batch_stream<forty_two_batch>::value);
+        STXXL_CHECK(!stxxl::stream::is_batch_stream<forty_two>::value);
+
+        forty_two_batch _42mill(42 * 1000000);
+
+        // materialize batch stream into std and stxxl vectors
+        std::vector<int> w(50 * 1000000);
+        stxxl::stream::materialize(_42mill.reset(), w.begin());
+        check_42_fill(w, _42mill.len());
+
+        stxxl::VECTOR_GENERATOR<int>::result v(60 * 1000000);
+        stxxl::generate(v.begin(), v.end(), generate_0, 42);
+
+        stxxl::stream::materialize(_42mill.reset(), v.begin() + 3);
+        STXXL_CHECK(v[2] == 0 && v[3] == 0 && v[42 * 1000000 + 2] == 42 * 1000000 - 1);
+        std::fill(v.begin(), v.end(), 0);
+
+        stxxl::stream::materialize(_42mill.reset(), v.begin(), v.end());
+        check_42_fill(v, _42mill.len());
+
+        STXXL_CHECK(stxxl::stream::materialize(_42mill.reset(), v.begin(), v.begin() + 1000) == v.begin() + 1000);
+        check_42_fill(v, 1000);
+
+        // batches pulled through transform
+        plus_one op;
+        typedef stxxl::stream::transform<plus_one, forty_two_batch> transform_type;
+        transform_type t(op, _42mill.reset());
+        STXXL_CHECK(stxxl::stream::is_batch_stream<transform_type>::value);
+        std::vector<int> buffer(1000);
+        STXXL_CHECK(stxxl::stream::pull_batch(t, &buffer[0], 1) == 1 && buffer[0] == 1);
+        ++t;
+        STXXL_CHECK(*t == 3);
+        STXXL_CHECK(stxxl::stream::pull_batch(t, &buffer[0], 1000) == 1000);
+        for (int i = 0; i < 1000; ++i)
+            STXXL_CHECK(buffer[i] == i + 3);
+        stxxl::stream::materialize(t, w.begin());
+        STXXL_CHECK(w[0] == 1003 && w[42 * 1000000 - 1003] == 42 * 1000000);
+    }
+    {
+        typedef stxxl::VECTOR_GENERATOR<int>::result vector_type;
+        const int n = 5 * 1000000;
+
+        vector_type v(n);
+        for (int i = 0; i < n; ++i)
+            v[i] = i;
+
+        // spans of vector streams through transform and make_tuple
+        typedef stxxl::stream::streamify_traits<vector_type::iterator>::stream_type input_type;
+        typedef stxxl::stream::transform<plus_one, input_type> transform_type;
+        typedef stxxl::stream::make_tuple<input_type, transform_type> tuple_type;
+        typedef stxxl::stream::transform<add_pair, tuple_type> sum_type;
+
+        STXXL_CHECK(stxxl::stream::is_span_stream<input_type>::value);
+        STXXL_CHECK(stxxl::stream::is_span_stream<transform_type>::value);
+        STXXL_CHECK(stxxl::stream::is_span_stream<tuple_type>::value);
+        STXXL_CHECK(stxxl::stream::is_span_stream<sum_type>::value);
+        STXXL_CHECK(stxxl::stream::is_span_stream<stxxl::stream::iterator2stream<int*> >::value);
+        STXXL_CHECK(!stxxl::stream::is_batch_stream<stxxl::stream::iterator2stream<std::vector<int>::iterator> >::value);
+
+        input_type in1 = stxxl::stream::streamify(v.begin() + 3, v.end() - 5);
+        input_type in2 = stxxl::stream::streamify(v.begin() + 3, v.end() - 5);
+        plus_one inc;
+        transform_type incremented(inc, in2);
+        tuple_type tuples(in1, incremented);
+        add_pair add;
+        sum_type sums(add, tuples);
+
+        // mix scalar and span access
+        STXXL_CHECK(*sums == 7);
+        ++sums;
+        stxxl::unsigned_type length;
+        const int* span = sums.peek_batch(length);
+        STXXL_CHECK(length > 10 && span[0] == 9 && span[1] == 11);
+        sums.consume(2);
+        STXXL_CHECK(*sums == 13);
+        ++sums;
+        STXXL_CHECK(*sums == 15);
+
+        vector_type w(n);
+        vector_type::iterator end = stxxl::stream::materialize(sums, w.begin() + 1);
+        STXXL_CHECK(end == w.begin() + 1 + (n - 12));
+        for (int i = 0; i < n - 12; ++i)
+            STXXL_CHECK(w[i + 1] == 2 * (i + 7) + 1);
+
+        // spans of pointers
+        std::vector<int> x(1000, 1);
+        stxxl::stream::iterator2stream<int*> xs(&x[0], &x[0] + x.size());
+        std::vector<int> y(1000, 0);
+        STXXL_CHECK(stxxl::stream::materialize(xs, y.begin()) == y.end());
+        STXXL_CHECK(y == x && xs.empty());
+
+        // the operation is applied once per element, whichever access is used
+        typedef stxxl::stream::iterator2stream<int*> pointer_stream_type;
+        pointer_stream_type zs(&x[0], &x[0] + x.size());
+        counting_plus_one counter;
+        stxxl::stream::transform<counting_plus_one, pointer_stream_type> counted(counter, zs);
+        STXXL_CHECK(*counted == 2);
+        ++counted;
+        span = counted.peek_batch(length);
+        STXXL_CHECK(length == x.size() - 1 && span[0] == 2);
+        counted.consume(3);
+        STXXL_CHECK(*counted == 2);
+        ++counted;
+        counted.consume(length - 5);
+        span = counted.peek_batch(length);
+        STXXL_CHECK(length == 1 && span[0] == 2);
+        std::vector<int> z(1, 0);
+        STXXL_CHECK(stxxl::stream::materialize(counted, z.begin()) == z.end());
+        STXXL_CHECK(z[0] == 2 && counted.empty());
+        STXXL_CHECK(counter.calls == x.size());
+
+        // also when results of peek_batch() are moved out by fill()
+        counter.calls = 0;
+        pointer_stream_type fs(&x[0], &x[0] + x.size());
+        stxxl::stream::transform<counting_plus_one, pointer_stream_type> filled(counter, fs);
+        std::vector<int> f(x.size(), 0);
+        span = filled.peek_batch(length);
+        STXXL_CHECK(length == x.size() && span[0] == 2);
+        filled.consume(10);
+        STXXL_CHECK(filled.fill(&f[0], 5) == 5);
+        span = filled.peek_batch(length);
+        STXXL_CHECK(length == x.size() - 15);
+        STXXL_CHECK(filled.fill(&f[5], 100) == 100);
+        STXXL_CHECK(*filled == 2);
+        ++filled;
+        STXXL_CHECK(filled.fill(&f[105], x.size()) == x.size() - 116);
+        STXXL_CHECK(filled.empty());
+        STXXL_CHECK(std::count(f.begin(), f.begin() + x.size() - 11, 2) == int(x.size() - 11));
+        STXXL_CHECK(counter.calls == x.size());
+    }
 }
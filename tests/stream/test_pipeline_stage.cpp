@@ -0,0 +1,177 @@
+/***************************************************************************
+ *  tests/stream/test_pipeline_stage.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+//! \example stream/test_pipeline_stage.cpp
+//! This is an example of how to overlap two sorts of a stream pipeline with
+//! \c stream::pipeline_stage: the merger of the first sort runs in a thread
+//! of its own while the second sort forms its runs.
+
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <stxxl/stream>
+
+typedef unsigned value_type;
+
+struct Cmp : public std::less<value_type>
+{
+    value_type min_value() const
+    {
+        return std::numeric_limits<value_type>::min();
+    }
+    value_type max_value() const
+    {
+        return std::numeric_limits<value_type>::max();
+    }
+};
+
+//! stream of random numbers of given length
+struct random_stream
+{
+    typedef unsigned value_type;
+
+    stxxl::random_number32 rnd;
+    stxxl::uint64 remaining;
+    value_type current;
+
+    random_stream(stxxl::uint64 length) : remaining(length), current(rnd()) { }
+
+    bool empty() const { return remaining == 0; }
+
+    const value_type& operator * () const { return current; }
+
+    random_stream& operator ++ ()
+    {
+        --remaining;
+        current = rnd();
+        return *this;
+    }
+};
+
+//! stream which throws after a given number of elements
+struct failing_stream : public random_stream
+{
+    stxxl::uint64 fail_after;
+
+    failing_stream(stxxl::uint64 length, stxxl::uint64 fail_after)
+        : random_stream(length), fail_after(fail_after) { }
+
+    failing_stream& operator ++ ()
+    {
+        if (--fail_after == 0)
+            throw std::runtime_error("input failed");
+        random_stream::operator ++ ();
+        return *this;
+    }
+};
+
+//! reverses the order
+struct complement
+{
+    typedef unsigned value_type;
+
+    value_type operator () (value_type x) const
+    {
+        return ~x;
+    }
+};
+
+int main()
+{
+    const stxxl::unsigned_type memory_to_use = 16 * 1024 * 1024;
+    const stxxl::uint64 n = 32 * 1024 * 1024 / sizeof(value_type);
+
+    typedef stxxl::stream::sort<random_stream, Cmp, 64* 1024> sort1_type;
+    typedef stxxl::stream::pipeline_stage<sort1_type> stage_type;
+    typedef stxxl::stream::transform<complement, stage_type> transform_type;
+    typedef stxxl::stream::sort<transform_type, Cmp, 64* 1024> sort2_type;
+
+    {
+        STXXL_MSG("Sorting " << n << " elements twice, overlapping the two sorts");
+
+        random_stream input(n);
+        sort1_type sort1(input, Cmp(), memory_to_use);
+        stage_type stage(sort1, 64 * 1024);
+        complement op;
+        transform_type complemented(op, stage);
+        sort2_type sort2(complemented, Cmp(), memory_to_use);
+
+        stxxl::uint64 count = 0;
+        value_type prev = 0;
+        for ( ; !sort2.empty(); ++sort2, ++count)
+        {
+            STXXL_CHECK(prev <= *sort2);
+            prev = *sort2;
+        }
+        STXXL_CHECK(count == n);
+    }
+    {
+        // batch pulls and short batches at the end
+        random_stream input(1000 * 1000 + 7);
+        stxxl::stream::pipeline_stage<random_stream> stage(input, 1000, 2);
+
+        std::vector<value_type> buffer(300 * 1000);
+        stxxl::uint64 count = 0;
+        while (stxxl::unsigned_type k = stxxl::stream::pull_batch(stage, &buffer[0], buffer.size()))
+            count += k;
+        STXXL_CHECK(count == 1000 * 1000 + 7);
+        STXXL_CHECK(stage.empty());
+    }
+    {
+        // empty input and early destruction
+        random_stream empty_input(0);
+        stxxl::stream::pipeline_stage<random_stream> empty_stage(empty_input, 1000);
+        STXXL_CHECK(empty_stage.empty());
+
+        random_stream input(1000 * 1000);
+        stxxl::stream::pipeline_stage<random_stream> stage(input, 1000);
+        for (unsigned i = 0; i < 5000; ++i)
+            ++stage;
+        STXXL_CHECK(!stage.empty());
+    }
+    {
+        // exceptions of the input reach the consumer after the complete
+        // blocks pulled before
+        failing_stream input(1000 * 1000, 2500);
+        stxxl::stream::pipeline_stage<failing_stream> stage(input, 1000, 2);
+
+        stxxl::uint64 count = 0;
+        bool caught = false;
+        try
+        {
+            for ( ; !stage.empty(); ++stage)
+                ++count;
+        }
+        catch (std::runtime_error& e)
+        {
+            caught = true;
+            STXXL_CHECK(std::string(e.what()) == "input failed");
+        }
+        STXXL_CHECK(caught);
+        STXXL_CHECK(count == 2000);
+
+        // and again on every access
+        caught = false;
+        try
+        {
+            std::vector<value_type> buffer(100);
+            stxxl::stream::pull_batch(stage, &buffer[0], buffer.size());
+        }
+        catch (std::runtime_error&)
+        {
+            caught = true;
+        }
+        STXXL_CHECK(caught);
+    }
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
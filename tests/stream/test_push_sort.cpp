@@ -42,23 +42,42 @@ struct Cmp : public std::binary_function<value_type, value_type, bool>
     }
 };
 
+// key extractor for sorting the runs by radix sort
+struct KeyExtractor
+{
+    typedef unsigned key_type;
+    key_type operator () (const value_type& v) const
+    {
+        return v;
+    }
+    value_type min_value() const
+    {
+        return std::numeric_limits<value_type>::min();
+    }
+    value_type max_value() const
+    {
+        return std::numeric_limits<value_type>::max();
+    }
+};
+
+typedef stxxl::radix_key_cmp<value_type, KeyExtractor> RadixCmp;
+
 // special parameter type
 typedef stxxl::stream::use_push<value_type> InputType;
-typedef stxxl::stream::runs_creator<InputType, Cmp, 4096, stxxl::RC> CreateRunsAlg;
-typedef CreateRunsAlg::sorted_runs_type SortedRunsType;
 
 // forced instantiation
-template class stxxl::stream::runs_merger<SortedRunsType, Cmp>;
+template class stxxl::stream::runs_merger<
+        stxxl::stream::runs_creator<InputType, Cmp, 4096, stxxl::RC>::sorted_runs_type, Cmp>;
 
-int main()
+template <typename CompareType>
+void test_push_sort()
 {
-#if STXXL_PARALLEL_MULTIWAY_MERGE
-    STXXL_MSG("STXXL_PARALLEL_MULTIWAY_MERGE");
-#endif
+    typedef stxxl::stream::runs_creator<InputType, CompareType, 4096, stxxl::RC> CreateRunsAlg;
+    typedef typename CreateRunsAlg::sorted_runs_type SortedRunsType;
 
     unsigned input_size = (50 * megabyte / sizeof(value_type));
 
-    Cmp c;
+    CompareType c;
     CreateRunsAlg SortedRuns(c, 10 * megabyte);
     value_type checksum_before(0);
 
@@ -72,10 +91,10 @@ int main()
     }
 
     SortedRunsType Runs = SortedRuns.result();  // get sorted_runs data structure
-    STXXL_CHECK(stxxl::stream::check_sorted_runs(Runs, Cmp()));
+    STXXL_CHECK(stxxl::stream::check_sorted_runs(Runs, CompareType()));
 
     // merge the runs
-    stxxl::stream::runs_merger<SortedRunsType, Cmp> merger(Runs, Cmp(), 10 * megabyte);
+    stxxl::stream::runs_merger<SortedRunsType, CompareType> merger(Runs, CompareType(), 10 * megabyte);
     stxxl::vector<value_type, 4, stxxl::lru_pager<8>, block_size, STXXL_DEFAULT_ALLOC_STRATEGY> array;
     STXXL_MSG(input_size << " " << Runs->elements);
     STXXL_MSG("checksum before: " << checksum_before);
@@ -87,9 +106,32 @@ int main()
         ++merger;
     }
     STXXL_MSG("checksum after:  " << checksum_after);
-    STXXL_CHECK(stxxl::is_sorted(array.begin(), array.end(), Cmp()));
+    STXXL_CHECK(stxxl::is_sorted(array.begin(), array.end(), CompareType()));
     STXXL_CHECK(checksum_before == checksum_after);
     STXXL_CHECK(merger.empty());
+}
+
+int main()
+{
+#if STXXL_PARALLEL_MULTIWAY_MERGE
+    STXXL_MSG("STXXL_PARALLEL_MULTIWAY_MERGE");
+#endif
+
+    test_push_sort<Cmp>();
+    test_push_sort<RadixCmp>();
+
+    // the copy of radix sort is accounted for only where it is used: for
+    // runs of blocks without padding, which are plain arrays
+    typedef stxxl::typed_block<4096, value_type> block_type;
+    typedef stxxl::element_iterator_traits<block_type, stxxl::uint64>::element_iterator element_iterator;
+    STXXL_CHECK((stxxl::sort_helper::memory_usage_factor<element_iterator>(RadixCmp()) == 2));
+    STXXL_CHECK((stxxl::sort_helper::memory_usage_factor<element_iterator>(Cmp()) ==
+                 stxxl::sort_memory_usage_factor()));
+
+    typedef stxxl::typed_block<4096, value_type, 0, int> padded_block_type;
+    typedef stxxl::element_iterator_traits<padded_block_type, stxxl::uint64>::element_iterator padded_iterator;
+    STXXL_CHECK((stxxl::sort_helper::memory_usage_factor<padded_iterator>(RadixCmp()) ==
+                 stxxl::sort_memory_usage_factor()));
 
     return 0;
 }
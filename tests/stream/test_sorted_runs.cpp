@@ -97,5 +97,44 @@ int main()
     STXXL_CHECK(checksum_before == checksum_after);
     STXXL_CHECK(merger.empty());
 
+    {
+        // merge again, pulling batches of random size
+        CreateRunsAlg SortedRuns2(c, 10 * megabyte);
+        for (unsigned cnt = input_size; cnt > 0; )
+        {
+            unsigned run_size = rnd_max(cnt) + 1;
+            cnt -= run_size;
+
+            std::vector<unsigned> tmp(run_size);
+            std::generate(tmp.begin(), tmp.end(), rnd _STXXL_FORCE_SEQUENTIAL);
+            std::sort(tmp.begin(), tmp.end(), c);
+            for (unsigned j = 0; j < run_size; ++j)
+                SortedRuns2.push(tmp[j]);
+            SortedRuns2.finish();
+        }
+
+        stxxl::stream::runs_merger<SortedRunsType, Cmp> merger2(SortedRuns2.result(), Cmp(), 10 * megabyte);
+
+        std::vector<value_type> output(input_size + 1);
+        value_type* out = &output[0];
+        while (!merger2.empty())
+        {
+            unsigned n = rnd_max(4 * 1024 * 1024);
+            if (n % 3 == 0) {
+                *out++ = *merger2;
+                ++merger2;
+            }
+            else {
+                stxxl::unsigned_type k = merger2.fill(out, n);
+                STXXL_CHECK(k == n || merger2.empty());
+                out += k;
+            }
+        }
+
+        STXXL_CHECK(out == &output[0] + input_size);
+        STXXL_CHECK(merger2.fill(out, 1) == 0);
+        STXXL_CHECK(stxxl::is_sorted(output.begin(), output.end() - 1, Cmp()));
+    }
+
     return 0;
 }
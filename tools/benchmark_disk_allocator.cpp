@@ -0,0 +1,143 @@
+/***************************************************************************
+ *  tools/benchmark_disk_allocator.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+static const char* description =
+    "Benchmark the free space management of the disk allocator. A sparse "
+    "file is filled with single blocks, then every other block is freed to "
+    "fragment the free space, and finally blocks are allocated into the "
+    "holes one at a time, and in runs which do not fit into a hole. "
+    "The time per allocated or freed block is reported for each phase. "
+    "No data is transferred to the file.";
+
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <stxxl/io>
+#include <stxxl/mng>
+#include <stxxl/timer>
+#include <stxxl/cmdline>
+#include <stxxl/bits/mng/disk_allocator.h>
+
+using stxxl::uint64;
+
+static const unsigned block_size = 64 * 1024;
+typedef stxxl::BID<block_size> bid_type;
+
+static void print_phase(const char* name, double seconds, uint64 blocks)
+{
+    std::cout << std::setw(24) << std::left << name << std::right
+              << std::setw(10) << blocks << " blocks "
+              << std::setw(10) << std::fixed << std::setprecision(3)
+              << seconds << " s "
+              << std::setw(10) << std::setprecision(3)
+              << (blocks ? seconds * 1e6 / double(blocks) : 0.0)
+              << " us/block" << std::endl;
+}
+
+int benchmark_disk_allocator(int argc, char* argv[])
+{
+    // parse command line
+    stxxl::cmdline_parser cp;
+
+    cp.set_description(description);
+
+    std::string filename;
+    cp.add_param_string("filename", filename,
+                        "Path of the (sparse) file to manage");
+
+    unsigned num_blocks = 256 * 1024;
+    cp.add_uint('n', "blocks", num_blocks,
+                "Number of blocks to allocate initially (default 262144)");
+
+    unsigned run_length = 4;
+    cp.add_uint('r', "run", run_length,
+                "Number of blocks allocated together in the run phase "
+                "(default 4)");
+
+    if (!cp.process(argc, argv))
+        return -1;
+
+    if (run_length < 2)
+        run_length = 2;
+
+    stxxl::file* file = stxxl::create_file(
+        "syscall", filename, stxxl::file::CREAT | stxxl::file::RDWR);
+
+    // leave room behind the initially filled blocks for the runs
+    stxxl::disk_config cfg(filename, 2 * uint64(num_blocks) * block_size, "syscall");
+    cfg.autogrow = true;
+
+    std::cout << "# Block size " << block_size << " bytes, "
+              << num_blocks << " blocks initially" << std::endl;
+
+    {
+        stxxl::disk_allocator alloc(file, cfg);
+        std::vector<bid_type> bids(num_blocks);
+        stxxl::timer timer;
+
+        // allocate single blocks, they are placed consecutively
+        timer.start();
+        for (unsigned i = 0; i < num_blocks; ++i)
+        {
+            bids[i].storage = file;
+            alloc.new_blocks(&bids[i], &bids[i] + 1);
+        }
+        timer.stop();
+        print_phase("fill", timer.seconds(), num_blocks);
+
+        // free every other block: num_blocks / 2 holes of one block each
+        timer.reset();
+        timer.start();
+        for (unsigned i = 0; i < num_blocks; i += 2)
+            alloc.delete_block(bids[i]);
+        timer.stop();
+        print_phase("fragment", timer.seconds(), (num_blocks + 1) / 2);
+
+        // allocate runs that do not fit into any hole
+        const unsigned num_runs = num_blocks / 2 / run_length;
+        std::vector<bid_type> runs(num_runs * run_length);
+        for (unsigned i = 0; i < runs.size(); ++i)
+            runs[i].storage = file;
+
+        timer.reset();
+        timer.start();
+        for (unsigned i = 0; i < num_runs; ++i)
+            alloc.new_blocks(&runs[i * run_length], &runs[(i + 1) * run_length]);
+        timer.stop();
+        print_phase("runs in fragmented", timer.seconds(), runs.size());
+
+        // allocate single blocks into the holes
+        timer.reset();
+        timer.start();
+        for (unsigned i = 0; i < num_blocks; i += 2)
+            alloc.new_blocks(&bids[i], &bids[i] + 1);
+        timer.stop();
+        print_phase("fill holes", timer.seconds(), (num_blocks + 1) / 2);
+
+        // free everything
+        timer.reset();
+        timer.start();
+        for (unsigned i = 0; i < num_blocks; ++i)
+            alloc.delete_block(bids[i]);
+        for (unsigned i = 0; i < runs.size(); ++i)
+            alloc.delete_block(runs[i]);
+        timer.stop();
+        print_phase("free all", timer.seconds(), num_blocks + runs.size());
+
+        STXXL_CHECK(alloc.get_used_bytes() == 0);
+    }
+
+    file->close_remove();
+    delete file;
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
@@ -0,0 +1,198 @@
+/***************************************************************************
+ *  tools/benchmark_latency.cpp
+ *
+ *  Part of the STXXL. See http://stxxl.sourceforge.net
+ *
+ *  Distributed under the Boost Software License, Version 1.0.
+ *  (See accompanying file LICENSE_1_0.txt or copy at
+ *  http://www.boost.org/LICENSE_1_0.txt)
+ **************************************************************************/
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <stxxl/io>
+#include <stxxl/aligned_alloc>
+#include <stxxl/bits/common/cmdline.h>
+#include <stxxl/bits/common/rand.h>
+
+using stxxl::file;
+using stxxl::request_ptr;
+using stxxl::uint64;
+using stxxl::unsigned_type;
+
+#if STXXL_WINDOWS
+static const char* default_file_type = "wincall";
+#else
+static const char* default_file_type = "syscall";
+#endif
+
+//! posts a read or write of a random block
+static request_ptr post_random(file* f, char* buffer, uint64 num_blocks,
+                               unsigned_type block_size, unsigned write_percent)
+{
+    static stxxl::random_number64 rnd;
+    static stxxl::random_number32 rnd_op;
+
+    const uint64 offset = rnd(num_blocks) * block_size;
+    if (rnd_op(100) < write_percent)
+        return f->awrite(buffer, offset, block_size);
+    else
+        return f->aread(buffer, offset, block_size);
+}
+
+int benchmark_latency(int argc, char* argv[])
+{
+    uint64 span = 0, volume = 0;
+    unsigned_type block_size = 0;
+    unsigned int depth = 16;
+    unsigned int write_percent = 30;
+    std::string file_type = default_file_type;
+    bool json = false;
+
+    std::vector<std::string> files_arr;
+
+    stxxl::cmdline_parser cp;
+
+    cp.add_param_bytes("span", span,
+                       "Span of each file to access randomly (e.g. 1GiB).");
+
+    cp.add_param_stringlist("filename", files_arr,
+                            "File paths to run benchmark on.");
+
+    cp.add_bytes('s', "size", volume,
+                 "Amount of data to access per file, default: the span.");
+
+    cp.add_bytes('b', "block_size", block_size,
+                 "Block size of the requests (default 1 MiB).");
+
+    cp.add_uint('q', "depth", depth,
+                "Number of outstanding requests per file (default 16).");
+
+    cp.add_uint('w', "write_percent", write_percent,
+                "Percentage of writes among the requests (default 30).");
+
+    cp.add_string('f', "file-type", file_type,
+                  "Method to open files (syscall|mmap|linuxaio|...[ queue_length=n]) "
+                  "default: " + file_type);
+
+    cp.add_flag('j', "json", json,
+                "Print the statistics as JSON object.");
+
+    cp.set_description(
+        "Fill files sequentially, then access random blocks of them keeping "
+        "a number of requests outstanding, and print per-disk latency "
+        "histograms, queue depths and wait times from the detailed I/O "
+        "statistics.");
+
+    if (!cp.process(argc, argv))
+        return -1;
+
+    if (block_size == 0)
+        block_size = 1024 * 1024;
+    if (depth == 0)
+        depth = 1;
+
+    const uint64 num_blocks = span / block_size;
+    if (num_blocks == 0) {
+        STXXL_ERRMSG("The span must hold one block at least.");
+        return -1;
+    }
+    const uint64 num_requests =
+        std::max<uint64>(1, (volume ? volume : span) / block_size);
+
+    const size_t num_files = files_arr.size();
+    std::vector<file*> files(num_files);
+    for (size_t i = 0; i < num_files; ++i)
+    {
+        files[i] = stxxl::create_file(
+            file_type, files_arr[i],
+            file::CREAT | file::RDWR | file::DIRECT, (int)i);
+        files[i]->set_size(num_blocks * block_size);
+    }
+
+    char* buffer = (char*)stxxl::aligned_alloc<STXXL_BLOCK_ALIGN>(
+        block_size * depth * num_files);
+    memset(buffer, 0x5a, block_size * depth * num_files);
+    std::vector<request_ptr> reqs(depth * num_files);
+
+    stxxl::stats* stats = stxxl::stats::get_instance();
+
+    // fill sequentially
+    for (uint64 b = 0; b < num_blocks; b += depth)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < num_files; ++i)
+            for (uint64 j = b; j < std::min(b + depth, num_blocks); ++j, ++n)
+                reqs[n] = files[i]->awrite(buffer + n * block_size, j * block_size, block_size);
+        stxxl::wait_all(reqs.begin(), reqs.begin() + n);
+    }
+
+    stats->set_detailed(true);
+    stxxl::stats_data stats_begin(*stats);
+
+    // access random blocks, replacing each completed request by a new one
+    std::vector<uint64> issued(num_files, 0);
+    // buffer slot of each outstanding request, file i owns the slots
+    // [i * depth, (i + 1) * depth)
+    std::vector<size_t> slots(depth * num_files);
+    size_t active = 0;
+
+    for (size_t i = 0; i < num_files; ++i)
+    {
+        for (unsigned j = 0; j < depth && issued[i] < num_requests; ++j, ++issued[i])
+        {
+            slots[active] = i * depth + j;
+            reqs[active] = post_random(files[i], buffer + slots[active] * block_size,
+                                       num_blocks, block_size, write_percent);
+            ++active;
+        }
+    }
+
+    {
+        stxxl::stats::scoped_wait_site wait_site("benchmark_latency");
+
+        while (active > 0)
+        {
+            const size_t k = stxxl::wait_any(reqs.begin(), reqs.begin() + active) - reqs.begin();
+            const size_t i = slots[k] / depth;
+            if (issued[i] < num_requests) {
+                ++issued[i];
+                reqs[k] = post_random(files[i], buffer + slots[k] * block_size,
+                                      num_blocks, block_size, write_percent);
+            }
+            else {
+                // no more requests for this file
+                --active;
+                reqs[k] = reqs[active];
+                slots[k] = slots[active];
+                reqs[active] = request_ptr();
+            }
+        }
+    }
+
+    stxxl::stats_data result = stxxl::stats_data(*stats) - stats_begin;
+    stats->set_detailed(false);
+
+    if (json) {
+        result.print_json(std::cout);
+        std::cout << std::endl;
+    }
+    else {
+        std::cout << result;
+    }
+
+    stxxl::aligned_dealloc<STXXL_BLOCK_ALIGN>(buffer);
+
+    for (size_t i = 0; i < num_files; ++i)
+    {
+        files[i]->close_remove();
+        delete files[i];
+    }
+
+    return 0;
+}
+
+// vim: et:ts=4:sw=4
@@ -49,6 +49,8 @@ extern int benchmark_files(int argc, char* argv[]);
 extern int benchmark_sort(int argc, char* argv[]);
 extern int benchmark_disks_random(int argc, char* argv[]);
 extern int benchmark_pqueue(int argc, char* argv[]);
+extern int benchmark_disk_allocator(int argc, char* argv[]);
+extern int benchmark_latency(int argc, char* argv[]);
 extern int do_mlock(int argc, char* argv[]);
 extern int do_mallinfo(int argc, char* argv[]);
 
@@ -91,6 +93,16 @@ struct SubTool subtools[] = {
         "benchmark_pqueue", &benchmark_pqueue, false,
         "Benchmark priority queue implementation using sequence of operations."
     },
+    {
+        "benchmark_disk_allocator", &benchmark_disk_allocator, false,
+        "Benchmark free space management of the disk allocator under "
+        "fragmentation."
+    },
+    {
+        "benchmark_latency", &benchmark_latency, false,
+        "Benchmark random block access on files and print latency "
+        "histograms and queue depths of the detailed I/O statistics."
+    },
     {
         "mlock", &do_mlock, true,
         "Lock physical memory."